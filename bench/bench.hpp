@@ -0,0 +1,58 @@
+#ifndef _BENCH_H_INCLUDED_
+#define _BENCH_H_INCLUDED_
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace my
+{
+    // 基准测试程序共用的计时函数
+    namespace bench
+    {
+        using Clock = ::std::chrono::steady_clock; // 计时使用的时钟
+
+        // 阻止编译器把 value 的计算当作无用代码删除
+        template <typename T>
+        inline void keep(const T &value)
+        {
+            asm volatile("" : : "g"(&value) : "memory");
+        }
+
+        // 获取从 start 到现在经过的秒数
+        inline double seconds_since(Clock::time_point start)
+        {
+            return ::std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        // 反复调用 fn，直到总时间不少于 min_time（先调用一批预热，不计入结果）
+        // 返回值: 每次调用的平均耗时（纳秒）
+        template <typename F>
+        double time_per_call(F &&fn, ::std::chrono::milliseconds min_time = ::std::chrono::milliseconds(300))
+        {
+            for (int i = 0; i < 1000; ++i) {
+                fn();
+            }
+            size_t calls = 0;
+            size_t batch = 1000;
+            Clock::time_point start = Clock::now();
+            while (Clock::now() - start < min_time) {
+                for (size_t i = 0; i < batch; ++i) {
+                    fn();
+                }
+                calls += batch;
+                batch *= 2;
+            }
+            return seconds_since(start) * 1e9 / calls;
+        }
+
+        // 读取第 index 个命令行参数作为数值，不存在时返回 fallback
+        inline long long arg_or(int argc, char *argv[], int index, long long fallback)
+        {
+            return index < argc ? ::std::atoll(argv[index]) : fallback;
+        }
+    } // namespace bench
+
+} // namespace my
+
+#endif // _BENCH_H_INCLUDED_
@@ -0,0 +1,122 @@
+#include "../include/CachePolicy.h"
+#include "../include/HttpCacheManager.h"
+#include "./bench.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr size_t URL_COUNT = 256; // 预先写入缓存的 URL 数
+
+    // 获取第 index 个 URL
+    ::std::string url_of(size_t index)
+    {
+        return ::std::format("http://bench.example.com/object/{}", index);
+    }
+
+    // 写入 URL_COUNT 个小响应并等待写入线程完成
+    void populate(::my::HttpCacheManager &cache)
+    {
+        ::my::Freshness freshness;
+        freshness.response_time = ::my::unix_now();
+        freshness.lifetime = 24 * 60 * 60;
+        for (size_t i = 0; i < URL_COUNT; ++i) {
+            ::my::HttpCacheManager::FillHandle fill = cache.create_cache(url_of(i));
+            ::std::string response = ::std::format("HTTP/1.1 200 OK\r\nETag: \"{}\"\r\nContent-Length: 4096\r\n\r\n", i);
+            response.append(4096, 'x');
+            cache.append_cache(fill, ::std::make_shared<const ::std::string>(::std::move(response)));
+            cache.commit_cache(fill, freshness);
+        }
+        for (size_t i = 0; i < URL_COUNT; ++i) {
+            while (!cache.has_cache(url_of(i))) {
+                ::std::this_thread::sleep_for(::std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    // threads 个线程同时调用 operation 一段时间，operation 的参数为线程编号和调用序号
+    // 返回值: 所有线程每秒完成的调用次数
+    double run_threads(int threads, const ::std::function<void(int, size_t)> &operation)
+    {
+        constexpr auto DURATION = ::std::chrono::milliseconds(300);
+        ::std::atomic<size_t> total = 0;
+        ::std::atomic_bool start = false;
+        ::std::vector<::std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                while (!start) {
+                    ::std::this_thread::yield();
+                }
+                size_t calls = 0;
+                ::my::bench::Clock::time_point begin = ::my::bench::Clock::now();
+                while (::my::bench::Clock::now() - begin < DURATION) {
+                    for (int i = 0; i < 64; ++i) {
+                        operation(t, calls++);
+                    }
+                }
+                total += calls;
+            });
+        }
+        ::my::bench::Clock::time_point begin = ::my::bench::Clock::now();
+        start = true;
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        return total / ::my::bench::seconds_since(begin);
+    }
+} // namespace
+
+// 缓存管理器的锁竞争：多个线程同时查询缓存的元数据或从内存层取出缓存
+// 每种操作分别测试各线程访问不同的 URL（分散到各分片和条目）和所有线程访问同一个 URL（竞争同一个条目锁）
+// 用法: cache_bench [最多线程数 = 8]
+int main(int argc, char *argv[])
+{
+    int max_threads = static_cast<int>(::my::bench::arg_or(argc, argv, 1, 8));
+    ::std::filesystem::path dir = ::std::filesystem::temp_directory_path() / "cache_bench";
+    ::std::filesystem::remove_all(dir);
+    ::std::filesystem::create_directories(dir);
+    {
+        ::my::HttpCacheManager cache(dir.string());
+        populate(cache);
+        ::std::vector<::std::string> urls;
+        for (size_t i = 0; i < URL_COUNT; ++i) {
+            urls.push_back(url_of(i));
+        }
+
+        // 各线程访问不同的 URL 时，第 t 个线程依次访问下标为 t, t + threads, ... 的 URL
+        auto distinct = [&urls](int threads, int t, size_t call) -> const ::std::string & {
+            return urls[(t + call * threads) % URL_COUNT];
+        };
+        struct Operation {
+            const char *name;                                          // 操作名称
+            ::std::function<void(const ::std::string &url)> operation; // 对一个 URL 的操作
+        };
+        Operation operations[] = {
+            {"get_validators + get_freshness", [&cache](const ::std::string &url) {
+                 ::my::bench::keep(cache.get_validators(url));
+                 ::my::bench::keep(cache.get_freshness(url));
+             }},
+            {"get_memory_cache", [&cache](const ::std::string &url) { ::my::bench::keep(cache.get_memory_cache(url)); }},
+        };
+
+        ::std::printf("%-32s %8s %16s %16s\n", "operation", "threads", "distinct (op/s)", "same URL (op/s)");
+        for (const Operation &op : operations) {
+            for (int threads = 1; threads <= max_threads; threads *= 2) {
+                double spread = run_threads(threads, [&](int t, size_t call) { op.operation(distinct(threads, t, call)); });
+                double same = run_threads(threads, [&](int, size_t) { op.operation(urls[0]); });
+                ::std::printf("%-32s %8d %16.0f %16.0f\n", op.name, threads, spread, same);
+            }
+        }
+    }
+    ::std::filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "../include/HttpRequest.h"
+#include "../include/HttpRequestParser.h"
+#include "./bench.hpp"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace
+{
+    // 典型的浏览器请求（742 字节，17 个头部字段）
+    const ::std::string REQUEST = "GET http://www.example.com/static/js/app.min.js?v=20240601 HTTP/1.1\r\n"
+                                  "Host: www.example.com\r\n"
+                                  "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+                                  "Accept: */*\r\n"
+                                  "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8,en-GB;q=0.7,en-US;q=0.6\r\n"
+                                  "Accept-Encoding: gzip, deflate, br\r\n"
+                                  "Referer: http://www.example.com/index.html\r\n"
+                                  "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark; lang=zh-CN; _ga=GA1.2.123456789.1700000000\r\n"
+                                  "Proxy-Connection: keep-alive\r\n"
+                                  "Cache-Control: max-age=0\r\n"
+                                  "If-None-Match: \"5f3c-1a2b3c4d5e6f\"\r\n"
+                                  "If-Modified-Since: Sat, 01 Jun 2024 08:00:00 GMT\r\n"
+                                  "Sec-Fetch-Dest: script\r\n"
+                                  "Sec-Fetch-Mode: no-cors\r\n"
+                                  "Sec-Fetch-Site: same-origin\r\n"
+                                  "DNT: 1\r\n"
+                                  "Upgrade-Insecure-Requests: 1\r\n"
+                                  "\r\n";
+
+    // 改用 HttpRequestParser 之前的请求解析（基线）：用 strchr 逐行查找，每个字段复制到 std::map 中
+    // 从最初的 HttpRequest 构造函数复制而来，只用于对比
+    struct BaselineRequest {
+        ::std::string method;                             // HTTP 方法
+        ::std::string url;                                // 请求的 URL
+        ::std::string version;                            // HTTP 版本
+        ::std::map<::std::string, ::std::string> headers; // 请求头部字段
+        ::std::string body;                               // 请求体
+
+        // 构造函数，从原始 HTTP 数据初始化，http_data 必须以 '\0' 结尾
+        BaselineRequest(const char *http_data, int size)
+        {
+            const char *line_start = http_data;
+            const char *line_end;
+            while (!isspace(*line_start)) {
+                line_end = strchr(line_start, '\n');
+                ::std::string_view line(line_start, line_end - line_start - 1);
+                if (line.empty()) {
+                    break;
+                }
+                if (method.empty()) {
+                    ::std::string_view m = line.substr(0, line.find(' '));
+                    method = ::std::string(m);
+                    line.remove_prefix(m.size() + 1);
+                    ::std::string_view u = line.substr(0, line.find(' '));
+                    url = ::std::string(u);
+                    line.remove_prefix(u.size() + 1);
+                    version = ::std::string(line);
+                } else {
+                    ::std::string_view key = line.substr(0, line.find(':'));
+                    line.remove_prefix(key.size() + 2);
+                    headers[::std::string(key)] = ::std::string(line);
+                }
+                line_start = line_end + 1;
+            }
+            const char *body_start = line_start + 2;
+            body = ::std::string(body_start, size - (body_start - http_data));
+        }
+    };
+
+    // 输出一项结果
+    void report(const char *name, double ns)
+    {
+        ::std::printf("%-32s %9.1f ns/request %9.1f MB/s\n", name, ns, REQUEST.size() / ns * 1e3);
+    }
+} // namespace
+
+// 请求解析的耗时：一次收到整个请求、请求分成 piece 字节的多段到达（每段到达后继续解析），以及构造 HttpRequest
+// 最后与基线（原来的 strchr + std::map 解析）对比，两者都从完整请求的一份副本开始
+// 用法: parse_bench [分段大小 = 64]
+int main(int argc, char *argv[])
+{
+    size_t piece = static_cast<size_t>(::my::bench::arg_or(argc, argv, 1, 64));
+    ::std::printf("request: %zu bytes\n", REQUEST.size());
+
+    report("parse (whole request)", ::my::bench::time_per_call([]() {
+        ::my::HttpRequestParser parser;
+        ::my::bench::keep(parser.parse(REQUEST));
+    }));
+
+    report("parse (incremental)", ::my::bench::time_per_call([piece]() {
+        ::my::HttpRequestParser parser;
+        ::my::HttpRequestParser::Result result = ::my::HttpRequestParser::Result::NEED_MORE;
+        for (size_t size = piece; result == ::my::HttpRequestParser::Result::NEED_MORE; size += piece) {
+            result = parser.parse(::std::string_view(REQUEST).substr(0, size));
+        }
+        ::my::bench::keep(result);
+    }));
+
+    double current = ::my::bench::time_per_call([]() {
+        ::std::string buffer = REQUEST;
+        ::my::HttpRequestParser parser;
+        parser.parse(buffer);
+        ::my::HttpRequest request(parser, buffer);
+        ::my::bench::keep(request);
+    });
+    double baseline = ::my::bench::time_per_call([]() {
+        ::std::string buffer = REQUEST;
+        BaselineRequest request(buffer.c_str(), static_cast<int>(buffer.size()));
+        ::my::bench::keep(request);
+    });
+    report("parse + HttpRequest", current);
+    report("baseline (strchr + std::map)", baseline);
+    ::std::printf("%-32s %9.2fx\n", "speedup over baseline", baseline / current);
+    return 0;
+}
@@ -0,0 +1,277 @@
+#include "../include/HttpProxyServer.h"
+#include "../include/wsa_wapper.h"
+#include "./bench.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <windows.h>
+#include <winsock2.h>
+
+// 代理服务器的停止标志，定义在 HttpProxyServer.cpp 中
+extern ::std::atomic_bool keybord_interrupt;
+
+namespace
+{
+    // 创建监听 127.0.0.1 上指定端口的套接字，port 为 0 时由系统选择
+    // 返回值: 套接字，port 返回实际的端口
+    SOCKET listen_local(unsigned short &port)
+    {
+        SOCKET s = socket(AF_INET, SOCK_STREAM, 0);
+        SOCKADDR_IN addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        addr.sin_port = htons(port);
+        int len = sizeof(addr);
+        if (bind(s, reinterpret_cast<SOCKADDR *>(&addr), sizeof(addr)) == SOCKET_ERROR || listen(s, SOMAXCONN) == SOCKET_ERROR ||
+            getsockname(s, reinterpret_cast<SOCKADDR *>(&addr), &len) == SOCKET_ERROR) {
+            ::std::fprintf(stderr, "Failed to listen on 127.0.0.1:%u. Error code: %d\n", port, WSAGetLastError());
+            ::std::exit(1);
+        }
+        port = ntohs(addr.sin_port);
+        return s;
+    }
+
+    // 连接到 127.0.0.1 上的指定端口，失败时在 2 秒内重试（等待代理服务器开始监听）
+    SOCKET connect_local(unsigned short port)
+    {
+        SOCKADDR_IN addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        addr.sin_port = htons(port);
+        for (int attempt = 0; attempt < 200; ++attempt) {
+            SOCKET s = socket(AF_INET, SOCK_STREAM, 0);
+            if (connect(s, reinterpret_cast<SOCKADDR *>(&addr), sizeof(addr)) != SOCKET_ERROR) {
+                return s;
+            }
+            closesocket(s);
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(10));
+        }
+        ::std::fprintf(stderr, "Failed to connect to 127.0.0.1:%u. Error code: %d\n", port, WSAGetLastError());
+        ::std::exit(1);
+    }
+
+    // 源服务器的一个连接：每收到一个完整的请求头部，回复一次 response，直到对方关闭连接
+    void serve_origin(SOCKET s, const ::std::string &response)
+    {
+        ::std::string request;
+        char buffer[4096];
+        while (true) {
+            size_t end = request.find("\r\n\r\n");
+            if (end != ::std::string::npos) {
+                request.erase(0, end + 4);
+                for (size_t sent = 0; sent < response.size();) {
+                    int n = send(s, response.data() + sent, static_cast<int>(response.size() - sent), 0);
+                    if (n <= 0) {
+                        closesocket(s);
+                        return;
+                    }
+                    sent += n;
+                }
+                continue;
+            }
+            int n = recv(s, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                closesocket(s);
+                return;
+            }
+            request.append(buffer, n);
+        }
+    }
+
+    // 获取调用线程已使用的 CPU 时间（用户态与内核态之和，秒）
+    double thread_cpu_seconds()
+    {
+        FILETIME creation, exit, kernel, user;
+        if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+            return 0;
+        }
+        auto ticks = [](const FILETIME &time) { return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+        return (ticks(kernel) + ticks(user)) / 1e7;
+    }
+
+    // 发送 size 字节，直到全部发送或出错
+    // 返回值: 是否全部发送
+    bool send_all(SOCKET s, const char *data, size_t size)
+    {
+        for (size_t sent = 0; sent < size;) {
+            int n = send(s, data + sent, static_cast<int>(size - sent), 0);
+            if (n <= 0) {
+                return false;
+            }
+            sent += n;
+        }
+        return true;
+    }
+
+    // 对比用的中转（staging 模式）：每个客户端连接一个阻塞线程，每收到一个请求头部就转发给源服务器，
+    // 再把 response_size 字节的响应逐块接收到接收缓冲、复制到发送缓冲后发送给客户端
+    // 即事件循环改为直接发送接收到的缓冲之前，经过会话发送缓冲的转发方式
+    // 客户端关闭连接后把本线程的 CPU 时间累加到 cpu_seconds
+    void relay_staging(SOCKET client, unsigned short origin_port, size_t response_size, ::std::atomic<double> &cpu_seconds, ::std::atomic<int> &active)
+    {
+        SOCKET origin = connect_local(origin_port);
+        ::std::string request;
+        ::std::vector<char> recv_buffer(65536);
+        ::std::vector<char> send_buffer(65536);
+        while (true) {
+            size_t end = request.find("\r\n\r\n");
+            if (end == ::std::string::npos) {
+                int n = recv(client, recv_buffer.data(), static_cast<int>(recv_buffer.size()), 0);
+                if (n <= 0) {
+                    break;
+                }
+                request.append(recv_buffer.data(), n);
+                continue;
+            }
+            if (!send_all(origin, request.data(), end + 4)) {
+                break;
+            }
+            request.erase(0, end + 4);
+            size_t relayed = 0;
+            while (relayed < response_size) {
+                int n = recv(origin, recv_buffer.data(), static_cast<int>(::std::min(recv_buffer.size(), response_size - relayed)), 0);
+                if (n <= 0) {
+                    break;
+                }
+                ::std::memcpy(send_buffer.data(), recv_buffer.data(), n);
+                if (!send_all(client, send_buffer.data(), n)) {
+                    break;
+                }
+                relayed += n;
+            }
+            if (relayed < response_size) {
+                break;
+            }
+        }
+        closesocket(origin);
+        closesocket(client);
+        cpu_seconds += thread_cpu_seconds();
+        --active;
+    }
+
+    // 通过代理依次请求 count 次，每次读完整个响应
+    // 返回值: 收到的响应体总字节数
+    uint64_t run_client(unsigned short proxy_port, unsigned short origin_port, size_t body_size, int count)
+    {
+        SOCKET s = connect_local(proxy_port);
+        ::std::string request = ::std::format("GET http://127.0.0.1:{}/bench HTTP/1.1\r\nHost: 127.0.0.1:{}\r\n\r\n", origin_port, origin_port);
+        ::std::string head;
+        ::std::vector<char> buffer(65536);
+        uint64_t body_bytes = 0;
+        for (int i = 0; i < count; ++i) {
+            send(s, request.data(), static_cast<int>(request.size()), 0);
+            // 先读到头部结束，再读完 body_size 字节的响应体
+            size_t received = 0;
+            size_t head_end = ::std::string::npos;
+            head.clear();
+            while (head_end == ::std::string::npos) {
+                int n = recv(s, buffer.data(), static_cast<int>(buffer.size()), 0);
+                if (n <= 0) {
+                    ::std::fprintf(stderr, "Proxy closed the connection\n");
+                    ::std::exit(1);
+                }
+                head.append(buffer.data(), n);
+                head_end = head.find("\r\n\r\n");
+            }
+            received = head.size() - (head_end + 4);
+            while (received < body_size) {
+                int n = recv(s, buffer.data(), static_cast<int>(::std::min(buffer.size(), body_size - received)), 0);
+                if (n <= 0) {
+                    ::std::fprintf(stderr, "Proxy closed the connection\n");
+                    ::std::exit(1);
+                }
+                received += n;
+            }
+            body_bytes += received;
+        }
+        closesocket(s);
+        return body_bytes;
+    }
+} // namespace
+
+// 代理转发吞吐量：本进程中运行源服务器和不使用缓存的代理服务器，客户端通过代理反复下载同一个响应
+// 同时统计转发线程的 CPU 时间，以每 GiB 响应体消耗的 CPU 秒数表示
+// 测量的是事件循环直接发送接收缓冲的转发路径；staging 模式改用经过发送缓冲复制的阻塞中转作为对比
+// 用法: relay_bench [响应体大小 MiB = 8] [每个客户端的请求数 = 32] [客户端数 = 1] [代理端口 = 19321] [proxy | staging]
+int main(int argc, char *argv[])
+{
+    size_t body_size = static_cast<size_t>(::my::bench::arg_or(argc, argv, 1, 8)) << 20;
+    int count = static_cast<int>(::my::bench::arg_or(argc, argv, 2, 32));
+    int clients = static_cast<int>(::my::bench::arg_or(argc, argv, 3, 1));
+    unsigned short proxy_port = static_cast<unsigned short>(::my::bench::arg_or(argc, argv, 4, 19321));
+    bool staging = argc > 5 && ::std::string_view(argv[5]) == "staging";
+    ::my::init_wsa();
+
+    // 源服务器：每个连接一个线程，程序结束时不再等待
+    ::std::string response = ::std::format("HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: {}\r\n\r\n", body_size);
+    response.append(body_size, 'x');
+    unsigned short origin_port = 0;
+    SOCKET origin = listen_local(origin_port);
+    ::std::thread([origin, &response]() {
+        while (true) {
+            SOCKET s = accept(origin, nullptr, nullptr);
+            if (s == INVALID_SOCKET) {
+                return;
+            }
+            ::std::thread(serve_origin, s, ::std::cref(response)).detach();
+        }
+    }).detach();
+
+    // 转发线程的 CPU 时间：代理服务器为运行事件循环的线程，staging 模式为各中转线程之和
+    ::std::atomic<double> relay_cpu = 0;
+    ::std::atomic<int> active_relays = 0;
+    ::std::unique_ptr<::my::HttpProxyServer> proxy;
+    ::std::thread relay_thread;
+    if (staging) {
+        SOCKET listener = listen_local(proxy_port);
+        relay_thread = ::std::thread([listener, origin_port, &response, &relay_cpu, &active_relays, clients]() {
+            for (int i = 0; i < clients; ++i) {
+                SOCKET s = accept(listener, nullptr, nullptr);
+                if (s == INVALID_SOCKET) {
+                    break;
+                }
+                ++active_relays;
+                ::std::thread(relay_staging, s, origin_port, response.size(), ::std::ref(relay_cpu), ::std::ref(active_relays)).detach();
+            }
+            closesocket(listener);
+        });
+    } else {
+        proxy = ::std::make_unique<::my::HttpProxyServer>("127.0.0.1", proxy_port, false);
+        relay_thread = ::std::thread([&proxy, &relay_cpu]() {
+            proxy->run_event_loop();
+            relay_cpu = thread_cpu_seconds();
+        });
+    }
+
+    ::my::bench::Clock::time_point start = ::my::bench::Clock::now();
+    ::std::vector<::std::thread> threads;
+    ::std::atomic<uint64_t> total_bytes = 0;
+    for (int i = 0; i < clients; ++i) {
+        threads.emplace_back([&]() { total_bytes += run_client(proxy_port, origin_port, body_size, count); });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    double seconds = ::my::bench::seconds_since(start);
+
+    if (!staging) {
+        keybord_interrupt = true;
+    }
+    relay_thread.join();
+    while (active_relays > 0) {
+        ::std::this_thread::sleep_for(::std::chrono::milliseconds(1));
+    }
+    double gib = static_cast<double>(total_bytes) / (1 << 30);
+    ::std::printf("%s: %d client(s) x %d request(s) x %zu bytes in %.3f s: %.1f MiB/s, %.1f requests/s\n", staging ? "staging" : "relay", clients, count, body_size,
+                  seconds, total_bytes / seconds / (1 << 20), clients * count / seconds);
+    ::std::printf("%s: relay CPU %.3f s, %.3f CPU-s/GiB\n", staging ? "staging" : "relay", relay_cpu.load(), relay_cpu / gib);
+    return 0;
+}
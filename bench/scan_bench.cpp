@@ -0,0 +1,79 @@
+#include "../include/HttpRequestParser.h"
+#include "../include/HttpResponseHead.h"
+#include "../include/simd_scan.h"
+#include "./bench.hpp"
+
+#include <cstdio>
+#include <string>
+
+namespace
+{
+    // 典型的浏览器请求
+    const ::std::string REQUEST = "GET http://www.example.com/static/js/app.min.js?v=20240601 HTTP/1.1\r\n"
+                                  "Host: www.example.com\r\n"
+                                  "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+                                  "Accept: */*\r\n"
+                                  "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8,en-GB;q=0.7,en-US;q=0.6\r\n"
+                                  "Accept-Encoding: gzip, deflate, br\r\n"
+                                  "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark; lang=zh-CN; _ga=GA1.2.123456789.1700000000\r\n"
+                                  "Proxy-Connection: keep-alive\r\n"
+                                  "If-None-Match: \"5f3c-1a2b3c4d5e6f\"\r\n"
+                                  "If-Modified-Since: Sat, 01 Jun 2024 08:00:00 GMT\r\n"
+                                  "\r\n";
+
+    // 典型的服务器响应头部
+    const ::std::string RESPONSE = "HTTP/1.1 200 OK\r\n"
+                                   "Date: Sat, 01 Jun 2024 08:00:00 GMT\r\n"
+                                   "Server: nginx/1.24.0\r\n"
+                                   "Content-Type: application/javascript; charset=utf-8\r\n"
+                                   "Content-Length: 123456\r\n"
+                                   "Last-Modified: Fri, 31 May 2024 12:00:00 GMT\r\n"
+                                   "ETag: \"5f3c-1a2b3c4d5e6f\"\r\n"
+                                   "Cache-Control: public, max-age=31536000, immutable\r\n"
+                                   "Vary: Accept-Encoding\r\n"
+                                   "Connection: keep-alive\r\n"
+                                   "\r\n";
+} // namespace
+
+// 分隔符扫描在各指令集下的速度：长数据中查找（分隔符在末尾）、逐行扫描请求，以及解析请求和响应头部
+// CPU 不支持的指令集被跳过
+// 用法: scan_bench [长数据的字节数 = 4096]
+int main(int argc, char *argv[])
+{
+    size_t size = static_cast<size_t>(::my::bench::arg_or(argc, argv, 1, 4096));
+    ::std::string data(size, 'a');
+    data.back() = '\n';
+
+    for (::my::ScanLevel level : {::my::ScanLevel::SCALAR, ::my::ScanLevel::SSE42, ::my::ScanLevel::AVX2}) {
+        if (::my::set_scan_level(level) != level) {
+            ::std::printf("%s: not supported\n", ::my::scan_level_name(level));
+            continue;
+        }
+        ::std::printf("%s:\n", ::my::scan_level_name(level));
+
+        double ns = ::my::bench::time_per_call([&data]() { ::my::bench::keep(::my::find_first_of(data.data(), data.size(), ":\n")); });
+        ::std::printf("  find_first_of (%zu bytes)      %9.1f ns %9.2f GB/s\n", data.size(), ns, data.size() / ns);
+
+        ns = ::my::bench::time_per_call([]() {
+            size_t lines = 0;
+            for (size_t pos = 0; pos < REQUEST.size(); ++lines) {
+                pos += ::my::find_first_of(REQUEST.data() + pos, REQUEST.size() - pos, "\n") + 1;
+            }
+            ::my::bench::keep(lines);
+        });
+        ::std::printf("  line scan (%zu-byte request)    %9.1f ns %9.2f GB/s\n", REQUEST.size(), ns, REQUEST.size() / ns);
+
+        ns = ::my::bench::time_per_call([]() {
+            ::my::HttpRequestParser parser;
+            ::my::bench::keep(parser.parse(REQUEST));
+        });
+        ::std::printf("  HttpRequestParser              %9.1f ns\n", ns);
+
+        ns = ::my::bench::time_per_call([]() {
+            ::my::HttpResponseHead head(RESPONSE.data(), static_cast<int>(RESPONSE.size()));
+            ::my::bench::keep(head);
+        });
+        ::std::printf("  HttpResponseHead               %9.1f ns\n", ns);
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+#ifndef _BOUNDED_QUEUE_H_INCLUDED_
+#define _BOUNDED_QUEUE_H_INCLUDED_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace my
+{
+    // BoundedQueue 类是容量固定的无锁多生产者多消费者队列（Dmitry Vyukov 的有界队列）
+    // 每个槽位记录一个序号，生产者和消费者分别用一个原子计数器争取位置，争取到后只访问自己的槽位
+    // 队列已满时 try_push 立即失败，队列为空时 try_pop 立即失败，都不等待
+    // 容量必须是 2 的幂，元素类型必须可以默认构造和移动赋值
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        // 构造函数，接受容量参数
+        explicit BoundedQueue(size_t capacity) : mask_(capacity - 1), slots_(new Slot[capacity])
+        {
+            for (size_t i = 0; i < capacity; ++i) {
+                slots_[i].sequence.store(i, ::std::memory_order_relaxed);
+            }
+        }
+
+        // 放入一个元素，成功时移走 value，队列已满时 value 不变
+        // 返回值: 是否放入
+        bool try_push(T &&value)
+        {
+            size_t pos = tail_.load(::std::memory_order_relaxed);
+            Slot *slot = nullptr;
+            while (true) {
+                slot = &slots_[pos & mask_];
+                size_t sequence = slot->sequence.load(::std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (tail_.compare_exchange_weak(pos, pos + 1, ::std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    return false; // 槽位中的元素尚未被取出，队列已满
+                } else {
+                    pos = tail_.load(::std::memory_order_relaxed);
+                }
+            }
+            slot->value = ::std::move(value);
+            slot->sequence.store(pos + 1, ::std::memory_order_release);
+            return true;
+        }
+
+        // 取出一个元素，槽位中留下默认构造的元素（及时释放元素持有的资源）
+        // 返回值: 是否取出
+        bool try_pop(T &value)
+        {
+            size_t pos = head_.load(::std::memory_order_relaxed);
+            Slot *slot = nullptr;
+            while (true) {
+                slot = &slots_[pos & mask_];
+                size_t sequence = slot->sequence.load(::std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (head_.compare_exchange_weak(pos, pos + 1, ::std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    return false; // 槽位中的元素尚未放入，队列为空
+                } else {
+                    pos = head_.load(::std::memory_order_relaxed);
+                }
+            }
+            value = ::std::move(slot->value);
+            slot->value = T();
+            slot->sequence.store(pos + mask_ + 1, ::std::memory_order_release);
+            return true;
+        }
+
+        // 获取容量
+        size_t capacity() const { return mask_ + 1; }
+
+        // 禁用拷贝构造函数
+        BoundedQueue(const BoundedQueue &) = delete;
+        // 禁用拷贝赋值运算符
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    private:
+        // Slot 结构体表示一个槽位
+        // 序号等于放入位置时可以放入，等于放入位置加一时可以取出，取出后加上容量留给下一轮
+        struct Slot {
+            ::std::atomic<size_t> sequence; // 序号
+            T value;                        // 元素
+        };
+
+        const size_t mask_;                         // 容量减一，用于把位置映射到槽位
+        ::std::unique_ptr<Slot[]> slots_;           // 槽位
+        alignas(64) ::std::atomic<size_t> tail_{0}; // 下一个放入的位置，与 head_ 分开在不同的缓存行中
+        alignas(64) ::std::atomic<size_t> head_{0}; // 下一个取出的位置
+    }; // class BoundedQueue
+
+} // namespace my
+
+#endif // _BOUNDED_QUEUE_H_INCLUDED_
@@ -0,0 +1,58 @@
+#ifndef _CACHE_FILE_H_INCLUDED_
+#define _CACHE_FILE_H_INCLUDED_
+
+#include <cstdint>
+#include <string>
+#include <windows.h>
+
+namespace my
+{
+    // CacheFile 类持有一个打开的只读缓存文件句柄，表示文件中的一个缓存的响应
+    // 响应可以占据整个文件（单独的缓存文件），也可以是段文件中的一段（SegmentStore）
+    // 打开后即使缓存被移除或重新创建，句柄仍指向打开时的文件内容，读取时无需加锁
+    class CacheFile
+    {
+    public:
+        // 默认构造函数，不持有文件
+        CacheFile() = default;
+        // 析构函数，关闭文件句柄
+        ~CacheFile();
+
+        // 以只读方式打开文件，失败时抛出异常
+        // overlapped: 是否以 FILE_FLAG_OVERLAPPED 打开，以便通过完成端口异步读取
+        static CacheFile open(const ::std::string &path, bool overlapped = false);
+        // 以只读方式打开文件中从 offset 开始的 size 个字节，超出文件范围或失败时抛出异常
+        static CacheFile open(const ::std::string &path, bool overlapped, uint64_t offset, uint64_t size);
+
+        // 文件是否已打开
+        bool is_open() const;
+        // 获取文件句柄
+        HANDLE handle() const;
+        // 获取响应的大小
+        uint64_t size() const;
+        // 获取响应在文件中的偏移量
+        uint64_t offset() const;
+        // 从响应中的指定位置读取数据，不改变文件指针，可被多个线程同时调用
+        // 返回值: 读取的字节数，到达响应末尾时返回 0
+        int read(char *buffer, int buf_size, uint64_t offset) const;
+        // 关闭文件句柄
+        void close();
+
+        // 移动构造函数
+        CacheFile(CacheFile &&other) noexcept;
+        // 移动赋值运算符
+        CacheFile &operator=(CacheFile &&other) noexcept;
+        // 禁用拷贝构造函数
+        CacheFile(const CacheFile &) = delete;
+        // 禁用拷贝赋值运算符
+        CacheFile &operator=(const CacheFile &) = delete;
+
+    private:
+        HANDLE handle_ = INVALID_HANDLE_VALUE; // 文件句柄
+        uint64_t offset_ = 0;                  // 响应在文件中的偏移量
+        uint64_t size_ = 0;                    // 响应的大小
+    }; // class CacheFile
+
+} // namespace my
+
+#endif // _CACHE_FILE_H_INCLUDED_
@@ -0,0 +1,172 @@
+#ifndef _CACHE_INDEX_H_INCLUDED_
+#define _CACHE_INDEX_H_INCLUDED_
+
+#include "./CacheKey.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include <windows.h>
+
+namespace my
+{
+    // CacheIndex 类是保存在磁盘上的缓存索引，记录每个缓存的键、大小、验证器、新鲜度和访问统计
+    // 索引文件是映射到内存的开放寻址哈希表（线性探测），由固定大小的记录组成，打开时只需映射文件，无需逐条解析
+    // 每次修改先把完整的记录追加到预写日志，再写入映射中的记录；进程异常退出后，打开时重放日志，修复写了一半的记录
+    // 每条记录带有校验和，校验失败的记录视为不存在
+    // 线程安全
+    class CacheIndex
+    {
+    public:
+        static constexpr uint64_t MIN_CAPACITY = 1 << 16;  // 新建索引的槽数
+        static constexpr size_t MAX_MODIFIED_TIME = 36;    // 可以记录的 Last-Modified 的最大长度
+        static constexpr size_t MAX_ETAG = 116;            // 可以记录的 ETag 的最大长度
+        static constexpr size_t CHECKPOINT_RECORDS = 4096; // 日志中的记录数达到该值时把映射写回磁盘并清空日志
+
+        // Item 结构体表示一个缓存的索引项
+        struct Item {
+            Hash128 key;                         // 缓存键
+            Hash128 check;                       // URL 的校验哈希，用于检测键冲突
+            uint64_t size = 0;                   // 缓存的响应大小
+            uint32_t segment = 0;                // 响应所在的段文件编号，0 表示保存在单独的缓存文件中
+            uint64_t offset = 0;                 // 响应在段文件中的偏移量
+            int64_t stored_at = 0;               // 写入缓存的时间（Unix 时间，秒），即收到响应的时间
+            int64_t initial_age = 0;             // 收到响应时响应已有的年龄（秒）
+            int64_t lifetime = 0;                // 新鲜期（秒）
+            int32_t stale_while_revalidate = -1; // 响应的 stale-while-revalidate（秒），没有时为 -1
+            int32_t stale_if_error = -1;         // 响应的 stale-if-error（秒），没有时为 -1
+            bool must_revalidate = false;        // 过期后是否必须验证
+            int64_t accessed_at = 0;             // 最后访问时间（Unix 时间，秒）
+            uint32_t hits = 0;                   // 访问次数
+            ::std::string modified_time;         // 最后修改时间
+            ::std::string etag;                  // ETag
+        };
+
+        // 构造函数，打开索引文件 path 和日志文件 path + ".wal"，不存在或无法识别时新建，失败时抛出异常
+        explicit CacheIndex(const ::std::string &path);
+        // 析构函数，把映射写回磁盘并清空日志
+        ~CacheIndex();
+
+        // 索引是否为新建的（原有的索引文件不存在或无法识别）
+        bool created() const;
+        // 查找索引项
+        ::std::optional<Item> find(const Hash128 &key) const;
+        // 获取所有索引项
+        ::std::vector<Item> items() const;
+        // 插入或替换索引项
+        // 返回值: 是否成功，验证器过长无法记录时返回 false
+        bool put(const Item &item);
+        // 移除索引项
+        void erase(const Hash128 &key);
+        // 记录一次访问，访问统计不写入日志，异常退出时可能丢失
+        void touch(const Hash128 &key, int64_t now);
+        // 获取索引项数
+        size_t size() const;
+        // 把映射写回磁盘并清空日志
+        void checkpoint();
+
+        // 禁用拷贝构造函数
+        CacheIndex(const CacheIndex &) = delete;
+        // 禁用拷贝赋值运算符
+        CacheIndex &operator=(const CacheIndex &) = delete;
+
+    private:
+        static constexpr char MAGIC[8] = {'S', 'H', 'P', 'I', 'N', 'D', 'E', 'X'}; // 索引文件的标识
+        static constexpr uint32_t VERSION = 4;                                     // 索引文件的格式版本
+
+        // State 枚举表示槽的状态
+        enum State : uint8_t {
+            EMPTY = 0,   // 空槽，探测到此结束
+            LIVE = 1,    // 有效的索引项
+            DELETED = 2, // 已移除的索引项，探测时跳过
+        };
+
+        // Flag 枚举表示记录的标志位
+        enum Flag : uint8_t {
+            MUST_REVALIDATE = 1, // 过期后必须验证
+        };
+
+        // Record 结构体是索引文件和日志中的一条记录
+        // 校验和覆盖访问统计和校验和本身以外的所有字段，访问统计可以不经日志直接修改
+        struct Record {
+            uint64_t key[2];                       // 缓存键（低 64 位、高 64 位）
+            uint64_t check[2];                     // URL 的校验哈希
+            uint64_t size;                         // 缓存的响应大小
+            uint64_t offset;                       // 响应在段文件中的偏移量
+            int64_t stored_at;                     // 写入缓存的时间
+            int64_t initial_age;                   // 收到响应时响应已有的年龄
+            int64_t lifetime;                      // 新鲜期
+            int32_t stale_while_revalidate;        // stale-while-revalidate
+            int32_t stale_if_error;                // stale-if-error
+            int64_t accessed_at;                   // 最后访问时间
+            uint32_t hits;                         // 访问次数
+            uint32_t checksum;                     // 校验和
+            uint32_t segment;                      // 响应所在的段文件编号
+            uint8_t state;                         // 槽的状态
+            uint8_t modified_time_size;            // Last-Modified 的长度
+            uint8_t etag_size;                     // ETag 的长度
+            uint8_t flags;                         // 标志，见 Flag
+            char modified_time[MAX_MODIFIED_TIME]; // Last-Modified
+            char etag[MAX_ETAG];                   // ETag
+        };
+        static_assert(sizeof(Record) == 256);
+
+        // Header 结构体是索引文件的文件头，占用一条记录的空间
+        struct Header {
+            char magic[8];        // 索引文件的标识
+            uint32_t version;     // 格式版本
+            uint32_t record_size; // 记录大小
+            uint64_t capacity;    // 槽数，为 2 的幂
+            uint64_t used;        // 非空的槽数（包括已移除的）
+            uint64_t count;       // 索引项数
+        };
+
+        // Mapping 结构体表示一个映射到内存的文件
+        struct Mapping {
+            HANDLE file = INVALID_HANDLE_VALUE; // 文件句柄
+            HANDLE mapping = nullptr;           // 文件映射对象
+            char *data = nullptr;               // 映射的内存
+        };
+
+        // 打开并映射文件，capacity 不为 0 时把文件重建为有 capacity 个槽的空索引
+        static Mapping open_mapping(const ::std::string &path, uint64_t capacity);
+        // 取消映射并关闭文件
+        static void close_mapping(Mapping &mapping);
+        // 获取映射中的文件头
+        static Header &header_of(const Mapping &mapping);
+        // 获取映射中的第一条记录
+        static Record *records_of(const Mapping &mapping);
+        // 把记录转换为索引项
+        static Item item_of(const Record &record);
+        // 计算记录的校验和
+        static uint32_t checksum_of(const Record &record);
+        // 把记录写入映射：插入、替换或移除键相同的索引项
+        static void apply(const Mapping &mapping, const Record &record);
+
+        // 查找键对应的记录（不检查校验和），不存在时返回空指针
+        Record *probe(const Hash128 &key) const;
+        // 查找键对应的有效记录，不存在或校验失败时返回空指针
+        Record *locate(const Hash128 &key) const;
+        // 确保还能插入一条记录，负载过高时重建索引
+        // 返回值: 是否重建了索引
+        bool reserve();
+        // 修改索引：先把记录追加到日志，再写入映射，日志过长时做检查点
+        void commit(const Record &record);
+        // 重放日志中完整且校验通过的记录
+        void replay();
+        // 把映射写回磁盘并清空日志，调用时必须持有锁
+        void checkpoint_locked();
+
+        ::std::string path_;                // 索引文件路径
+        mutable ::std::mutex mutex_;        // 保护以下所有成员和映射的内容
+        Mapping main_;                      // 索引文件的映射
+        HANDLE wal_ = INVALID_HANDLE_VALUE; // 日志文件句柄
+        size_t wal_records_ = 0;            // 日志中的记录数
+        bool created_ = false;              // 索引是否为新建的
+    }; // class CacheIndex
+
+} // namespace my
+
+#endif // _CACHE_INDEX_H_INCLUDED_
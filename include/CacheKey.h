@@ -0,0 +1,31 @@
+#ifndef _CACHE_KEY_H_INCLUDED_
+#define _CACHE_KEY_H_INCLUDED_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace my
+{
+    // Hash128 结构体表示一个 128 位哈希值
+    struct Hash128 {
+        uint64_t low = 0;  // 低 64 位
+        uint64_t high = 0; // 高 64 位
+
+        bool operator==(const Hash128 &other) const = default;
+    };
+
+    // 计算 MurmurHash3（x64 版本，128 位）哈希值
+    // 按小端序读取数据，结果只取决于输入，与平台、编译器和标准库实现无关，可以用作持久化的键
+    Hash128 murmur3_128(::std::string_view data, uint32_t seed = 0);
+
+    // 规范化 URL（RFC 3986 第 6.2.2 节），使等价的 URL 得到相同的结果：
+    //   协议和主机名转为小写，省略默认端口（http 为 80，https 为 443），空路径改为 "/"；
+    //   解码表示非保留字符的百分号编码，其余百分号编码的十六进制数字转为大写；
+    //   移除路径中的 "." 和 ".." 段，去掉片段（# 之后的部分）
+    // 返回值: 规范化的 URL，不是 http 或 https URL 时返回空字符串
+    ::std::string normalize_url(::std::string_view url);
+
+} // namespace my
+
+#endif // _CACHE_KEY_H_INCLUDED_
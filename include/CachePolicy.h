@@ -0,0 +1,62 @@
+#ifndef _CACHE_POLICY_H_INCLUDED_
+#define _CACHE_POLICY_H_INCLUDED_
+
+#include "./HttpHeaders.h"
+#include "./HttpResponseHead.h"
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace my
+{
+    // Freshness 结构体表示缓存的响应的新鲜度（RFC 9111 第 4.2 节），时间均为 Unix 时间（秒）
+    // 过期后仍可使用的窗口来自响应中的 stale-while-revalidate 和 stale-if-error 指令（RFC 5861）
+    struct Freshness {
+        static constexpr int64_t MAX_HEURISTIC_LIFETIME = 24 * 60 * 60; // 启发式新鲜期的上限
+        static constexpr int64_t MAX_DELTA_SECONDS = 2147483648LL;      // 时长的上限（第 1.2.2 节）
+        static constexpr int64_t UNSPECIFIED = -1;                      // 表示响应没有给出窗口
+
+        int64_t response_time = 0;                    // 收到响应的时间
+        int64_t initial_age = 0;                      // 收到响应时响应已有的年龄（修正后的初始年龄）
+        int64_t lifetime = 0;                         // 新鲜期
+        int64_t stale_while_revalidate = UNSPECIFIED; // 过期后在后台验证期间仍可使用的时长
+        int64_t stale_if_error = UNSPECIFIED;         // 过期后在服务器出错时仍可使用的时长
+        bool must_revalidate = false;                 // 过期后是否必须验证（must-revalidate、proxy-revalidate、s-maxage、no-cache）
+
+        // 获取响应在 now 时的年龄
+        int64_t age(int64_t now) const;
+        // 响应在 now 时是否新鲜
+        bool is_fresh(int64_t now) const;
+        // 响应在 now 时是否过期不超过 window 秒且允许不经验证使用
+        bool is_usable_stale(int64_t now, int64_t window) const;
+    };
+
+    // 获取当前的 Unix 时间（秒）
+    int64_t unix_now();
+
+    // 解析 HTTP 日期，接受 IMF-fixdate 以及已废弃的 RFC 850 和 asctime 格式（RFC 9110 第 5.6.7 节）
+    // 返回值: Unix 时间（秒），无法解析时返回空
+    ::std::optional<int64_t> parse_http_date(::std::string_view date);
+
+    // 获取 Cache-Control 字段（可能有多个）中指定指令的值，指令名不区分大小写，带引号的值去掉引号
+    // 返回值: 指令的值，指令没有值时为空字符串，不存在该指令时返回空
+    ::std::optional<::std::string_view> cache_directive(const HttpHeaders &headers, ::std::string_view directive);
+
+    // 共享缓存能否保存响应：没有 no-store 和 private 指令，且不是 Vary: *（第 3 节）
+    bool is_storable(const HttpResponseHead &head);
+    // 响应是否明确给出了新鲜期（s-maxage、max-age 或 Expires）
+    bool has_explicit_lifetime(const HttpResponseHead &head);
+    // 状态码是否默认可缓存，只有这些状态码的响应在没有明确新鲜期时可以使用启发式新鲜期（第 4.2.2 节）
+    bool is_heuristically_cacheable(::std::string_view status);
+    // 计算响应的新鲜度
+    // request_time: 发送请求的时间，response_time: 收到响应的时间
+    Freshness compute_freshness(const HttpResponseHead &head, int64_t request_time, int64_t response_time);
+    // 请求是否允许不经验证直接使用新鲜度为 freshness 的缓存（第 4.2 节和第 5.2.1 节）
+    // 考虑请求中的 no-cache、max-age、min-fresh 指令和 Pragma: no-cache
+    bool allows_cached(const HttpHeaders &request_headers, const Freshness &freshness, int64_t now);
+    // 请求是否允许使用过期的缓存（第 4.2.4 节）：没有 no-cache、Pragma: no-cache 和 min-fresh，且缓存的年龄不超过请求的 max-age
+    bool allows_stale(const HttpHeaders &request_headers, const Freshness &freshness, int64_t now);
+
+} // namespace my
+
+#endif // _CACHE_POLICY_H_INCLUDED_
@@ -0,0 +1,75 @@
+#ifndef _CONNECTION_POOL_H_INCLUDED_
+#define _CONNECTION_POOL_H_INCLUDED_
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <winsock2.h>
+
+namespace my
+{
+    // ConnectionPool 类按服务器 host:port 管理空闲的长连接
+    class ConnectionPool
+    {
+    public:
+        using Clock = ::std::chrono::steady_clock; // 计时使用的时钟
+
+        // 构造函数，接受每个服务器的最大空闲连接数和空闲超时时间
+        explicit ConnectionPool(size_t max_idle_per_host = 8, Clock::duration idle_timeout = ::std::chrono::seconds(30));
+        // 析构函数，关闭所有空闲连接
+        ~ConnectionPool();
+
+        // 取出一个可用的空闲连接，没有时返回 INVALID_SOCKET
+        SOCKET checkout(::std::string_view key);
+        // 归还一个可复用的连接
+        void release(::std::string_view key, SOCKET socket);
+        // 关闭所有超时的空闲连接
+        void prune();
+        // 关闭所有空闲连接
+        void clear();
+
+        // 获取空闲连接总数
+        size_t idle_count() const;
+        // 获取复用连接的次数
+        size_t hit_count() const;
+        // 获取没有可复用连接的次数
+        size_t miss_count() const;
+
+        // 设置每个服务器的最大空闲连接数
+        void set_max_idle_per_host(size_t max_idle_per_host);
+        // 设置空闲超时时间
+        void set_idle_timeout(Clock::duration idle_timeout);
+
+        // 生成连接池的键
+        static ::std::string make_key(::std::string_view host, unsigned short port);
+
+        // 禁用拷贝构造函数
+        ConnectionPool(const ConnectionPool &) = delete;
+        // 禁用拷贝赋值运算符
+        ConnectionPool &operator=(const ConnectionPool &) = delete;
+
+    private:
+        // 一个空闲连接
+        struct IdleConnection {
+            SOCKET socket;                // 套接字
+            Clock::time_point idle_since; // 开始空闲的时间
+        };
+
+        // 检查空闲连接是否仍然可用（未被服务器关闭，也没有多余数据）
+        static bool is_alive(SOCKET socket);
+
+        size_t max_idle_per_host_;      // 每个服务器的最大空闲连接数
+        Clock::duration idle_timeout_;  // 空闲超时时间
+        ::std::atomic_size_t hit_cnt_;  // 复用连接的次数
+        ::std::atomic_size_t miss_cnt_; // 没有可复用连接的次数
+
+        ::std::unordered_map<::std::string, ::std::deque<IdleConnection>> idle_; // 按 host:port 分组的空闲连接（队尾最新）
+        mutable ::std::mutex mutex_;                                             // 保护 idle_ 的互斥锁
+    }; // class ConnectionPool
+
+} // namespace my
+
+#endif // _CONNECTION_POOL_H_INCLUDED_
@@ -0,0 +1,249 @@
+#ifndef _COROUTINE_HPP_INCLUDED_
+#define _COROUTINE_HPP_INCLUDED_
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+
+namespace my
+{
+    template <typename T = void>
+    class Coroutine;
+
+    namespace detail
+    {
+        // 协程结束时的等待对象：有等待者时转到等待者继续执行，否则（分离执行的协程）销毁自身
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+
+            template <typename Promise>
+            ::std::coroutine_handle<> await_suspend(::std::coroutine_handle<Promise> handle) noexcept
+            {
+                ::std::coroutine_handle<> continuation = handle.promise().continuation;
+                if (!continuation) {
+                    handle.destroy();
+                    return ::std::noop_coroutine();
+                }
+                return continuation;
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        // 协程 promise 的公共部分
+        struct PromiseBase {
+            ::std::coroutine_handle<> continuation; // 等待此协程结束的协程
+            ::std::exception_ptr exception;         // 协程中未处理的异常
+
+            // 协程创建后先挂起，被等待或分离执行时才开始执行
+            ::std::suspend_always initial_suspend() const noexcept { return {}; }
+            // 协程结束时恢复等待者
+            FinalAwaiter final_suspend() const noexcept { return {}; }
+            // 保存未处理的异常，在等待者中重新抛出
+            void unhandled_exception() noexcept { exception = ::std::current_exception(); }
+        };
+
+        // 有返回值的协程的 promise
+        template <typename T>
+        struct Promise : PromiseBase {
+            ::std::optional<T> value; // 协程的返回值
+
+            Coroutine<T> get_return_object();
+            void return_value(T result) { value.emplace(::std::move(result)); }
+
+            // 获取返回值，协程抛出异常时重新抛出
+            T result()
+            {
+                if (exception) {
+                    ::std::rethrow_exception(exception);
+                }
+                return ::std::move(*value);
+            }
+        };
+
+        // 无返回值的协程的 promise
+        template <>
+        struct Promise<void> : PromiseBase {
+            Coroutine<void> get_return_object();
+            void return_void() {}
+
+            // 协程抛出异常时重新抛出
+            void result()
+            {
+                if (exception) {
+                    ::std::rethrow_exception(exception);
+                }
+            }
+        };
+    } // namespace detail
+
+    // Coroutine 类表示一个惰性启动的协程
+    // 被 co_await 时开始执行，结束后恢复等待者；也可以用 spawn 分离执行
+    template <typename T>
+    class Coroutine
+    {
+    public:
+        using promise_type = detail::Promise<T>; // 协程的 promise 类型
+
+        // 等待协程结束的等待对象
+        struct Awaiter {
+            ::std::coroutine_handle<promise_type> handle; // 被等待的协程
+
+            bool await_ready() const noexcept { return !handle || handle.done(); }
+
+            // 记录等待者后直接转到被等待的协程执行
+            ::std::coroutine_handle<> await_suspend(::std::coroutine_handle<> waiter) noexcept
+            {
+                handle.promise().continuation = waiter;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().result(); }
+        };
+
+        // 构造函数，接管协程句柄
+        explicit Coroutine(::std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+        // 析构函数，销毁尚未分离的协程
+        ~Coroutine()
+        {
+            if (handle_) {
+                handle_.destroy();
+            }
+        }
+
+        // 开始执行协程并等待其结束
+        Awaiter operator co_await() const noexcept { return Awaiter{handle_}; }
+
+        // 放弃对协程的所有权，返回协程句柄
+        ::std::coroutine_handle<promise_type> release() noexcept { return ::std::exchange(handle_, nullptr); }
+
+        // 移动构造函数
+        Coroutine(Coroutine &&other) noexcept : handle_(::std::exchange(other.handle_, nullptr)) {}
+
+        // 移动赋值运算符
+        Coroutine &operator=(Coroutine &&other) noexcept
+        {
+            if (this != &other) {
+                if (handle_) {
+                    handle_.destroy();
+                }
+                handle_ = ::std::exchange(other.handle_, nullptr);
+            }
+            return *this;
+        }
+
+        // 禁用拷贝构造函数
+        Coroutine(const Coroutine &) = delete;
+        // 禁用拷贝赋值运算符
+        Coroutine &operator=(const Coroutine &) = delete;
+
+    private:
+        ::std::coroutine_handle<promise_type> handle_; // 协程句柄
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        Coroutine<T> Promise<T>::get_return_object()
+        {
+            return Coroutine<T>(::std::coroutine_handle<Promise<T>>::from_promise(*this));
+        }
+
+        inline Coroutine<void> Promise<void>::get_return_object()
+        {
+            return Coroutine<void>(::std::coroutine_handle<Promise<void>>::from_promise(*this));
+        }
+    } // namespace detail
+
+    // 分离执行协程：立即开始执行，结束后自行销毁
+    // 分离执行的协程没有等待者，应自行处理所有异常，未处理的异常会被丢弃
+    inline void spawn(Coroutine<void> coroutine)
+    {
+        coroutine.release().resume();
+    }
+
+    // CallbackAwaiter 类把回调式的异步操作包装为可在协程中等待的对象
+    // 挂起时调用 submit 提交操作，操作完成时传给回调的结果即为 co_await 的值
+    // 回调必须在 submit 返回之后才被调用（如由事件循环分发），并在协程所在的线程中调用
+    template <typename T>
+    class CallbackAwaiter
+    {
+    public:
+        using Callback = ::std::function<void(T result)>; // 操作完成时的回调类型
+        using Submit = ::std::function<void(Callback)>;   // 提交操作的函数类型
+
+        // 构造函数，接受提交操作的函数
+        explicit CallbackAwaiter(Submit submit) : submit_(::std::move(submit)) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(::std::coroutine_handle<> handle)
+        {
+            submit_([this, handle](T result) {
+                result_.emplace(::std::move(result));
+                handle.resume();
+            });
+        }
+
+        T await_resume() { return ::std::move(*result_); }
+
+    private:
+        Submit submit_;             // 提交操作的函数
+        ::std::optional<T> result_; // 操作的结果
+    };
+
+    namespace detail
+    {
+        // when_all 的共享状态
+        struct WhenAllState {
+            int remaining = 0;                // 尚未结束的协程数
+            ::std::coroutine_handle<> waiter; // 等待所有协程结束的协程
+            ::std::exception_ptr exception;   // 第一个未处理的异常
+        };
+
+        // 运行 when_all 中的一个协程，最后一个结束时恢复等待者
+        inline Coroutine<void> when_all_member(Coroutine<void> coroutine, WhenAllState &state)
+        {
+            try {
+                co_await coroutine;
+            } catch (...) {
+                if (!state.exception) {
+                    state.exception = ::std::current_exception();
+                }
+            }
+            if (--state.remaining == 0 && state.waiter) {
+                state.waiter.resume();
+            }
+        }
+
+        // 等待 when_all 中所有协程结束的等待对象
+        struct WhenAllAwaiter {
+            WhenAllState &state; // 共享状态
+
+            bool await_ready() const noexcept { return state.remaining == 0; }
+            void await_suspend(::std::coroutine_handle<> waiter) noexcept { state.waiter = waiter; }
+
+            void await_resume() const
+            {
+                if (state.exception) {
+                    ::std::rethrow_exception(state.exception);
+                }
+            }
+        };
+    } // namespace detail
+
+    // 同时运行两个协程，两者都结束后返回；任一协程抛出异常时，在两者都结束后重新抛出第一个异常
+    inline Coroutine<void> when_all(Coroutine<void> first, Coroutine<void> second)
+    {
+        detail::WhenAllState state;
+        state.remaining = 2;
+        spawn(detail::when_all_member(::std::move(first), state));
+        spawn(detail::when_all_member(::std::move(second), state));
+        co_await detail::WhenAllAwaiter{state};
+    }
+} // namespace my
+
+#endif // _COROUTINE_HPP_INCLUDED_
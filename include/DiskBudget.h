@@ -0,0 +1,108 @@
+#ifndef _DISK_BUDGET_H_INCLUDED_
+#define _DISK_BUDGET_H_INCLUDED_
+
+#include "./CacheKey.h"
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace my
+{
+    // DiskBudget 类记录磁盘层中每个缓存文件的大小和访问情况，按字节数和对象数限制容量，并选出应淘汰的缓存
+    // 只记录元数据，不负责删除文件；淘汰策略与内存层（HotCache）相同，为 S3-FIFO：
+    //   写入完成的缓存先进入小队列，在小队列中被访问过的移入主队列，其余的被淘汰并记入幽灵队列；
+    //   幽灵队列中的缓存再次写入时直接进入主队列；主队列按 FIFO 淘汰，被访问过的降低访问计数后重新插入
+    // 正在写入的数据单独计入用量，写入完成后再计入对应的缓存，写入期间的缓存不会被选中淘汰
+    // 不是线程安全的，由使用者加锁
+    class DiskBudget
+    {
+    public:
+        static constexpr int MAX_FREQ = 3;       // 访问计数的上限
+        static constexpr int SMALL_PERCENT = 10; // 小队列占用量的百分比
+
+        // Victim 结构体表示一个被选中淘汰的缓存
+        struct Victim {
+            Hash128 key;       // 缓存键
+            uint64_t size = 0; // 缓存文件大小
+        };
+
+        // Stats 结构体记录磁盘层的用量和淘汰统计
+        struct Stats {
+            size_t objects = 0;         // 缓存的对象数
+            uint64_t bytes = 0;         // 缓存的字节数（包括正在写入的数据）
+            uint64_t pending_bytes = 0; // 正在写入的字节数
+            size_t evictions = 0;       // 被淘汰的对象数
+            uint64_t evicted_bytes = 0; // 被淘汰的字节数
+            uint64_t byte_budget = 0;   // 字节数上限，0 表示不限制
+            size_t object_budget = 0;   // 对象数上限，0 表示不限制
+        };
+
+        // 构造函数
+        // byte_budget: 字节数上限，object_budget: 对象数上限，0 表示不限制
+        DiskBudget(uint64_t byte_budget, size_t object_budget);
+
+        // 记录写入完成的缓存，已存在时更新其大小并保留其位置和访问计数
+        // accessed: 是否视为已被访问过（用于启动时恢复访问统计）
+        void add(const Hash128 &key, uint64_t size, bool accessed = false);
+        // 记录一次访问
+        void touch(const Hash128 &key);
+        // 移除缓存的记录（缓存被移除或重新写入）
+        void erase(const Hash128 &key);
+        // 是否记录了缓存
+        bool contains(const Hash128 &key) const;
+        // 记录正在写入的数据
+        void reserve(uint64_t bytes);
+        // 正在写入的数据写入完成或被丢弃
+        void release(uint64_t bytes);
+
+        // 是否超过容量
+        bool over_budget() const;
+        // 按淘汰策略选出最多 max_count 个缓存，使用量不超过容量；选中的缓存不再被记录
+        ::std::vector<Victim> select_victims(size_t max_count);
+
+        // 设置容量
+        void set_budget(uint64_t byte_budget, size_t object_budget);
+        // 获取统计
+        Stats stats() const;
+
+    private:
+        // KeyHash 结构体是缓存键的哈希函数，缓存键本身就是均匀的哈希值
+        struct KeyHash {
+            size_t operator()(const Hash128 &key) const { return static_cast<size_t>(key.low ^ key.high); }
+        };
+
+        // Entry 结构体表示一个记录的缓存
+        struct Entry {
+            Hash128 key;       // 缓存键
+            uint64_t size = 0; // 缓存文件大小
+            int freq = 0;      // 访问计数
+            bool main = false; // 是否在主队列中
+        };
+        using Queue = ::std::list<Entry>;    // 队列，新的缓存在前
+        using Ghosts = ::std::list<Hash128>; // 幽灵队列，新的键在前
+
+        // 处理小队列末尾的缓存：被访问过的移入主队列，否则选为淘汰对象
+        void evict_small(::std::vector<Victim> &victims);
+        // 处理主队列末尾的缓存：被访问过的降低访问计数后重新插入，否则选为淘汰对象
+        void evict_main(::std::vector<Victim> &victims);
+        // 把被淘汰的缓存的键记入幽灵队列
+        void remember(const Hash128 &key);
+
+        Queue small_;                                                     // 小队列
+        Queue main_;                                                      // 主队列
+        ::std::unordered_map<Hash128, Queue::iterator, KeyHash> index_;   // 键到缓存的索引
+        Ghosts ghost_;                                                    // 幽灵队列
+        ::std::unordered_map<Hash128, Ghosts::iterator, KeyHash> ghosts_; // 幽灵队列的索引
+        uint64_t small_bytes_ = 0;                                        // 小队列中的字节数
+        uint64_t main_bytes_ = 0;                                         // 主队列中的字节数
+        uint64_t pending_bytes_ = 0;                                      // 正在写入的字节数
+        uint64_t byte_budget_;                                            // 字节数上限
+        size_t object_budget_;                                            // 对象数上限
+        size_t evictions_ = 0;                                            // 被淘汰的对象数
+        uint64_t evicted_bytes_ = 0;                                      // 被淘汰的字节数
+    }; // class DiskBudget
+
+} // namespace my
+
+#endif // _DISK_BUDGET_H_INCLUDED_
@@ -0,0 +1,135 @@
+#ifndef _DNS_RESOLVER_H_INCLUDED_
+#define _DNS_RESOLVER_H_INCLUDED_
+
+#include "./SimpleThreadPool.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace my
+{
+    // DnsResolver 类提供带缓存的异步主机名解析
+    // 缓存按主机名分片加锁，遵循记录的 TTL，并缓存不存在的域名（NXDOMAIN）
+    // 对同一主机名的并发解析只会发起一次查询
+    class DnsResolver
+    {
+    public:
+        using Clock = ::std::chrono::steady_clock; // 计时使用的时钟
+
+        // Status 枚举表示解析结果的状态
+        enum class Status {
+            OK,        // 解析成功
+            NOT_FOUND, // 域名不存在（会被缓存）
+            FAILED,    // 查询失败，如超时或服务器错误（不会被缓存）
+        };
+
+        // Result 结构体表示一次解析的结果
+        struct Result {
+            Status status = Status::FAILED;         // 解析状态
+            ::std::vector<::std::string> addresses; // IPv4 地址列表
+            ::std::chrono::seconds ttl{0};          // 记录的 TTL
+            int error_code = 0;                     // 失败时的错误码
+
+            // 获取第一个地址，解析失败时抛出异常
+            const ::std::string &address(::std::string_view host) const;
+        };
+
+        // 解析后端类型，同步地完成一次查询（在解析线程中调用）
+        using Backend = ::std::function<Result(const ::std::string &host)>;
+        // 异步解析完成时的回调类型
+        using Callback = ::std::function<void(const Result &result)>;
+
+        static constexpr size_t SHARD_COUNT = 16;                                         // 缓存分片数
+        static constexpr ::std::chrono::seconds DEFAULT_TTL = ::std::chrono::seconds(60); // 后端无法提供 TTL 时使用的 TTL
+
+        // 构造函数，接受解析线程数和解析后端
+        explicit DnsResolver(int worker_count = 2, Backend backend = system_backend());
+        // 默认析构函数
+        ~DnsResolver() = default;
+
+        // 同步解析，命中缓存时不会阻塞；并发的相同查询会等待同一次解析
+        Result resolve(::std::string_view host);
+        // 异步解析，返回可在任意线程等待的 future
+        ::std::shared_future<Result> resolve_async(::std::string_view host);
+        // 异步解析，命中缓存时在调用线程中立即调用回调，否则在解析线程中调用
+        void resolve_async(::std::string_view host, Callback callback);
+        // 只查询缓存，不发起解析
+        ::std::optional<Result> lookup_cache(::std::string_view host);
+
+        // 清空缓存
+        void clear();
+        // 设置不存在的域名的缓存时间
+        void set_negative_ttl(::std::chrono::seconds ttl);
+        // 设置缓存时间上限
+        void set_max_ttl(::std::chrono::seconds ttl);
+
+        // 获取命中缓存的次数
+        size_t hit_count() const;
+        // 获取发起查询的次数
+        size_t miss_count() const;
+        // 获取合并到进行中查询的次数
+        size_t coalesced_count() const;
+
+        // 使用系统解析器（DnsQuery 提供 TTL，失败时回退到 getaddrinfo）的后端
+        static Backend system_backend();
+        // 使用 hosts 格式文件的后端，不访问网络，便于测试
+        static Backend hosts_file_backend(::std::string path, ::std::chrono::seconds ttl = DEFAULT_TTL);
+
+        // 禁用拷贝构造函数
+        DnsResolver(const DnsResolver &) = delete;
+        // 禁用拷贝赋值运算符
+        DnsResolver &operator=(const DnsResolver &) = delete;
+
+    private:
+        // 缓存项
+        struct Entry {
+            Result result;             // 解析结果
+            Clock::time_point expires; // 过期时间
+        };
+
+        // 进行中的查询
+        struct Pending {
+            ::std::promise<Result> promise;      // 查询结果
+            ::std::shared_future<Result> future; // 供等待者共享的 future
+            ::std::vector<Callback> callbacks;   // 完成时调用的回调
+        };
+
+        // 缓存分片
+        struct Shard {
+            ::std::mutex mutex;                                                      // 保护本分片的互斥锁
+            ::std::unordered_map<::std::string, Entry> entries;                      // 缓存项
+            ::std::unordered_map<::std::string, ::std::shared_ptr<Pending>> pending; // 进行中的查询
+        };
+
+        // 规范化主机名（小写）
+        static ::std::string normalize(::std::string_view host);
+        // 获取主机名所在的分片
+        Shard &shard_of(const ::std::string &key);
+        // 在持有分片锁时查询缓存
+        ::std::optional<Result> find_locked(Shard &shard, const ::std::string &key);
+        // 开始一次查询，或加入进行中的查询
+        ::std::shared_ptr<Pending> start_lookup(const ::std::string &key, Callback callback);
+        // 在解析线程中执行查询并唤醒等待者
+        void run_lookup(::std::string key, ::std::shared_ptr<Pending> pending);
+
+        Backend backend_;                           // 解析后端
+        ::std::array<Shard, SHARD_COUNT> shards_;   // 缓存分片
+        ::std::atomic<long long> negative_ttl_{30}; // 不存在的域名的缓存时间（秒）
+        ::std::atomic<long long> max_ttl_{3600};    // 缓存时间上限（秒）
+        ::std::atomic_size_t hit_cnt_{0};           // 命中缓存的次数
+        ::std::atomic_size_t miss_cnt_{0};          // 发起查询的次数
+        ::std::atomic_size_t coalesced_cnt_{0};     // 合并到进行中查询的次数
+        SimpleThreadPool workers_;                  // 解析线程（最后构造，最先析构）
+    }; // class DnsResolver
+
+} // namespace my
+
+#endif // _DNS_RESOLVER_H_INCLUDED_
@@ -0,0 +1,82 @@
+#ifndef _EVENT_LOOP_H_INCLUDED_
+#define _EVENT_LOOP_H_INCLUDED_
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <winsock2.h>
+
+namespace my
+{
+    // EventLoop 类实现一个基于就绪通知（WSAPoll）的单线程事件循环
+    // 所有注册的套接字都应当设置为非阻塞模式
+    class EventLoop
+    {
+    public:
+        // 事件回调类型，参数为 WSAPoll 返回的 revents
+        using Handler = ::std::function<void(short revents)>;
+        // 投递到事件循环线程执行的任务类型
+        using Task = ::std::function<void()>;
+
+        static constexpr short READ = POLLRDNORM;  // 可读事件
+        static constexpr short WRITE = POLLWRNORM; // 可写事件
+
+        // 默认构造函数
+        EventLoop() = default;
+        // 析构函数，关闭唤醒套接字
+        ~EventLoop();
+
+        // 创建唤醒套接字，之后其他线程可以通过 post 唤醒事件循环（需在 Winsock 初始化后调用）
+        bool open();
+        // 关闭唤醒套接字
+        void close();
+
+        // 注册套接字及其关注的事件和回调
+        void add(SOCKET s, short events, Handler handler);
+        // 修改套接字关注的事件
+        void modify(SOCKET s, short events);
+        // 注销套接字（不会关闭套接字）
+        void remove(SOCKET s);
+        // 检查套接字是否已注册
+        bool contains(SOCKET s) const;
+        // 获取已注册的套接字数量
+        size_t size() const;
+
+        // 从任意线程投递任务，任务将在事件循环线程中执行（线程安全）
+        void post(Task task);
+
+        // 等待事件并分发一次，timeout_ms 为最长等待时间（毫秒）
+        // 返回值: 本次分发的事件数量，出错时返回 SOCKET_ERROR
+        int run_once(int timeout_ms);
+
+        // 禁用拷贝构造函数
+        EventLoop(const EventLoop &) = delete;
+        // 禁用拷贝赋值运算符
+        EventLoop &operator=(const EventLoop &) = delete;
+
+    private:
+        // 执行所有已投递的任务
+        void run_posted_tasks();
+
+        // 一次就绪通知
+        struct ReadyItem {
+            SOCKET socket;                      // 就绪的套接字
+            short revents;                      // 就绪的事件
+            ::std::shared_ptr<Handler> handler; // 收集时注册的回调
+        };
+
+        ::std::vector<WSAPOLLFD> poll_fds_;                  // WSAPoll 参数数组
+        ::std::vector<::std::shared_ptr<Handler>> handlers_; // 与 poll_fds_ 一一对应的回调
+        ::std::unordered_map<SOCKET, size_t> index_;         // 套接字到数组下标的映射
+        ::std::vector<ReadyItem> ready_;                     // 本轮就绪的套接字（复用以避免分配）
+
+        SOCKET wakeup_socket_ = INVALID_SOCKET; // 连接到自身的 UDP 套接字，用于跨线程唤醒 WSAPoll
+        ::std::vector<Task> posted_tasks_;      // 其他线程投递的任务
+        ::std::mutex posted_mutex_;             // 保护 posted_tasks_ 的互斥锁
+    }; // class EventLoop
+
+} // namespace my
+
+#endif // _EVENT_LOOP_H_INCLUDED_
@@ -0,0 +1,94 @@
+#ifndef _HOT_CACHE_H_INCLUDED_
+#define _HOT_CACHE_H_INCLUDED_
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace my
+{
+    // HotCache 类是按字节数限制容量的内存缓存，保存不可变的共享缓冲，取出的缓冲在被淘汰后仍可继续使用
+    // 淘汰策略为 S3-FIFO：
+    //   新对象先进入小队列（约占容量的 10%），在小队列中被访问过的对象移入主队列，其余的被淘汰并记入幽灵队列；
+    //   幽灵队列中的对象再次放入时直接进入主队列；主队列按 FIFO 淘汰，被访问过的对象降低访问计数后重新插入
+    // 一次性访问的大量对象（如扫描）只会经过小队列，不会挤掉主队列中的热点对象
+    // 不是线程安全的，由使用者加锁
+    class HotCache
+    {
+    public:
+        using Buffer = ::std::shared_ptr<const ::std::string>; // 缓存的数据
+
+        static constexpr int MAX_FREQ = 3;       // 访问计数的上限
+        static constexpr int SMALL_PERCENT = 10; // 小队列占容量的百分比
+
+        // Stats 结构体记录内存缓存的统计
+        struct Stats {
+            size_t hits = 0;        // 命中次数
+            size_t misses = 0;      // 未命中次数
+            uint64_t hit_bytes = 0; // 命中时提供的字节数
+            size_t objects = 0;     // 缓存的对象数
+            size_t bytes = 0;       // 缓存的字节数
+            size_t evictions = 0;   // 被淘汰的对象数
+            size_t budget = 0;      // 容量（字节）
+        };
+
+        // 构造函数
+        // budget: 容量（字节）
+        // max_object_size: 可以缓存的最大对象（字节）
+        HotCache(size_t budget, size_t max_object_size);
+
+        // 获取对象，命中时增加其访问计数
+        // 返回值: 缓存的数据，未命中时返回空指针
+        Buffer get(const ::std::string &key);
+        // 放入对象，已存在时替换其数据
+        // 返回值: 是否已放入（对象超过大小限制时不放入，并移除已有的对象）
+        bool put(const ::std::string &key, Buffer buffer);
+        // 移除对象
+        void erase(const ::std::string &key);
+        // 是否缓存了对象（不影响访问计数和统计）
+        bool contains(const ::std::string &key) const;
+
+        // 设置容量，超出的部分立即淘汰
+        void set_budget(size_t budget);
+        // 获取可以缓存的最大对象
+        size_t max_object_size() const;
+        // 获取统计
+        Stats stats() const;
+
+    private:
+        // Entry 结构体表示一个缓存的对象
+        struct Entry {
+            ::std::string key; // 键
+            Buffer buffer;     // 数据
+            int freq = 0;      // 访问计数
+            bool main = false; // 是否在主队列中
+        };
+        using Queue = ::std::list<Entry>;          // 队列，新对象在前
+        using Ghosts = ::std::list<::std::string>; // 幽灵队列，新的键在前
+
+        // 淘汰对象直到不超过容量
+        void evict();
+        // 处理小队列末尾的对象：被访问过的移入主队列，否则淘汰
+        void evict_small();
+        // 处理主队列末尾的对象：被访问过的降低访问计数后重新插入，否则淘汰
+        void evict_main();
+        // 把被淘汰的对象的键记入幽灵队列
+        void remember(const ::std::string &key);
+
+        Queue small_;                                                       // 小队列
+        Queue main_;                                                        // 主队列
+        ::std::unordered_map<::std::string, Queue::iterator> index_;        // 键到对象的索引
+        Ghosts ghost_;                                                      // 幽灵队列
+        ::std::unordered_map<::std::string, Ghosts::iterator> ghost_index_; // 幽灵队列的索引
+        size_t small_bytes_ = 0;                                            // 小队列中的字节数
+        size_t main_bytes_ = 0;                                             // 主队列中的字节数
+        size_t budget_;                                                     // 容量
+        size_t max_object_size_;                                            // 可以缓存的最大对象
+        Stats stats_;                                                       // 命中、未命中和淘汰的统计
+    }; // class HotCache
+
+} // namespace my
+
+#endif // _HOT_CACHE_H_INCLUDED_
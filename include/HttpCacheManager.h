@@ -1,44 +1,163 @@
 #ifndef _HTTP_CACHE_MANAGER_H_INCLUDED_
 #define _HTTP_CACHE_MANAGER_H_INCLUDED_
 
+#include "./BoundedQueue.hpp"
+#include "./CacheFile.h"
+#include "./CacheIndex.h"
+#include "./CacheKey.h"
+#include "./CachePolicy.h"
+#include "./DiskBudget.h"
+#include "./HotCache.h"
 #include "./HttpRequest.h"
 #include "./HttpResponseHead.h"
-#include <map>
+#include "./SegmentStore.h"
+#include "./SharedFetch.h"
+#include "./SimpleThreadPool.hpp"
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace my
 {
 
     // HttpCacheManager 类用于管理 HTTP 缓存
+    // 缓存分为两层：所有缓存都保存在磁盘上，较小的缓存同时保存在内存层中，命中内存层时不再访问文件
+    // 磁盘上不超过 SegmentStore::MAX_OBJECT 的响应顺序追加到段文件中（SegmentStore），更大的响应保存在单独的缓存文件中
+    // 缓存键是规范化 URL 的 128 位哈希值，同时用作缓存文件名；条目记录 URL 的另一个哈希值，不符（键冲突）时视为未命中
+    // 缓存的元数据保存在内存映射的索引（CacheIndex）中，每次修改立即写入，条目在首次访问时从索引加载
+    // 每个缓存记录其新鲜度（RFC 9111），新鲜的缓存可以不经服务器验证直接使用
+    // 缓存条目按键的哈希值分散到 SHARD_COUNT 个分片中，分片锁只保护条目的查找和内存层；
+    // 每个条目有自己的锁，保护条目的状态和对应的缓存文件，文件的读写只持有条目锁，不同 URL 的操作互不阻塞
+    // 需要同时持有两种锁时，先获取条目锁再获取分片锁；索引、磁盘层的用量和段文件各有自己的锁，总是最后获取
+    // 同一 URL 同时只有一个请求向服务器获取响应并写入缓存，其他并发请求作为读者共享该响应
+    // 磁盘层按字节数和对象数限制容量（DiskBudget），超出时由后台线程分批淘汰缓存，不阻塞请求
+    // 段文件中被移除的响应留下的空间由同一个后台线程整理回收
+    // 写入缓存不在请求的线程中进行：收到的数据块经无锁的有界队列交给写入线程，由它合并成大块顺序写入，
+    // 响应完整后先写入段文件或临时文件，再在条目锁内改名、写入索引，之后缓存才可用（写后发布）
     class HttpCacheManager
     {
     public:
-        // 构造函数，接受缓存目录路径
-        HttpCacheManager(::std::string_view cache_dir);
-        // 析构函数
+        static constexpr size_t MEMORY_BUDGET = 64 * 1024 * 1024; // 内存层的默认容量（字节）
+        static constexpr size_t MAX_MEMORY_OBJECT = 256 * 1024;   // 内存层可以缓存的最大响应（字节）
+        static constexpr size_t SHARD_COUNT = 16;                 // 分片数
+        static constexpr uint64_t DISK_BUDGET = 4ULL << 30;       // 磁盘层的默认容量（字节）
+        static constexpr size_t DISK_OBJECT_BUDGET = 1 << 20;     // 磁盘层默认最多保存的缓存文件数
+        static constexpr size_t EVICTION_BATCH = 64;              // 后台淘汰每批选出的缓存数，每批之间释放锁
+        static constexpr uint64_t SEGMENTS_PER_BUDGET = 8;        // 段文件大小不超过磁盘层容量的几分之一，使整理不必反复重写大部分缓存
+        static constexpr size_t WRITE_QUEUE_SIZE = 1024;          // 写入队列的容量（数据块数），必须是 2 的幂
+        static constexpr size_t WRITE_BATCH = 1 << 20;            // 写入单独的缓存文件时每次写入的最少字节数
+
+        // DiskStats 结构体记录磁盘层的统计
+        struct DiskStats {
+            size_t hits = 0;              // 命中次数（打开缓存文件或把缓存文件读入内存层）
+            size_t misses = 0;            // 未命中次数
+            uint64_t hit_bytes = 0;       // 命中时提供的字节数
+            size_t objects = 0;           // 缓存文件数
+            uint64_t bytes = 0;           // 缓存文件的总字节数（包括正在写入的数据）
+            uint64_t budget = 0;          // 容量（字节）
+            size_t object_budget = 0;     // 最多保存的缓存文件数
+            size_t evictions = 0;         // 被淘汰的缓存文件数
+            uint64_t evicted_bytes = 0;   // 被淘汰的字节数
+            SegmentStore::Stats segments; // 段文件
+        };
+
+        // Validators 结构体记录缓存的验证器，用于向服务器发送条件请求
+        struct Validators {
+            ::std::string modified_time; // 最后修改时间，没有时为空
+            ::std::string etag;          // ETag，没有时为空
+        };
+
+        // CacheStats 结构体记录各层缓存的统计
+        struct CacheStats {
+            HotCache::Stats memory; // 内存层
+            DiskStats disk;         // 磁盘层
+            size_t fetches = 0;     // 作为发起者向服务器获取的次数
+            size_t collapsed = 0;   // 作为读者加入进行中的获取的次数
+            size_t written = 0;     // 写入线程完成写入的缓存数
+            size_t dropped = 0;     // 写入队列已满而放弃写入的缓存数
+        };
+
+        // FetchRole 枚举表示请求在同一 URL 的并发获取中的角色
+        enum class FetchRole {
+            NONE,   // 未参与
+            LEADER, // 发起者：向服务器请求并写入缓存，收到的数据同时交给读者
+            READER, // 读者：不向服务器请求，共享发起者收到的响应
+            BYPASS, // 无法加入进行中的获取：向服务器请求，但不写入缓存
+        };
+
+        // Fetch 结构体表示请求参与的获取
+        struct Fetch {
+            FetchRole role = FetchRole::NONE;       // 角色
+            ::std::shared_ptr<SharedFetch> shared;  // 共享的获取，结束后为空
+            size_t reader = SharedFetch::NO_READER; // 读者编号
+        };
+
+        // Fill 结构体表示一个正在写入的缓存，定义在类之后，使用者只持有其句柄
+        struct Fill;
+        using FillHandle = ::std::shared_ptr<Fill>; // 正在写入的缓存，由 create_cache 返回，之后的写入操作以它为参数
+
+        // 构造函数，接受缓存目录路径、内存层的容量和磁盘层的容量
+        HttpCacheManager(::std::string_view cache_dir, size_t memory_budget = MEMORY_BUDGET, uint64_t disk_budget = DISK_BUDGET,
+                         size_t disk_object_budget = DISK_OBJECT_BUDGET);
+        // 析构函数，等待写入线程处理完已提交的缓存，停止后台淘汰和整理，索引在析构时写回磁盘
         ~HttpCacheManager();
 
         // 检查指定 URL 是否有缓存
         bool has_cache(::std::string_view url) const;
-        // 读取指定 URL 的缓存数据
-        int read_cache(::std::string_view url, char *buffer, int buf_size, int start) const;
-        // 追加数据到指定 URL 的缓存
-        void append_cache(::std::string_view url, const char *data, int data_size);
+        // 打开指定 URL 的缓存文件，之后的读取和发送无需持有锁
+        // 缓存已被移除或正在重新写入时抛出异常
+        // overlapped: 是否以 FILE_FLAG_OVERLAPPED 打开
+        CacheFile open_cache(::std::string_view url, bool overlapped = false) const;
+        // 获取指定 URL 在内存层中的缓存，内存层未命中时把不超过 MAX_MEMORY_OBJECT 的缓存文件读入内存层
+        // 返回值: 缓存的完整响应，无法从内存层提供时返回空指针
+        HotCache::Buffer get_memory_cache(::std::string_view url);
+        // 追加一块数据到正在写入的缓存，数据块交给写入线程，不等待写入
+        void append_cache(const FillHandle &fill, SharedFetch::Chunk chunk);
 
         // 创建指定 URL 的缓存
-        void create_cache(::std::string_view url);
-        // 更新指定 URL 的缓存时间
-        bool update_cache_time(::std::string_view url);
+        // 返回值: 正在写入的缓存
+        FillHandle create_cache(::std::string_view url);
+        // 响应完整后提交缓存及其新鲜度，由写入线程完成写入后缓存才可用
+        // 返回值: 是否提交，缓存已被放弃（写入队列已满、已被移除或重新创建）时返回 false
+        bool commit_cache(const FillHandle &fill, const Freshness &freshness);
+        // 放弃正在写入的缓存（响应不完整或不能缓存），已提交或已放弃时不做任何事
+        void abort_cache(const FillHandle &fill);
+        // 服务器确认缓存仍然有效后更新指定 URL 的缓存的新鲜度
+        bool refresh_cache(::std::string_view url, const Freshness &freshness);
         // 移除指定 URL 的缓存
         void remove_cache(::std::string_view url);
 
-        // 获取指定 URL 的最后修改时间
-        ::std::string get_modified_time(::std::string_view url) const;
-        // 获取指定 URL 的 ETag
-        ::std::string get_etag(::std::string_view url) const;
+        // 获取指定 URL 的缓存的验证器（最后修改时间和 ETag），两者在同一次加锁中读取，没有缓存时返回空
+        ::std::optional<Validators> get_validators(::std::string_view url) const;
+        // 获取指定 URL 的缓存的新鲜度，没有缓存时返回空
+        ::std::optional<Freshness> get_freshness(::std::string_view url) const;
+
+        // 加入指定 URL 进行中的获取，没有进行中的获取时成为发起者，不能缓存的 URL 返回 BYPASS
+        Fetch join_fetch(::std::string_view url);
+        // 没有进行中的获取时成为指定 URL 的获取的发起者，否则不参与（role 为 NONE）
+        Fetch lead_fetch(::std::string_view url);
+        // 结束参与获取：发起者以 state 结束获取并使之后的请求不再加入，读者离开获取；已结束时不做任何事
+        // 发起者的响应已提交但尚未写入时，获取在写入完成之前继续接受读者
+        void end_fetch(::std::string_view url, Fetch &fetch, SharedFetch::State state);
 
-        // 获取指定 URL 的缓存键
+        // 设置内存层的容量（平均分配给各分片），超出的部分立即淘汰
+        void set_memory_budget(size_t budget);
+        // 设置磁盘层的容量（字节数和缓存文件数，0 表示不限制），超出的部分在后台淘汰
+        void set_disk_budget(uint64_t budget, size_t object_budget);
+        // 获取各层缓存的统计
+        CacheStats stats() const;
+
+        // 指定 URL 能否缓存：只有能规范化的绝对 http 或 https URL 才有缓存键，其他 URL 的请求不读写缓存
+        static bool is_cacheable(::std::string_view url);
+        // 获取指定 URL 的缓存键：规范化 URL 的 MurmurHash3 哈希值，32 个十六进制数字
+        // 结果与平台和编译器无关，缓存目录可以在不同的构建之间继续使用；不是 http 或 https URL 时返回空字符串
         static ::std::string get_key(::std::string_view url);
 
         // 禁用拷贝构造函数
@@ -51,19 +170,168 @@ namespace my
         HttpCacheManager &operator=(HttpCacheManager &&) = delete;
 
     private:
+        static constexpr uint32_t CHECK_SEED = 0x5bd1e995; // 计算 URL 校验哈希时使用的种子
+
+        // FillEnd 枚举表示请求的线程如何结束正在写入的缓存
+        enum class FillEnd {
+            NONE,   // 仍在接收
+            COMMIT, // 响应完整，写入后发布
+            ABORT,  // 放弃，丢弃已写入的数据
+        };
+
+        // WriteJob 结构体是写入队列中的一项
+        struct WriteJob {
+            FillHandle fill;          // 所属的缓存
+            SharedFetch::Chunk chunk; // 数据块，与读者共享同一份数据
+        };
+
+        // Key 结构体表示 URL 对应的缓存键
+        struct Key {
+            ::std::string url;  // 规范化的 URL，内存层和进行中的获取以此为键
+            ::std::string name; // 缓存键的十六进制表示，缓存条目和缓存文件以此为键
+            Hash128 hash;       // 缓存键，索引以此为键
+            Hash128 check;      // URL 的校验哈希
+            bool valid = false; // URL 能否缓存，规范化失败（如 origin-form 或非 http(s) URL）时为 false，不能用于任何缓存操作
+        };
+
+        // Entry 结构体表示一个缓存键的缓存条目
+        struct Entry {
+            ::std::mutex mutex;              // 保护条目的状态和对应的缓存文件
+            ::std::string url;               // 规范化的 URL，用于淘汰时移除内存层中的缓存（由分片锁保护），从索引加载时未知
+            Hash128 check;                   // 缓存的 URL 的校验哈希，与请求的 URL 不符时说明键冲突
+            bool cached = false;             // 缓存文件是否完整可用
+            bool filling = false;            // 缓存文件是否正在写入
+            ::std::string modified_time;     // 最后修改时间
+            ::std::string etag;              // ETag
+            Freshness freshness;             // 新鲜度
+            FillHandle fill;                 // 正在写入的缓存，写入线程发布或放弃它后为空
+            SegmentStore::Location location; // 响应在段文件中的位置，segment 为 0 时保存在单独的缓存文件中
+        };
+
+        // Shard 结构体表示一个分片
+        struct Shard {
+            ::std::mutex mutex;                                                          // 保护条目的查找和内存层
+            ::std::unordered_map<::std::string, ::std::shared_ptr<Entry>> entries;       // 缓存条目
+            HotCache hot{0, MAX_MEMORY_OBJECT};                                          // 内存层中属于该分片的部分，以 URL 为键
+            ::std::unordered_map<::std::string, ::std::shared_ptr<SharedFetch>> fetches; // 进行中的获取，以 URL 为键
+        };
+
+        // 获取指定 URL 的缓存键，不能缓存的 URL 得到 valid 为 false 的键，公开的操作都拒绝这样的键
+        static Key key_of(::std::string_view url);
+        // 获取键所在的分片
+        Shard &shard_of(const Key &key) const;
+        // 查找缓存条目，不在内存中时从索引加载，都不存在时返回空指针
+        ::std::shared_ptr<Entry> find_entry(const Key &key) const;
+        // 查找缓存条目，不存在时创建
+        ::std::shared_ptr<Entry> get_entry(const Key &key);
+        // 查找缓存条目，调用时必须持有分片锁
+        ::std::shared_ptr<Entry> find_locked(Shard &shard, const Key &key) const;
+        // 释放不再使用的缓存条目：既没有缓存也没有在写入、且没有其他使用者时从分片中移除
+        // 调用时不能持有该条目的锁
+        void release_entry(const Key &key, ::std::shared_ptr<Entry> &entry);
+        // 移除条目对应的缓存（内存层、索引、磁盘层的用量和磁盘上的数据），调用时必须持有条目锁
+        // 返回值: 响应所在的段是否需要整理
+        bool discard_locked(const Key &key, Entry &entry);
+        // 从索引恢复磁盘层的用量、访问统计和各段的有效字节数，移除没有索引项的缓存文件和段文件
+        void load_budget();
+        // 记录一次磁盘层的访问，正在淘汰时不等待（访问统计是近似的）
+        void touch_budget(const Hash128 &key) const;
+        // 磁盘层超过容量时开始后台淘汰，已在淘汰时不做任何事
+        void schedule_eviction();
+        // 在后台线程中分批淘汰缓存，直到不超过容量
+        void run_eviction();
+        // 淘汰一个缓存，缓存在被选中后已重新写入时不做任何事
+        // 返回值: 响应所在的段是否需要整理
+        bool evict_cache(const DiskBudget::Victim &victim);
+        // 有需要整理的段时开始后台整理，已在整理时不做任何事
+        void schedule_compaction();
+        // 唤醒写入线程
+        void signal_writer();
+        // 写入线程：取出数据块并写入，处理请求的线程已结束的缓存，没有工作时等待唤醒
+        void run_writer();
+        // 在写入线程中处理一个数据块：记录在内存中，超过 SegmentStore::MAX_OBJECT 后积累到 WRITE_BATCH 再写入临时文件
+        void write_chunk(Fill &fill, const SharedFetch::Chunk &chunk);
+        // 在写入线程中写入临时文件中积累的数据
+        void flush_fill(Fill &fill);
+        // 在写入线程中结束一个缓存：提交的完整响应写入后发布，其他情况丢弃已写入的数据
+        void finish_fill(Fill &fill);
+        // 在后台线程中整理段文件：把仍有效的响应移到当前段，之后删除整个段文件
+        void run_compaction();
+        // 把段中的一个响应移到当前段，响应已被移除、重新写入或已移动时不做任何事
+        // 返回值: 是否移动
+        bool move_object(const SegmentStore::Object &object);
+        // 把新鲜度写入索引项
+        static void store_freshness(CacheIndex::Item &item, const Freshness &freshness);
+        // 从索引项中读取新鲜度
+        static Freshness freshness_of(const CacheIndex::Item &item);
+        // 获取缓存键的十六进制表示
+        static ::std::string name_of(const Hash128 &hash);
+        // 获取缓存文件路径
+        ::std::string path_of(const ::std::string &key) const;
+        // 获取正在写入的缓存的临时文件路径，同一 URL 先后写入的缓存使用不同的临时文件
+        ::std::string temp_path_of(const Fill &fill) const;
+        // 从响应头部中读取 Last-Modified 和 ETag
+        // 返回值: 是否有其中之一
+        static bool parse_validators(::std::string_view head, ::std::string &modified_time, ::std::string &etag);
+
         // 缓存目录路径
         ::std::string cache_dir_;
-        // 缓存时间映射文件名
-        ::std::string cache_time_map_filename_;
-        // 缓存时间映射
-        ::std::map<::std::string, ::std::string> cache_time_map_;
-        // 缓存 ETag 映射
-        ::std::map<::std::string, ::std::string> cache_etag_map_;
-
-        // 用于保护缓存数据的互斥锁
-        mutable ::std::mutex cache_mutex_;
+        // 缓存索引
+        ::std::unique_ptr<CacheIndex> index_;
+        // 段文件
+        SegmentStore segments_;
+        // 分片
+        mutable ::std::array<Shard, SHARD_COUNT> shards_;
+
+        // 磁盘层的统计
+        mutable ::std::atomic<size_t> disk_hits_{0};        // 命中次数
+        mutable ::std::atomic<size_t> disk_misses_{0};      // 未命中次数
+        mutable ::std::atomic<uint64_t> disk_hit_bytes_{0}; // 命中时提供的字节数
+        ::std::atomic<size_t> fetch_cnt_{0};                // 作为发起者获取的次数
+        ::std::atomic<size_t> collapsed_cnt_{0};            // 作为读者加入获取的次数
+
+        // 写入线程
+        BoundedQueue<WriteJob> write_queue_{WRITE_QUEUE_SIZE}; // 写入队列
+        ::std::mutex fills_mutex_;                             // 保护 new_fills_
+        ::std::vector<FillHandle> new_fills_;                  // 新创建的缓存，由写入线程取走，之后它负责结束这些缓存
+        ::std::atomic<uint32_t> write_signal_{0};              // 唤醒写入线程的计数，有新工作时递增
+        ::std::atomic_bool writer_stopping_{false};            // 是否正在析构，写入线程处理完已提交的缓存后退出
+        ::std::atomic<uint64_t> next_fill_id_{1};              // 下一个缓存的编号，用于临时文件名
+        ::std::atomic<size_t> written_cnt_{0};                 // 完成写入的缓存数
+        ::std::atomic<size_t> dropped_cnt_{0};                 // 写入队列已满而放弃写入的缓存数
+        ::std::thread writer_;                                 // 写入线程
+
+        // 磁盘层的容量、后台淘汰和整理
+        mutable ::std::mutex budget_mutex_;    // 保护 budget_，总是最后获取
+        mutable DiskBudget budget_;            // 磁盘层的用量和淘汰策略
+        ::std::atomic_bool evicting_{false};   // 是否正在后台淘汰
+        ::std::atomic_bool compacting_{false}; // 是否正在后台整理
+        ::std::atomic_bool stopping_{false};   // 是否正在析构，后台淘汰和整理在当前批次或当前响应结束后停止
+        SimpleThreadPool maintainer_{1};       // 后台线程，依次进行淘汰和整理（最后构造，最先析构）
     }; // class CacheManager
 
+    // HttpCacheManager::Fill 结构体表示一个正在写入的缓存
+    // 请求的线程只访问原子成员和提交前写入的新鲜度，其余成员只由写入线程访问
+    struct HttpCacheManager::Fill {
+        Key key;                                   // 缓存键
+        ::std::shared_ptr<Entry> entry;            // 所属的条目，结束后由写入线程释放
+        uint64_t id = 0;                           // 编号，用于临时文件名
+        ::std::atomic<FillEnd> end{FillEnd::NONE}; // 请求的线程如何结束它
+        ::std::atomic_bool dropped{false};         // 写入队列已满而放弃，之后的数据块不再放入队列
+        ::std::atomic<size_t> pushed{0};           // 放入写入队列的数据块数
+        Freshness freshness;                       // 新鲜度，提交时写入
+        ::std::shared_ptr<SharedFetch> fetch;      // 写入完成前继续接受读者的获取，由条目锁保护
+        size_t processed = 0;                      // 写入线程已处理的数据块数，等于 pushed 时已收到全部数据
+        uint64_t size = 0;                         // 响应的大小
+        uint64_t reserved = 0;                     // 写入期间计入磁盘层用量的字节数
+        ::std::string data;                        // 完整的响应，溢出后为积累的待写入数据
+        ::std::string head;                        // 响应头部，溢出时记录，用于读取验证器
+        bool spilled = false;                      // 是否超过 SegmentStore::MAX_OBJECT，超过后写入临时文件
+        bool failed = false;                       // 写入临时文件是否失败
+        bool finished = false;                     // 写入线程是否已结束它，之后队列中剩余的数据块被丢弃
+        ::std::ofstream file;                      // 临时文件
+    }; // struct HttpCacheManager::Fill
+
 } // namespace my
 
 #endif // _HTTP_CACHE_MANAGER_H_INCLUDED_
\ No newline at end of file
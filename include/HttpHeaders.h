@@ -0,0 +1,131 @@
+#ifndef _HTTP_HEADERS_H_INCLUDED_
+#define _HTTP_HEADERS_H_INCLUDED_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace my
+{
+    // HttpHeaders 类表示一组 HTTP 头部字段
+    // 字段保持插入顺序，允许同名字段，字段名不区分大小写（按字段名的哈希值过滤后再比较）
+    // 字段名和值连续存放在对象自带的缓冲区中，字段数和总长度不超过内置容量时不分配堆内存
+    class HttpHeaders
+    {
+    public:
+        static constexpr size_t INLINE_FIELDS = 32;  // 内置的字段容量
+        static constexpr size_t INLINE_BYTES = 2048; // 内置的字段名和值的存储容量（字节）
+
+        // Source 结构体表示一个字段在原始数据中所在的整行（含 CRLF），size 为 0 表示字段是新增或修改过的
+        struct Source {
+            uint32_t offset; // 起始位置
+            uint32_t size;   // 长度
+        };
+
+        // Field 结构体表示一个头部字段，指向 HttpHeaders 内部的存储，修改 HttpHeaders 后失效
+        struct Field {
+            ::std::string_view name;  // 字段名
+            ::std::string_view value; // 字段值
+        };
+
+        // 按插入顺序遍历头部字段的迭代器
+        class Iterator
+        {
+        public:
+            // 构造函数
+            Iterator(const HttpHeaders *headers, size_t index) : headers_(headers), index_(index) {}
+
+            Field operator*() const { return headers_->field(index_); }
+            Iterator &operator++()
+            {
+                ++index_;
+                return *this;
+            }
+            bool operator==(const Iterator &other) const { return index_ == other.index_; }
+
+        private:
+            const HttpHeaders *headers_; // 遍历的头部字段
+            size_t index_;               // 当前字段的下标
+        };
+
+        // 默认构造函数
+        HttpHeaders() = default;
+        // 拷贝构造函数，只复制已使用的部分
+        HttpHeaders(const HttpHeaders &other);
+        // 移动构造函数
+        HttpHeaders(HttpHeaders &&other) noexcept;
+        // 拷贝赋值运算符
+        HttpHeaders &operator=(const HttpHeaders &other);
+        // 移动赋值运算符
+        HttpHeaders &operator=(HttpHeaders &&other) noexcept;
+
+        // 追加一个字段，保留已有的同名字段
+        // source: 字段在原始数据中所在的行，原样转发时可以直接引用原始数据
+        void add(::std::string_view name, ::std::string_view value, Source source = {});
+        // 设置字段的值：替换第一个同名字段的值并删除其余的同名字段，不存在时追加
+        // 被替换的字段不再对应原始数据中的行
+        void set(::std::string_view name, ::std::string_view value);
+        // 删除所有同名字段
+        // 返回值: 删除的字段数
+        size_t erase(::std::string_view name);
+        // 删除所有字段
+        void clear();
+
+        // 获取第一个同名字段的值，不存在时返回空的 string_view（data() 为 nullptr）
+        ::std::string_view get(::std::string_view name) const;
+        // 是否存在同名字段
+        bool contains(::std::string_view name) const;
+        // 同名字段（可能有多个）的逗号分隔值中是否包含指定的标记，不区分大小写
+        bool has_token(::std::string_view name, ::std::string_view token) const;
+
+        // 获取字段数
+        size_t size() const;
+        // 是否没有字段
+        bool empty() const;
+        // 获取第 index 个字段
+        Field field(size_t index) const;
+        // 获取第 index 个字段在原始数据中所在的行
+        Source source(size_t index) const;
+        // 获取指向第一个字段的迭代器
+        Iterator begin() const;
+        // 获取指向最后一个字段之后的迭代器
+        Iterator end() const;
+
+    private:
+        // Entry 结构体表示一个字段在存储中的位置
+        struct Entry {
+            uint32_t name_offset;  // 字段名的起始位置
+            uint32_t name_size;    // 字段名的长度
+            uint32_t value_offset; // 字段值的起始位置
+            uint32_t value_size;   // 字段值的长度
+            uint32_t hash;         // 小写字段名的哈希值
+            Source source;         // 字段在原始数据中所在的行
+        };
+
+        // 计算字段名不区分大小写的哈希值
+        static uint32_t hash(::std::string_view name);
+        // 从 from 开始查找同名字段，找不到时返回 size()
+        size_t find(::std::string_view name, uint32_t name_hash, size_t from) const;
+        // 把字符串追加到存储中，返回其起始位置
+        uint32_t store(::std::string_view str);
+        // 获取存储中的一段
+        ::std::string_view view(uint32_t offset, uint32_t size) const;
+        // 获取字段数组
+        Entry *entries();
+        // 获取字段数组
+        const Entry *entries() const;
+        // 复制另一组头部字段
+        void copy_from(const HttpHeaders &other);
+
+        Entry inline_entries_[INLINE_FIELDS]; // 内置的字段数组
+        ::std::vector<Entry> heap_entries_;   // 字段数超过内置容量后使用的字段数组，非空时代替内置数组
+        size_t count_ = 0;                    // 字段数
+        char inline_bytes_[INLINE_BYTES];     // 内置的字段名和值的存储
+        ::std::string heap_bytes_;            // 超过内置容量后使用的存储，非空时代替内置存储
+        size_t used_ = 0;                     // 存储中已使用的字节数
+    }; // class HttpHeaders
+
+} // namespace my
+
+#endif // _HTTP_HEADERS_H_INCLUDED_
@@ -1,12 +1,22 @@
 #ifndef _HTTP_PROXY_SERVER_H_INCLUDED_
 #define _HTTP_PROXY_SERVER_H_INCLUDED_
 
+#include "./ConnectionPool.h"
+#include "./Coroutine.hpp"
+#include "./DnsResolver.h"
 #include "./Host.h"
 #include "./HttpCacheManager.h"
 #include "./HttpRequest.h"
+#include "./HttpResponseFramer.h"
 #include "./HttpRouterGuard.h"
+#include "./IoService.h"
 #include "./SimpleThreadPool.hpp"
+#include "./TimerWheel.h"
 #include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
 #include <windows.h>
 #include <winsock2.h>
 
@@ -19,28 +29,84 @@ namespace my
         NO_CACHE,      // 没有缓存
         FOUND,         // 找到缓存
         EXPIRED,       // 缓存已过期
+        SERVER_ERROR,  // 验证缓存时服务器出错（5xx）
+    };
+
+    // ClientStats 结构体记录客户端连接的复用情况
+    struct ClientStats {
+        size_t connections = 0;                 // 已关闭的客户端连接数
+        size_t requests = 0;                    // 这些连接上处理的请求总数
+        size_t reused_requests = 0;             // 在已有连接上处理的后续请求数
+        size_t max_requests_per_connection = 0; // 单个连接上处理的最大请求数
+
+        // 平均每个连接处理的请求数
+        double requests_per_connection() const
+        {
+            return connections == 0 ? 0.0 : static_cast<double>(requests) / connections;
+        }
+    };
+
+    // ProxyTimeouts 结构体表示一个代理服务器（监听端口）上各阶段的超时时间（毫秒），0 表示不限制
+    struct ProxyTimeouts {
+        int header_read = 10000; // 从开始接收一个请求到请求接收完整的最长时间
+        int connect = 5000;      // 连接服务器的最长时间
+        int first_byte = 10000;  // 发送请求后等待响应的第一个数据包的最长时间
+        int read = 10000;        // 接收响应期间两个数据包之间的最长间隔
+        int idle = 5000;         // 客户端连接在请求之间的最长空闲时间
+        int request = 60000;     // 处理一个请求（从开始处理到响应转发完）的最长时间，不包括 CONNECT 隧道
+        int tunnel_idle = 60000; // CONNECT 隧道的最长空闲时间
+    };
+
+    // StaleWindows 结构体表示缓存过期后仍可使用的默认时长（秒），用于响应中没有对应指令（RFC 5861）的缓存，0 表示不使用
+    // 响应中有 must-revalidate、proxy-revalidate、s-maxage 或 no-cache 时过期的缓存总是不可使用
+    struct StaleWindows {
+        int64_t while_revalidate = 0; // 过期后在后台验证期间仍可使用的时长（stale-while-revalidate）
+        int64_t if_error = 0;         // 过期后在服务器出错或超时时仍可使用的时长（stale-if-error）
     };
 
     // HttpProxyServer 类用于实现 HTTP 代理服务器
+    // 每个客户端连接由一个协程处理，协程在事件循环中等待异步的套接字操作，一个线程可以同时处理大量连接
     class HttpProxyServer
     {
     public:
-        static constexpr int MAX_BUFFER_SIZE = 65535; // 最大缓冲区大小
+        static constexpr int MAX_BUFFER_SIZE = 65535;           // 最大缓冲区大小
+        static constexpr int MAX_REQUESTS_PER_CONNECTION = 100; // 单个客户端连接上处理的最大请求数
+        static constexpr int MAX_BACKGROUND_REFRESHES = 32;     // 同时进行的后台验证的最大数量，超出时请求改为同步验证
 
         // 构造函数，初始化代理服务器
         HttpProxyServer(const char *p_ip, unsigned short p_port, bool use_cache = false);
         // 析构函数，清理资源
         ~HttpProxyServer();
 
-        // 运行代理服务器
+        // 运行代理服务器（单线程，所有客户端连接在一个事件循环中并发处理）
         bool run();
-        // 运行多线程代理服务器
+        // 运行多线程代理服务器（每个线程一个事件循环，客户端连接依次分配给各个事件循环）
         bool run_multithread();
+        // 运行事件循环代理服务器（与 run 相同）
+        bool run_event_loop();
         // 检查代理服务器是否正在运行
         bool is_running() const;
 
         // 获取路由守护对象
         HttpRouterGuard &router_guard();
+        // 获取到服务器的连接池
+        ConnectionPool &upstream_pool();
+        // 获取主机名解析器
+        DnsResolver &resolver();
+        // 获取缓存管理器
+        HttpCacheManager &cache_manager();
+        // 获取客户端连接的复用统计
+        ClientStats client_stats() const;
+        // 设置事件循环使用的 I/O 后端（需在运行之前调用），不可用时回退到 WSAPoll
+        void set_io_backend(IoService::Backend backend);
+        // 设置各阶段的超时时间（需在运行之前调用）
+        void set_timeouts(const ProxyTimeouts &timeouts);
+        // 获取各阶段的超时时间
+        const ProxyTimeouts &timeouts() const;
+        // 设置过期的缓存仍可使用的默认时长
+        void set_stale_windows(const StaleWindows &windows);
+        // 获取过期的缓存仍可使用的默认时长
+        const StaleWindows &stale_windows() const;
 
         // 禁用拷贝构造函数
         HttpProxyServer(const HttpProxyServer &) = delete;
@@ -52,30 +118,117 @@ namespace my
         HttpProxyServer &operator=(HttpProxyServer &&) = delete;
 
     private:
-        // 内部运行方法，支持单线程和多线程
-        bool inner_run(bool is_multithread);
-        // 处理客户端请求
-        void handle_client(int c_no, Host client);
+        // 一个线程上的事件循环
+        struct Reactor;
+        // 一个客户端连接的状态
+        struct Connection;
+
+        // 内部运行方法，reactor_count 为事件循环（线程）数
+        bool inner_run(size_t reactor_count);
+        // 在当前线程中运行事件循环，检测到键盘中断后关闭其上的所有连接
+        void run_reactor(Reactor &reactor);
+        // 在当前线程中以较低的优先级运行后台验证的事件循环
+        void run_refresh_reactor();
+        // 接受一个客户端连接，并交给一个事件循环处理
+        void accept_client(SOCKET s, int error_code, int &client_cnt);
+        // 在连接上启动一个定时器（替换 timer 中原有的定时器），timeout_ms 为 0 时只取消原有的定时器
+        void arm_timer(Connection &conn, TimerWheel::TimerId &timer, const char *name, int timeout_ms);
+        // 取消连接上的一个定时器
+        void disarm_timer(Connection &conn, TimerWheel::TimerId &timer);
+        // 结束连接（超时或停止），取消连接上未完成的操作
+        void expire_connection(Connection &conn, const char *reason);
+        // 处理客户端连接
+        Coroutine<void> handle_client(Reactor &reactor, int c_no, Host client);
+        // 处理客户端连接上的一个请求，返回是否可以继续使用该连接
+        Coroutine<bool> handle_request(Connection &conn, const HttpRequest &c_req);
+        // 记录一个客户端连接关闭时处理的请求数
+        void record_client_connection(int req_cnt);
+        // 输出客户端连接的复用统计
+        void log_client_stats() const;
 
-        // 检查缓存并接收数据
-        CheckCacheResult check_cache_and_recv(HttpRequest client_request, const Host &server, char *buffer, int buf_size, int &recv_size);
+        // 接收一次数据，timeout_ms 毫秒内没有完成时连接超时，name 为超时的名称
+        Coroutine<IoService::Result> receive(Connection &conn, SOCKET s, const char *name, int timeout_ms);
+        // 解析主机名，完成后在事件循环线程中继续
+        Coroutine<DnsResolver::Result> resolve(Reactor &reactor, ::std::string host);
+        // 建立到服务器的新连接，套接字保存在 conn.server 中
+        Coroutine<void> open_server_connection(Connection &conn);
+        // 在客户端和服务器之间双向转发数据，直到连接关闭或空闲超时
+        Coroutine<void> tunnel(Connection &conn, ::std::string s_hostname);
+        // 在隧道中把数据从一方转发给另一方，直到发送方关闭发送方向
+        Coroutine<void> relay(Connection &conn, SOCKET from, SOCKET to, ::std::string_view s_hostname, uint64_t &bytes);
+        // 记录一个隧道关闭时转发的字节数
+        void record_tunnel(::std::string_view s_hostname, uint64_t up_bytes, uint64_t down_bytes);
+        // 改写转发给服务器的请求，并返回初步的缓存检查结果
+        CheckCacheResult prepare_request(HttpRequest &client_request);
+        // 根据服务器响应的第一个数据包确定最终的缓存检查结果
+        CheckCacheResult check_cache_status(CheckCacheResult chk_res, const char *buffer, int recv_size);
+        // 响应转发结束后提交或放弃缓存
+        void finish_cache(const HttpCacheManager::FillHandle &fill, ::std::string_view url, int total_size, const Freshness &freshness);
+        // 服务器确认缓存仍然有效（304）后根据其响应头部更新缓存的新鲜度
+        void refresh_freshness(::std::string_view url, const HttpResponseHead &head, int64_t request_time);
+        // 检查缓存并接收第一个数据包
+        Coroutine<CheckCacheResult> check_cache_and_recv(Connection &conn, HttpRequest client_request, IoService::Result &first_packet);
+        // 取出连接池中的空闲连接或建立新连接，然后检查缓存并接收第一个数据包，复用的连接已失效时换用新连接重试一次
+        // request_time: 返回向服务器发送请求的时间
+        Coroutine<CheckCacheResult> request_from_server(Connection &conn, const HttpRequest &c_req, ::std::string_view s_hostname, const ::std::string &pool_key,
+                                                        IoService::Result &first_packet, int64_t &request_time);
         // 从缓存中响应请求
-        int answer_from_cache(::std::string_view url, const Host &client);
-        // 从服务器响应请求
-        int answer_from_server(CheckCacheResult chk_res, ::std::string_view url, const Host &client, const Host &server, char *buffer, int buf_size, int recv_size);
+        Coroutine<int> answer_from_cache(Connection &conn, ::std::string_view url, HttpResponseFramer &framer);
+        // 从服务器响应请求，shared 不为空时收到的数据同时交给同一 URL 的读者
+        // request_time: 向服务器发送请求的时间，用于计算响应的年龄
+        Coroutine<int> answer_from_server(Connection &conn, CheckCacheResult chk_res, ::std::string_view url, int64_t request_time, ::std::string first_packet,
+                                          HttpResponseFramer &framer, SharedFetch *shared = nullptr);
+        // 缓存新鲜且请求允许时，不经服务器验证直接从缓存响应请求；缓存过期但在 stale-while-revalidate 窗口内时同样响应，并在后台验证
+        // 返回值: 是否已从缓存响应了请求
+        Coroutine<bool> answer_from_fresh_cache(Connection &conn, const HttpRequest &c_req, bool &keep_alive);
+        // 验证缓存时服务器出错或超时，缓存在 stale-if-error 窗口内且请求允许时从过期的缓存响应请求
+        // 返回值: 是否已从缓存响应了请求
+        Coroutine<bool> answer_from_stale_cache(Connection &conn, const HttpRequest &c_req, bool &keep_alive);
+        // 开始在后台验证指定请求的缓存
+        // 返回值: 验证已开始或已有同一 URL 进行中的获取时返回 true，后台验证过多或正在停止时返回 false
+        bool start_background_refresh(const HttpRequest &c_req);
+        // 在后台验证的事件循环中向服务器验证缓存，服务器返回新的响应时写入缓存，fetch 为请求作为发起者参与的获取
+        Coroutine<void> refresh_in_background(HttpRequest c_req, HttpCacheManager::Fetch fetch);
+        // 加入同一 URL 进行中的获取，作为读者共享发起者收到的响应
+        // 返回值: 是否已作为读者响应了请求，否则 fetch 记录请求在获取中的角色
+        Coroutine<bool> answer_from_fetch(Connection &conn, const HttpRequest &c_req, HttpCacheManager::Fetch &fetch, HttpResponseFramer &framer, bool &keep_alive);
 
-        // 发送请求并接收响应
-        int send_and_recv(const HttpRequest &request, const Host &host, char *recv_buffer, int buf_size);
+        // 发送请求并接收响应的第一个数据包
+        Coroutine<IoService::Result> send_and_recv(Connection &conn, const HttpRequest &request);
 
         int p_no_;                       // 代理服务器编号
         Host proxy_;                     // 代理服务器主机信息
         bool use_cache_;                 // 是否使用缓存
         HttpCacheManager cache_manager_; // 缓存管理器
         HttpRouterGuard router_guard_;   // 路由守护对象
+        ConnectionPool upstream_pool_;   // 到服务器的连接池
         ::std::atomic_int task_count_;   // 任务计数
         ::std::atomic_bool is_running_;  // 运行状态
 
-        SimpleThreadPool thread_pool_; // 线程池
+        ::std::atomic_size_t client_conn_cnt_;       // 已关闭的客户端连接数
+        ::std::atomic_size_t client_req_cnt_;        // 客户端连接上处理的请求总数
+        ::std::atomic_size_t client_reused_req_cnt_; // 在已有连接上处理的后续请求数
+        ::std::atomic_size_t client_max_req_;        // 单个连接上处理的最大请求数
+        ::std::atomic_size_t tunnel_cnt_;            // 已关闭的 CONNECT 隧道数
+        ::std::atomic_uint64_t tunnel_up_bytes_;     // 隧道中从客户端转发给服务器的字节数
+        ::std::atomic_uint64_t tunnel_down_bytes_;   // 隧道中从服务器转发给客户端的字节数
+        ::std::atomic_size_t fresh_hit_cnt_;         // 不经验证直接从新鲜的缓存响应的请求数
+        ::std::atomic_size_t revalidated_cnt_;       // 经服务器确认（304）后从缓存响应的请求数
+        ::std::atomic_size_t stale_revalidate_cnt_;  // 在后台验证期间从过期的缓存响应的请求数
+        ::std::atomic_size_t stale_error_cnt_;       // 服务器出错时从过期的缓存响应的请求数
+        ::std::atomic_size_t refresh_cnt_;           // 完成的后台验证数
+        ::std::atomic_size_t refresh_failed_cnt_;    // 失败的后台验证数
+        ::std::atomic_int refreshing_cnt_;           // 进行中的后台验证数
+
+        SimpleThreadPool thread_pool_; // 线程池（多线程模式下运行其余的事件循环）
+
+        IoService::Backend io_backend_;                      // 事件循环请求使用的 I/O 后端
+        ProxyTimeouts timeouts_;                             // 各阶段的超时时间
+        StaleWindows stale_windows_;                         // 过期的缓存仍可使用的默认时长
+        ::std::vector<::std::unique_ptr<Reactor>> reactors_; // 事件循环，第一个在调用线程中运行并负责接受连接
+        ::std::unique_ptr<Reactor> refresh_reactor_;         // 后台验证的事件循环，在线程池中以较低的优先级运行
+
+        DnsResolver resolver_; // 主机名解析器（解析线程会向事件循环投递任务，因此在其之后声明）
 
         static int instance_count_; // 实例计数
         static int p_id_;           // 代理服务器 ID
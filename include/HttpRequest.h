@@ -1,31 +1,46 @@
 #ifndef _HTTP_REQUEST_H_INCLUDED_
 #define _HTTP_REQUEST_H_INCLUDED_
 
-#include <map>
+#include "./HttpHeaders.h"
+#include "./HttpRequestParser.h"
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace my
 {
     // HttpRequest 结构体表示一个 HTTP 请求
+    // 请求持有客户端发来的原始数据，请求体和未修改的头部字段行在转发时直接引用原始数据
     struct HttpRequest {
         ::std::string method;  // HTTP 方法（如 GET, POST）
         ::std::string url;     // 请求的 URL
         ::std::string version; // HTTP 版本（如 HTTP/1.1）
 
-        ::std::map<std::string, std::string> headers; // 请求头部字段
-        ::std::string body;                           // 请求体
+        HttpHeaders headers;     // 请求头部字段（保持原始顺序，允许同名字段）
+        ::std::string_view body; // 请求体，指向 raw 中的数据
+
+        ::std::shared_ptr<const ::std::string> raw; // 原始请求数据，请求的副本之间共享
+        ::std::string_view raw_request_line;        // raw 中的请求行（含 CRLF）
 
         // 默认构造函数
         HttpRequest() = default;
-        // 构造函数，从原始 HTTP 数据初始化
+        // 构造函数，从一个完整的原始 HTTP 请求初始化，请求不完整或格式错误时抛出异常
         HttpRequest(const char *http_data, int size);
+        // 构造函数，从已解析完整的请求初始化，并从 buffer 的开头取走请求的原始数据
+        // buffer 为传给 parser 的数据，取走后只剩下后续请求的数据
+        HttpRequest(const HttpRequestParser &parser, ::std::string &buffer);
         // 默认析构函数
         ~HttpRequest() = default;
 
         // 获取主机和端口号
         ::std::pair<::std::string, unsigned short> get_host_port() const;
-        // 将请求转换为字符串
-        ::std::string to_string() const;
+        // 客户端是否希望在响应后保持连接（依据 Connection 和 Proxy-Connection 头部）
+        bool is_keep_alive() const;
+        // 将请求转换为一组待发送的分段，依次发送这些分段即得到完整的请求
+        // 未修改的请求行、头部字段行和请求体指向 raw，新增或修改的头部字段行写入 scratch
+        // 返回的分段在 scratch 和请求被修改或销毁前有效
+        ::std::vector<::std::string_view> to_buffers(::std::string &scratch) const;
     };
 } // namespace my
 
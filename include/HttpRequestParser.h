@@ -0,0 +1,131 @@
+#ifndef _HTTP_REQUEST_PARSER_H_INCLUDED_
+#define _HTTP_REQUEST_PARSER_H_INCLUDED_
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace my
+{
+    // HttpRequestParser 类以状态机的方式增量解析客户端请求
+    // 请求行和头部字段中的空格、冒号和行结束符由向量化的 find_first_of 查找，每个字节只扫描一次
+    // 请求数据可以分多次到达：每次把从请求开头起已收到的全部数据传给 parse，解析从上次停下的位置继续
+    // 解析结果只记录在数据中的位置，不复制数据也不分配堆内存，访问结果时才生成指向数据的 string_view
+    // 因此在请求解析完整并使用完结果之前，调用者不能改动已收到的数据（可以在末尾追加，缓冲区可以重新分配）
+    class HttpRequestParser
+    {
+    public:
+        static constexpr size_t MAX_HEAD_SIZE = 65536;              // 请求头部的最大长度
+        static constexpr size_t MAX_HEADERS = 128;                  // 头部字段的最大个数
+        static constexpr uint64_t MAX_BODY_SIZE = 16 * 1024 * 1024; // 请求体的最大长度，完整的请求需要缓冲在内存中
+
+        // Result 枚举表示一次解析的结果
+        enum class Result {
+            NEED_MORE, // 请求尚未完整，需要更多数据
+            COMPLETE,  // 请求已完整
+            FAILED,    // 请求格式错误或超出限制
+        };
+
+        // Error 枚举表示解析失败的原因
+        enum class Error {
+            NONE,            // 没有错误
+            BAD_REQUEST,     // 请求格式错误
+            HEAD_TOO_LARGE,  // 请求头部过长或头部字段过多
+            NOT_IMPLEMENTED, // 不支持的请求体编码（Transfer-Encoding）
+            BODY_TOO_LARGE,  // 请求体超过 MAX_BODY_SIZE
+        };
+
+        // Header 结构体表示一个头部字段，指向解析的数据
+        struct Header {
+            ::std::string_view name;  // 字段名
+            ::std::string_view value; // 字段值（已去掉首尾空白）
+            ::std::string_view line;  // 字段所在的整行（含行结束符）
+        };
+
+        // 默认构造函数
+        HttpRequestParser() = default;
+
+        // 解析请求，data 为从请求开头起已收到的全部数据，可以包含后续请求的数据
+        Result parse(::std::string_view data);
+        // 重置状态以解析下一个请求
+        void reset();
+
+        // 获取解析失败的原因
+        Error error() const;
+        // 获取解析失败原因的描述
+        const char *error_message() const;
+        // 获取完整请求的长度（请求头部 + 请求体），请求完整前为 0
+        size_t request_length() const;
+
+        // 获取请求行（含行结束符）
+        ::std::string_view request_line() const;
+        // 获取 HTTP 方法（如 GET, POST）
+        ::std::string_view method() const;
+        // 获取请求的 URL
+        ::std::string_view url() const;
+        // 获取 HTTP 版本（如 HTTP/1.1）
+        ::std::string_view version() const;
+        // 获取头部字段的个数
+        size_t header_count() const;
+        // 获取第 index 个头部字段
+        Header header(size_t index) const;
+        // 不区分大小写地查找头部字段，找不到时返回空的 string_view（data() 为 nullptr）
+        ::std::string_view find_header(::std::string_view name) const;
+        // 获取请求体
+        ::std::string_view body() const;
+
+    private:
+        // State 枚举表示解析所处的阶段
+        enum class State {
+            REQUEST_LINE, // 正在解析请求行
+            HEADER_LINE,  // 正在解析头部字段
+            BODY,         // 正在接收请求体
+            COMPLETE,     // 请求已完整
+            FAILED,       // 解析失败
+        };
+
+        // Span 结构体表示数据中的一段
+        struct Span {
+            uint32_t offset = 0; // 起始位置
+            uint32_t size = 0;   // 长度
+        };
+
+        // Field 结构体表示一个头部字段在数据中的位置
+        struct Field {
+            Span name;  // 字段名
+            Span value; // 字段值
+            Span line;  // 字段所在的整行
+        };
+
+        // 解析请求行
+        bool parse_request_line(size_t begin, size_t end);
+        // 解析一个头部字段行
+        bool parse_header_line(size_t begin, size_t end);
+        // 解析失败，记录原因
+        Result fail(Error error);
+        // 获取一段数据
+        ::std::string_view view(Span span) const;
+
+        State state_ = State::REQUEST_LINE;       // 当前状态
+        Error error_ = Error::NONE;               // 解析失败的原因
+        const char *data_ = nullptr;              // 最近一次传入的数据
+        size_t line_start_ = 0;                   // 当前行的起始位置
+        size_t scan_pos_ = 0;                     // 查找分隔符的起始位置，避免重复扫描
+        size_t spaces_[2] = {};                   // 请求行中两个空格的位置
+        size_t space_count_ = 0;                  // 请求行中已找到的空格数
+        size_t colon_ = 0;                        // 当前头部字段行中冒号的位置，0 表示尚未找到
+        Span request_line_;                       // 请求行
+        Span method_;                             // HTTP 方法
+        Span url_;                                // 请求的 URL
+        Span version_;                            // HTTP 版本
+        ::std::array<Field, MAX_HEADERS> fields_; // 头部字段
+        size_t field_count_ = 0;                  // 头部字段的个数
+        size_t head_size_ = 0;                    // 请求头部的长度
+        uint64_t content_length_ = 0;             // 请求体的长度
+        bool has_content_length_ = false;         // 是否有 Content-Length 头部
+        bool has_transfer_encoding_ = false;      // 是否有 Transfer-Encoding 头部
+    }; // class HttpRequestParser
+
+} // namespace my
+
+#endif // _HTTP_REQUEST_PARSER_H_INCLUDED_
@@ -0,0 +1,79 @@
+#ifndef _HTTP_RESPONSE_FRAMER_H_INCLUDED_
+#define _HTTP_RESPONSE_FRAMER_H_INCLUDED_
+
+#include "./HttpResponseHead.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace my
+{
+    // HttpResponseFramer 类用于逐段分析服务器响应，确定响应在字节流中的结束位置
+    // 支持 Content-Length、chunked 传输编码（含尾部字段）以及以关闭连接结束的响应
+    // 1xx 临时响应之后继续分析最终响应；204、304 以及 HEAD 请求的响应没有响应体
+    // 数据可以在任意位置被分段输入，结果与一次输入全部数据相同
+    class HttpResponseFramer
+    {
+    public:
+        static constexpr size_t MAX_HEAD_SIZE = 65536; // 响应头部的最大长度
+
+        // State 枚举表示分析所处的阶段
+        enum class State {
+            HEAD,           // 正在接收响应头部
+            BODY_LENGTH,    // 正在接收由 Content-Length 指定长度的响应体
+            CHUNK_SIZE,     // 正在接收分块大小行
+            CHUNK_DATA,     // 正在接收分块数据
+            CHUNK_DATA_END, // 正在接收分块数据后的 CRLF
+            TRAILER,        // 正在接收分块尾部字段
+            UNTIL_CLOSE,    // 响应体直到服务器关闭连接才结束
+            COMPLETE,       // 响应已完整
+        };
+
+        // 默认构造函数
+        HttpResponseFramer() = default;
+
+        // 设置响应对应的请求方法，HEAD 请求的响应没有响应体，CONNECT 请求的 2xx 响应在头部之后转为隧道
+        void set_request_method(::std::string_view method);
+        // 输入一段响应数据
+        // 返回值: 属于当前响应的字节数，小于 size 表示剩余数据属于后续响应
+        size_t feed(const char *data, size_t size);
+        // 重置状态以分析下一个响应（请求方法也被清除）
+        void reset();
+
+        // 响应是否已完整
+        bool is_complete() const;
+        // 响应是否以关闭连接结束
+        bool is_close_delimited() const;
+        // 响应头部是否已完整且响应体有明确的结束位置（不以关闭连接结束）
+        bool is_self_delimited() const;
+        // 响应结束后连接是否可以复用
+        bool is_keep_alive() const;
+        // 获取当前状态
+        State state() const;
+        // 获取已解析的（最终）响应头部
+        const HttpResponseHead &head() const;
+        // 获取最终响应之前的 1xx 临时响应数
+        size_t interim_count() const;
+
+    private:
+        // 响应头部接收完整后确定响应体的长度
+        void begin_body();
+        // 确定响应体的编码方式和长度
+        void determine_body();
+        // 从输入中读取一行到 line_，返回是否读到了完整的一行
+        bool read_line(const char *data, size_t size, size_t &pos);
+
+        State state_ = State::HEAD;    // 当前状态
+        ::std::string line_;           // 未完整的头部或分块控制行
+        size_t head_line_start_ = 0;   // 接收头部时 line_ 中最后一个未完整行的起始位置
+        HttpResponseHead head_;        // 已解析的响应头部
+        uint64_t remaining_ = 0;       // 当前响应体或分块剩余的字节数
+        bool keep_alive_ = false;      // 连接是否可以复用
+        bool head_request_ = false;    // 请求方法是否为 HEAD
+        bool connect_request_ = false; // 请求方法是否为 CONNECT
+        size_t interim_count_ = 0;     // 已接收的 1xx 临时响应数
+    }; // class HttpResponseFramer
+
+} // namespace my
+
+#endif // _HTTP_RESPONSE_FRAMER_H_INCLUDED_
@@ -1,7 +1,7 @@
 #ifndef _HTTP_RESPONSE_HEAD_H_INCLUDED_
 #define _HTTP_RESPONSE_HEAD_H_INCLUDED_
 
-#include <map>
+#include "./HttpHeaders.h"
 #include <string>
 
 namespace my
@@ -12,7 +12,7 @@ namespace my
         ::std::string status;  // 响应状态码（如 200, 404）
         ::std::string message; // 响应状态消息（如 OK, Not Found）
 
-        ::std::map<::std::string, ::std::string> headers; // 响应头部字段
+        HttpHeaders headers; // 响应头部字段（保持原始顺序，允许同名字段）
 
         // 默认构造函数
         HttpResponseHead() = default;
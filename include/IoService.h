@@ -0,0 +1,197 @@
+#ifndef _IO_SERVICE_H_INCLUDED_
+#define _IO_SERVICE_H_INCLUDED_
+
+#include "./Coroutine.hpp"
+#include "./EventLoop.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <windows.h>
+#include <winsock2.h>
+
+namespace my
+{
+    // IoService 类提供完成式的异步 I/O：提交一个操作，操作完成后在事件循环线程中调用回调
+    // 每个操作也有对应的 async_ 版本，可以在协程中直接 co_await
+    // 有两种后端：
+    //   COMPLETION_PORT: 使用 I/O 完成端口（AcceptEx、ConnectEx、WSARecv、WSASend、TransmitFile、重叠 ReadFile），
+    //                    一次 GetQueuedCompletionStatusEx 取出一批完成通知；
+    //                    接收时先投递零字节的 WSARecv 等待可读，可读后才取出缓冲读取，空闲连接不占用缓冲
+    //   POLL: 使用 WSAPoll 就绪通知，在套接字就绪后以非阻塞方式完成操作
+    // 完成端口不可用时自动回退到 POLL 后端
+    class IoService
+    {
+    public:
+        // Backend 枚举表示 I/O 后端
+        enum class Backend {
+            POLL,            // WSAPoll 就绪通知
+            COMPLETION_PORT, // I/O 完成端口
+        };
+
+        using Handler = ::std::function<void(int error_code)>;                         // 发送、连接完成时的回调
+        using DataHandler = ::std::function<void(::std::string data, int error_code)>; // 接收、读取完成时的回调，data 为空且无错误表示已到末尾
+        using AcceptHandler = ::std::function<void(SOCKET s, int error_code)>;         // 接受连接时的回调
+        using Task = ::std::function<void()>;                                          // 投递的任务
+
+        // Result 结构体表示在协程中等待的操作的结果
+        struct Result {
+            ::std::string data; // 接收、读取的数据，为空且无错误表示已到末尾
+            int error_code = 0; // 错误码，0 表示成功
+        };
+        using Awaiter = CallbackAwaiter<Result>; // 在协程中等待操作完成的对象
+
+        static constexpr int BUFFER_SIZE = 65536;   // 接收和读取缓冲的大小
+        static constexpr int ACCEPT_DEPTH = 8;      // 完成端口后端同时投递的 AcceptEx 数
+        static constexpr int ACCEPT_RETRY_MS = 100; // 无法接受连接（如套接字耗尽）时暂停接受的时长（毫秒）
+        static constexpr int BATCH_SIZE = 64;       // 一次取出的最大完成通知数
+        static constexpr size_t MAX_POOLED = 256;   // 缓冲池中保留的最大缓冲数
+
+        // 默认构造函数
+        IoService() = default;
+        // 析构函数，关闭 I/O 服务
+        ~IoService();
+
+        // 打开 I/O 服务，请求的后端不可用时回退到 POLL（需在 Winsock 初始化后调用）
+        bool open(Backend backend);
+        // 关闭 I/O 服务，等待所有已取消的操作完成
+        void close();
+        // 获取实际使用的后端
+        Backend backend() const;
+        // 获取后端名称
+        const char *backend_name() const;
+
+        // 把套接字加入 I/O 服务，之后才能对其提交操作
+        void associate(SOCKET s);
+        // 把以 FILE_FLAG_OVERLAPPED 打开的文件加入 I/O 服务
+        void associate(HANDLE file);
+        // 把套接字移出 I/O 服务但不关闭（如归还到连接池），调用时不能有未完成的操作
+        void release(SOCKET s);
+        // 取消套接字上所有未完成的操作并关闭套接字，被取消的操作以错误码完成
+        void close(SOCKET s);
+        // 取消套接字上所有未完成的操作（包括持续接受连接）但不关闭套接字
+        void cancel(SOCKET s);
+
+        // 在监听套接字上持续接受连接，每接受一个连接调用一次回调，直到被取消
+        void accept(SOCKET listen_socket, AcceptHandler handler);
+        // 以非阻塞方式连接到服务器
+        void connect(SOCKET s, const char *ip, unsigned short port, Handler handler);
+        // 接收一次数据，缓冲由 I/O 服务提供并随回调交给调用者
+        void recv(SOCKET s, DataHandler handler);
+        // 发送全部数据，data 在发送期间由 I/O 服务持有
+        void send(SOCKET s, ::std::string data, Handler handler);
+        // 以一次聚集写依次发送全部分段，分段指向的数据由调用者保证在发送完成前有效
+        void send(SOCKET s, ::std::vector<::std::string_view> buffers, Handler handler);
+        // 从文件的指定位置读取一块数据
+        void read_file(HANDLE file, uint64_t offset, DataHandler handler);
+        // 先发送 head，再把文件从 offset 开始的 size 字节发送到套接字
+        void transmit_file(SOCKET s, HANDLE file, uint64_t offset, uint64_t size, ::std::string head, Handler handler);
+        // 从任意线程投递任务，任务将在事件循环线程中执行（线程安全）
+        void post(Task task);
+
+        // 协程中等待连接完成
+        Awaiter async_connect(SOCKET s, ::std::string ip, unsigned short port);
+        // 协程中等待接收一次数据
+        Awaiter async_recv(SOCKET s);
+        // 协程中等待全部数据发送完
+        Awaiter async_send(SOCKET s, ::std::string data);
+        // 协程中等待全部分段发送完
+        Awaiter async_send(SOCKET s, ::std::vector<::std::string_view> buffers);
+        // 协程中等待读取一块文件数据
+        Awaiter async_read_file(HANDLE file, uint64_t offset);
+        // 协程中等待文件发送完
+        Awaiter async_transmit_file(SOCKET s, HANDLE file, uint64_t offset, uint64_t size, ::std::string head);
+
+        // 等待并分发一批完成通知，timeout_ms 为最长等待时间（毫秒）
+        // 返回值: 本次分发的完成通知数，出错时返回 SOCKET_ERROR
+        int run_once(int timeout_ms);
+
+        // 从缓冲池中取出一个缓冲
+        ::std::string take_buffer();
+        // 把不再使用的缓冲放回缓冲池
+        void give_buffer(::std::string buffer);
+
+        // 获取等待完成通知的次数（系统调用次数）
+        size_t wait_count() const;
+        // 获取已分发的完成通知数
+        size_t completion_count() const;
+
+        // 禁用拷贝构造函数
+        IoService(const IoService &) = delete;
+        // 禁用拷贝赋值运算符
+        IoService &operator=(const IoService &) = delete;
+
+    private:
+        // 一个已提交的操作
+        struct Operation;
+        // POLL 后端中一个套接字上未完成的操作，每种操作同一时间最多一个
+        struct PollSocket {
+            AcceptHandler accept;               // 持续接受连接的回调
+            Handler connect;                    // 未完成的连接
+            DataHandler recv;                   // 未完成的接收
+            Handler send;                       // 未完成的发送
+            ::std::string send_data;            // 待发送的数据
+            ::std::vector<WSABUF> send_buffers; // 待发送的分段（发送 send_data 时指向 send_data）
+            size_t send_done = 0;               // 已发送完的分段数
+        };
+
+        // 开始发送，gather 为空时发送整个 data
+        void start_send(SOCKET s, ::std::string data, ::std::vector<WSABUF> gather, Handler handler);
+
+        // 完成端口后端：投递一个 AcceptEx
+        void post_accept(SOCKET listen_socket, Operation *op);
+        // 完成端口后端：投递一个零字节的 WSARecv，等待套接字可读
+        void post_recv(Operation *op);
+        // 完成端口后端：投递一个 WSASend
+        void post_send(Operation *op);
+        // 完成端口后端：投递一个 TransmitFile
+        void post_transmit(Operation *op);
+        // 完成端口后端：投递操作失败时把失败作为完成通知排队
+        void fail(Operation *op, int error_code);
+        // 完成端口后端：处理一个完成通知
+        void complete(Operation *op);
+
+        // POLL 后端：获取套接字的操作状态
+        PollSocket &poll_socket(SOCKET s);
+        // POLL 后端：尝试以非阻塞方式推进套接字上的操作
+        void poll_progress(SOCKET s, short revents);
+        // POLL 后端：根据未完成的操作更新关注的事件
+        void poll_update(SOCKET s);
+        // POLL 后端：取消套接字上所有未完成的操作
+        void poll_cancel(SOCKET s);
+        // POLL 后端：TransmitFile 需要阻塞套接字，改为逐块读取文件并发送
+        void poll_transmit(SOCKET s, HANDLE file, uint64_t offset, uint64_t size, ::std::string head, Handler handler);
+        // POLL 后端：把一个完成回调排队，在本轮等待结束后调用
+        void defer(Task task);
+        // 暂停在监听套接字上接受连接，ACCEPT_RETRY_MS 后在 run_once 中恢复
+        void delay_accept(SOCKET listen_socket);
+        // 恢复到期的暂停接受的监听套接字
+        // 返回值: 本次最长等待时间，不超过 timeout_ms，且不晚于下一次恢复
+        int resume_accepts(int timeout_ms);
+
+        Backend backend_ = Backend::POLL;                         // 实际使用的后端
+        bool is_open_ = false;                                    // 是否已打开
+        HANDLE port_ = nullptr;                                   // 完成端口
+        void *accept_ex_ = nullptr;                               // AcceptEx 函数指针
+        void *connect_ex_ = nullptr;                              // ConnectEx 函数指针
+        size_t outstanding_ = 0;                                  // 完成端口后端中尚未完成的操作数
+        ::std::unordered_map<SOCKET, AcceptHandler> acceptors_;   // 正在接受连接的监听套接字
+        ::std::vector<SOCKET> accept_retries_;                    // 暂停接受连接的监听套接字，完成端口后端中每个失败的 AcceptEx 一项
+        ::std::chrono::steady_clock::time_point accept_retry_at_; // 恢复接受连接的时间
+
+        EventLoop event_loop_;                                              // POLL 后端的事件循环
+        ::std::unordered_map<SOCKET, ::std::unique_ptr<PollSocket>> polls_; // POLL 后端中各套接字的操作状态
+        ::std::vector<Task> deferred_;                                      // POLL 后端中等待调用的完成回调
+
+        ::std::vector<::std::string> buffers_; // 缓冲池
+        size_t wait_cnt_ = 0;                  // 等待完成通知的次数
+        size_t completion_cnt_ = 0;            // 已分发的完成通知数
+    }; // class IoService
+
+} // namespace my
+
+#endif // _IO_SERVICE_H_INCLUDED_
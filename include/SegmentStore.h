@@ -0,0 +1,148 @@
+#ifndef _SEGMENT_STORE_H_INCLUDED_
+#define _SEGMENT_STORE_H_INCLUDED_
+
+#include "./CacheKey.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <windows.h>
+
+namespace my
+{
+    // SegmentStore 类把较小的缓存的响应顺序追加到预先分配好大小的段文件中，代替每个缓存一个文件
+    // 每个响应前有一个二进制的对象头部，记录缓存键、状态码、头部和正文的长度以及数据的校验和
+    // 写满的段被封存，不再追加；响应被移除或重新写入后只减少所在段的有效字节数，不修改文件
+    // 封存的段中有效数据过少时，由使用者把仍有效的响应移到当前段（整理），之后删除整个段文件
+    // 段中响应的位置（段编号和偏移量）由使用者记录在索引中，启动时根据索引恢复各段的有效字节数
+    // 线程安全：锁只保护段的列表和追加位置，读写文件时不持有锁
+    class SegmentStore
+    {
+    public:
+        static constexpr uint64_t SEGMENT_SIZE = 64ULL << 20;    // 段文件的默认大小（字节），也是上限
+        static constexpr uint64_t MIN_SEGMENT_SIZE = 4ULL << 20; // 段文件大小的下限（字节）
+        static constexpr uint64_t MAX_OBJECT = 1 << 20;          // 可以放入段文件的最大响应（字节）
+        static constexpr int COMPACT_PERCENT = 50;               // 封存的段中有效数据低于该百分比时需要整理
+
+        // Location 结构体表示响应在段文件中的位置
+        struct Location {
+            uint32_t segment = 0; // 段编号，0 表示不在段文件中
+            uint64_t offset = 0;  // 响应数据（对象头部之后）在段文件中的偏移量
+            uint64_t size = 0;    // 响应的大小
+
+            bool operator==(const Location &other) const = default;
+        };
+
+        // Object 结构体表示整理时在段中找到的一个响应
+        struct Object {
+            Hash128 key;       // 缓存键
+            Location location; // 位置
+        };
+
+        // Stats 结构体记录段文件的统计
+        struct Stats {
+            size_t segments = 0;      // 段文件数
+            uint64_t file_bytes = 0;  // 段文件的总大小
+            uint64_t live_bytes = 0;  // 有效数据（包括对象头部）的字节数
+            size_t compactions = 0;   // 整理后删除的段文件数
+            size_t moved = 0;         // 整理时移动的响应数
+            uint64_t moved_bytes = 0; // 整理时移动的字节数
+        };
+
+        // 构造函数，打开目录 dir 中已有的段文件，恢复完所有响应（finish_restore）之前它们都被视为已封存
+        explicit SegmentStore(const ::std::string &dir);
+
+        // 追加一个响应，当前段写不下时封存它并新建一个段，失败时抛出异常
+        // 返回值: 响应的位置
+        Location append(const Hash128 &key, ::std::string_view data);
+        // 读取一个响应，并检查对象头部和校验和
+        // 返回值: 是否成功，位置无效、读取失败或数据损坏时返回 false
+        bool read(const Location &location, const Hash128 &key, ::std::string &data) const;
+        // 响应被移除或重新写入，不再计入所在段的有效字节数
+        // 返回值: 所在段是否需要整理
+        bool release(const Location &location);
+        // 启动时记录索引中的一个响应
+        // 返回值: 位置是否有效，段文件不存在或位置超出范围时返回 false
+        bool restore(const Location &location);
+        // 获取需要整理的段，有效数据少的在前
+        ::std::vector<uint32_t> candidates() const;
+        // 按顺序读出段中所有响应的对象头部，遇到无法识别的头部时结束
+        ::std::vector<Object> scan(uint32_t segment) const;
+        // 记录整理时移动的响应
+        void record_move(uint64_t bytes);
+        // 删除没有有效数据的封存的段
+        // 返回值: 是否删除
+        bool remove(uint32_t segment);
+        // 启动时恢复完所有响应后调用：删除没有有效数据的段，编号最大的段继续作为当前段
+        void finish_restore();
+        // 设置之后新建的段文件的大小，限制在 MIN_SEGMENT_SIZE 和 SEGMENT_SIZE 之间
+        void set_segment_size(uint64_t size);
+        // 获取段文件路径
+        ::std::string path_of(uint32_t segment) const;
+        // 获取统计
+        Stats stats() const;
+
+        // 文件名是否为段文件
+        static bool is_segment(const ::std::string &name);
+
+        // 禁用拷贝构造函数
+        SegmentStore(const SegmentStore &) = delete;
+        // 禁用拷贝赋值运算符
+        SegmentStore &operator=(const SegmentStore &) = delete;
+
+    private:
+        static constexpr uint32_t MAGIC = 0x4F505348; // 对象头部的标识（"HSPO"）
+
+        // Header 结构体是段文件中每个响应前的对象头部
+        struct Header {
+            uint32_t magic;     // 标识
+            uint32_t checksum;  // 响应数据的校验和（MurmurHash3 的低 32 位）
+            uint64_t key[2];    // 缓存键（低 64 位、高 64 位）
+            uint64_t size;      // 响应的大小（头部和正文）
+            uint32_t head_size; // 响应头部（状态行、头部字段和结尾的空行）的长度，无法识别时为 0
+            uint16_t status;    // 状态码，无法识别时为 0
+            uint16_t reserved;  // 保留，为 0
+        };
+        static_assert(sizeof(Header) == 40);
+
+        // Segment 结构体表示一个段文件，句柄在最后一个使用者释放后关闭
+        struct Segment {
+            uint32_t id = 0;                      // 段编号
+            HANDLE handle = INVALID_HANDLE_VALUE; // 文件句柄（读写）
+            uint64_t size = 0;                    // 文件大小
+            uint64_t end = 0;                     // 追加位置，启动时打开的段为最后一个有效响应的结尾
+            uint64_t live = 0;                    // 有效数据（包括对象头部）的字节数
+            bool sealed = false;                  // 是否已封存
+
+            // 析构函数，关闭文件句柄
+            ~Segment();
+        };
+
+        // 查找段，不存在时返回空指针
+        ::std::shared_ptr<Segment> segment_of(uint32_t id) const;
+        // 新建一个段作为当前段，调用时必须持有锁
+        void open_active();
+        // 段是否需要整理，调用时必须持有锁
+        static bool needs_compaction(const Segment &segment);
+        // 计算响应数据的校验和
+        static uint32_t checksum_of(::std::string_view data);
+        // 从响应中解析状态码和头部长度
+        static void parse_head(::std::string_view data, Header &header);
+
+        ::std::string dir_;                                         // 段文件所在的目录
+        mutable ::std::mutex mutex_;                                // 保护以下所有成员和各段的追加位置、有效字节数
+        ::std::map<uint32_t, ::std::shared_ptr<Segment>> segments_; // 段，按编号排序
+        ::std::shared_ptr<Segment> active_;                         // 当前段，没有时为空
+        uint32_t next_id_ = 1;                                      // 下一个段的编号
+        uint64_t segment_size_ = SEGMENT_SIZE;                      // 新建的段文件的大小
+        size_t compactions_ = 0;                                    // 整理后删除的段文件数
+        size_t moved_ = 0;                                          // 整理时移动的响应数
+        uint64_t moved_bytes_ = 0;                                  // 整理时移动的字节数
+    }; // class SegmentStore
+
+} // namespace my
+
+#endif // _SEGMENT_STORE_H_INCLUDED_
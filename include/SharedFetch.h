@@ -0,0 +1,75 @@
+#ifndef _SHARED_FETCH_H_INCLUDED_
+#define _SHARED_FETCH_H_INCLUDED_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace my
+{
+    // SharedFetch 类表示一次正在从服务器获取响应的请求，同一 URL 的并发请求作为读者共享该响应
+    // 发起者把收到的数据按块追加，读者可以在任意线程中读取已收到的块，没有新数据时注册回调等待
+    // 缓冲的数据超过 MAX_BUFFERED 后不再接受新的读者，并释放所有读者都已读过的块
+    // 响应完整但尚未写入缓存时，获取可以在结束后继续接受新的读者，直到 close
+    // 线程安全
+    class SharedFetch
+    {
+    public:
+        using Chunk = ::std::shared_ptr<const ::std::string>; // 一块数据，发送期间由读者持有
+        using Waiter = ::std::function<void()>;               // 有新数据或获取结束时的回调，在发起者的线程中调用
+
+        static constexpr size_t MAX_BUFFERED = 16 * 1024 * 1024; // 接受新读者时最多缓冲的字节数
+        static constexpr size_t NO_READER = SIZE_MAX;            // 无效的读者编号
+
+        // State 枚举表示获取的状态
+        enum class State {
+            FETCHING,     // 正在获取
+            COMPLETE,     // 响应已完整接收
+            NOT_MODIFIED, // 服务器确认缓存未修改，读者应从缓存中响应
+            ABANDONED,    // 获取失败，读者应自行向服务器请求（已发送部分数据的读者只能断开连接）
+        };
+
+        // 追加一块数据
+        void append(Chunk chunk);
+        // 结束获取，唤醒所有等待的读者；已结束时不做任何事
+        // joinable: 结束后是否继续接受新的读者（缓冲的数据未超过 MAX_BUFFERED 且尚未 close 时）
+        void finish(State state, bool joinable = false);
+        // 不再接受新的读者，并释放所有读者都已读过的块
+        void close();
+
+        // 加入一个读者
+        // 返回值: 读者编号，不再接受新读者时返回 NO_READER
+        size_t attach();
+        // 移除读者，其尚未读取的块可以被释放
+        void detach(size_t reader);
+        // 读取读者尚未读取的所有块
+        // 返回值: 当前的状态
+        State read(size_t reader, ::std::vector<Chunk> &chunks);
+        // 在没有新数据且仍在获取时注册等待回调
+        // 返回值: 是否注册了回调（未注册时应立即再次读取）
+        bool wait(size_t reader, Waiter waiter);
+        // 获取当前的读者数
+        size_t reader_count() const;
+
+    private:
+        // 释放所有读者都已读过的块（只在不再接受新读者时释放）
+        void trim();
+
+        mutable ::std::mutex mutex_;    // 保护以下所有成员
+        ::std::deque<Chunk> chunks_;    // 缓冲的块
+        size_t first_ = 0;              // chunks_ 中第一块的序号
+        size_t buffered_ = 0;           // chunks_ 中的字节数
+        bool joinable_ = true;          // 是否接受新的读者
+        ::std::vector<size_t> cursors_; // 各读者下一次读取的块序号，已移除的读者为 NO_READER
+        size_t readers_ = 0;            // 当前的读者数
+        ::std::vector<Waiter> waiters_; // 等待新数据的读者的回调
+        State state_ = State::FETCHING; // 获取的状态
+    }; // class SharedFetch
+
+} // namespace my
+
+#endif // _SHARED_FETCH_H_INCLUDED_
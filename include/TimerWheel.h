@@ -0,0 +1,90 @@
+#ifndef _TIMER_WHEEL_H_INCLUDED_
+#define _TIMER_WHEEL_H_INCLUDED_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace my
+{
+    // TimerWheel 类是分层时间轮，管理大量到期时间不同的定时器
+    // 共 LEVELS 层，每层 SLOTS 个槽，第 n 层的一个槽覆盖 SLOTS^n 个刻度；定时器按到期时间与当前刻度的距离放入对应层的槽中，
+    // 低层转完一圈时把高层对应槽中的定时器重新分配到低层
+    // 添加和取消定时器都是 O(1)，定时器最多晚一个刻度触发，不会提前触发
+    // 不是线程安全的，只应在所属事件循环的线程中使用
+    class TimerWheel
+    {
+    public:
+        using Clock = ::std::chrono::steady_clock; // 计时使用的时钟
+        using Callback = ::std::function<void()>;  // 定时器到期时的回调
+        using TimerId = uint64_t;                  // 定时器标识，0 表示无效的定时器
+
+        static constexpr int SLOT_BITS = 6;                                        // 每层槽数的位数
+        static constexpr size_t SLOTS = size_t(1) << SLOT_BITS;                    // 每层的槽数
+        static constexpr int LEVELS = 4;                                           // 层数
+        static constexpr uint64_t MAX_TICKS = uint64_t(1) << (SLOT_BITS * LEVELS); // 可以直接放入时间轮的最大刻度距离
+
+        // 构造函数，tick 为一个刻度的时长
+        explicit TimerWheel(Clock::duration tick = ::std::chrono::milliseconds(10));
+
+        // 添加一个在 delay 之后到期的定时器
+        // 返回值: 定时器标识，用于取消定时器
+        TimerId schedule(Clock::duration delay, Callback callback);
+        // 取消定时器，定时器已触发或已取消时不做任何事
+        // 返回值: 是否取消了一个尚未触发的定时器
+        bool cancel(TimerId id);
+        // 推进到当前时间，依次调用到期的定时器的回调（回调中可以添加或取消定时器）
+        // 返回值: 触发的定时器数
+        size_t advance();
+        // 推进到指定时间
+        size_t advance(Clock::time_point now);
+
+        // 获取距离下一次需要推进的毫秒数，不超过 max_ms；没有定时器时返回 max_ms
+        int next_timeout_ms(int max_ms) const;
+        // 获取尚未触发的定时器数
+        size_t size() const;
+
+        // 禁用拷贝构造函数
+        TimerWheel(const TimerWheel &) = delete;
+        // 禁用拷贝赋值运算符
+        TimerWheel &operator=(const TimerWheel &) = delete;
+
+    private:
+        static constexpr uint32_t NIL = UINT32_MAX; // 空的节点下标
+        static constexpr uint64_t MASK = SLOTS - 1; // 取一层中槽号的掩码
+
+        // Node 结构体表示一个定时器，通过下标链接成槽中的双向链表，空闲的节点通过 next 链接成空闲链表
+        struct Node {
+            uint64_t expiry = 0;     // 到期的刻度
+            uint32_t prev = NIL;     // 槽中的上一个节点
+            uint32_t next = NIL;     // 槽中的下一个节点
+            uint32_t slot = NIL;     // 所在的槽（层号 * SLOTS + 槽号），空闲时为 NIL
+            uint32_t generation = 1; // 节点被复用的次数，使已失效的定时器标识不会取消新的定时器
+            Callback callback;       // 到期时的回调
+        };
+
+        // 把节点按到期刻度放入对应层的槽中
+        void insert(uint32_t index);
+        // 把节点从所在的槽中移出
+        void unlink(uint32_t index);
+        // 释放节点
+        void release(uint32_t index);
+        // 把高层的一个槽中的定时器重新分配到低层
+        void cascade(int level, uint64_t slot);
+        // 获取时间点对应的刻度（向下取整）
+        uint64_t tick_of(Clock::time_point time) const;
+
+        Clock::duration tick_;                         // 一个刻度的时长
+        Clock::time_point start_;                      // 第 0 个刻度的时间
+        uint64_t current_ = 0;                         // 当前刻度，之前的定时器都已触发
+        ::std::array<uint32_t, SLOTS * LEVELS> heads_; // 各槽中链表的第一个节点
+        ::std::vector<Node> nodes_;                    // 节点池
+        uint32_t free_ = NIL;                          // 空闲链表的第一个节点
+        size_t count_ = 0;                             // 尚未触发的定时器数
+    }; // class TimerWheel
+
+} // namespace my
+
+#endif // _TIMER_WHEEL_H_INCLUDED_
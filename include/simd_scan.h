@@ -0,0 +1,29 @@
+#ifndef _SIMD_SCAN_H_INCLUDED_
+#define _SIMD_SCAN_H_INCLUDED_
+
+#include <cstddef>
+#include <string_view>
+
+namespace my
+{
+    // ScanLevel 枚举表示扫描分隔符时使用的指令集
+    enum class ScanLevel {
+        SCALAR, // 逐字节比较
+        SSE42,  // SSE4.2 字符串比较指令，一次比较 16 字节
+        AVX2,   // AVX2，一次比较 32 字节
+    };
+
+    // 获取当前使用的指令集，首次调用时根据 CPU 支持的指令集选择
+    ScanLevel scan_level();
+    // 获取指令集的名称
+    const char *scan_level_name(ScanLevel level);
+    // 指定使用的指令集（如用于对比性能），CPU 不支持时选择支持的最高指令集
+    // 返回值: 实际使用的指令集
+    ScanLevel set_scan_level(ScanLevel level);
+
+    // 查找第一个属于 delims 的字符（delims 最多 16 个字符，通常是 "\n"、":\n"、" \n" 这样的行内分隔符）
+    // 返回值: 该字符在 data 中的位置，找不到时返回 size
+    size_t find_first_of(const char *data, size_t size, ::std::string_view delims);
+} // namespace my
+
+#endif // _SIMD_SCAN_H_INCLUDED_
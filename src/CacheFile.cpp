@@ -0,0 +1,118 @@
+#include "../include/CacheFile.h"
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+#include <utility>
+
+// 析构函数，关闭文件句柄
+my::CacheFile::~CacheFile()
+{
+    close();
+}
+
+// 以只读方式打开文件，响应占据整个文件
+// 共享删除权限使缓存可以在传输期间被移除或替换，已打开的句柄不受影响；共享写入权限使段文件可以在读取期间继续追加
+my::CacheFile my::CacheFile::open(const ::std::string &path, bool overlapped)
+{
+    CacheFile file;
+    DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN | (overlapped ? FILE_FLAG_OVERLAPPED : 0);
+    file.handle_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, flags, nullptr);
+    if (file.handle_ == INVALID_HANDLE_VALUE) {
+        throw ::std::runtime_error(::std::format("Failed to open cache file: {}. Error code: {}", path, GetLastError()));
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file.handle_, &size)) {
+        throw ::std::runtime_error(::std::format("Failed to get size of cache file: {}. Error code: {}", path, GetLastError()));
+    }
+    file.size_ = static_cast<uint64_t>(size.QuadPart);
+    return file;
+}
+
+// 以只读方式打开文件中的一段
+my::CacheFile my::CacheFile::open(const ::std::string &path, bool overlapped, uint64_t offset, uint64_t size)
+{
+    CacheFile file = open(path, overlapped);
+    if (offset > file.size_ || size > file.size_ - offset) {
+        throw ::std::runtime_error(::std::format("Cached response is out of range: {} (offset {}, size {}, file size {})", path, offset, size, file.size_));
+    }
+    file.offset_ = offset;
+    file.size_ = size;
+    return file;
+}
+
+// 文件是否已打开
+bool my::CacheFile::is_open() const
+{
+    return handle_ != INVALID_HANDLE_VALUE;
+}
+
+// 获取文件句柄
+HANDLE my::CacheFile::handle() const
+{
+    return handle_;
+}
+
+// 获取响应的大小
+uint64_t my::CacheFile::size() const
+{
+    return size_;
+}
+
+// 获取响应在文件中的偏移量
+uint64_t my::CacheFile::offset() const
+{
+    return offset_;
+}
+
+// 从响应中的指定位置读取数据，使用 OVERLAPPED 指定偏移量而不依赖文件指针
+// 读取的范围限制在响应之内，不会读到段文件中的其他缓存；以 FILE_FLAG_OVERLAPPED 打开的文件需要等待读取完成
+int my::CacheFile::read(char *buffer, int buf_size, uint64_t offset) const
+{
+    if (offset >= size_) {
+        return 0;
+    }
+    DWORD to_read = static_cast<DWORD>(::std::min<uint64_t>(static_cast<uint64_t>(buf_size), size_ - offset));
+    offset += offset_;
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD read_size = 0;
+    if (!ReadFile(handle_, buffer, to_read, &read_size, &overlapped) &&
+        (GetLastError() != ERROR_IO_PENDING || !GetOverlappedResult(handle_, &overlapped, &read_size, TRUE))) {
+        if (GetLastError() == ERROR_HANDLE_EOF) {
+            return 0;
+        }
+        throw ::std::runtime_error(::std::format("Failed to read cache file. Error code: {}", GetLastError()));
+    }
+    return static_cast<int>(read_size);
+}
+
+// 关闭文件句柄
+void my::CacheFile::close()
+{
+    if (handle_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(handle_);
+        handle_ = INVALID_HANDLE_VALUE;
+        offset_ = 0;
+        size_ = 0;
+    }
+}
+
+// 移动构造函数
+my::CacheFile::CacheFile(CacheFile &&other) noexcept
+    : handle_(::std::exchange(other.handle_, INVALID_HANDLE_VALUE)), offset_(::std::exchange(other.offset_, 0)), size_(::std::exchange(other.size_, 0))
+{
+}
+
+// 移动赋值运算符
+my::CacheFile &my::CacheFile::operator=(CacheFile &&other) noexcept
+{
+    if (this != &other) {
+        close();
+        handle_ = ::std::exchange(other.handle_, INVALID_HANDLE_VALUE);
+        offset_ = ::std::exchange(other.offset_, 0);
+        size_ = ::std::exchange(other.size_, 0);
+    }
+    return *this;
+}
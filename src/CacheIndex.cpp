@@ -0,0 +1,408 @@
+#include "../include/CacheIndex.h"
+#include "../include/format_log.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+// 构造函数，打开或新建索引
+// 残留的临时文件说明上次重建索引时异常退出，此时原索引和日志仍然完整，直接删除临时文件
+my::CacheIndex::CacheIndex(const ::std::string &path) : path_(path)
+{
+    static_assert(sizeof(Header) <= sizeof(Record));
+    DeleteFileA((path_ + ".tmp").c_str());
+
+    ::std::error_code ec;
+    uintmax_t file_size = ::std::filesystem::file_size(path_, ec);
+    if (!ec && file_size >= sizeof(Record)) {
+        main_ = open_mapping(path_, 0);
+        const Header &header = header_of(main_);
+        bool valid = ::std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION &&
+                     header.record_size == sizeof(Record) && header.capacity >= MIN_CAPACITY &&
+                     (header.capacity & (header.capacity - 1)) == 0 && file_size == (header.capacity + 1) * sizeof(Record);
+        if (!valid) {
+            close_mapping(main_);
+        }
+    }
+    if (!main_.data) {
+        created_ = true;
+        main_ = open_mapping(path_, MIN_CAPACITY);
+    }
+
+    wal_ = CreateFileA((path_ + ".wal").c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (wal_ == INVALID_HANDLE_VALUE) {
+        DWORD error = GetLastError();
+        close_mapping(main_);
+        throw ::std::runtime_error(::std::format("Failed to open cache index log: {}.wal. Error code: {}", path_, error));
+    }
+    // 新建索引时日志属于无法识别的旧索引，不重放
+    if (!created_) {
+        replay();
+    }
+    checkpoint_locked();
+}
+
+// 析构函数，把映射写回磁盘并清空日志，之后打开索引时无需重放
+my::CacheIndex::~CacheIndex()
+{
+    checkpoint_locked();
+    CloseHandle(wal_);
+    close_mapping(main_);
+}
+
+// 索引是否为新建的
+bool my::CacheIndex::created() const
+{
+    return created_;
+}
+
+// 查找索引项
+::std::optional<my::CacheIndex::Item> my::CacheIndex::find(const Hash128 &key) const
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    const Record *record = locate(key);
+    if (!record) {
+        return ::std::nullopt;
+    }
+    return item_of(*record);
+}
+
+// 获取所有索引项，用于启动时恢复磁盘层的用量和访问统计
+::std::vector<my::CacheIndex::Item> my::CacheIndex::items() const
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    const Header &header = header_of(main_);
+    const Record *records = records_of(main_);
+    ::std::vector<Item> items;
+    items.reserve(static_cast<size_t>(header.count));
+    for (uint64_t i = 0; i < header.capacity; ++i) {
+        if (records[i].state == LIVE && records[i].checksum == checksum_of(records[i])) {
+            items.push_back(item_of(records[i]));
+        }
+    }
+    return items;
+}
+
+// 插入或替换索引项
+bool my::CacheIndex::put(const Item &item)
+{
+    if (item.modified_time.size() > MAX_MODIFIED_TIME || item.etag.size() > MAX_ETAG) {
+        return false;
+    }
+    Record record = {};
+    record.key[0] = item.key.low;
+    record.key[1] = item.key.high;
+    record.check[0] = item.check.low;
+    record.check[1] = item.check.high;
+    record.size = item.size;
+    record.offset = item.offset;
+    record.segment = item.segment;
+    record.stored_at = item.stored_at;
+    record.initial_age = item.initial_age;
+    record.lifetime = item.lifetime;
+    record.stale_while_revalidate = item.stale_while_revalidate;
+    record.stale_if_error = item.stale_if_error;
+    record.flags = item.must_revalidate ? MUST_REVALIDATE : 0;
+    record.accessed_at = item.accessed_at;
+    record.hits = item.hits;
+    record.state = LIVE;
+    record.modified_time_size = static_cast<uint8_t>(item.modified_time.size());
+    record.etag_size = static_cast<uint8_t>(item.etag.size());
+    ::std::memcpy(record.modified_time, item.modified_time.data(), item.modified_time.size());
+    ::std::memcpy(record.etag, item.etag.data(), item.etag.size());
+    record.checksum = checksum_of(record);
+
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    commit(record);
+    return true;
+}
+
+// 移除索引项，不存在时不写日志
+void my::CacheIndex::erase(const Hash128 &key)
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    if (!probe(key)) {
+        return;
+    }
+    Record record = {};
+    record.key[0] = key.low;
+    record.key[1] = key.high;
+    record.state = DELETED;
+    record.checksum = checksum_of(record);
+    commit(record);
+}
+
+// 记录一次访问，直接修改映射中的记录
+void my::CacheIndex::touch(const Hash128 &key, int64_t now)
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    if (Record *record = locate(key)) {
+        record->accessed_at = now;
+        ++record->hits;
+    }
+}
+
+// 获取索引项数
+size_t my::CacheIndex::size() const
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    return static_cast<size_t>(header_of(main_).count);
+}
+
+// 把映射写回磁盘并清空日志
+void my::CacheIndex::checkpoint()
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    checkpoint_locked();
+}
+
+// 打开并映射文件
+// 重建时文件扩展部分的内容不保证为零，映射后显式清零
+my::CacheIndex::Mapping my::CacheIndex::open_mapping(const ::std::string &path, uint64_t capacity)
+{
+    Mapping mapping;
+    DWORD disposition = capacity ? CREATE_ALWAYS : OPEN_EXISTING;
+    mapping.file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (mapping.file == INVALID_HANDLE_VALUE) {
+        throw ::std::runtime_error(::std::format("Failed to open cache index: {}. Error code: {}", path, GetLastError()));
+    }
+    uint64_t size = capacity ? (capacity + 1) * sizeof(Record) : 0;
+    mapping.mapping = CreateFileMappingA(mapping.file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+    if (mapping.mapping) {
+        mapping.data = static_cast<char *>(MapViewOfFile(mapping.mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+    }
+    if (!mapping.data) {
+        DWORD error = GetLastError();
+        close_mapping(mapping);
+        throw ::std::runtime_error(::std::format("Failed to map cache index: {}. Error code: {}", path, error));
+    }
+
+    if (capacity) {
+        ::std::memset(mapping.data, 0, size);
+        Header &header = header_of(mapping);
+        ::std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.record_size = sizeof(Record);
+        header.capacity = capacity;
+    }
+    return mapping;
+}
+
+// 取消映射并关闭文件
+void my::CacheIndex::close_mapping(Mapping &mapping)
+{
+    if (mapping.data) {
+        UnmapViewOfFile(mapping.data);
+    }
+    if (mapping.mapping) {
+        CloseHandle(mapping.mapping);
+    }
+    if (mapping.file != INVALID_HANDLE_VALUE) {
+        CloseHandle(mapping.file);
+    }
+    mapping = Mapping{};
+}
+
+// 获取映射中的文件头
+my::CacheIndex::Header &my::CacheIndex::header_of(const Mapping &mapping)
+{
+    return *reinterpret_cast<Header *>(mapping.data);
+}
+
+// 获取映射中的第一条记录，文件头之后是各个槽
+my::CacheIndex::Record *my::CacheIndex::records_of(const Mapping &mapping)
+{
+    return reinterpret_cast<Record *>(mapping.data + sizeof(Record));
+}
+
+// 把记录转换为索引项
+my::CacheIndex::Item my::CacheIndex::item_of(const Record &record)
+{
+    Item item;
+    item.key = Hash128{record.key[0], record.key[1]};
+    item.check = Hash128{record.check[0], record.check[1]};
+    item.size = record.size;
+    item.segment = record.segment;
+    item.offset = record.offset;
+    item.stored_at = record.stored_at;
+    item.initial_age = record.initial_age;
+    item.lifetime = record.lifetime;
+    item.stale_while_revalidate = record.stale_while_revalidate;
+    item.stale_if_error = record.stale_if_error;
+    item.must_revalidate = (record.flags & MUST_REVALIDATE) != 0;
+    item.accessed_at = record.accessed_at;
+    item.hits = record.hits;
+    item.modified_time.assign(record.modified_time, record.modified_time_size);
+    item.etag.assign(record.etag, record.etag_size);
+    return item;
+}
+
+// 计算记录的校验和：把不在校验范围内的字段清零后取 MurmurHash3 的低 32 位
+uint32_t my::CacheIndex::checksum_of(const Record &record)
+{
+    Record copy = record;
+    copy.accessed_at = 0;
+    copy.hits = 0;
+    copy.checksum = 0;
+    return static_cast<uint32_t>(murmur3_128(::std::string_view(reinterpret_cast<const char *>(&copy), sizeof(copy))).low);
+}
+
+// 把记录写入映射
+// 插入时优先复用探测路径上第一个非有效的槽；移除只把槽标记为已移除，以免打断其他键的探测路径
+void my::CacheIndex::apply(const Mapping &mapping, const Record &record)
+{
+    Header &header = header_of(mapping);
+    Record *records = records_of(mapping);
+    uint64_t mask = header.capacity - 1;
+    Record *found = nullptr;  // 键相同的记录
+    Record *target = nullptr; // 插入的位置
+    for (uint64_t i = record.key[0] & mask, n = 0; n < header.capacity; i = (i + 1) & mask, ++n) {
+        Record &slot = records[i];
+        if (slot.state == LIVE && slot.key[0] == record.key[0] && slot.key[1] == record.key[1]) {
+            found = &slot;
+            break;
+        }
+        if (slot.state != LIVE && !target) {
+            target = &slot;
+        }
+        if (slot.state == EMPTY) {
+            break;
+        }
+    }
+
+    if (record.state != LIVE) {
+        if (found) {
+            found->state = DELETED;
+            --header.count;
+        }
+        return;
+    }
+    if (found) {
+        ::std::memcpy(found, &record, sizeof(Record));
+        return;
+    }
+    // reserve 保证总能找到插入的位置
+    if (!target) {
+        return;
+    }
+    if (target->state == EMPTY) {
+        ++header.used;
+    }
+    ++header.count;
+    ::std::memcpy(target, &record, sizeof(Record));
+}
+
+// 查找键对应的记录（不检查校验和）
+my::CacheIndex::Record *my::CacheIndex::probe(const Hash128 &key) const
+{
+    const Header &header = header_of(main_);
+    Record *records = records_of(main_);
+    uint64_t mask = header.capacity - 1;
+    for (uint64_t i = key.low & mask, n = 0; n < header.capacity; i = (i + 1) & mask, ++n) {
+        Record &slot = records[i];
+        if (slot.state == EMPTY) {
+            break;
+        }
+        if (slot.state == LIVE && slot.key[0] == key.low && slot.key[1] == key.high) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+// 查找键对应的有效记录
+my::CacheIndex::Record *my::CacheIndex::locate(const Hash128 &key) const
+{
+    Record *record = probe(key);
+    return record && record->checksum == checksum_of(*record) ? record : nullptr;
+}
+
+// 确保还能插入一条记录
+// 非空的槽超过 3/4 时重建索引：索引项超过一半时容量加倍，否则只清除已移除的槽
+// 新索引先写入临时文件并写回磁盘，再替换原索引，替换前异常退出时原索引和日志仍然完整
+// 重建不清空日志：新索引已包含日志中的修改，重放日志的结果不变，由调用者决定何时做检查点
+bool my::CacheIndex::reserve()
+{
+    const Header &header = header_of(main_);
+    if ((header.used + 1) * 4 <= header.capacity * 3) {
+        return false;
+    }
+    uint64_t capacity = (header.count + 1) * 2 > header.capacity ? header.capacity * 2 : header.capacity;
+
+    ::std::string temp_path = path_ + ".tmp";
+    Mapping next = open_mapping(temp_path, capacity);
+    Record *records = records_of(main_);
+    for (uint64_t i = 0; i < header.capacity; ++i) {
+        if (records[i].state == LIVE && records[i].checksum == checksum_of(records[i])) {
+            apply(next, records[i]);
+        }
+    }
+    FlushViewOfFile(next.data, 0);
+    FlushFileBuffers(next.file);
+    close_mapping(next);
+
+    close_mapping(main_);
+    BOOL moved = MoveFileExA(temp_path.c_str(), path_.c_str(), MOVEFILE_REPLACE_EXISTING);
+    DWORD error = GetLastError();
+    main_ = open_mapping(path_, 0);
+    if (!moved) {
+        throw ::std::runtime_error(::std::format("Failed to replace cache index: {}. Error code: {}", path_, error));
+    }
+    return true;
+}
+
+// 修改索引
+// 记录完整写入日志后才修改映射，映射中写了一半的记录可以在重放日志时修复
+void my::CacheIndex::commit(const Record &record)
+{
+    // 日志中的修改都已包含在重建的索引中
+    if (record.state == LIVE && reserve()) {
+        checkpoint_locked();
+    }
+    DWORD written = 0;
+    if (!WriteFile(wal_, &record, sizeof(Record), &written, nullptr) || written != sizeof(Record)) {
+        throw ::std::runtime_error(::std::format("Failed to write cache index log: {}.wal. Error code: {}", path_, GetLastError()));
+    }
+    ++wal_records_;
+    apply(main_, record);
+    if (wal_records_ >= CHECKPOINT_RECORDS) {
+        checkpoint_locked();
+    }
+}
+
+// 重放日志
+// 最后一条记录可能只写了一半，校验失败时停止；应用时重建索引不清空日志，全部应用后才由构造函数做检查点
+// 重放中途异常退出时下次从头重放，每条记录整体替换或移除一个键，重复应用的结果相同
+void my::CacheIndex::replay()
+{
+    ::std::vector<Record> records;
+    Record record;
+    DWORD read_size = 0;
+    while (ReadFile(wal_, &record, sizeof(Record), &read_size, nullptr) && read_size == sizeof(Record)) {
+        if (record.checksum != checksum_of(record)) {
+            break;
+        }
+        records.push_back(record);
+    }
+    for (const Record &logged : records) {
+        if (logged.state == LIVE) {
+            reserve();
+        }
+        apply(main_, logged);
+    }
+}
+
+// 把映射写回磁盘并清空日志
+// 写回失败时保留日志，下次打开时仍可重放
+void my::CacheIndex::checkpoint_locked()
+{
+    if (!FlushViewOfFile(main_.data, 0) || !FlushFileBuffers(main_.file)) {
+        err("Failed to flush cache index: {}. Error code: {}", path_, GetLastError());
+        return;
+    }
+    LARGE_INTEGER zero = {};
+    SetFilePointerEx(wal_, zero, nullptr, FILE_BEGIN);
+    SetEndOfFile(wal_);
+    wal_records_ = 0;
+}
@@ -0,0 +1,247 @@
+#include "../include/CacheKey.h"
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+namespace
+{
+    // 按小端序读取 8 字节
+    uint64_t load_le64(const unsigned char *p)
+    {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i) {
+            value = (value << 8) | p[i];
+        }
+        return value;
+    }
+
+    // MurmurHash3 的最终混合函数
+    uint64_t fmix64(uint64_t k)
+    {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+
+    // 十六进制数字的值，不是十六进制数字时返回 -1
+    int hex_value(char c)
+    {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    // 是否为非保留字符（RFC 3986 第 2.3 节）
+    bool is_unreserved(unsigned char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c == '~';
+    }
+
+    // 转为小写（只处理 ASCII 字母）
+    ::std::string to_lower(::std::string_view str)
+    {
+        ::std::string result(str);
+        for (char &c : result) {
+            if (c >= 'A' && c <= 'Z') {
+                c = static_cast<char>(c - 'A' + 'a');
+            }
+        }
+        return result;
+    }
+
+    // 规范化百分号编码：解码非保留字符，其余编码的十六进制数字转为大写，不完整的编码保持原样
+    ::std::string normalize_percent(::std::string_view str)
+    {
+        static constexpr char HEX[] = "0123456789ABCDEF";
+        ::std::string result;
+        result.reserve(str.size());
+        for (size_t i = 0; i < str.size(); ++i) {
+            int high = -1, low = -1;
+            if (str[i] == '%' && i + 2 < str.size()) {
+                high = hex_value(str[i + 1]);
+                low = hex_value(str[i + 2]);
+            }
+            if (high < 0 || low < 0) {
+                result += str[i];
+                continue;
+            }
+            unsigned char value = static_cast<unsigned char>(high * 16 + low);
+            if (is_unreserved(value)) {
+                result += static_cast<char>(value);
+            } else {
+                result += '%';
+                result += HEX[high];
+                result += HEX[low];
+            }
+            i += 2;
+        }
+        return result;
+    }
+
+    // 移除路径中的 "." 和 ".." 段（RFC 3986 第 5.2.4 节），path 以 '/' 开头
+    ::std::string remove_dot_segments(::std::string_view path)
+    {
+        ::std::string result;
+        ::std::vector<size_t> starts; // 结果中各段（含前导 '/'）的起始位置
+        size_t pos = 0;
+        while (pos < path.size()) {
+            size_t next = path.find('/', pos + 1);
+            if (next == ::std::string_view::npos) {
+                next = path.size();
+            }
+            ::std::string_view segment = path.substr(pos + 1, next - pos - 1);
+            bool last = next == path.size();
+            if (segment == "." || segment == "..") {
+                if (segment == ".." && !starts.empty()) {
+                    result.resize(starts.back());
+                    starts.pop_back();
+                }
+                // 以 "." 或 ".." 结尾的路径仍以 '/' 结尾
+                if (last) {
+                    result += '/';
+                }
+            } else {
+                starts.push_back(result.size());
+                result += '/';
+                result += segment;
+            }
+            pos = next;
+        }
+        return result.empty() ? "/" : result;
+    }
+} // namespace
+
+// 计算 MurmurHash3（x64 版本，128 位）哈希值
+my::Hash128 my::murmur3_128(::std::string_view data, uint32_t seed)
+{
+    constexpr uint64_t c1 = 0x87c37b91114253d5ULL;
+    constexpr uint64_t c2 = 0x4cf5ad432745937fULL;
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data.data());
+    const size_t size = data.size();
+    const size_t blocks = size / 16;
+
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+    for (size_t i = 0; i < blocks; ++i) {
+        uint64_t k1 = load_le64(bytes + i * 16);
+        uint64_t k2 = load_le64(bytes + i * 16 + 8);
+
+        k1 *= c1;
+        k1 = ::std::rotl(k1, 31);
+        k1 *= c2;
+        h1 ^= k1;
+        h1 = ::std::rotl(h1, 27);
+        h1 += h2;
+        h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= c2;
+        k2 = ::std::rotl(k2, 33);
+        k2 *= c1;
+        h2 ^= k2;
+        h2 = ::std::rotl(h2, 31);
+        h2 += h1;
+        h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    // 不足 16 字节的尾部，前 8 字节计入 k1，其余计入 k2
+    const unsigned char *tail = bytes + blocks * 16;
+    size_t rest = size & 15;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    for (size_t i = rest; i > 8; --i) {
+        k2 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 9) * 8);
+    }
+    if (rest > 8) {
+        k2 *= c2;
+        k2 = ::std::rotl(k2, 33);
+        k2 *= c1;
+        h2 ^= k2;
+    }
+    for (size_t i = ::std::min<size_t>(rest, 8); i > 0; --i) {
+        k1 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 1) * 8);
+    }
+    if (rest > 0) {
+        k1 *= c1;
+        k1 = ::std::rotl(k1, 31);
+        k1 *= c2;
+        h1 ^= k1;
+    }
+
+    h1 ^= size;
+    h2 ^= size;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+    return Hash128{h1, h2};
+}
+
+// 规范化 URL
+// 用户信息（@ 之前的部分）保持原样，IPv6 地址（方括号内）中的冒号不视为端口分隔符
+::std::string my::normalize_url(::std::string_view url)
+{
+    size_t scheme_end = url.find("://");
+    if (scheme_end == ::std::string_view::npos) {
+        return "";
+    }
+    ::std::string scheme = to_lower(url.substr(0, scheme_end));
+    ::std::string_view default_port;
+    if (scheme == "http") {
+        default_port = "80";
+    } else if (scheme == "https") {
+        default_port = "443";
+    } else {
+        return "";
+    }
+
+    // 去掉片段
+    ::std::string_view rest = url.substr(scheme_end + 3);
+    rest = rest.substr(0, rest.find('#'));
+
+    size_t authority_end = rest.find_first_of("/?");
+    if (authority_end == ::std::string_view::npos) {
+        authority_end = rest.size();
+    }
+    ::std::string_view authority = rest.substr(0, authority_end);
+    ::std::string_view path = rest.substr(authority_end);
+    ::std::string_view query;
+    if (size_t query_start = path.find('?'); query_start != ::std::string_view::npos) {
+        query = path.substr(query_start);
+        path = path.substr(0, query_start);
+    }
+
+    ::std::string_view userinfo;
+    if (size_t at = authority.rfind('@'); at != ::std::string_view::npos) {
+        userinfo = authority.substr(0, at + 1);
+        authority = authority.substr(at + 1);
+    }
+    ::std::string_view host = authority;
+    ::std::string_view port;
+    size_t colon = authority.rfind(':');
+    if (colon != ::std::string_view::npos && authority.find(']', colon) == ::std::string_view::npos) {
+        host = authority.substr(0, colon);
+        port = authority.substr(colon + 1);
+    }
+
+    ::std::string result = scheme + "://";
+    result += userinfo;
+    result += to_lower(normalize_percent(host));
+    if (!port.empty() && port != default_port) {
+        result += ':';
+        result += port;
+    }
+    result += path.empty() ? "/" : remove_dot_segments(normalize_percent(path));
+    result += normalize_percent(query);
+    return result;
+}
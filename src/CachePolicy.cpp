@@ -0,0 +1,319 @@
+#include "../include/CachePolicy.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    // 把 ASCII 大写字母转换为小写
+    char to_lower(char c)
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    // 不区分大小写地比较两个字符串
+    bool iequals(::std::string_view a, ::std::string_view b)
+    {
+        return a.size() == b.size() && ::std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return to_lower(x) == to_lower(y); });
+    }
+
+    // 去掉首尾的空白
+    ::std::string_view trim_ows(::std::string_view str)
+    {
+        while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) str.remove_prefix(1);
+        while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) str.remove_suffix(1);
+        return str;
+    }
+
+    // 跳过一个指定的字符
+    // 返回值: 是否为该字符
+    bool skip(::std::string_view &str, char c)
+    {
+        if (str.empty() || str.front() != c) {
+            return false;
+        }
+        str.remove_prefix(1);
+        return true;
+    }
+
+    // 读取 min_count 到 max_count 位十进制数字
+    // 返回值: 是否成功
+    bool read_digits(::std::string_view &str, size_t min_count, size_t max_count, int &value)
+    {
+        size_t count = 0;
+        value = 0;
+        while (count < max_count && count < str.size() && str[count] >= '0' && str[count] <= '9') {
+            value = value * 10 + (str[count] - '0');
+            ++count;
+        }
+        str.remove_prefix(count);
+        return count >= min_count;
+    }
+
+    // 读取月份的缩写（如 Nov），month 为 1 到 12
+    // 返回值: 是否成功
+    bool read_month(::std::string_view &str, int &month)
+    {
+        static constexpr ::std::string_view MONTHS[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+        if (str.size() < 3) {
+            return false;
+        }
+        for (int i = 0; i < 12; ++i) {
+            if (iequals(str.substr(0, 3), MONTHS[i])) {
+                month = i + 1;
+                str.remove_prefix(3);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 读取 HH:MM:SS 格式的时间
+    // 返回值: 是否成功
+    bool read_time(::std::string_view &str, int &hour, int &minute, int &second)
+    {
+        return read_digits(str, 2, 2, hour) && skip(str, ':') && read_digits(str, 2, 2, minute) && skip(str, ':') && read_digits(str, 2, 2, second);
+    }
+
+    // 计算公历日期距 1970-01-01 的天数
+    int64_t days_from_civil(int64_t year, int64_t month, int64_t day)
+    {
+        year -= month <= 2;
+        int64_t era = (year >= 0 ? year : year - 399) / 400;
+        int64_t year_of_era = year - era * 400;
+        int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+        return era * 146097 + day_of_era - 719468;
+    }
+
+    // 解析 delta-seconds（RFC 9111 第 1.2.2 节），超过上限的值取上限
+    // 返回值: 秒数，不是非负整数时返回空
+    ::std::optional<int64_t> parse_delta_seconds(::std::string_view str)
+    {
+        str = trim_ows(str);
+        if (str.empty()) {
+            return ::std::nullopt;
+        }
+        int64_t value = 0;
+        for (char c : str) {
+            if (c < '0' || c > '9') {
+                return ::std::nullopt;
+            }
+            value = ::std::min(value * 10 + (c - '0'), ::my::Freshness::MAX_DELTA_SECONDS);
+        }
+        return value;
+    }
+
+    // 获取 Cache-Control 中以秒为值的指令，值不合法时视为 0（第 4.2.1 节：视为已过期）
+    // 返回值: 秒数，不存在该指令时返回空
+    ::std::optional<int64_t> directive_seconds(const ::my::HttpHeaders &headers, ::std::string_view directive)
+    {
+        ::std::optional<::std::string_view> value = ::my::cache_directive(headers, directive);
+        if (!value) {
+            return ::std::nullopt;
+        }
+        return parse_delta_seconds(*value).value_or(0);
+    }
+
+    // 请求是否接受缓存的响应（不论新鲜与否）：没有 no-cache，且缓存的年龄不超过请求的 max-age
+    // 没有 Cache-Control 字段时 Pragma: no-cache 与 Cache-Control: no-cache 等效（第 5.4 节）
+    bool accepts_stored(const ::my::HttpHeaders &request_headers, const ::my::Freshness &freshness, int64_t now)
+    {
+        if (::my::cache_directive(request_headers, "no-cache") || (!request_headers.contains("Cache-Control") && request_headers.has_token("Pragma", "no-cache"))) {
+            return false;
+        }
+        ::std::optional<int64_t> max_age = directive_seconds(request_headers, "max-age");
+        return !max_age || freshness.age(now) <= *max_age;
+    }
+} // namespace
+
+// 获取响应在 now 时的年龄（第 4.2.3 节）：初始年龄加上在缓存中停留的时间
+int64_t my::Freshness::age(int64_t now) const
+{
+    return initial_age + ::std::max<int64_t>(0, now - response_time);
+}
+
+// 响应在 now 时是否新鲜
+bool my::Freshness::is_fresh(int64_t now) const
+{
+    return lifetime > age(now);
+}
+
+// 响应在 now 时是否过期不超过 window 秒且允许不经验证使用
+bool my::Freshness::is_usable_stale(int64_t now, int64_t window) const
+{
+    return !must_revalidate && window > 0 && age(now) < lifetime + window;
+}
+
+// 获取当前的 Unix 时间（秒）
+int64_t my::unix_now()
+{
+    return ::std::chrono::duration_cast<::std::chrono::seconds>(::std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// 解析 HTTP 日期
+//   IMF-fixdate: Sun, 06 Nov 1994 08:49:37 GMT
+//   RFC 850:     Sunday, 06-Nov-94 08:49:37 GMT（两位数年份小于 70 时属于 21 世纪）
+//   asctime:     Sun Nov  6 08:49:37 1994
+::std::optional<int64_t> my::parse_http_date(::std::string_view date)
+{
+    date = trim_ows(date);
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    if (size_t comma = date.find(','); comma != ::std::string_view::npos) {
+        ::std::string_view rest = date.substr(comma + 1);
+        if (!skip(rest, ' ') || !read_digits(rest, 2, 2, day)) {
+            return ::std::nullopt;
+        }
+        if (skip(rest, ' ')) {
+            if (!read_month(rest, month) || !skip(rest, ' ') || !read_digits(rest, 4, 4, year)) {
+                return ::std::nullopt;
+            }
+        } else if (skip(rest, '-')) {
+            if (!read_month(rest, month) || !skip(rest, '-') || !read_digits(rest, 2, 2, year)) {
+                return ::std::nullopt;
+            }
+            year += year < 70 ? 2000 : 1900;
+        } else {
+            return ::std::nullopt;
+        }
+        if (!skip(rest, ' ') || !read_time(rest, hour, minute, second) || !skip(rest, ' ') || !iequals(rest, "GMT")) {
+            return ::std::nullopt;
+        }
+    } else {
+        ::std::string_view rest = date;
+        if (rest.size() < 4 || rest[3] != ' ') {
+            return ::std::nullopt;
+        }
+        rest.remove_prefix(4);
+        if (!read_month(rest, month) || !skip(rest, ' ')) {
+            return ::std::nullopt;
+        }
+        skip(rest, ' ');
+        if (!read_digits(rest, 1, 2, day) || !skip(rest, ' ') || !read_time(rest, hour, minute, second) || !skip(rest, ' ') ||
+            !read_digits(rest, 4, 4, year) || !rest.empty()) {
+            return ::std::nullopt;
+        }
+    }
+    if (day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return ::std::nullopt;
+    }
+    return days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+// 获取 Cache-Control 字段中指定指令的值
+// 指令以逗号分隔，值可以是 token 或带引号的字符串，带引号的字符串中可以有逗号
+::std::optional<::std::string_view> my::cache_directive(const HttpHeaders &headers, ::std::string_view directive)
+{
+    for (HttpHeaders::Field field : headers) {
+        if (!iequals(field.name, "Cache-Control")) {
+            continue;
+        }
+        ::std::string_view rest = field.value;
+        while (!rest.empty()) {
+            size_t end = rest.find_first_of(",=");
+            ::std::string_view name = trim_ows(rest.substr(0, end));
+            ::std::string_view value = rest.substr(0, 0);
+            if (end != ::std::string_view::npos && rest[end] == '=') {
+                rest = trim_ows(rest.substr(end + 1));
+                if (skip(rest, '"')) {
+                    size_t close = 0;
+                    while (close < rest.size() && rest[close] != '"') {
+                        close += rest[close] == '\\' ? 2 : 1;
+                    }
+                    close = ::std::min(close, rest.size());
+                    value = rest.substr(0, close);
+                    rest.remove_prefix(::std::min(close + 1, rest.size()));
+                    end = rest.find(',');
+                } else {
+                    end = rest.find(',');
+                    value = trim_ows(rest.substr(0, end));
+                }
+            }
+            if (iequals(name, directive)) {
+                return value;
+            }
+            if (end == ::std::string_view::npos) {
+                break;
+            }
+            rest.remove_prefix(end + 1);
+        }
+    }
+    return ::std::nullopt;
+}
+
+// 共享缓存能否保存响应
+bool my::is_storable(const HttpResponseHead &head)
+{
+    return !cache_directive(head.headers, "no-store") && !cache_directive(head.headers, "private") && !head.headers.has_token("Vary", "*");
+}
+
+// 响应是否明确给出了新鲜期
+bool my::has_explicit_lifetime(const HttpResponseHead &head)
+{
+    return cache_directive(head.headers, "s-maxage") || cache_directive(head.headers, "max-age") || head.headers.contains("Expires");
+}
+
+// 状态码是否默认可缓存（RFC 9110 第 15.1 节）
+bool my::is_heuristically_cacheable(::std::string_view status)
+{
+    static constexpr ::std::string_view STATUSES[] = {"200", "203", "204", "206", "300", "301", "308", "404", "405", "410", "414", "501"};
+    return ::std::find(::std::begin(STATUSES), ::std::end(STATUSES), status) != ::std::end(STATUSES);
+}
+
+// 计算响应的新鲜度
+// 新鲜期（第 4.2.1 节）：no-cache 时为 0（每次使用前都要验证）；共享缓存优先使用 s-maxage，其次是 max-age，
+// 再次是 Expires 与 Date 之差（Expires 无法解析时视为已过期），都没有时根据 Last-Modified 启发式地取
+// Date 与 Last-Modified 之差的 10%，不超过 MAX_HEURISTIC_LIFETIME，只用于默认可缓存的状态码（第 4.2.2 节）
+// 初始年龄（第 4.2.3 节）：取 Date 推算的年龄和 Age 字段加上响应延迟中较大者
+// 共享缓存中 s-maxage 同时意味着 proxy-revalidate（第 5.2.2.10 节），与 no-cache 一样禁止使用过期的响应
+::my::Freshness my::compute_freshness(const HttpResponseHead &head, int64_t request_time, int64_t response_time)
+{
+    const HttpHeaders &headers = head.headers;
+    Freshness freshness;
+    freshness.response_time = response_time;
+    int64_t date = parse_http_date(headers.get("Date")).value_or(response_time);
+
+    if (cache_directive(headers, "no-cache")) {
+        freshness.lifetime = 0;
+    } else if (::std::optional<int64_t> s_maxage = directive_seconds(headers, "s-maxage")) {
+        freshness.lifetime = *s_maxage;
+    } else if (::std::optional<int64_t> max_age = directive_seconds(headers, "max-age")) {
+        freshness.lifetime = *max_age;
+    } else if (headers.contains("Expires")) {
+        ::std::optional<int64_t> expires = parse_http_date(headers.get("Expires"));
+        freshness.lifetime = expires ? ::std::max<int64_t>(0, *expires - date) : 0;
+    } else if (::std::optional<int64_t> modified = parse_http_date(headers.get("Last-Modified")); modified && is_heuristically_cacheable(head.status)) {
+        freshness.lifetime = ::std::clamp<int64_t>((date - *modified) / 10, 0, Freshness::MAX_HEURISTIC_LIFETIME);
+    }
+
+    freshness.must_revalidate = cache_directive(headers, "no-cache") || cache_directive(headers, "must-revalidate") ||
+                                cache_directive(headers, "proxy-revalidate") || cache_directive(headers, "s-maxage");
+    freshness.stale_while_revalidate = directive_seconds(headers, "stale-while-revalidate").value_or(Freshness::UNSPECIFIED);
+    freshness.stale_if_error = directive_seconds(headers, "stale-if-error").value_or(Freshness::UNSPECIFIED);
+
+    int64_t apparent_age = ::std::max<int64_t>(0, response_time - date);
+    int64_t age_value = parse_delta_seconds(headers.get("Age")).value_or(0);
+    int64_t response_delay = ::std::max<int64_t>(0, response_time - request_time);
+    freshness.initial_age = ::std::max(apparent_age, age_value + response_delay);
+    return freshness;
+}
+
+// 请求是否允许不经验证直接使用缓存
+bool my::allows_cached(const HttpHeaders &request_headers, const Freshness &freshness, int64_t now)
+{
+    if (!accepts_stored(request_headers, freshness, now)) {
+        return false;
+    }
+    int64_t age = freshness.age(now);
+    if (::std::optional<int64_t> min_fresh = directive_seconds(request_headers, "min-fresh"); min_fresh && freshness.lifetime - age < *min_fresh) {
+        return false;
+    }
+    return freshness.is_fresh(now);
+}
+
+// 请求是否允许使用过期的缓存
+// 要求缓存至少新鲜 min-fresh 秒的请求不接受过期的缓存
+bool my::allows_stale(const HttpHeaders &request_headers, const Freshness &freshness, int64_t now)
+{
+    return accepts_stored(request_headers, freshness, now) && !cache_directive(request_headers, "min-fresh");
+}
@@ -0,0 +1,149 @@
+#include "../include/ConnectionPool.h"
+
+#include <format>
+
+// 构造函数
+my::ConnectionPool::ConnectionPool(size_t max_idle_per_host, Clock::duration idle_timeout)
+    : max_idle_per_host_(max_idle_per_host), idle_timeout_(idle_timeout), hit_cnt_(0), miss_cnt_(0)
+{
+}
+
+// 析构函数，关闭所有空闲连接
+my::ConnectionPool::~ConnectionPool()
+{
+    clear();
+}
+
+// 取出一个可用的空闲连接，优先使用最近归还的连接
+SOCKET my::ConnectionPool::checkout(::std::string_view key)
+{
+    while (true) {
+        IdleConnection conn;
+        {
+            ::std::lock_guard<::std::mutex> lock(mutex_);
+            auto it = idle_.find(::std::string(key));
+            if (it == idle_.end() || it->second.empty()) {
+                miss_cnt_++;
+                return INVALID_SOCKET;
+            }
+            conn = it->second.back();
+            it->second.pop_back();
+        }
+
+        // 健康检查在锁外进行，失效的连接直接关闭
+        if (Clock::now() - conn.idle_since < idle_timeout_ && is_alive(conn.socket)) {
+            hit_cnt_++;
+            return conn.socket;
+        }
+        closesocket(conn.socket);
+    }
+}
+
+// 归还一个可复用的连接，超过上限时直接关闭
+void my::ConnectionPool::release(::std::string_view key, SOCKET socket)
+{
+    {
+        ::std::lock_guard<::std::mutex> lock(mutex_);
+        auto &conns = idle_[::std::string(key)];
+        if (conns.size() < max_idle_per_host_) {
+            conns.push_back({socket, Clock::now()});
+            return;
+        }
+    }
+    closesocket(socket);
+}
+
+// 关闭所有超时的空闲连接
+void my::ConnectionPool::prune()
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    auto now = Clock::now();
+    for (auto it = idle_.begin(); it != idle_.end();) {
+        auto &conns = it->second;
+        // 队头是最早归还的连接
+        while (!conns.empty() && now - conns.front().idle_since >= idle_timeout_) {
+            closesocket(conns.front().socket);
+            conns.pop_front();
+        }
+        if (conns.empty()) {
+            it = idle_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// 关闭所有空闲连接
+void my::ConnectionPool::clear()
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    for (auto &[key, conns] : idle_) {
+        for (auto &conn : conns) {
+            closesocket(conn.socket);
+        }
+    }
+    idle_.clear();
+}
+
+// 获取空闲连接总数
+size_t my::ConnectionPool::idle_count() const
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (auto &[key, conns] : idle_) {
+        count += conns.size();
+    }
+    return count;
+}
+
+// 获取复用连接的次数
+size_t my::ConnectionPool::hit_count() const
+{
+    return hit_cnt_;
+}
+
+// 获取没有可复用连接的次数
+size_t my::ConnectionPool::miss_count() const
+{
+    return miss_cnt_;
+}
+
+// 设置每个服务器的最大空闲连接数
+void my::ConnectionPool::set_max_idle_per_host(size_t max_idle_per_host)
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    max_idle_per_host_ = max_idle_per_host;
+}
+
+// 设置空闲超时时间
+void my::ConnectionPool::set_idle_timeout(Clock::duration idle_timeout)
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    idle_timeout_ = idle_timeout;
+}
+
+// 生成连接池的键
+::std::string my::ConnectionPool::make_key(::std::string_view host, unsigned short port)
+{
+    return ::std::format("{}:{}", host, port);
+}
+
+// 检查空闲连接是否仍然可用
+// 空闲连接上不应有任何可读事件：可读意味着服务器已关闭连接或发送了多余的数据
+bool my::ConnectionPool::is_alive(SOCKET socket)
+{
+    fd_set readfds;
+    FD_ZERO(&readfds);
+    FD_SET(socket, &readfds);
+    TIMEVAL timeout = {0, 0};
+    if (select(0, &readfds, nullptr, nullptr, &timeout) != 0) {
+        return false;
+    }
+
+    int error_code = 0;
+    int len = sizeof(error_code);
+    if (getsockopt(socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&error_code), &len) == SOCKET_ERROR) {
+        return false;
+    }
+    return error_code == 0;
+}
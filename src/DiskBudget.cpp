@@ -0,0 +1,170 @@
+#include "../include/DiskBudget.h"
+
+#include <algorithm>
+
+// 构造函数
+my::DiskBudget::DiskBudget(uint64_t byte_budget, size_t object_budget)
+    : byte_budget_(byte_budget), object_budget_(object_budget)
+{
+}
+
+// 记录写入完成的缓存
+// 新的缓存进入小队列，最近被淘汰过（在幽灵队列中）或视为已被访问过的缓存直接进入主队列
+void my::DiskBudget::add(const Hash128 &key, uint64_t size, bool accessed)
+{
+    if (auto it = index_.find(key); it != index_.end()) {
+        Entry &entry = *it->second;
+        (entry.main ? main_bytes_ : small_bytes_) += size;
+        (entry.main ? main_bytes_ : small_bytes_) -= entry.size;
+        entry.size = size;
+        return;
+    }
+
+    bool main = accessed;
+    if (auto ghost = ghosts_.find(key); ghost != ghosts_.end()) {
+        ghost_.erase(ghost->second);
+        ghosts_.erase(ghost);
+        main = true;
+    }
+    Queue &queue = main ? main_ : small_;
+    queue.push_front(Entry{key, size, accessed ? 1 : 0, main});
+    (main ? main_bytes_ : small_bytes_) += size;
+    index_[key] = queue.begin();
+}
+
+// 记录一次访问
+void my::DiskBudget::touch(const Hash128 &key)
+{
+    if (auto it = index_.find(key); it != index_.end()) {
+        Entry &entry = *it->second;
+        entry.freq = ::std::min(entry.freq + 1, MAX_FREQ);
+    }
+}
+
+// 移除缓存的记录
+void my::DiskBudget::erase(const Hash128 &key)
+{
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return;
+    }
+    Queue::iterator entry = it->second;
+    if (entry->main) {
+        main_bytes_ -= entry->size;
+        main_.erase(entry);
+    } else {
+        small_bytes_ -= entry->size;
+        small_.erase(entry);
+    }
+    index_.erase(it);
+}
+
+// 是否记录了缓存
+bool my::DiskBudget::contains(const Hash128 &key) const
+{
+    return index_.contains(key);
+}
+
+// 记录正在写入的数据
+void my::DiskBudget::reserve(uint64_t bytes)
+{
+    pending_bytes_ += bytes;
+}
+
+// 正在写入的数据写入完成或被丢弃
+void my::DiskBudget::release(uint64_t bytes)
+{
+    pending_bytes_ -= ::std::min(bytes, pending_bytes_);
+}
+
+// 是否超过容量，正在写入的数据同样计入字节数
+bool my::DiskBudget::over_budget() const
+{
+    return (byte_budget_ != 0 && small_bytes_ + main_bytes_ + pending_bytes_ > byte_budget_) || (object_budget_ != 0 && index_.size() > object_budget_);
+}
+
+// 按淘汰策略选出缓存，直到不超过容量或已选出 max_count 个
+// 小队列超过用量的 SMALL_PERCENT%（或主队列为空）时从小队列淘汰，否则从主队列淘汰
+// 只有正在写入的数据超过容量时没有可以淘汰的缓存，此时提前结束
+::std::vector<my::DiskBudget::Victim> my::DiskBudget::select_victims(size_t max_count)
+{
+    ::std::vector<Victim> victims;
+    while (over_budget() && victims.size() < max_count && !index_.empty()) {
+        uint64_t bytes = small_bytes_ + main_bytes_;
+        if (!small_.empty() && (small_bytes_ * 100 > bytes * SMALL_PERCENT || main_.empty())) {
+            evict_small(victims);
+        } else {
+            evict_main(victims);
+        }
+    }
+    return victims;
+}
+
+// 设置容量
+void my::DiskBudget::set_budget(uint64_t byte_budget, size_t object_budget)
+{
+    byte_budget_ = byte_budget;
+    object_budget_ = object_budget;
+}
+
+// 获取统计
+my::DiskBudget::Stats my::DiskBudget::stats() const
+{
+    Stats stats;
+    stats.objects = index_.size();
+    stats.bytes = small_bytes_ + main_bytes_ + pending_bytes_;
+    stats.pending_bytes = pending_bytes_;
+    stats.evictions = evictions_;
+    stats.evicted_bytes = evicted_bytes_;
+    stats.byte_budget = byte_budget_;
+    stats.object_budget = object_budget_;
+    return stats;
+}
+
+// 处理小队列末尾的缓存
+void my::DiskBudget::evict_small(::std::vector<Victim> &victims)
+{
+    Queue::iterator entry = ::std::prev(small_.end());
+    small_bytes_ -= entry->size;
+    if (entry->freq > 0) {
+        entry->freq = 0;
+        entry->main = true;
+        main_.splice(main_.begin(), small_, entry);
+        main_bytes_ += entry->size;
+        return;
+    }
+    victims.push_back(Victim{entry->key, entry->size});
+    remember(entry->key);
+    ++evictions_;
+    evicted_bytes_ += entry->size;
+    index_.erase(entry->key);
+    small_.erase(entry);
+}
+
+// 处理主队列末尾的缓存
+void my::DiskBudget::evict_main(::std::vector<Victim> &victims)
+{
+    Queue::iterator entry = ::std::prev(main_.end());
+    if (entry->freq > 0) {
+        --entry->freq;
+        main_.splice(main_.begin(), main_, entry);
+        return;
+    }
+    victims.push_back(Victim{entry->key, entry->size});
+    ++evictions_;
+    evicted_bytes_ += entry->size;
+    main_bytes_ -= entry->size;
+    index_.erase(entry->key);
+    main_.erase(entry);
+}
+
+// 把被淘汰的缓存的键记入幽灵队列，幽灵队列最多记录与记录的缓存数相同的键
+void my::DiskBudget::remember(const Hash128 &key)
+{
+    ghost_.push_front(key);
+    ghosts_[key] = ghost_.begin();
+    while (ghost_.size() > ::std::max<size_t>(index_.size(), 1)) {
+        ghosts_.erase(ghost_.back());
+        ghost_.pop_back();
+    }
+}
@@ -0,0 +1,302 @@
+#include "../include/DnsResolver.h"
+
+#include <algorithm>
+#include <cctype>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+// windns.h 需要在 winsock2.h 之后包含
+#include <windns.h>
+
+// 获取第一个地址，解析失败时抛出异常
+const ::std::string &my::DnsResolver::Result::address(::std::string_view host) const
+{
+    if (status != Status::OK || addresses.empty()) {
+        throw ::std::runtime_error(::std::format("Failed to resolve host: {}. Error code: {}", host, error_code));
+    }
+    return addresses.front();
+}
+
+// 构造函数
+my::DnsResolver::DnsResolver(int worker_count, Backend backend)
+    : backend_(::std::move(backend)), workers_(worker_count)
+{
+}
+
+// 同步解析
+my::DnsResolver::Result my::DnsResolver::resolve(::std::string_view host)
+{
+    if (auto cached = lookup_cache(host)) {
+        return *cached;
+    }
+    return resolve_async(host).get();
+}
+
+// 异步解析，返回可在任意线程等待的 future
+::std::shared_future<my::DnsResolver::Result> my::DnsResolver::resolve_async(::std::string_view host)
+{
+    ::std::string key = normalize(host);
+    // IP 地址字面量无需解析，也不进入缓存
+    if (inet_addr(key.c_str()) != INADDR_NONE) {
+        ::std::promise<Result> promise;
+        promise.set_value({Status::OK, {key}, ::std::chrono::seconds(0), 0});
+        return promise.get_future().share();
+    }
+    return start_lookup(key, nullptr)->future;
+}
+
+// 异步解析，命中缓存时在调用线程中立即调用回调
+void my::DnsResolver::resolve_async(::std::string_view host, Callback callback)
+{
+    if (auto cached = lookup_cache(host)) {
+        callback(*cached);
+        return;
+    }
+    start_lookup(normalize(host), ::std::move(callback));
+}
+
+// 只查询缓存，不发起解析
+::std::optional<my::DnsResolver::Result> my::DnsResolver::lookup_cache(::std::string_view host)
+{
+    ::std::string key = normalize(host);
+    if (inet_addr(key.c_str()) != INADDR_NONE) {
+        return Result{Status::OK, {key}, ::std::chrono::seconds(0), 0};
+    }
+    Shard &shard = shard_of(key);
+    ::std::lock_guard<::std::mutex> lock(shard.mutex);
+    return find_locked(shard, key);
+}
+
+// 清空缓存（进行中的查询不受影响）
+void my::DnsResolver::clear()
+{
+    for (auto &shard : shards_) {
+        ::std::lock_guard<::std::mutex> lock(shard.mutex);
+        shard.entries.clear();
+    }
+}
+
+// 设置不存在的域名的缓存时间
+void my::DnsResolver::set_negative_ttl(::std::chrono::seconds ttl)
+{
+    negative_ttl_ = ttl.count();
+}
+
+// 设置缓存时间上限
+void my::DnsResolver::set_max_ttl(::std::chrono::seconds ttl)
+{
+    max_ttl_ = ttl.count();
+}
+
+// 获取命中缓存的次数
+size_t my::DnsResolver::hit_count() const
+{
+    return hit_cnt_;
+}
+
+// 获取发起查询的次数
+size_t my::DnsResolver::miss_count() const
+{
+    return miss_cnt_;
+}
+
+// 获取合并到进行中查询的次数
+size_t my::DnsResolver::coalesced_count() const
+{
+    return coalesced_cnt_;
+}
+
+// 使用系统解析器的后端
+// DnsQuery 能给出记录的 TTL；它失败时（如名称只存在于 NetBIOS 或本地配置中）回退到 getaddrinfo，并使用默认 TTL
+my::DnsResolver::Backend my::DnsResolver::system_backend()
+{
+    return [](const ::std::string &host) {
+        Result result;
+
+        PDNS_RECORD records = nullptr;
+        DNS_STATUS status = DnsQuery_A(host.c_str(), DNS_TYPE_A, DNS_QUERY_STANDARD, nullptr, &records, nullptr);
+        if (status == 0) {
+            DWORD ttl = 0;
+            for (PDNS_RECORD rec = records; rec != nullptr; rec = rec->pNext) {
+                // 跳过 CNAME 等其他类型的记录
+                if (rec->wType != DNS_TYPE_A || rec->Flags.S.Section != DnsSectionAnswer) {
+                    continue;
+                }
+                IN_ADDR addr;
+                addr.s_addr = rec->Data.A.IpAddress;
+                result.addresses.emplace_back(inet_ntoa(addr));
+                ttl = result.addresses.size() == 1 ? rec->dwTtl : ::std::min(ttl, rec->dwTtl);
+            }
+            DnsRecordListFree(records, DnsFreeRecordList);
+            if (!result.addresses.empty()) {
+                result.status = Status::OK;
+                result.ttl = ::std::chrono::seconds(ttl);
+                return result;
+            }
+        } else if (status == DNS_ERROR_RCODE_NAME_ERROR) {
+            result.status = Status::NOT_FOUND;
+            result.error_code = status;
+            return result;
+        }
+
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *info = nullptr;
+        int rc = getaddrinfo(host.c_str(), nullptr, &hints, &info);
+        if (rc != 0) {
+            result.status = rc == EAI_NONAME ? Status::NOT_FOUND : Status::FAILED;
+            result.error_code = rc;
+            return result;
+        }
+        for (addrinfo *p = info; p != nullptr; p = p->ai_next) {
+            ::std::string ip = inet_ntoa(reinterpret_cast<SOCKADDR_IN *>(p->ai_addr)->sin_addr);
+            if (::std::find(result.addresses.begin(), result.addresses.end(), ip) == result.addresses.end()) {
+                result.addresses.push_back(::std::move(ip));
+            }
+        }
+        freeaddrinfo(info);
+        result.status = result.addresses.empty() ? Status::NOT_FOUND : Status::OK;
+        result.ttl = DEFAULT_TTL;
+        return result;
+    };
+}
+
+// 使用 hosts 格式文件的后端
+// 每行为 "IP 主机名 [别名...]"，# 之后为注释；文件中不存在的主机名视为不存在的域名
+my::DnsResolver::Backend my::DnsResolver::hosts_file_backend(::std::string path, ::std::chrono::seconds ttl)
+{
+    return [path = ::std::move(path), ttl](const ::std::string &host) {
+        Result result;
+        ::std::ifstream file(path);
+        if (!file) {
+            result.status = Status::FAILED;
+            return result;
+        }
+
+        ::std::string line;
+        while (::std::getline(file, line)) {
+            line = line.substr(0, line.find('#'));
+            ::std::istringstream iss(line);
+            ::std::string ip, name;
+            if (!(iss >> ip)) {
+                continue;
+            }
+            while (iss >> name) {
+                if (normalize(name) == host) {
+                    result.addresses.push_back(ip);
+                    break;
+                }
+            }
+        }
+        result.status = result.addresses.empty() ? Status::NOT_FOUND : Status::OK;
+        result.ttl = ttl;
+        return result;
+    };
+}
+
+// 规范化主机名（小写）
+::std::string my::DnsResolver::normalize(::std::string_view host)
+{
+    ::std::string key(host);
+    ::std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(::std::tolower(c)); });
+    return key;
+}
+
+// 获取主机名所在的分片
+my::DnsResolver::Shard &my::DnsResolver::shard_of(const ::std::string &key)
+{
+    return shards_[::std::hash<::std::string>{}(key) % SHARD_COUNT];
+}
+
+// 在持有分片锁时查询缓存，过期的缓存项顺便移除
+::std::optional<my::DnsResolver::Result> my::DnsResolver::find_locked(Shard &shard, const ::std::string &key)
+{
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+        return ::std::nullopt;
+    }
+    if (Clock::now() >= it->second.expires) {
+        shard.entries.erase(it);
+        return ::std::nullopt;
+    }
+    hit_cnt_++;
+    return it->second.result;
+}
+
+// 开始一次查询，或加入进行中的查询
+::std::shared_ptr<my::DnsResolver::Pending> my::DnsResolver::start_lookup(const ::std::string &key, Callback callback)
+{
+    Shard &shard = shard_of(key);
+    ::std::shared_ptr<Pending> pending;
+    {
+        ::std::lock_guard<::std::mutex> lock(shard.mutex);
+        // 加锁后再查一次缓存，查询可能刚刚完成
+        if (auto cached = find_locked(shard, key)) {
+            pending = ::std::make_shared<Pending>();
+            pending->future = pending->promise.get_future().share();
+            pending->promise.set_value(*cached);
+        } else if (auto it = shard.pending.find(key); it != shard.pending.end()) {
+            coalesced_cnt_++;
+            if (callback) {
+                it->second->callbacks.push_back(::std::move(callback));
+            }
+            return it->second;
+        } else {
+            miss_cnt_++;
+            pending = ::std::make_shared<Pending>();
+            pending->future = pending->promise.get_future().share();
+            if (callback) {
+                pending->callbacks.push_back(::std::move(callback));
+            }
+            shard.pending.emplace(key, pending);
+            workers_.add_task(&DnsResolver::run_lookup, this, key, pending);
+            return pending;
+        }
+    }
+
+    // 命中缓存，在锁外调用回调
+    if (callback) {
+        callback(pending->future.get());
+    }
+    return pending;
+}
+
+// 在解析线程中执行查询并唤醒等待者
+void my::DnsResolver::run_lookup(::std::string key, ::std::shared_ptr<Pending> pending)
+{
+    Result result;
+    try {
+        result = backend_(key);
+    } catch (const ::std::exception &) {
+        result = Result();
+    }
+
+    // 成功的结果按记录的 TTL 缓存，不存在的域名按 negative_ttl_ 缓存，查询失败不缓存
+    ::std::chrono::seconds ttl(0);
+    if (result.status == Status::OK) {
+        ttl = ::std::min(result.ttl, ::std::chrono::seconds(max_ttl_.load()));
+    } else if (result.status == Status::NOT_FOUND) {
+        ttl = ::std::chrono::seconds(negative_ttl_.load());
+    }
+
+    ::std::vector<Callback> callbacks;
+    {
+        Shard &shard = shard_of(key);
+        ::std::lock_guard<::std::mutex> lock(shard.mutex);
+        if (ttl.count() > 0) {
+            shard.entries[key] = {result, Clock::now() + ttl};
+        }
+        shard.pending.erase(key);
+        // 移出分片后不会再有新的回调加入
+        callbacks.swap(pending->callbacks);
+    }
+
+    pending->promise.set_value(result);
+    for (auto &callback : callbacks) {
+        callback(result);
+    }
+}
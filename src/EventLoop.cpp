@@ -0,0 +1,173 @@
+#include "../include/EventLoop.h"
+
+#include <stdexcept>
+
+// 析构函数，关闭唤醒套接字
+my::EventLoop::~EventLoop()
+{
+    close();
+}
+
+// 创建唤醒套接字
+// Winsock 没有 eventfd，使用一个绑定到回环地址并连接到自身的 UDP 套接字代替
+bool my::EventLoop::open()
+{
+    if (wakeup_socket_ != INVALID_SOCKET) {
+        return true;
+    }
+
+    SOCKET s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s == INVALID_SOCKET) {
+        return false;
+    }
+    SOCKADDR_IN addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    int addr_len = sizeof(addr);
+    u_long mode = 1;
+    if (bind(s, reinterpret_cast<SOCKADDR *>(&addr), sizeof(addr)) == SOCKET_ERROR ||
+        getsockname(s, reinterpret_cast<SOCKADDR *>(&addr), &addr_len) == SOCKET_ERROR ||
+        connect(s, reinterpret_cast<SOCKADDR *>(&addr), sizeof(addr)) == SOCKET_ERROR ||
+        ioctlsocket(s, FIONBIO, &mode) == SOCKET_ERROR) {
+        closesocket(s);
+        return false;
+    }
+
+    wakeup_socket_ = s;
+    add(wakeup_socket_, READ, [this](short) {
+        // 清空唤醒数据后执行投递的任务
+        char buffer[64];
+        while (recv(wakeup_socket_, buffer, sizeof(buffer), 0) > 0) {
+        }
+        run_posted_tasks();
+    });
+    return true;
+}
+
+// 关闭唤醒套接字
+void my::EventLoop::close()
+{
+    if (wakeup_socket_ != INVALID_SOCKET) {
+        remove(wakeup_socket_);
+        closesocket(wakeup_socket_);
+        wakeup_socket_ = INVALID_SOCKET;
+    }
+}
+
+// 从任意线程投递任务
+void my::EventLoop::post(Task task)
+{
+    bool need_wakeup;
+    {
+        ::std::lock_guard<::std::mutex> lock(posted_mutex_);
+        need_wakeup = posted_tasks_.empty(); // 已有待执行的任务时唤醒数据已经发出
+        posted_tasks_.push_back(::std::move(task));
+    }
+    if (need_wakeup && wakeup_socket_ != INVALID_SOCKET) {
+        send(wakeup_socket_, "", 1, 0);
+    }
+}
+
+// 执行所有已投递的任务
+void my::EventLoop::run_posted_tasks()
+{
+    ::std::vector<Task> tasks;
+    {
+        ::std::lock_guard<::std::mutex> lock(posted_mutex_);
+        tasks.swap(posted_tasks_);
+    }
+    for (auto &task : tasks) {
+        task();
+    }
+}
+
+// 注册套接字及其关注的事件和回调
+void my::EventLoop::add(SOCKET s, short events, Handler handler)
+{
+    if (index_.contains(s)) {
+        throw ::std::runtime_error("Socket already registered in event loop");
+    }
+    WSAPOLLFD pfd;
+    pfd.fd = s;
+    pfd.events = events;
+    pfd.revents = 0;
+    index_[s] = poll_fds_.size();
+    poll_fds_.push_back(pfd);
+    handlers_.push_back(::std::make_shared<Handler>(::std::move(handler)));
+}
+
+// 修改套接字关注的事件
+void my::EventLoop::modify(SOCKET s, short events)
+{
+    auto it = index_.find(s);
+    if (it != index_.end()) {
+        poll_fds_[it->second].events = events;
+    }
+}
+
+// 注销套接字，使用末尾元素填补空位以保持 O(1)
+void my::EventLoop::remove(SOCKET s)
+{
+    auto it = index_.find(s);
+    if (it == index_.end()) {
+        return;
+    }
+    size_t pos = it->second;
+    size_t last = poll_fds_.size() - 1;
+    if (pos != last) {
+        poll_fds_[pos] = poll_fds_[last];
+        handlers_[pos] = ::std::move(handlers_[last]);
+        index_[poll_fds_[pos].fd] = pos;
+    }
+    poll_fds_.pop_back();
+    handlers_.pop_back();
+    index_.erase(it);
+}
+
+// 检查套接字是否已注册
+bool my::EventLoop::contains(SOCKET s) const
+{
+    return index_.contains(s);
+}
+
+// 获取已注册的套接字数量
+size_t my::EventLoop::size() const
+{
+    return poll_fds_.size();
+}
+
+// 等待事件并分发一次
+int my::EventLoop::run_once(int timeout_ms)
+{
+    if (poll_fds_.empty()) {
+        return 0;
+    }
+
+    int sum = WSAPoll(poll_fds_.data(), static_cast<ULONG>(poll_fds_.size()), timeout_ms);
+    if (sum <= 0) {
+        return sum;
+    }
+
+    // 先收集就绪的套接字，回调中可能增删注册项
+    // 同时持有回调的引用，回调可安全注销自身
+    ready_.clear();
+    for (size_t i = 0; i < poll_fds_.size(); ++i) {
+        if (poll_fds_[i].revents != 0) {
+            ready_.push_back({poll_fds_[i].fd, poll_fds_[i].revents, handlers_[i]});
+            poll_fds_[i].revents = 0;
+        }
+    }
+
+    for (auto &item : ready_) {
+        auto it = index_.find(item.socket);
+        // 已被之前的回调注销，或套接字句柄已被新连接复用
+        if (it == index_.end() || handlers_[it->second] != item.handler) {
+            continue;
+        }
+        (*item.handler)(item.revents);
+    }
+    int dispatched = static_cast<int>(ready_.size());
+    ready_.clear();
+    return dispatched;
+}
@@ -0,0 +1,161 @@
+#include "../include/HotCache.h"
+
+#include <algorithm>
+
+// 构造函数
+my::HotCache::HotCache(size_t budget, size_t max_object_size)
+    : budget_(budget), max_object_size_(max_object_size)
+{
+}
+
+// 获取对象
+my::HotCache::Buffer my::HotCache::get(const ::std::string &key)
+{
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        ++stats_.misses;
+        return nullptr;
+    }
+    Entry &entry = *it->second;
+    entry.freq = ::std::min(entry.freq + 1, MAX_FREQ);
+    ++stats_.hits;
+    stats_.hit_bytes += entry.buffer->size();
+    return entry.buffer;
+}
+
+// 放入对象
+// 新对象进入小队列，最近被淘汰过（在幽灵队列中）的对象直接进入主队列
+bool my::HotCache::put(const ::std::string &key, Buffer buffer)
+{
+    size_t size = buffer->size();
+    if (size > max_object_size_ || size > budget_) {
+        erase(key);
+        return false;
+    }
+
+    if (auto it = index_.find(key); it != index_.end()) {
+        // 替换数据，保留对象在队列中的位置和访问计数
+        Entry &entry = *it->second;
+        (entry.main ? main_bytes_ : small_bytes_) += size;
+        (entry.main ? main_bytes_ : small_bytes_) -= entry.buffer->size();
+        entry.buffer = ::std::move(buffer);
+    } else {
+        bool main = false;
+        if (auto ghost = ghost_index_.find(key); ghost != ghost_index_.end()) {
+            ghost_.erase(ghost->second);
+            ghost_index_.erase(ghost);
+            main = true;
+        }
+        Queue &queue = main ? main_ : small_;
+        queue.push_front(Entry{key, ::std::move(buffer), 0, main});
+        (main ? main_bytes_ : small_bytes_) += size;
+        index_[key] = queue.begin();
+    }
+    evict();
+    return true;
+}
+
+// 移除对象
+void my::HotCache::erase(const ::std::string &key)
+{
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return;
+    }
+    Queue::iterator entry = it->second;
+    if (entry->main) {
+        main_bytes_ -= entry->buffer->size();
+        main_.erase(entry);
+    } else {
+        small_bytes_ -= entry->buffer->size();
+        small_.erase(entry);
+    }
+    index_.erase(it);
+}
+
+// 是否缓存了对象
+bool my::HotCache::contains(const ::std::string &key) const
+{
+    return index_.contains(key);
+}
+
+// 设置容量
+void my::HotCache::set_budget(size_t budget)
+{
+    budget_ = budget;
+    evict();
+}
+
+// 获取可以缓存的最大对象
+size_t my::HotCache::max_object_size() const
+{
+    return max_object_size_;
+}
+
+// 获取统计
+my::HotCache::Stats my::HotCache::stats() const
+{
+    Stats stats = stats_;
+    stats.objects = index_.size();
+    stats.bytes = small_bytes_ + main_bytes_;
+    stats.budget = budget_;
+    return stats;
+}
+
+// 淘汰对象直到不超过容量
+// 小队列超过其份额（或主队列为空）时从小队列淘汰，否则从主队列淘汰
+void my::HotCache::evict()
+{
+    while (small_bytes_ + main_bytes_ > budget_) {
+        if (!small_.empty() && (small_bytes_ > budget_ / 100 * SMALL_PERCENT || main_.empty())) {
+            evict_small();
+        } else {
+            evict_main();
+        }
+    }
+}
+
+// 处理小队列末尾的对象
+void my::HotCache::evict_small()
+{
+    Queue::iterator entry = ::std::prev(small_.end());
+    size_t size = entry->buffer->size();
+    small_bytes_ -= size;
+    if (entry->freq > 0) {
+        entry->freq = 0;
+        entry->main = true;
+        main_.splice(main_.begin(), small_, entry);
+        main_bytes_ += size;
+        return;
+    }
+    remember(entry->key);
+    index_.erase(entry->key);
+    small_.erase(entry);
+    ++stats_.evictions;
+}
+
+// 处理主队列末尾的对象
+void my::HotCache::evict_main()
+{
+    Queue::iterator entry = ::std::prev(main_.end());
+    if (entry->freq > 0) {
+        --entry->freq;
+        main_.splice(main_.begin(), main_, entry);
+        return;
+    }
+    main_bytes_ -= entry->buffer->size();
+    index_.erase(entry->key);
+    main_.erase(entry);
+    ++stats_.evictions;
+}
+
+// 把被淘汰的对象的键记入幽灵队列，幽灵队列最多记录与缓存中对象数相同的键
+void my::HotCache::remember(const ::std::string &key)
+{
+    ghost_.push_front(key);
+    ghost_index_[key] = ghost_.begin();
+    while (ghost_.size() > ::std::max<size_t>(index_.size(), 1)) {
+        ghost_index_.erase(ghost_.back());
+        ghost_.pop_back();
+    }
+}
@@ -1,191 +1,1077 @@
 #include "../include/HttpCacheManager.h"
 #include "../include/format_log.hpp"
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
-#include <iomanip>
 #include <sstream>
+#include <unordered_set>
 
 // 构造函数，初始化缓存管理器
-my::HttpCacheManager::HttpCacheManager(::std::string_view cache_dir) : cache_dir_(cache_dir)
+// 打开索引只需映射索引文件，之后根据索引项恢复磁盘层的用量
+my::HttpCacheManager::HttpCacheManager(::std::string_view cache_dir, size_t memory_budget, uint64_t disk_budget, size_t disk_object_budget)
+    : cache_dir_(cache_dir), segments_(cache_dir_), budget_(disk_budget, disk_object_budget)
 {
-    cache_time_map_filename_ = cache_dir_ + "\\cache_time_map";
     if (!::std::filesystem::exists(cache_dir_)) {
         ::std::filesystem::create_directory(cache_dir_);
     }
+    for (Shard &shard : shards_) {
+        shard.hot.set_budget(memory_budget / SHARD_COUNT);
+    }
+    segments_.set_segment_size(disk_budget == 0 ? SegmentStore::SEGMENT_SIZE : disk_budget / SEGMENTS_PER_BUDGET);
+
+    index_ = ::std::make_unique<CacheIndex>(cache_dir_ + "\\cache_index");
+    load_budget();
+    writer_ = ::std::thread(&HttpCacheManager::run_writer, this);
+}
+
+// 析构函数
+// 先等待写入线程写完已提交的缓存（未提交的被放弃），它可能开始淘汰和整理，因此之后再停止后台线程
+// 后台线程在正在进行的淘汰批次或正在移动的响应完成后停止，最后写回索引
+my::HttpCacheManager::~HttpCacheManager()
+{
+    writer_stopping_ = true;
+    signal_writer();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    stopping_ = true;
+    maintainer_.stop();
+}
+
+// 检查指定 URL 是否有缓存
+// 条目中的 URL 与请求的 URL 不符时说明两个 URL 的键冲突，视为未命中
+bool my::HttpCacheManager::has_cache(::std::string_view url) const
+{
+    Key key = key_of(url);
+    if (!key.valid) {
+        return false;
+    }
+    if (::std::shared_ptr<Entry> entry = find_entry(key)) {
+        ::std::lock_guard<::std::mutex> lock(entry->mutex);
+        if (entry->cached && entry->check == key.check) {
+            return true;
+        }
+    }
+    ++disk_misses_;
+    return false;
+}
 
-    // 从缓存时间映射文件中读取缓存时间和 ETag
-    ::std::ifstream ifs(cache_time_map_filename_);
-    if (ifs.is_open()) {
-        ::std::string key, time, etag, line;
-        while (::std::getline(ifs, line)) {
-            key = line;
-            ::std::getline(ifs, line);
-            time = line;
-            ::std::getline(ifs, line);
-            etag = line;
-            if (::std::filesystem::exists(cache_dir_ + "\\" + key)) {
-                cache_time_map_[key] = time;
-                cache_etag_map_[key] = etag;
+// 打开指定 URL 的缓存文件，保存在段文件中的响应打开段文件中的对应部分
+// 只在打开时持有条目锁，返回的句柄在缓存被移除、重新创建或段文件被整理后仍然有效
+my::CacheFile my::HttpCacheManager::open_cache(::std::string_view url, bool overlapped) const
+{
+    Key key = key_of(url);
+    ::std::shared_ptr<Entry> entry = key.valid ? find_entry(key) : nullptr;
+    if (!entry) {
+        throw ::std::runtime_error(::std::format("Cache not found: {}({})", key.name, url));
+    }
+    ::std::lock_guard<::std::mutex> lock(entry->mutex);
+    if (!entry->cached || entry->check != key.check) {
+        throw ::std::runtime_error(::std::format("Cache is being removed or rewritten: {}({})", key.name, url));
+    }
+    const SegmentStore::Location &location = entry->location;
+    CacheFile file = location.segment != 0 ? CacheFile::open(segments_.path_of(location.segment), overlapped, location.offset, location.size)
+                                           : CacheFile::open(path_of(key.name), overlapped);
+    index_->touch(key.hash, unix_now());
+    touch_budget(key.hash);
+    ++disk_hits_;
+    disk_hit_bytes_ += file.size();
+    return file;
+}
+
+// 获取指定 URL 在内存层中的缓存
+// 内存层未命中时，已完成写入的较小的缓存被整个读入内存层，之后的请求不再访问文件
+// 段文件中的响应读取时检查校验和，数据损坏时移除缓存，之后的请求重新向服务器获取
+// 读取文件时只持有条目锁，放入内存层时仍持有条目锁，重新写入的缓存不会被旧数据覆盖
+my::HotCache::Buffer my::HttpCacheManager::get_memory_cache(::std::string_view url)
+{
+    Key key = key_of(url);
+    if (!key.valid) {
+        return nullptr;
+    }
+    Shard &shard = shard_of(key);
+    {
+        ::std::lock_guard<::std::mutex> lock(shard.mutex);
+        if (HotCache::Buffer buffer = shard.hot.get(key.url)) {
+            touch_budget(key.hash);
+            return buffer;
+        }
+    }
+
+    ::std::shared_ptr<Entry> entry = find_entry(key);
+    if (!entry) {
+        return nullptr;
+    }
+    ::std::unique_lock<::std::mutex> lock(entry->mutex);
+    if (!entry->cached || entry->check != key.check) {
+        return nullptr;
+    }
+    ::std::string data;
+    if (entry->location.segment != 0) {
+        if (entry->location.size == 0 || entry->location.size > MAX_MEMORY_OBJECT) {
+            return nullptr;
+        }
+        if (!segments_.read(entry->location, key.hash, data)) {
+            err("Cache: corrupted cache in segment {}: {}({})", entry->location.segment, key.name, url);
+            bool compact = discard_locked(key, *entry);
+            lock.unlock();
+            release_entry(key, entry);
+            if (compact) {
+                schedule_compaction();
             }
+            return nullptr;
+        }
+    } else {
+        ::std::error_code ec;
+        uintmax_t size = ::std::filesystem::file_size(path_of(key.name), ec);
+        if (ec || size == 0 || size > MAX_MEMORY_OBJECT) {
+            return nullptr;
+        }
+        data.resize(static_cast<size_t>(size));
+        ::std::ifstream ifs(path_of(key.name), ::std::ios::binary);
+        if (!ifs.read(data.data(), data.size())) {
+            return nullptr;
         }
-        ifs.close();
     }
+    index_->touch(key.hash, unix_now());
+    touch_budget(key.hash);
+    ++disk_hits_;
+    disk_hit_bytes_ += data.size();
+
+    HotCache::Buffer buffer = ::std::make_shared<const ::std::string>(::std::move(data));
+    ::std::lock_guard<::std::mutex> shard_lock(shard.mutex);
+    shard.hot.put(key.url, buffer);
+    return buffer;
 }
 
-// 析构函数，保存缓存时间和 ETag 到文件
-my::HttpCacheManager::~HttpCacheManager()
+// 追加一块数据到正在写入的缓存
+// 只把数据块的引用放入写入队列，不复制数据、不加锁、不访问文件，写入由写入线程完成
+// 写入队列已满时放弃这个缓存而不是等待，转发给客户端不受写入速度的影响；缓存已被放弃或已提交时丢弃数据
+void my::HttpCacheManager::append_cache(const FillHandle &fill, SharedFetch::Chunk chunk)
 {
-    ::std::ofstream ofs(cache_time_map_filename_);
-    if (!ofs.is_open()) {
-        err("Failed to save cache_time_map file: " + cache_time_map_filename_);
+    if (!fill || chunk->empty() || fill->dropped.load(::std::memory_order_relaxed) || fill->end.load(::std::memory_order_relaxed) != FillEnd::NONE) {
         return;
     }
-    for (auto &pair : cache_time_map_) {
-        ofs << pair.first << ::std::endl;
-        ofs << pair.second << ::std::endl;
-        ofs << cache_etag_map_[pair.first] << ::std::endl;
+    WriteJob job{fill, ::std::move(chunk)};
+    if (!write_queue_.try_push(::std::move(job))) {
+        fill->dropped = true;
+        ++dropped_cnt_;
+        err("Cache: write queue is full, gave up caching: {}({})", fill->key.name, fill->key.url);
+        return;
     }
-    ofs.close();
+    ++fill->pushed;
+    signal_writer();
 }
 
-// 检查指定 URL 是否有缓存
-bool my::HttpCacheManager::has_cache(::std::string_view url) const
+// 创建指定 URL 的缓存
+// 写入线程发布之前缓存不可用；同一 URL 尚未发布的缓存被取代，写入线程不再发布它
+// 键冲突时新的 URL 取代原有的缓存，原有 URL 之后的请求不再命中
+// 先移除索引项再写入，写入期间异常退出不会留下指向不完整数据的索引项
+// 旧的响应在段文件中的空间由整理回收；单独的旧文件由写入线程在发布或放弃时替换或移除，此处不访问文件
+my::HttpCacheManager::FillHandle my::HttpCacheManager::create_cache(::std::string_view url)
 {
-    ::std::lock_guard<::std::mutex> lock(cache_mutex_);
-    return cache_time_map_.contains(get_key(url));
+    Key key = key_of(url);
+    if (!key.valid) {
+        return nullptr;
+    }
+    ::std::shared_ptr<Entry> entry = get_entry(key);
+    FillHandle fill = ::std::make_shared<Fill>();
+    fill->key = key;
+    fill->entry = entry;
+    fill->id = next_fill_id_++;
+    bool compact = false;
+    {
+        ::std::lock_guard<::std::mutex> lock(entry->mutex);
+        // 内存层中的旧响应已失效
+        {
+            Shard &shard = shard_of(key);
+            ::std::lock_guard<::std::mutex> shard_lock(shard.mutex);
+            shard.hot.erase(key.url);
+        }
+        index_->erase(key.hash);
+        {
+            ::std::lock_guard<::std::mutex> budget_lock(budget_mutex_);
+            budget_.erase(key.hash);
+        }
+        compact = segments_.release(entry->location);
+        if (entry->fill) {
+            FillEnd none = FillEnd::NONE;
+            entry->fill->end.compare_exchange_strong(none, FillEnd::ABORT);
+        }
+        entry->check = key.check;
+        entry->cached = false;
+        entry->filling = true;
+        entry->fill = fill;
+        entry->location = SegmentStore::Location{};
+    }
+
+    // 交给写入线程，之后由它负责结束这个缓存
+    {
+        ::std::lock_guard<::std::mutex> lock(fills_mutex_);
+        new_fills_.push_back(fill);
+    }
+    if (compact) {
+        schedule_compaction();
+    }
+    return fill;
 }
 
-// 读取指定 URL 的缓存数据
-int my::HttpCacheManager::read_cache(::std::string_view url, char *buffer, int buf_size, int start) const
+// 提交正在写入的缓存
+// 新鲜度在标记提交之前写入，写入线程看到提交后才读取它
+bool my::HttpCacheManager::commit_cache(const FillHandle &fill, const Freshness &freshness)
 {
-    ::std::lock_guard<::std::mutex> lock(cache_mutex_);
+    if (!fill) {
+        return false;
+    }
+    fill->freshness = freshness;
+    FillEnd none = FillEnd::NONE;
+    bool committed = fill->end.compare_exchange_strong(none, FillEnd::COMMIT);
+    signal_writer();
+    return committed && !fill->dropped;
+}
 
-    ::std::string key = get_key(url);
-    ::std::ifstream ifs(cache_dir_ + "\\" + key, ::std::ios::binary);
-    if (ifs.is_open()) {
-        ifs.seekg(start, ::std::ios::beg);
-        ifs.read(buffer, buf_size);
-        auto read_size = ifs.gcount();
-        buffer[read_size] = '\0';
-        ifs.close();
-        return read_size;
-    } else {
-        throw ::std::runtime_error("Failed to open cache file: " + key + "(" + ::std::string(url) + ")");
+// 放弃正在写入的缓存
+void my::HttpCacheManager::abort_cache(const FillHandle &fill)
+{
+    if (!fill) {
+        return;
+    }
+    FillEnd none = FillEnd::NONE;
+    if (fill->end.compare_exchange_strong(none, FillEnd::ABORT)) {
+        signal_writer();
     }
 }
 
-// 追加数据到指定 URL 的缓存
-void my::HttpCacheManager::append_cache(::std::string_view url, const char *data, int data_size)
+// 服务器确认缓存仍然有效（304 Not Modified）后更新指定 URL 的缓存的新鲜度
+// 只更新条目和索引中的新鲜度，缓存文件中保存的响应头部不变
+// 返回值: 是否更新，缓存已被移除或被键冲突的另一个 URL 取代时返回 false
+bool my::HttpCacheManager::refresh_cache(::std::string_view url, const Freshness &freshness)
 {
-    ::std::lock_guard<::std::mutex> lock(cache_mutex_);
+    Key key = key_of(url);
+    ::std::shared_ptr<Entry> entry = key.valid ? find_entry(key) : nullptr;
+    if (!entry) {
+        return false;
+    }
+    ::std::lock_guard<::std::mutex> lock(entry->mutex);
+    if (!entry->cached || entry->check != key.check) {
+        return false;
+    }
+    ::std::optional<CacheIndex::Item> item = index_->find(key.hash);
+    if (!item || item->check != key.check) {
+        return false;
+    }
+    store_freshness(*item, freshness);
+    if (!index_->put(*item)) {
+        return false;
+    }
+    entry->freshness = freshness;
+    return true;
+}
 
-    ::std::string key = get_key(url);
-    ::std::ofstream ofs(cache_dir_ + "\\" + key, ::std::ios::binary | ::std::ios::app);
-    if (!ofs.is_open()) {
-        throw ::std::runtime_error("Failed to open cache file: " + key + "(" + ::std::string(url) + ")");
+// 移除指定 URL 的缓存
+// 缓存属于键冲突的另一个 URL 时不做任何事
+void my::HttpCacheManager::remove_cache(::std::string_view url)
+{
+    Key key = key_of(url);
+    if (!key.valid) {
+        return;
+    }
+    ::std::shared_ptr<Entry> entry = find_entry(key);
+    if (!entry) {
+        ::std::filesystem::remove(path_of(key.name));
+        return;
+    }
+    bool compact = false;
+    {
+        ::std::lock_guard<::std::mutex> lock(entry->mutex);
+        if (entry->check == key.check) {
+            compact = discard_locked(key, *entry);
+        }
+    }
+    release_entry(key, entry);
+    if (compact) {
+        schedule_compaction();
     }
-    ofs.write(data, data_size);
-    ofs.close();
 }
 
-// 创建指定 URL 的缓存
-void my::HttpCacheManager::create_cache(::std::string_view url)
+// 获取指定 URL 的缓存的验证器
+// 两个验证器在同一次持有条目锁时读取，不会分别来自被替换前后的两个缓存
+::std::optional<my::HttpCacheManager::Validators> my::HttpCacheManager::get_validators(::std::string_view url) const
 {
-    ::std::lock_guard<::std::mutex> lock(cache_mutex_);
+    Key key = key_of(url);
+    ::std::shared_ptr<Entry> entry = key.valid ? find_entry(key) : nullptr;
+    if (entry) {
+        ::std::lock_guard<::std::mutex> lock(entry->mutex);
+        if (entry->cached && entry->check == key.check) {
+            return Validators{entry->modified_time, entry->etag};
+        }
+    }
+    return ::std::nullopt;
+}
 
-    ::std::string key = get_key(url);
-    ::std::ofstream ofs(cache_dir_ + "\\" + key, ::std::ios::binary);
-    if (!ofs.is_open()) {
-        throw ::std::runtime_error("Failed to create cache file: " + key + "(" + ::std::string(url) + ")");
+// 获取指定 URL 的缓存的新鲜度
+::std::optional<my::Freshness> my::HttpCacheManager::get_freshness(::std::string_view url) const
+{
+    Key key = key_of(url);
+    ::std::shared_ptr<Entry> entry = key.valid ? find_entry(key) : nullptr;
+    if (entry) {
+        ::std::lock_guard<::std::mutex> lock(entry->mutex);
+        if (entry->cached && entry->check == key.check) {
+            return entry->freshness;
+        }
     }
-    ofs.close();
+    return ::std::nullopt;
 }
 
-// 更新指定 URL 的缓存时间
-bool my::HttpCacheManager::update_cache_time(::std::string_view url)
+// 加入指定 URL 进行中的获取
+// 进行中的获取不再接受读者时（缓冲的数据过多），请求只能绕过缓存自行获取，以免与发起者同时写入缓存文件
+// 不能缓存的 URL 没有缓存键，不同的 URL 不能共享获取，同样绕过
+my::HttpCacheManager::Fetch my::HttpCacheManager::join_fetch(::std::string_view url)
 {
-    ::std::unique_lock<::std::mutex> lock(cache_mutex_);
+    Fetch fetch;
+    Key key = key_of(url);
+    if (!key.valid) {
+        fetch.role = FetchRole::BYPASS;
+        return fetch;
+    }
+    Shard &shard = shard_of(key);
+    ::std::lock_guard<::std::mutex> lock(shard.mutex);
 
-    ::std::string key = get_key(url);
-    ::std::ifstream ifs(cache_dir_ + "\\" + key);
-    if (!ifs.is_open()) {
-        throw ::std::runtime_error("Failed to open cache file: " + key + "(" + ::std::string(url) + ")");
+    ::std::shared_ptr<SharedFetch> &shared = shard.fetches[key.url];
+    if (!shared) {
+        shared = ::std::make_shared<SharedFetch>();
+        fetch.role = FetchRole::LEADER;
+        fetch.shared = shared;
+        ++fetch_cnt_;
+        return fetch;
     }
-    ::std::string line;
-    bool find_last_modified = false, find_e_tag = false;
-    while (::std::getline(ifs, line)) {
-        if (line.empty()) {
+    fetch.reader = shared->attach();
+    if (fetch.reader == SharedFetch::NO_READER) {
+        fetch.role = FetchRole::BYPASS;
+        return fetch;
+    }
+    fetch.role = FetchRole::READER;
+    fetch.shared = shared;
+    ++collapsed_cnt_;
+    return fetch;
+}
+
+// 在没有进行中的获取时成为指定 URL 的获取的发起者（用于后台验证），已有进行中的获取时不参与
+my::HttpCacheManager::Fetch my::HttpCacheManager::lead_fetch(::std::string_view url)
+{
+    Fetch fetch;
+    Key key = key_of(url);
+    if (!key.valid) {
+        return fetch;
+    }
+    Shard &shard = shard_of(key);
+    ::std::lock_guard<::std::mutex> lock(shard.mutex);
+
+    ::std::shared_ptr<SharedFetch> &shared = shard.fetches[key.url];
+    if (!shared) {
+        shared = ::std::make_shared<SharedFetch>();
+        fetch.role = FetchRole::LEADER;
+        fetch.shared = shared;
+        ++fetch_cnt_;
+    }
+    return fetch;
+}
+
+// 结束参与获取
+// 发起者先从分片中移除获取再结束它，之后的请求不会加入已结束的获取
+// 响应完整且已提交、但写入线程尚未发布缓存时，获取留在分片中并继续接受读者，新读者读到完整的响应；
+// 写入线程发布或放弃缓存时再移除获取（在条目锁内交接，不会错过），期间的请求既不会未命中也不会重复获取
+void my::HttpCacheManager::end_fetch(::std::string_view url, Fetch &fetch, SharedFetch::State state)
+{
+    if (!fetch.shared) {
+        return;
+    }
+    if (fetch.role == FetchRole::LEADER) {
+        Key key = key_of(url);
+        bool publishing = false;
+        if (state == SharedFetch::State::COMPLETE) {
+            if (::std::shared_ptr<Entry> entry = find_entry(key)) {
+                ::std::lock_guard<::std::mutex> lock(entry->mutex);
+                if (entry->fill && entry->fill->key.url == key.url && entry->fill->end.load() == FillEnd::COMMIT) {
+                    entry->fill->fetch = fetch.shared;
+                    publishing = true;
+                }
+            }
+        }
+        if (!publishing) {
+            Shard &shard = shard_of(key);
+            ::std::lock_guard<::std::mutex> lock(shard.mutex);
+            auto it = shard.fetches.find(key.url);
+            if (it != shard.fetches.end() && it->second == fetch.shared) {
+                shard.fetches.erase(it);
+            }
+        }
+        fetch.shared->finish(state, publishing);
+    } else if (fetch.role == FetchRole::READER) {
+        fetch.shared->detach(fetch.reader);
+    }
+    fetch.shared.reset();
+}
+
+// 设置内存层的容量
+void my::HttpCacheManager::set_memory_budget(size_t budget)
+{
+    for (Shard &shard : shards_) {
+        ::std::lock_guard<::std::mutex> lock(shard.mutex);
+        shard.hot.set_budget(budget / SHARD_COUNT);
+    }
+}
+
+// 设置磁盘层的容量，之后新建的段文件按新的容量确定大小
+void my::HttpCacheManager::set_disk_budget(uint64_t budget, size_t object_budget)
+{
+    bool over_budget = false;
+    {
+        ::std::lock_guard<::std::mutex> lock(budget_mutex_);
+        budget_.set_budget(budget, object_budget);
+        over_budget = budget_.over_budget();
+    }
+    segments_.set_segment_size(budget == 0 ? SegmentStore::SEGMENT_SIZE : budget / SEGMENTS_PER_BUDGET);
+    if (over_budget) {
+        schedule_eviction();
+    }
+}
+
+// 获取各层缓存的统计，内存层的统计为各分片之和
+my::HttpCacheManager::CacheStats my::HttpCacheManager::stats() const
+{
+    CacheStats stats;
+    for (Shard &shard : shards_) {
+        ::std::lock_guard<::std::mutex> lock(shard.mutex);
+        HotCache::Stats part = shard.hot.stats();
+        stats.memory.hits += part.hits;
+        stats.memory.misses += part.misses;
+        stats.memory.hit_bytes += part.hit_bytes;
+        stats.memory.objects += part.objects;
+        stats.memory.bytes += part.bytes;
+        stats.memory.evictions += part.evictions;
+        stats.memory.budget += part.budget;
+    }
+    stats.disk.hits = disk_hits_.load();
+    stats.disk.misses = disk_misses_.load();
+    stats.disk.hit_bytes = disk_hit_bytes_.load();
+    {
+        ::std::lock_guard<::std::mutex> lock(budget_mutex_);
+        DiskBudget::Stats part = budget_.stats();
+        stats.disk.objects = part.objects;
+        stats.disk.bytes = part.bytes;
+        stats.disk.budget = part.byte_budget;
+        stats.disk.object_budget = part.object_budget;
+        stats.disk.evictions = part.evictions;
+        stats.disk.evicted_bytes = part.evicted_bytes;
+    }
+    stats.disk.segments = segments_.stats();
+    stats.fetches = fetch_cnt_.load();
+    stats.collapsed = collapsed_cnt_.load();
+    stats.written = written_cnt_.load();
+    stats.dropped = dropped_cnt_.load();
+    return stats;
+}
+
+// 获取键所在的分片
+my::HttpCacheManager::Shard &my::HttpCacheManager::shard_of(const Key &key) const
+{
+    return shards_[key.hash.high % SHARD_COUNT];
+}
+
+// 查找缓存条目
+::std::shared_ptr<my::HttpCacheManager::Entry> my::HttpCacheManager::find_entry(const Key &key) const
+{
+    Shard &shard = shard_of(key);
+    ::std::lock_guard<::std::mutex> lock(shard.mutex);
+    return find_locked(shard, key);
+}
+
+// 查找缓存条目，不存在时创建
+::std::shared_ptr<my::HttpCacheManager::Entry> my::HttpCacheManager::get_entry(const Key &key)
+{
+    Shard &shard = shard_of(key);
+    ::std::lock_guard<::std::mutex> lock(shard.mutex);
+    if (::std::shared_ptr<Entry> entry = find_locked(shard, key)) {
+        return entry;
+    }
+    ::std::shared_ptr<Entry> entry = ::std::make_shared<Entry>();
+    entry->url = key.url;
+    shard.entries.emplace(key.name, entry);
+    return entry;
+}
+
+// 查找缓存条目，调用时必须持有分片锁
+// 不在内存中的条目从索引加载，加载后留在内存中，直到缓存被移除
+// 淘汰时只知道缓存键，此时条目的 URL 为空，之后由带有 URL 的查找补上
+::std::shared_ptr<my::HttpCacheManager::Entry> my::HttpCacheManager::find_locked(Shard &shard, const Key &key) const
+{
+    if (auto it = shard.entries.find(key.name); it != shard.entries.end()) {
+        if (it->second->url.empty()) {
+            it->second->url = key.url;
+        }
+        return it->second;
+    }
+    ::std::optional<CacheIndex::Item> item = index_->find(key.hash);
+    if (!item) {
+        return nullptr;
+    }
+    ::std::shared_ptr<Entry> entry = ::std::make_shared<Entry>();
+    entry->url = key.url;
+    entry->check = item->check;
+    entry->cached = true;
+    entry->modified_time = ::std::move(item->modified_time);
+    entry->etag = ::std::move(item->etag);
+    entry->freshness = freshness_of(*item);
+    entry->location = SegmentStore::Location{item->segment, item->offset, item->size};
+    shard.entries.emplace(key.name, entry);
+    return entry;
+}
+
+// 释放不再使用的缓存条目
+// 条目只能在持有分片锁时被取得，因此持有分片锁且引用计数为 2（分片和调用者）时没有其他使用者，可以不加条目锁读取其状态
+void my::HttpCacheManager::release_entry(const Key &key, ::std::shared_ptr<Entry> &entry)
+{
+    Shard &shard = shard_of(key);
+    ::std::lock_guard<::std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key.name);
+    if (it != shard.entries.end() && it->second == entry && entry.use_count() == 2 && !entry->cached && !entry->filling) {
+        shard.entries.erase(it);
+    }
+    entry.reset();
+}
+
+// 移除条目对应的缓存
+// 段文件中的响应只减少所在段的有效字节数，空间由整理回收；单独的缓存文件直接删除
+// 正在写入的缓存被放弃，写入线程不再发布它，并释放其计入的用量
+bool my::HttpCacheManager::discard_locked(const Key &key, Entry &entry)
+{
+    entry.cached = false;
+    entry.filling = false;
+    if (entry.fill) {
+        FillEnd none = FillEnd::NONE;
+        if (entry.fill->end.compare_exchange_strong(none, FillEnd::ABORT)) {
+            signal_writer();
+        }
+        entry.fill.reset();
+    }
+    {
+        Shard &shard = shard_of(key);
+        ::std::lock_guard<::std::mutex> shard_lock(shard.mutex);
+        shard.hot.erase(key.url.empty() ? entry.url : key.url);
+    }
+    index_->erase(key.hash);
+    {
+        ::std::lock_guard<::std::mutex> budget_lock(budget_mutex_);
+        budget_.erase(key.hash);
+    }
+    bool compact = segments_.release(entry.location);
+    entry.location = SegmentStore::Location{};
+    ::std::error_code ec;
+    ::std::filesystem::remove(path_of(key.name), ec);
+    return compact;
+}
+
+// 从索引恢复磁盘层的用量和访问统计
+// 索引项按最后访问时间从早到晚加入，被访问过的直接进入主队列；超过容量（如容量被调小）时开始后台淘汰
+// 指向不存在的段文件或超出段文件范围的索引项被移除；没有有效数据的段文件直接删除，有效数据过少的段在后台整理
+// 没有索引项的缓存文件（旧版本的缓存、写入中途异常退出留下的文件）不计入用量，直接移除；索引是新建的时移除所有缓存文件
+void my::HttpCacheManager::load_budget()
+{
+    ::std::vector<CacheIndex::Item> items = index_->items();
+    ::std::erase_if(items, [this](const CacheIndex::Item &item) {
+        if (item.segment != 0 && !segments_.restore(SegmentStore::Location{item.segment, item.offset, item.size})) {
+            err("Cache: segment {} of cache {} is missing, removed from index", item.segment, name_of(item.key));
+            index_->erase(item.key);
+            return true;
+        }
+        return false;
+    });
+    ::std::sort(items.begin(), items.end(), [](const CacheIndex::Item &a, const CacheIndex::Item &b) { return a.accessed_at < b.accessed_at; });
+    ::std::unordered_set<::std::string> names;
+    bool over_budget = false;
+    {
+        ::std::lock_guard<::std::mutex> lock(budget_mutex_);
+        for (const CacheIndex::Item &item : items) {
+            names.insert(name_of(item.key));
+            budget_.add(item.key, item.size, item.hits > 0);
+        }
+        over_budget = budget_.over_budget();
+    }
+    segments_.finish_restore();
+
+    ::std::error_code ec;
+    for (const auto &file : ::std::filesystem::directory_iterator(cache_dir_, ec)) {
+        ::std::string name = file.path().filename().string();
+        if (file.is_regular_file() && name.find("cache_index") != 0 && !SegmentStore::is_segment(name) && !names.contains(name)) {
+            ::std::filesystem::remove(file.path(), ec);
+        }
+    }
+    if (over_budget) {
+        schedule_eviction();
+    }
+    schedule_compaction();
+}
+
+// 记录一次磁盘层的访问
+// 命中内存层时同样记录，使热点缓存的文件不被淘汰；淘汰线程持有锁时放弃记录，不阻塞请求
+void my::HttpCacheManager::touch_budget(const Hash128 &key) const
+{
+    ::std::unique_lock<::std::mutex> lock(budget_mutex_, ::std::try_to_lock);
+    if (lock.owns_lock()) {
+        budget_.touch(key);
+    }
+}
+
+// 开始后台淘汰
+void my::HttpCacheManager::schedule_eviction()
+{
+    if (!stopping_ && !evicting_.exchange(true)) {
+        maintainer_.add_task(&HttpCacheManager::run_eviction, this);
+    }
+}
+
+// 在后台线程中淘汰缓存
+// 每批最多选出 EVICTION_BATCH 个缓存，选出后释放锁再逐个移除，移除期间写入和访问不受影响
+// 只有正在写入的数据超过容量时选不出缓存，此时结束，之后的写入会再次开始淘汰
+void my::HttpCacheManager::run_eviction()
+{
+    while (!stopping_) {
+        ::std::vector<DiskBudget::Victim> victims;
+        {
+            ::std::lock_guard<::std::mutex> lock(budget_mutex_);
+            victims = budget_.select_victims(EVICTION_BATCH);
+        }
+        if (victims.empty()) {
             break;
         }
-        if (line.find("Last-Modified:") == 0) {
-            find_last_modified = true;
-            cache_time_map_[key] = line.substr(15);
-        } else if (line.find("ETag:") == 0) {
-            find_e_tag = true;
-            cache_etag_map_[key] = line.substr(6);
+        bool compact = false;
+        for (const DiskBudget::Victim &victim : victims) {
+            compact = evict_cache(victim) || compact;
+        }
+        log("Cache: evicted {} cache files from disk", victims.size());
+        if (compact) {
+            schedule_compaction();
         }
     }
-    ifs.close();
-    if (find_last_modified || find_e_tag) {
-        if (!find_last_modified) {
-            cache_time_map_[key] = "";
+    evicting_ = false;
+}
+
+// 淘汰一个缓存
+// 缓存在被选中后可能已被移除、正在重新写入或已重新写入（重新计入了用量），这些情况下不做任何事
+// 没有条目也没有索引项时不删除文件，以免删除另一个请求刚开始写入的缓存文件
+bool my::HttpCacheManager::evict_cache(const DiskBudget::Victim &victim)
+{
+    Key key;
+    key.hash = victim.key;
+    key.name = name_of(victim.key);
+    ::std::shared_ptr<Entry> entry = find_entry(key);
+    if (!entry) {
+        return false;
+    }
+    bool compact = false;
+    {
+        ::std::lock_guard<::std::mutex> lock(entry->mutex);
+        bool evictable = entry->cached && !entry->filling;
+        if (evictable) {
+            ::std::lock_guard<::std::mutex> budget_lock(budget_mutex_);
+            evictable = !budget_.contains(victim.key);
         }
-        if (!find_e_tag) {
-            cache_etag_map_[key] = "";
+        if (evictable) {
+            compact = discard_locked(key, *entry);
         }
-        return true;
     }
-    lock.unlock();
+    release_entry(key, entry);
+    return compact;
+}
 
-    remove_cache(url);
-    return false;
+// 开始后台整理
+// 与淘汰在同一个后台线程中依次进行，整理移动响应时不会与淘汰争用条目
+void my::HttpCacheManager::schedule_compaction()
+{
+    if (!stopping_ && !compacting_.exchange(true)) {
+        maintainer_.add_task(&HttpCacheManager::run_compaction, this);
+    }
 }
 
-// 移除指定 URL 的缓存
-void my::HttpCacheManager::remove_cache(::std::string_view url)
+// 在后台线程中整理段文件
+// 按有效数据从少到多处理需要整理的段：按顺序读出段中的对象头部，把索引仍指向该位置的响应移到当前段
+// 移动完成后段中没有有效数据，删除段文件；正在发送其中响应的句柄不受影响
+// 写入失败（如磁盘已满）时放弃本次整理，之后移除缓存时会再次开始
+void my::HttpCacheManager::run_compaction()
 {
-    ::std::lock_guard<::std::mutex> lock(cache_mutex_);
-    ::std::string key = get_key(url);
-    ::std::filesystem::remove(cache_dir_ + "\\" + key);
-    cache_time_map_.erase(key);
-    cache_etag_map_.erase(key);
+    try {
+        for (uint32_t segment : segments_.candidates()) {
+            if (stopping_) {
+                break;
+            }
+            size_t moved = 0;
+            for (const SegmentStore::Object &object : segments_.scan(segment)) {
+                if (stopping_) {
+                    break;
+                }
+                moved += move_object(object) ? 1 : 0;
+            }
+            if (segments_.remove(segment)) {
+                log("Cache: compacted segment {}, moved {} cached responses", segment, moved);
+            }
+        }
+    } catch (const ::std::exception &e) {
+        err("Cache: failed to compact segments: {}", e.what());
+    }
+    compacting_ = false;
 }
 
-// 获取指定 URL 的最后修改时间
-::std::string my::HttpCacheManager::get_modified_time(::std::string_view url) const
+// 把段中的一个响应移到当前段
+// 持有条目锁完成读取、追加和写入索引，移动期间同一 URL 的请求等待，其他 URL 不受影响
+// 条目中的位置与对象头部的位置相同才说明响应仍然有效，被移除或重新写入的响应留在原处，随段文件一起删除
+bool my::HttpCacheManager::move_object(const SegmentStore::Object &object)
 {
-    ::std::lock_guard<::std::mutex> lock(cache_mutex_);
-    return cache_time_map_.at(get_key(url));
+    Key key;
+    key.hash = object.key;
+    key.name = name_of(object.key);
+    ::std::shared_ptr<Entry> entry = find_entry(key);
+    if (!entry) {
+        return false;
+    }
+    bool moved = false;
+    {
+        ::std::lock_guard<::std::mutex> lock(entry->mutex);
+        if (entry->cached && !entry->filling && entry->location == object.location) {
+            ::std::optional<CacheIndex::Item> item = index_->find(key.hash);
+            ::std::string data;
+            if (!item || !segments_.read(object.location, key.hash, data)) {
+                err("Cache: corrupted cache in segment {}: {}", object.location.segment, key.name);
+                discard_locked(key, *entry);
+            } else {
+                SegmentStore::Location location = segments_.append(key.hash, data);
+                item->segment = location.segment;
+                item->offset = location.offset;
+                if (index_->put(*item)) {
+                    entry->location = location;
+                    segments_.release(object.location);
+                    segments_.record_move(data.size());
+                    moved = true;
+                } else {
+                    segments_.release(location);
+                }
+            }
+        }
+    }
+    release_entry(key, entry);
+    return moved;
+}
+
+// 唤醒写入线程
+// 写入线程只在没有工作时等待，此时通知才需要系统调用
+void my::HttpCacheManager::signal_writer()
+{
+    write_signal_.fetch_add(1, ::std::memory_order_release);
+    write_signal_.notify_one();
+}
+
+// 写入线程
+// 每轮先取走新创建的缓存，再取出队列中的数据块，最后结束请求的线程已结束的缓存：
+// 放弃的和写入队列已满的立即结束；提交的在其所有数据块都处理完后结束；析构时未提交的被放弃
+// 检查工作之前读取唤醒计数，检查之后有新工作时计数已改变，等待立即返回，不会错过唤醒
+void my::HttpCacheManager::run_writer()
+{
+    ::std::vector<FillHandle> fills;
+    while (true) {
+        uint32_t signal = write_signal_.load(::std::memory_order_acquire);
+        bool stopping = writer_stopping_.load();
+        {
+            ::std::lock_guard<::std::mutex> lock(fills_mutex_);
+            fills.insert(fills.end(), new_fills_.begin(), new_fills_.end());
+            new_fills_.clear();
+        }
+
+        size_t popped = 0;
+        WriteJob job;
+        while (popped < WRITE_QUEUE_SIZE && write_queue_.try_pop(job)) {
+            write_chunk(*job.fill, job.chunk);
+            job = WriteJob{};
+            ++popped;
+        }
+
+        size_t finished = ::std::erase_if(fills, [this, stopping](const FillHandle &fill) {
+            FillEnd end = fill->end.load(::std::memory_order_acquire);
+            bool done = end == FillEnd::ABORT || fill->dropped || (end == FillEnd::COMMIT && fill->processed == fill->pushed.load()) ||
+                        (end == FillEnd::NONE && stopping);
+            if (done) {
+                finish_fill(*fill);
+            }
+            return done;
+        });
+
+        if (stopping && fills.empty() && popped == 0) {
+            break;
+        }
+        if (popped == 0 && finished == 0) {
+            write_signal_.wait(signal, ::std::memory_order_acquire);
+        }
+    }
 }
 
-// 获取指定 URL 的 ETag
-::std::string my::HttpCacheManager::get_etag(::std::string_view url) const
+// 在写入线程中处理一个数据块
+// 不超过 SegmentStore::MAX_OBJECT 的响应完整记录在内存中，发布时一次追加到段文件
+// 更大的响应改为写入临时文件，数据积累到 WRITE_BATCH 才写入一次，小的数据包合并成大块顺序写入
+// 数据块在处理时计入磁盘层的用量，大的响应在写入期间就可能触发淘汰
+void my::HttpCacheManager::write_chunk(Fill &fill, const SharedFetch::Chunk &chunk)
 {
-    ::std::lock_guard<::std::mutex> lock(cache_mutex_);
-    return cache_etag_map_.at(get_key(url));
+    ++fill.processed;
+    if (fill.finished || fill.failed || fill.dropped || fill.end.load(::std::memory_order_relaxed) == FillEnd::ABORT) {
+        return;
+    }
+    if (!fill.spilled && fill.data.size() + chunk->size() > SegmentStore::MAX_OBJECT) {
+        fill.head = fill.data.substr(0, fill.data.find("\r\n\r\n"));
+        fill.file.open(temp_path_of(fill), ::std::ios::binary | ::std::ios::trunc);
+        if (!fill.file.is_open()) {
+            err("Cache: failed to create temporary cache file: {}({})", temp_path_of(fill), fill.key.url);
+            fill.failed = true;
+            return;
+        }
+        fill.spilled = true;
+    }
+    fill.data.append(*chunk);
+    fill.size += chunk->size();
+    if (fill.spilled && fill.data.size() >= WRITE_BATCH) {
+        flush_fill(fill);
+    }
+
+    bool over_budget = false;
+    fill.reserved += chunk->size();
+    {
+        ::std::lock_guard<::std::mutex> budget_lock(budget_mutex_);
+        budget_.reserve(chunk->size());
+        over_budget = budget_.over_budget();
+    }
+    if (over_budget) {
+        schedule_eviction();
+    }
+}
+
+// 在写入线程中写入临时文件中积累的数据，写入后保留缓冲的容量供之后积累
+void my::HttpCacheManager::flush_fill(Fill &fill)
+{
+    if (fill.data.empty() || fill.failed) {
+        return;
+    }
+    if (!fill.file.write(fill.data.data(), fill.data.size())) {
+        err("Cache: failed to write temporary cache file: {}({})", temp_path_of(fill), fill.key.url);
+        fill.failed = true;
+    }
+    fill.data.clear();
+}
+
+// 在写入线程中结束一个缓存
+// 既没有验证器（无法向服务器验证）也没有新鲜期（无法直接使用）的响应不缓存
+// 数据在不持有任何锁时写完：较小的响应追加到段文件，较大的响应写完临时文件并关闭
+// 之后在条目锁内发布：临时文件改名为缓存文件，写入索引，放入内存层；缓存已被取代或移除时不发布
+// 发布前后都移除继续接受读者的获取，之后的请求直接命中缓存或重新获取
+// 没有发布的缓存释放其在段文件中的空间并删除临时文件；计入的用量在结束时释放，发布的缓存按实际大小重新计入
+void my::HttpCacheManager::finish_fill(Fill &fill)
+{
+    fill.finished = true;
+    const Key &key = fill.key;
+    bool commit = fill.end.load() == FillEnd::COMMIT && !fill.dropped && !fill.failed && fill.size > 0;
+
+    CacheIndex::Item item;
+    SegmentStore::Location location;
+    if (commit) {
+        ::std::string_view head = fill.spilled ? ::std::string_view(fill.head) : ::std::string_view(fill.data).substr(0, fill.data.find("\r\n\r\n"));
+        if (!parse_validators(head, item.modified_time, item.etag) && fill.freshness.lifetime <= 0) {
+            log("Cache: refused to create cache for: {} ({}), neither Last-Modified nor ETag found and no freshness lifetime", key.url, key.name);
+            commit = false;
+        }
+    }
+    if (commit && fill.spilled) {
+        flush_fill(fill);
+        fill.file.close();
+        commit = !fill.failed && !fill.file.fail();
+    } else if (commit) {
+        try {
+            location = segments_.append(key.hash, fill.data);
+        } catch (const ::std::exception &e) {
+            err("Cache: {}", e.what());
+            commit = false;
+        }
+    }
+    if (fill.file.is_open()) {
+        fill.file.close();
+    }
+    item.key = key.hash;
+    item.check = key.check;
+    item.size = fill.size;
+    item.segment = location.segment;
+    item.offset = location.offset;
+    store_freshness(item, fill.freshness);
+    item.accessed_at = unix_now();
+
+    bool published = false;
+    bool over_budget = false;
+    ::std::shared_ptr<SharedFetch> fetch;
+    ::std::shared_ptr<Entry> entry = ::std::move(fill.entry);
+    {
+        ::std::lock_guard<::std::mutex> lock(entry->mutex);
+        fetch = ::std::move(fill.fetch);
+        if (entry->fill.get() == &fill) {
+            entry->fill.reset();
+            entry->filling = false;
+            published = commit && (!fill.spilled || MoveFileExA(temp_path_of(fill).c_str(), path_of(key.name).c_str(), MOVEFILE_REPLACE_EXISTING)) &&
+                        index_->put(item);
+            if (published) {
+                entry->modified_time = item.modified_time;
+                entry->etag = item.etag;
+                entry->freshness = fill.freshness;
+                entry->cached = true;
+                entry->location = location;
+            } else if (commit) {
+                err("Cache: failed to publish cache for: {} ({})", key.url, key.name);
+            }
+            // 单独的旧缓存文件已被替换；新的响应保存在段文件中或没有发布时移除它
+            if (!published || !fill.spilled) {
+                ::std::error_code ec;
+                ::std::filesystem::remove(path_of(key.name), ec);
+            }
+        }
+        {
+            Shard &shard = shard_of(key);
+            ::std::lock_guard<::std::mutex> shard_lock(shard.mutex);
+            if (published && !fill.spilled && fill.size <= MAX_MEMORY_OBJECT) {
+                shard.hot.put(key.url, ::std::make_shared<const ::std::string>(::std::move(fill.data)));
+            }
+            auto it = shard.fetches.find(key.url);
+            if (fetch && it != shard.fetches.end() && it->second == fetch) {
+                shard.fetches.erase(it);
+            }
+        }
+        ::std::lock_guard<::std::mutex> budget_lock(budget_mutex_);
+        budget_.release(fill.reserved);
+        if (published) {
+            budget_.add(key.hash, item.size);
+        }
+        over_budget = budget_.over_budget();
+    }
+    fill.reserved = 0;
+    ::std::string().swap(fill.data);
+
+    if (!published) {
+        if (segments_.release(location)) {
+            schedule_compaction();
+        }
+        if (fill.spilled) {
+            ::std::error_code ec;
+            ::std::filesystem::remove(temp_path_of(fill), ec);
+        }
+    }
+    if (fetch) {
+        fetch->close();
+    }
+    release_entry(key, entry);
+    if (over_budget) {
+        schedule_eviction();
+    }
+    if (published) {
+        ++written_cnt_;
+        log("Cache: cache created(updated) for: {} ({}, {} bytes), fresh for {}s", key.url, key.name, fill.size,
+            fill.freshness.lifetime - fill.freshness.initial_age);
+    }
+}
+
+// 把新鲜度写入索引项，过期后可用的窗口不超过 int32_t 的范围
+void my::HttpCacheManager::store_freshness(CacheIndex::Item &item, const Freshness &freshness)
+{
+    auto window = [](int64_t seconds) { return static_cast<int32_t>(::std::min<int64_t>(seconds, INT32_MAX)); };
+    item.stored_at = freshness.response_time;
+    item.initial_age = freshness.initial_age;
+    item.lifetime = freshness.lifetime;
+    item.stale_while_revalidate = window(freshness.stale_while_revalidate);
+    item.stale_if_error = window(freshness.stale_if_error);
+    item.must_revalidate = freshness.must_revalidate;
+}
+
+// 从索引项中读取新鲜度
+my::Freshness my::HttpCacheManager::freshness_of(const CacheIndex::Item &item)
+{
+    Freshness freshness;
+    freshness.response_time = item.stored_at;
+    freshness.initial_age = item.initial_age;
+    freshness.lifetime = item.lifetime;
+    freshness.stale_while_revalidate = item.stale_while_revalidate;
+    freshness.stale_if_error = item.stale_if_error;
+    freshness.must_revalidate = item.must_revalidate;
+    return freshness;
+}
+
+// 获取缓存文件路径
+::std::string my::HttpCacheManager::path_of(const ::std::string &key) const
+{
+    return cache_dir_ + "\\" + key;
+}
+
+// 获取正在写入的缓存的临时文件路径
+// 临时文件名以缓存键开头，写入中途异常退出留下的临时文件没有索引项，启动时被移除
+::std::string my::HttpCacheManager::temp_path_of(const Fill &fill) const
+{
+    return ::std::format("{}.{}.tmp", path_of(fill.key.name), fill.id);
+}
+
+// 从响应头部中读取 Last-Modified 和 ETag，逐行读取时去掉行尾的 \r
+bool my::HttpCacheManager::parse_validators(::std::string_view head, ::std::string &modified_time, ::std::string &etag)
+{
+    ::std::istringstream lines{::std::string(head)};
+    ::std::string line;
+    bool find_last_modified = false, find_e_tag = false;
+    while (::std::getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            break;
+        }
+        if (line.find("Last-Modified:") == 0) {
+            find_last_modified = true;
+            modified_time = line.substr(15);
+        } else if (line.find("ETag:") == 0) {
+            find_e_tag = true;
+            etag = line.substr(6);
+        }
+    }
+    return find_last_modified || find_e_tag;
+}
+
+// 指定 URL 能否缓存
+bool my::HttpCacheManager::is_cacheable(::std::string_view url)
+{
+    return !normalize_url(url).empty();
 }
 
 // 获取指定 URL 的缓存键
 ::std::string my::HttpCacheManager::get_key(::std::string_view url)
 {
-    ::std::string host, path;
-    size_t pos = 0;
-    if (url.find("http://") == 0) {
-        pos = 7;
-    } else if (url.find("https://") == 0) {
-        pos = 8;
-    } else {
-        return "";
-    }
+    return key_of(url).name;
+}
 
-    size_t host_end = url.find('/', pos);
-    host = ::std::string(url.substr(pos, host_end - pos));
-    path = ::std::string(url.substr(host_end));
+// 获取指定 URL 的缓存键
+// 等价的 URL 规范化后相同，得到相同的键；键按高 64 位在前的顺序格式化
+my::HttpCacheManager::Key my::HttpCacheManager::key_of(::std::string_view url)
+{
+    Key key;
+    key.url = normalize_url(url);
+    if (key.url.empty()) {
+        return key;
+    }
+    key.valid = true;
+    key.hash = murmur3_128(key.url);
+    key.check = murmur3_128(key.url, CHECK_SEED);
+    key.name = name_of(key.hash);
+    return key;
+}
 
-    ::std::stringstream ss;
-    ss << std::hex << std::uppercase << std::setfill('0') << std::setw(2)
-       << ::std::hash<::std::string>()(host)
-       << ::std::hash<::std::string>()(path);
-    return ss.str();
+// 获取缓存键的十六进制表示，高 64 位在前
+::std::string my::HttpCacheManager::name_of(const Hash128 &hash)
+{
+    return ::std::format("{:016X}{:016X}", hash.high, hash.low);
 }
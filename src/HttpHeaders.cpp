@@ -0,0 +1,290 @@
+#include "../include/HttpHeaders.h"
+
+#include <algorithm>
+#include <cstring>
+
+// 把 ASCII 大写字母转换为小写
+static char to_lower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// 不区分大小写地比较两个字符串
+static bool iequals(::std::string_view a, ::std::string_view b)
+{
+    return a.size() == b.size() && ::std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return to_lower(x) == to_lower(y); });
+}
+
+// 去掉首尾的空白
+static ::std::string_view trim_ows(::std::string_view str)
+{
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) str.remove_prefix(1);
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) str.remove_suffix(1);
+    return str;
+}
+
+// 拷贝构造函数
+my::HttpHeaders::HttpHeaders(const HttpHeaders &other)
+{
+    copy_from(other);
+}
+
+// 移动构造函数
+my::HttpHeaders::HttpHeaders(HttpHeaders &&other) noexcept
+{
+    *this = ::std::move(other);
+}
+
+// 拷贝赋值运算符
+my::HttpHeaders &my::HttpHeaders::operator=(const HttpHeaders &other)
+{
+    if (this != &other) {
+        copy_from(other);
+    }
+    return *this;
+}
+
+// 移动赋值运算符，已分配的堆内存直接转移
+my::HttpHeaders &my::HttpHeaders::operator=(HttpHeaders &&other) noexcept
+{
+    if (this != &other) {
+        count_ = other.count_;
+        used_ = other.used_;
+        heap_entries_ = ::std::move(other.heap_entries_);
+        heap_bytes_ = ::std::move(other.heap_bytes_);
+        if (heap_entries_.empty()) {
+            ::std::copy_n(other.inline_entries_, count_, inline_entries_);
+        }
+        if (heap_bytes_.empty()) {
+            ::std::memcpy(inline_bytes_, other.inline_bytes_, used_);
+        }
+        other.clear();
+    }
+    return *this;
+}
+
+// 追加一个字段，保留已有的同名字段
+void my::HttpHeaders::add(::std::string_view name, ::std::string_view value, Source source)
+{
+    Entry entry;
+    entry.name_offset = store(name);
+    entry.name_size = static_cast<uint32_t>(name.size());
+    entry.value_offset = store(value);
+    entry.value_size = static_cast<uint32_t>(value.size());
+    entry.hash = hash(name);
+    entry.source = source;
+
+    if (heap_entries_.empty() && count_ < INLINE_FIELDS) {
+        inline_entries_[count_] = entry;
+    } else {
+        // 超过内置容量时把所有字段移到堆上
+        if (heap_entries_.empty()) {
+            heap_entries_.reserve(INLINE_FIELDS * 2);
+            heap_entries_.assign(inline_entries_, inline_entries_ + count_);
+        }
+        heap_entries_.push_back(entry);
+    }
+    ++count_;
+}
+
+// 设置字段的值：替换第一个同名字段的值并删除其余的同名字段，不存在时追加
+void my::HttpHeaders::set(::std::string_view name, ::std::string_view value)
+{
+    uint32_t name_hash = hash(name);
+    size_t index = find(name, name_hash, 0);
+    if (index == count_) {
+        add(name, value);
+        return;
+    }
+
+    // 新值追加到存储中，旧值占用的空间不回收（一组头部字段的生命周期很短）
+    uint32_t offset = store(value);
+    entries()[index].value_offset = offset;
+    entries()[index].value_size = static_cast<uint32_t>(value.size());
+    entries()[index].source = Source();
+
+    while ((index = find(name, name_hash, index + 1)) != count_) {
+        Entry *first = entries();
+        ::std::copy(first + index + 1, first + count_, first + index);
+        if (!heap_entries_.empty()) {
+            heap_entries_.pop_back();
+        }
+        --count_;
+        --index;
+    }
+}
+
+// 删除所有同名字段，保持其余字段的顺序
+size_t my::HttpHeaders::erase(::std::string_view name)
+{
+    uint32_t name_hash = hash(name);
+    Entry *first = entries();
+    Entry *last = ::std::remove_if(first, first + count_, [&](const Entry &entry) {
+        return entry.hash == name_hash && iequals(view(entry.name_offset, entry.name_size), name);
+    });
+    size_t erased = first + count_ - last;
+    count_ -= erased;
+    if (!heap_entries_.empty()) {
+        heap_entries_.resize(count_);
+    }
+    return erased;
+}
+
+// 删除所有字段
+void my::HttpHeaders::clear()
+{
+    heap_entries_.clear();
+    heap_bytes_.clear();
+    count_ = 0;
+    used_ = 0;
+}
+
+// 获取第一个同名字段的值
+::std::string_view my::HttpHeaders::get(::std::string_view name) const
+{
+    size_t index = find(name, hash(name), 0);
+    if (index == count_) {
+        return {};
+    }
+    const Entry &entry = entries()[index];
+    return view(entry.value_offset, entry.value_size);
+}
+
+// 是否存在同名字段
+bool my::HttpHeaders::contains(::std::string_view name) const
+{
+    return find(name, hash(name), 0) != count_;
+}
+
+// 同名字段的逗号分隔值中是否包含指定的标记
+bool my::HttpHeaders::has_token(::std::string_view name, ::std::string_view token) const
+{
+    uint32_t name_hash = hash(name);
+    for (size_t index = find(name, name_hash, 0); index != count_; index = find(name, name_hash, index + 1)) {
+        const Entry &entry = entries()[index];
+        ::std::string_view rest = view(entry.value_offset, entry.value_size);
+        while (!rest.empty()) {
+            size_t comma = rest.find(',');
+            if (iequals(trim_ows(rest.substr(0, comma)), token)) {
+                return true;
+            }
+            if (comma == ::std::string_view::npos) {
+                break;
+            }
+            rest.remove_prefix(comma + 1);
+        }
+    }
+    return false;
+}
+
+// 获取字段数
+size_t my::HttpHeaders::size() const
+{
+    return count_;
+}
+
+// 是否没有字段
+bool my::HttpHeaders::empty() const
+{
+    return count_ == 0;
+}
+
+// 获取第 index 个字段
+my::HttpHeaders::Field my::HttpHeaders::field(size_t index) const
+{
+    const Entry &entry = entries()[index];
+    return {view(entry.name_offset, entry.name_size), view(entry.value_offset, entry.value_size)};
+}
+
+// 获取第 index 个字段在原始数据中所在的行
+my::HttpHeaders::Source my::HttpHeaders::source(size_t index) const
+{
+    return entries()[index].source;
+}
+
+// 获取指向第一个字段的迭代器
+my::HttpHeaders::Iterator my::HttpHeaders::begin() const
+{
+    return Iterator(this, 0);
+}
+
+// 获取指向最后一个字段之后的迭代器
+my::HttpHeaders::Iterator my::HttpHeaders::end() const
+{
+    return Iterator(this, count_);
+}
+
+// 计算字段名不区分大小写的哈希值（FNV-1a）
+uint32_t my::HttpHeaders::hash(::std::string_view name)
+{
+    uint32_t value = 2166136261u;
+    for (char c : name) {
+        value = (value ^ static_cast<unsigned char>(to_lower(c))) * 16777619u;
+    }
+    return value;
+}
+
+// 从 from 开始查找同名字段，先比较哈希值再比较字段名
+size_t my::HttpHeaders::find(::std::string_view name, uint32_t name_hash, size_t from) const
+{
+    const Entry *first = entries();
+    for (size_t index = from; index < count_; ++index) {
+        if (first[index].hash == name_hash && iequals(view(first[index].name_offset, first[index].name_size), name)) {
+            return index;
+        }
+    }
+    return count_;
+}
+
+// 把字符串追加到存储中，超过内置容量时把存储移到堆上
+uint32_t my::HttpHeaders::store(::std::string_view str)
+{
+    size_t offset = used_;
+    if (str.empty()) {
+        return static_cast<uint32_t>(offset);
+    }
+    if (heap_bytes_.empty() && used_ + str.size() <= INLINE_BYTES) {
+        ::std::memcpy(inline_bytes_ + used_, str.data(), str.size());
+    } else {
+        if (heap_bytes_.empty()) {
+            heap_bytes_.reserve(::std::max(INLINE_BYTES * 2, used_ + str.size()));
+            heap_bytes_.assign(inline_bytes_, used_);
+        }
+        heap_bytes_.append(str);
+    }
+    used_ += str.size();
+    return static_cast<uint32_t>(offset);
+}
+
+// 获取存储中的一段
+::std::string_view my::HttpHeaders::view(uint32_t offset, uint32_t size) const
+{
+    return {(heap_bytes_.empty() ? inline_bytes_ : heap_bytes_.data()) + offset, size};
+}
+
+// 获取字段数组
+my::HttpHeaders::Entry *my::HttpHeaders::entries()
+{
+    return heap_entries_.empty() ? inline_entries_ : heap_entries_.data();
+}
+
+// 获取字段数组
+const my::HttpHeaders::Entry *my::HttpHeaders::entries() const
+{
+    return heap_entries_.empty() ? inline_entries_ : heap_entries_.data();
+}
+
+// 复制另一组头部字段，只复制已使用的部分
+void my::HttpHeaders::copy_from(const HttpHeaders &other)
+{
+    count_ = other.count_;
+    used_ = other.used_;
+    heap_entries_ = other.heap_entries_;
+    heap_bytes_ = other.heap_bytes_;
+    if (heap_entries_.empty()) {
+        ::std::copy_n(other.inline_entries_, count_, inline_entries_);
+    }
+    if (heap_bytes_.empty()) {
+        ::std::memcpy(inline_bytes_, other.inline_bytes_, used_);
+    }
+}
@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <chrono>
+#include <future>
 #include <thread>
+#include <unordered_map>
 
+#include "../include/CachePolicy.h"
 #include "../include/HttpProxyServer.h"
 #include "../include/HttpRequest.h"
 #include "../include/HttpResponseHead.h"
@@ -26,10 +31,78 @@ BOOL WINAPI keybord_interrupt_handler(DWORD ctrl_type)
     return FALSE;
 }
 
+// 请求无法解析时回复给客户端的错误响应
+static ::std::string parse_error_response(::my::HttpRequestParser::Error error)
+{
+    switch (error) {
+    case ::my::HttpRequestParser::Error::HEAD_TOO_LARGE:
+        return "HTTP/1.1 431 Request Header Fields Too Large\r\nConnection: close\r\n\r\n";
+    case ::my::HttpRequestParser::Error::NOT_IMPLEMENTED:
+        return "HTTP/1.1 501 Not Implemented\r\nConnection: close\r\n\r\n";
+    case ::my::HttpRequestParser::Error::BODY_TOO_LARGE:
+        return "HTTP/1.1 413 Content Too Large\r\nConnection: close\r\n\r\n";
+    default:
+        return "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n";
+    }
+}
+
+// 在缓存的响应中设置 Age 字段（RFC 9111 第 5.1 节），替换原有的 Age 字段
+// data: 缓存的响应开头的一段，head_size: 返回原响应头部（含结尾的空行）的长度
+// 返回值: 新的响应头部，data 中没有完整的响应头部时返回空字符串
+static ::std::string with_age_field(::std::string_view data, int64_t age, size_t &head_size)
+{
+    size_t end = data.find("\r\n\r\n");
+    if (end == ::std::string_view::npos) {
+        return "";
+    }
+    head_size = end + 4;
+    ::std::string head;
+    head.reserve(head_size + 24);
+    for (size_t pos = 0; pos < end + 2;) {
+        size_t next = data.find("\r\n", pos) + 2;
+        ::std::string_view line = data.substr(pos, next - pos);
+        bool is_age = line.size() > 4 && (line[0] | 0x20) == 'a' && (line[1] | 0x20) == 'g' && (line[2] | 0x20) == 'e' && line[3] == ':';
+        if (!is_age) {
+            head.append(line);
+        }
+        pos = next;
+    }
+    head.append(::std::format("Age: {}\r\n\r\n", age));
+    return head;
+}
+
+// 一个线程上的事件循环：I/O 服务、定时器及其处理的客户端连接
+struct my::HttpProxyServer::Reactor {
+    size_t index = 0;                                    // 事件循环编号
+    IoService io;                                        // I/O 服务，连接上的所有操作都在此提交和完成
+    TimerWheel timers;                                   // 连接的超时定时器
+    ::std::unordered_map<int, Connection *> connections; // 活动的客户端连接（由处理连接的协程持有）
+};
+
+// 一个客户端连接的状态，由处理连接的协程持有，定时器到期时据此取消连接上未完成的操作
+// 同时最多有两个定时器：当前的一次等待（连接、接收、空闲）和当前的阶段（接收请求、处理请求）
+struct my::HttpProxyServer::Connection {
+    Reactor &reactor;                       // 所在的事件循环
+    int c_no;                               // 客户端编号
+    Host client;                            // 客户端主机信息
+    Host server;                            // 当前请求的服务器主机信息，未连接时 socket 为 INVALID_SOCKET
+    ::std::string c_in;                     // 已接收但尚未处理的客户端数据
+    int req_cnt = 0;                        // 在此连接上处理的请求数
+    TimerWheel::TimerId wait_timer = 0;     // 当前等待的定时器
+    TimerWheel::TimerId deadline_timer = 0; // 当前阶段的定时器
+    bool timed_out = false;                 // 是否已超时（或因停止而被取消）
+    const char *timeout_name = "";          // 超时的名称（或停止的原因）
+
+    Connection(Reactor &reactor, int c_no, Host client) : reactor(reactor), c_no(c_no), client(client) {}
+};
+
 // 构造函数
 ::my::HttpProxyServer::HttpProxyServer(const char *p_ip, unsigned short p_port, bool use_cache)
     : proxy_(INVALID_SOCKET, p_ip, p_port),
-      use_cache_(use_cache), cache_manager_(".\\cache"), task_count_(0)
+      use_cache_(use_cache), cache_manager_(".\\cache"), task_count_(0),
+      client_conn_cnt_(0), client_req_cnt_(0), client_reused_req_cnt_(0), client_max_req_(0),
+      tunnel_cnt_(0), tunnel_up_bytes_(0), tunnel_down_bytes_(0), fresh_hit_cnt_(0), revalidated_cnt_(0),
+      stale_revalidate_cnt_(0), stale_error_cnt_(0), refresh_cnt_(0), refresh_failed_cnt_(0), refreshing_cnt_(0), io_backend_(IoService::Backend::COMPLETION_PORT)
 {
     log("Initializing proxy<{}> ...", p_id_);
     try {
@@ -87,6 +160,8 @@ BOOL WINAPI keybord_interrupt_handler(DWORD ctrl_type)
         closesocket(proxy_.socket);
         log("Proxy<{}>: Socket closed", p_no_);
     }
+    // 关闭连接池中的空闲连接
+    upstream_pool_.clear();
     log("Proxy<{}>: destroyed\n", p_no_);
 
     // 如果这是最后一个实例且 Winsock 已初始化，则清理 Winsock
@@ -99,17 +174,26 @@ BOOL WINAPI keybord_interrupt_handler(DWORD ctrl_type)
 }
 
 // 运行代理服务器（单线程模式）
+// 所有客户端连接在调用线程的事件循环中并发处理
 // 返回值: 如果成功运行则返回 true，否则返回 false
 bool ::my::HttpProxyServer::run()
 {
-    return inner_run(false);
+    return inner_run(1);
 }
 
 // 运行代理服务器（多线程模式）
+// 每个线程运行一个事件循环，线程数为硬件并发线程数
 // 返回值: 如果成功运行则返回 true，否则返回 false
 bool my::HttpProxyServer::run_multithread()
 {
-    return inner_run(true);
+    return inner_run(::std::max(1u, ::std::thread::hardware_concurrency()));
+}
+
+// 运行代理服务器（事件循环模式），与单线程模式相同
+// 返回值: 如果成功运行则返回 true，否则返回 false
+bool my::HttpProxyServer::run_event_loop()
+{
+    return inner_run(1);
 }
 
 // 检查代理服务器是否正在运行
@@ -126,125 +210,356 @@ bool my::HttpProxyServer::is_running() const
     return router_guard_;
 }
 
-bool my::HttpProxyServer::inner_run(bool is_multithread)
+// 获取到服务器的连接池
+// 返回值: 连接池的引用，可用于调整空闲连接上限和超时时间
+::my::ConnectionPool &my::HttpProxyServer::upstream_pool()
+{
+    return upstream_pool_;
+}
+
+// 获取主机名解析器
+::my::DnsResolver &my::HttpProxyServer::resolver()
+{
+    return resolver_;
+}
+
+// 获取缓存管理器
+my::HttpCacheManager &my::HttpProxyServer::cache_manager()
+{
+    return cache_manager_;
+}
+
+// 获取客户端连接的复用统计
+// 返回值: 统计数据的快照
+::my::ClientStats my::HttpProxyServer::client_stats() const
+{
+    ClientStats stats;
+    stats.connections = client_conn_cnt_;
+    stats.requests = client_req_cnt_;
+    stats.reused_requests = client_reused_req_cnt_;
+    stats.max_requests_per_connection = client_max_req_;
+    return stats;
+}
+
+// 设置事件循环使用的 I/O 后端
+void my::HttpProxyServer::set_io_backend(IoService::Backend backend)
+{
+    io_backend_ = backend;
+}
+
+// 设置各阶段的超时时间
+void my::HttpProxyServer::set_timeouts(const ProxyTimeouts &timeouts)
+{
+    timeouts_ = timeouts;
+}
+
+// 获取各阶段的超时时间
+const my::ProxyTimeouts &my::HttpProxyServer::timeouts() const
+{
+    return timeouts_;
+}
+
+// 设置过期的缓存仍可使用的默认时长
+void my::HttpProxyServer::set_stale_windows(const StaleWindows &windows)
+{
+    stale_windows_ = windows;
+}
+
+// 获取过期的缓存仍可使用的默认时长
+const my::StaleWindows &my::HttpProxyServer::stale_windows() const
+{
+    return stale_windows_;
+}
+
+// 内部运行方法
+// 第一个事件循环在调用线程中运行并接受连接，其余的事件循环在线程池中运行
+// 使用缓存时另有一个后台验证的事件循环在线程池中运行，不处理客户端连接
+bool my::HttpProxyServer::inner_run(size_t reactor_count)
 {
     if (is_running_) {
         err("Proxy<{}>: is already running", p_no_);
         return false;
     }
+    reactors_.clear();
+    for (size_t i = 0; i < reactor_count; ++i) {
+        auto reactor = ::std::make_unique<Reactor>();
+        reactor->index = i;
+        if (!reactor->io.open(io_backend_)) {
+            err("In Proxy<{}>:", p_no_);
+            con<8>("Failed to open I/O service. Error code: {}", WSAGetLastError());
+            reactors_.clear();
+            return false;
+        }
+        reactors_.push_back(::std::move(reactor));
+    }
+    refresh_reactor_.reset();
+    if (use_cache_) {
+        auto reactor = ::std::make_unique<Reactor>();
+        reactor->index = reactor_count;
+        if (reactor->io.open(io_backend_)) {
+            refresh_reactor_ = ::std::move(reactor);
+        } else {
+            err("In Proxy<{}>:", p_no_);
+            con<8>("Failed to open I/O service for background refresh, stale cache will be revalidated synchronously. Error code: {}", WSAGetLastError());
+        }
+    }
     is_running_ = true;
 
     // 添加ctrl+c中断处理函数
     SetConsoleCtrlHandler(keybord_interrupt_handler, TRUE);
 
-    log("Proxy<{}>: is running...\n", p_no_);
-
-    // 超时处理
-    fd_set readfds;
-    FD_ZERO(&readfds);
-    FD_SET(proxy_.socket, &readfds);
-    TIMEVAL timeout = {0, 0};
+    log("Proxy<{}>: is running ({} event loops, {})...\n", p_no_, reactor_count, reactors_[0]->io.backend_name());
 
-    Host client;
     int client_cnt = 0;
+    reactors_[0]->io.accept(proxy_.socket, [this, &client_cnt](SOCKET s, int error_code) { accept_client(s, error_code, client_cnt); });
 
-    while (!keybord_interrupt) {
+    ::std::vector<::std::future<void>> workers;
+    for (size_t i = 1; i < reactor_count; ++i) {
+        workers.push_back(thread_pool_.add_task(&HttpProxyServer::run_reactor, this, ::std::ref(*reactors_[i])));
+    }
+    if (refresh_reactor_) {
+        workers.push_back(thread_pool_.add_task(&HttpProxyServer::run_refresh_reactor, this));
+    }
+    run_reactor(*reactors_[0]);
+    for (auto &worker : workers) {
+        worker.wait();
+    }
 
-        // 如果没有客户端连接，则等待客户端连接
-        while (!keybord_interrupt) {
-            fd_set readfds_copy = readfds;
-            int sum = select(0, &readfds_copy, nullptr, nullptr, &timeout);
-            if (sum == SOCKET_ERROR) {
-                err("In Proxy<{}>:", p_no_);
-                con<8>("Failed to call select. Error code: {}", WSAGetLastError());
-                con<8>("Continue listening...");
-            } else if (sum == 0) {
-                ::std::this_thread::sleep_for(::std::chrono::milliseconds(100));
-            } else {
-                break;
-            }
-        }
-        if (keybord_interrupt) {
-            break;
-        }
+    // 移除ctrl+c中断处理函数
+    SetConsoleCtrlHandler(keybord_interrupt_handler, FALSE);
+    set_nonblocking(proxy_.socket, false);
+
+    refresh_reactor_.reset();
+
+    log_client_stats();
+    log("Proxy<{}>: stopped\n", p_no_);
+    is_running_ = false;
+    return true;
+}
 
-        // 接受客户端连接
-        client.socket = accept(proxy_.socket, nullptr, nullptr);
-        if (client.socket == INVALID_SOCKET) {
+// 在当前线程中运行事件循环
+// 等待 I/O 直到下一个定时器到期（最长 100ms，以便检查键盘中断），连接的接受与转发均由完成通知驱动协程前进
+void my::HttpProxyServer::run_reactor(Reactor &reactor)
+{
+    auto last_prune = ::std::chrono::steady_clock::now();
+    while (!keybord_interrupt) {
+        if (reactor.io.run_once(reactor.timers.next_timeout_ms(100)) == SOCKET_ERROR) {
             err("In Proxy<{}>:", p_no_);
-            con<8>("Failed to accept client. Error code: {}", WSAGetLastError());
+            con<8>("Failed to wait for I/O completions. Error code: {}", WSAGetLastError());
             con<8>("Continue listening...");
-            continue;
         }
-        client.update();
+        reactor.timers.advance();
+        if (reactor.index == 0 && ::std::chrono::steady_clock::now() - last_prune >= ::std::chrono::seconds(1)) {
+            last_prune = ::std::chrono::steady_clock::now();
+            upstream_pool_.prune();
+        }
+    }
 
-        // 检查客户端 IP 是否被阻止
-        if (router_guard_.check_client(client.ip) == HttpRouterGuard::Response::BLOCKED) {
-            log("Proxy<{}>: client<{}> ip: \"{}\" is blocked, rejected", p_no_, client_cnt, client.ip);
-            send(client.socket, "HTTP/1.1 403 Forbidden\r\n\r\n", 26, 0);
-            closesocket(client.socket);
-            continue;
+    if (reactor.index == 0) {
+        log("Proxy<{}>: Keyboard interrupt detected, stopping...", p_no_);
+        reactor.io.cancel(proxy_.socket);
+    }
+    // 取消所有连接上的操作，等待协程结束（正在解析主机名的连接在解析完成后结束）
+    if (!reactor.connections.empty()) {
+        log("Closing {} active connections...", reactor.connections.size());
+        for (auto &[c_no, conn] : reactor.connections) {
+            expire_connection(*conn, "stopped");
+        }
+        for (int idle = 0; !reactor.connections.empty() && idle < 50;) {
+            int count = reactor.io.run_once(100);
+            idle = count > 0 ? 0 : idle + 1;
         }
+    }
+    reactor.io.close();
+}
 
-        ++client_cnt;
-        task_count_++;
+// 在当前线程中以较低的优先级运行后台验证的事件循环
+// 后台验证不影响客户端的响应时间，CPU 繁忙时让出给处理客户端连接的事件循环；结束后恢复线程池线程的优先级
+void my::HttpProxyServer::run_refresh_reactor()
+{
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+    run_reactor(*refresh_reactor_);
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+}
 
-        // 处理客户端请求
-        if (is_multithread) {
-            // 多线程模式
-            thread_pool_.add_task(handle_client, this, client_cnt, client);
-        } else {
-            // 单线程模式
-            con<0>("====================[task {}]====================", client_cnt);
-            handle_client(client_cnt, client);
-            con<0>("====================[task {}]====================\n", client_cnt);
-        }
+// 接受一个客户端连接
+// 连接依次分配给各个事件循环，之后该连接上的所有操作都在这个事件循环中完成
+void my::HttpProxyServer::accept_client(SOCKET s, int error_code, int &client_cnt)
+{
+    if (error_code != 0) {
+        err("In Proxy<{}>:", p_no_);
+        con<8>("Failed to accept client. Error code: {}", error_code);
+        con<8>("Continue listening...");
+        return;
+    }
+    // 停止时已接受但尚未处理的连接直接关闭
+    if (keybord_interrupt) {
+        closesocket(s);
+        return;
     }
 
-    // 移除ctrl+c中断处理函数
-    SetConsoleCtrlHandler(keybord_interrupt_handler, FALSE);
+    Host client;
+    client.socket = s;
+    client.update();
+
+    // 检查客户端 IP 是否被阻止
+    if (router_guard_.check_client(client.ip) == HttpRouterGuard::Response::BLOCKED) {
+        log("Proxy<{}>: client<{}> ip: \"{}\" is blocked, rejected", p_no_, client_cnt, client.ip);
+        send(client.socket, "HTTP/1.1 403 Forbidden\r\n\r\n", 26, 0);
+        closesocket(client.socket);
+        return;
+    }
+
+    ++client_cnt;
+    task_count_++;
 
-    log("Proxy<{}>: Keyboard interrupt detected, stopping...", p_no_);
-    if (task_count_ > 0) {
-        log("Waiting for {} tasks to finish...", task_count_.load());
-        thread_pool_.wait_all();
+    int c_no = client_cnt;
+    Reactor &reactor = *reactors_[c_no % reactors_.size()];
+    reactor.io.post([this, &reactor, c_no, client]() {
+        reactor.io.associate(client.socket);
+        spawn(handle_client(reactor, c_no, client));
+    });
+}
+
+// 在连接上启动一个定时器
+// 定时器到期时结束连接；回调引用 conn，连接的协程结束前必须取消其上所有的定时器
+void my::HttpProxyServer::arm_timer(Connection &conn, TimerWheel::TimerId &timer, const char *name, int timeout_ms)
+{
+    conn.reactor.timers.cancel(timer);
+    timer = 0;
+    if (timeout_ms > 0) {
+        timer = conn.reactor.timers.schedule(::std::chrono::milliseconds(timeout_ms), [this, &conn, &timer, name]() {
+            timer = 0;
+            expire_connection(conn, name);
+        });
     }
+}
 
-    log("Proxy<{}>: stopped\n", p_no_);
-    is_running_ = false;
-    return true;
+// 取消连接上的一个定时器
+void my::HttpProxyServer::disarm_timer(Connection &conn, TimerWheel::TimerId &timer)
+{
+    conn.reactor.timers.cancel(timer);
+    timer = 0;
 }
 
-void ::my::HttpProxyServer::handle_client(int c_no, Host client)
+// 结束连接，取消连接上未完成的操作，协程随后以错误码恢复并根据 timed_out 结束连接
+void my::HttpProxyServer::expire_connection(Connection &conn, const char *reason)
 {
-    // HOSTENT *s_hostent = nullptr;
-    Host server;
-    ::std::string s_hostname;
-    int recv_cnt, recv_size, send_size;
+    if (conn.timed_out) {
+        return;
+    }
+    conn.timed_out = true;
+    conn.timeout_name = reason;
+    if (conn.client.socket != INVALID_SOCKET) {
+        conn.reactor.io.cancel(conn.client.socket);
+    }
+    if (conn.server.socket != INVALID_SOCKET) {
+        conn.reactor.io.cancel(conn.server.socket);
+    }
+}
+
+// 处理客户端连接
+// 在同一连接上依次处理客户端发来的请求（包括流水线请求），并按顺序响应
+my::Coroutine<void> my::HttpProxyServer::handle_client(Reactor &reactor, int c_no, Host client)
+{
+    Connection conn(reactor, c_no, client);
+    HttpRequestParser parser;
+    reactor.connections[c_no] = &conn;
+    bool keep_alive = true;
 
-    // 请求处理逻辑
     try {
         log("Proxy<{}>: connected with client<{}>: {}:{}", p_no_, c_no, client.ip, client.port);
         con<6>("{}:{} ------------- {}:{} - - - - ?:?", client.ip, client.port, proxy_.ip, proxy_.port);
 
-        char buffer[MAX_BUFFER_SIZE];
+        while (keep_alive && conn.req_cnt < MAX_REQUESTS_PER_CONNECTION) {
+            // 接收客户端请求，直到缓冲区中有一个完整的请求，每次收到数据后从上次停下的位置继续解析
+            parser.reset();
+            HttpRequestParser::Result parsed = parser.parse(conn.c_in);
+            bool reading = false;
+            while (parsed == HttpRequestParser::Result::NEED_MORE) {
+                // 请求之间的空闲等待使用空闲超时；收到请求的数据后，整个请求需在 header_read 内接收完整
+                bool idle = conn.c_in.empty() && conn.req_cnt > 0;
+                if (!idle && !reading) {
+                    arm_timer(conn, conn.deadline_timer, "header read", timeouts_.header_read);
+                    reading = true;
+                }
+                IoService::Result received = co_await receive(conn, client.socket, "idle", idle ? timeouts_.idle : 0);
+                if (conn.timed_out) {
+                    if (idle) {
+                        log("Proxy<{}>: client<{}> idle for {}ms, closing", p_no_, c_no, timeouts_.idle);
+                        keep_alive = false;
+                        break;
+                    }
+                    throw ::std::runtime_error(::std::format("Timeout ({}) when receiving data from client<{}>", conn.timeout_name, c_no));
+                }
+                if (received.error_code != 0) {
+                    throw ::std::runtime_error(::std::format("Failed to receive data from client<{}>. Error code: {}", c_no, received.error_code));
+                } else if (received.data.empty()) {
+                    if (idle) {
+                        keep_alive = false; // 客户端在请求之间关闭了连接
+                        break;
+                    }
+                    throw ::std::runtime_error(::std::format("Client<{}> disconnected", c_no));
+                }
+                conn.c_in.append(received.data);
+                reactor.io.give_buffer(::std::move(received.data));
+                parsed = parser.parse(conn.c_in);
+            }
+            disarm_timer(conn, conn.deadline_timer);
+            if (!keep_alive) {
+                break;
+            }
+            if (parsed == HttpRequestParser::Result::FAILED) {
+                // 请求无法解析时回复错误状态并关闭连接
+                co_await reactor.io.async_send(client.socket, parse_error_response(parser.error()));
+                throw ::std::runtime_error(::std::format("Invalid request from client<{}>: {}", c_no, parser.error_message()));
+            }
+
+            // 请求取走缓冲区开头的原始数据，缓冲区中只剩下后续请求的数据
+            size_t request_length = parser.request_length();
+            HttpRequest c_req(parser, conn.c_in);
+            ++conn.req_cnt;
 
-        // 接收客户端请求
-        recv_size = recv_with_timeout(client.socket, buffer, MAX_BUFFER_SIZE, {1, 0});
-        if (recv_size == SOCKET_ERROR) {
-            throw ::std::runtime_error(::std::format("Failed to receive data from client<{}>. Error code: {}", c_no, WSAGetLastError()));
-        } else if (recv_size == 0) {
-            throw ::std::runtime_error(::std::format("Client<{}> disconnected", c_no));
+            log("Proxy<{}>: received {} bytes data from client<{}> successfully (request {} on this connection):", p_no_, request_length, c_no, conn.req_cnt);
+            keep_alive = co_await handle_request(conn, c_req);
         }
+    } catch (const ::std::exception &e) {
+        err("In Proxy<{}>:", p_no_);
+        con<8>("{}", e.what());
+    }
+
+    disarm_timer(conn, conn.wait_timer);
+    disarm_timer(conn, conn.deadline_timer);
+    reactor.connections.erase(c_no);
+    reactor.io.close(client.socket);
+    log("Proxy<{}>: disconnected with client<{}> after {} requests", p_no_, c_no, conn.req_cnt);
+    record_client_connection(conn.req_cnt);
+
+    --task_count_;
+}
 
+// 处理客户端连接上的一个请求
+// 返回值: 响应结束后是否可以继续在该连接上处理请求
+my::Coroutine<bool> my::HttpProxyServer::handle_request(Connection &conn, const HttpRequest &c_req)
+{
+    IoService &io = conn.reactor.io;
+    const Host &client = conn.client;
+    Host &server = conn.server;
+    ::std::string s_hostname;
+    ::std::string pool_key;
+    HttpResponseFramer framer;
+    HttpCacheManager::Fetch fetch;
+    bool keep_alive = c_req.is_keep_alive();
+    framer.set_request_method(c_req.method);
+
+    server = Host();
+    arm_timer(conn, conn.deadline_timer, "request", timeouts_.request);
+    try {
         // 通过客户端请求解析出服务器主机名和端口号
-        HttpRequest c_req(buffer, recv_size);
+        // 只有需要连接服务器时才解析主机名，过滤、缓存命中和共享进行中的获取都不等待 DNS
         ::std::tie(s_hostname, server.port) = c_req.get_host_port();
-        server.ip = get_ip_str(s_hostname.c_str());
 
-        log("Proxy<{}>: received {} bytes data from client<{}> successfully:", p_no_, recv_size, c_no);
-        // out_http_data(10, buffer, recv_size);
-        con<6>("{}:{} ====[{}]===> {}:{} - - - - - - - {}:{} ({})", client.ip, client.port, c_req.method, proxy_.ip, proxy_.port, server.ip, server.port, s_hostname);
+        con<6>("{}:{} ====[{}]===> {}:{} - - - - - - - {}:{}", client.ip, client.port, c_req.method, proxy_.ip, proxy_.port, s_hostname, server.port);
         con<6>("URL: {}", c_req.url);
 
         // 检查服务器 IP 是否被阻止
@@ -253,207 +568,938 @@ void ::my::HttpProxyServer::handle_client(int c_no, Host client)
         // 根据检查结果进行处理
         if (response == HttpRouterGuard::Response::BLOCKED) {
             // 如果服务器 IP 被阻止，则返回 403 Forbidden
-            send(client.socket, "HTTP/1.1 403 Forbidden\r\n\r\n", 26, 0);
+            co_await io.async_send(client.socket, "HTTP/1.1 403 Forbidden\r\n\r\n");
+            keep_alive = false;
 
             log("Proxy<{}>: requesting url: \"{}\" is blocked, rejected", p_no_, c_req.url);
-            con<6>("{}:{} <====[ 403 ]==== {}:{} ------------- {}:{} ({})", client.ip, client.port, proxy_.ip, proxy_.port, server.ip, server.port, s_hostname);
+            con<6>("{}:{} <====[ 403 ]==== {}:{} ------------- {}:{}", client.ip, client.port, proxy_.ip, proxy_.port, s_hostname, server.port);
 
         } else if (response == HttpRouterGuard::Response::REDIRECTED) {
             // 如果服务器 IP 被重定向，则返回 302 Found
             // 并且返回重定向的 URL
             ::std::string redirect_url = router_guard_.get_redirect_url(c_req.url);
-            ::std::string response = "HTTP/1.1 302 Found\r\nLocation: " + redirect_url + "\r\n\r\n";
-
-            send(client.socket, response.c_str(), response.length(), 0);
+            co_await io.async_send(client.socket, "HTTP/1.1 302 Found\r\nLocation: " + redirect_url + "\r\n\r\n");
+            keep_alive = false;
 
             log("Proxy<{}>: requesting url: \"{}\" is redirected to \"{}\"", p_no_, c_req.url, redirect_url);
-            con<6>("{}:{} <====[ 302 ]==== {}:{} ------------- {}:{} ({})", client.ip, client.port, proxy_.ip, proxy_.port, server.ip, server.port, s_hostname);
+            con<6>("{}:{} <====[ 302 ]==== {}:{} ------------- {}:{}", client.ip, client.port, proxy_.ip, proxy_.port, s_hostname, server.port);
+
+        } else if (co_await answer_from_fresh_cache(conn, c_req, keep_alive)) {
+            // 缓存新鲜，已不经服务器验证直接从缓存响应
+
+        } else if (co_await answer_from_fetch(conn, c_req, fetch, framer, keep_alive)) {
+            // 同一 URL 正在从服务器获取，已作为读者共享其响应
 
         } else if (c_req.method == "GET" || c_req.method == "POST") {
-            // 如果是 GET 或 POST 请求，则连接到服务器
+            // 如果是 GET 或 POST 请求，则优先复用连接池中的空闲连接，否则连接到服务器
+            // 完成端口后端中套接字只能关联到一个完成端口，因此连接只在归还它的事件循环中复用
+            pool_key = ::std::format("{}#{}", ConnectionPool::make_key(s_hostname, server.port), conn.reactor.index);
+
+            // 检查cache并接收第一个数据包
+            // 解析主机名、连接或等待响应失败（包括超时）时先记下错误，有可用的过期缓存时从缓存响应（stale-if-error）
+            IoService::Result first_packet;
+            CheckCacheResult chk_res = CheckCacheResult::NONE;
+            int64_t request_time = 0;
+            ::std::string server_error;
             try {
-                server.socket = connect_to_server(server.ip.c_str(), server.port);
+                DnsResolver::Result resolved = co_await resolve(conn.reactor, s_hostname);
+                server.ip = resolved.address(s_hostname);
+                chk_res = co_await request_from_server(conn, c_req, s_hostname, pool_key, first_packet, request_time);
             } catch (const ::std::runtime_error &e) {
-                throw ::std::runtime_error(::std::format("During connecting to server {}:{}", server.ip, server.port) + "\n        " + e.what());
+                bool waiting_timeout = ::std::string_view(conn.timeout_name) == "connect" || ::std::string_view(conn.timeout_name) == "first byte";
+                if (conn.timed_out && !waiting_timeout) {
+                    throw;
+                }
+                server_error = e.what();
+                conn.timed_out = false;
+            }
+            bool served_stale = false;
+            if (!server_error.empty() || chk_res == CheckCacheResult::SERVER_ERROR) {
+                served_stale = co_await answer_from_stale_cache(conn, c_req, keep_alive);
+                if (!served_stale && !server_error.empty()) {
+                    throw ::std::runtime_error(server_error);
+                }
+                // 没有可用的缓存时把服务器的错误响应转发给客户端，不写入缓存
+                chk_res = CheckCacheResult::NOT_SUPPORTED;
+            }
+            // 无法加入进行中的获取的请求不写入缓存，以免与发起者同时写入缓存文件
+            if (fetch.role == HttpCacheManager::FetchRole::BYPASS && (chk_res == CheckCacheResult::EXPIRED || chk_res == CheckCacheResult::NO_CACHE)) {
+                chk_res = CheckCacheResult::NOT_SUPPORTED;
             }
 
-            log("Proxy<{}>: enstabished connection with server {}", p_no_, s_hostname);
-            con<6>("{}:{} ------------- {}:{} ------------- {}:{} ({})", client.ip, client.port, proxy_.ip, proxy_.port, server.ip, server.port, s_hostname);
-
-            // ::std::cout << "DEBUG: about to check cache" << ::std::endl;
-            // 检查cache并接收第一个数据包
-            CheckCacheResult chk_res = check_cache_and_recv(c_req, server, buffer, MAX_BUFFER_SIZE, recv_size);
+            if (served_stale) {
+                // 服务器出错，已从过期的缓存响应，服务器连接在最后关闭
+                con<6>("{}:{} <==[stale]=== {}:{} ------------- {}:{}", client.ip, client.port, proxy_.ip, proxy_.port, s_hostname, server.port);
 
-            if (chk_res == CheckCacheResult::FOUND) {
+            } else if (chk_res == CheckCacheResult::FOUND) {
                 // 如果缓存命中，则从缓存中响应请求
                 log("Proxy<{}>: cache hit for: {} ({})", p_no_, c_req.url, HttpCacheManager::get_key(c_req.url));
-
-                int total_size = answer_from_cache(c_req.url, client);
-                log("Proxy<{}>: transmitted {} bytes data from cache to client<{}> successfully", p_no_, total_size, c_no);
+                framer.feed(first_packet.data.data(), first_packet.data.size());
+                io.give_buffer(::std::move(first_packet.data));
+                if (framer.state() != HttpResponseFramer::State::HEAD) {
+                    refresh_freshness(c_req.url, framer.head(), request_time);
+                }
+                cache_manager_.end_fetch(c_req.url, fetch, SharedFetch::State::NOT_MODIFIED);
+
+                HttpResponseFramer cache_framer;
+                int total_size = co_await answer_from_cache(conn, c_req.url, cache_framer);
+                // 缓存中只保存完整的响应，只需确认它不以关闭连接结束
+                keep_alive = keep_alive && cache_framer.is_self_delimited();
+                log("Proxy<{}>: transmitted {} bytes data from cache to client<{}> successfully", p_no_, total_size, conn.c_no);
                 con<6>("{}:{} <==[cached]== {}:{} ------------- {}:{} ({})", client.ip, client.port, proxy_.ip, proxy_.port, server.ip, server.port, s_hostname);
 
             } else {
                 // 否则继续从服务器接收数据
-                // ::std::cout << "DEBUG: about to answer from server" << ::std::endl;
-                ::std::string status(strchr(buffer, ' ') + 1, 3);
+                ::std::string_view first(first_packet.data);
+                size_t start = first.find(' ');
+                ::std::string status = start == ::std::string_view::npos ? "" : ::std::string(first.substr(start + 1, 3));
 
-                int total_size = answer_from_server(chk_res, c_req.url, client, server, buffer, MAX_BUFFER_SIZE, recv_size);
+                SharedFetch *shared = fetch.role == HttpCacheManager::FetchRole::LEADER ? fetch.shared.get() : nullptr;
+                int total_size = co_await answer_from_server(conn, chk_res, c_req.url, request_time, ::std::move(first_packet.data), framer, shared);
+                cache_manager_.end_fetch(c_req.url, fetch, SharedFetch::State::COMPLETE);
+                // 以关闭连接结束的响应只能通过关闭客户端连接来结束
+                keep_alive = keep_alive && framer.is_complete();
 
-                log("Proxy<{}>: transmitted {} bytes data from server {} to client<{}> successfully", p_no_, total_size, s_hostname, c_no);
+                log("Proxy<{}>: transmitted {} bytes data from server {} to client<{}> successfully", p_no_, total_size, s_hostname, conn.c_no);
                 con<6>("{}:{} <================[ {} ]================= {}:{} ({})", client.ip, client.port, status, server.ip, server.port, s_hostname);
             }
+        } else if (c_req.method == "CONNECT") {
+            // 如果是 CONNECT 请求，则连接到服务器后在客户端和服务器之间建立隧道
+            keep_alive = false;
+            DnsResolver::Result resolved = co_await resolve(conn.reactor, s_hostname);
+            server.ip = resolved.address(s_hostname);
+            co_await open_server_connection(conn);
+            log("Proxy<{}>: enstabished tunnel with server {}", p_no_, s_hostname);
+            con<6>("{}:{} <====[ 200 ]==== {}:{} ============= {}:{} ({})", client.ip, client.port, proxy_.ip, proxy_.port, server.ip, server.port, s_hostname);
+            // 隧道的持续时间不受请求超时的限制，只受空闲超时的限制
+            disarm_timer(conn, conn.deadline_timer);
+
+            IoService::Result sent = co_await io.async_send(client.socket, "HTTP/1.1 200 Connection Established\r\n\r\n");
+            if (sent.error_code != 0) {
+                throw ::std::runtime_error(::std::format("Failed to send data to client<{}>. Error code: {}", conn.c_no, sent.error_code));
+            }
+            co_await tunnel(conn, s_hostname);
+
         } else {
             // 如果是其他请求方法，则返回 405 Method Not Allowed
-            send(client.socket, "HTTP/1.1 405 Method Not Allowed\r\n\r\n", 34, 0);
+            co_await io.async_send(client.socket, "HTTP/1.1 405 Method Not Allowed\r\n\r\n");
+            keep_alive = false;
 
-            log("Proxy<{}>: received an unsupported method {} from client<{}>, rejected", p_no_, c_req.method, c_no);
-            con<6>("{}:{} <====[ 405 ]==== {}:{} ------------- {}:{} ({})", client.ip, client.port, proxy_.ip, proxy_.port, server.ip, server.port, s_hostname);
+            log("Proxy<{}>: received an unsupported method {} from client<{}>, rejected", p_no_, c_req.method, conn.c_no);
+            con<6>("{}:{} <====[ 405 ]==== {}:{} ------------- {}:{}", client.ip, client.port, proxy_.ip, proxy_.port, s_hostname, server.port);
         }
-    } catch (const ::std::exception &e) {
-        err("In Proxy<{}>:", p_no_);
-        con<8>("{}", e.what());
+    } catch (const ::std::exception &) {
+        disarm_timer(conn, conn.deadline_timer);
+        cache_manager_.end_fetch(c_req.url, fetch, SharedFetch::State::ABANDONED);
+        if (server.socket != INVALID_SOCKET) {
+            io.close(server.socket);
+            server.socket = INVALID_SOCKET;
+            log("Proxy<{}>: disconnected with server {}", p_no_, s_hostname);
+        }
+        throw;
     }
+    disarm_timer(conn, conn.deadline_timer);
+    cache_manager_.end_fetch(c_req.url, fetch, SharedFetch::State::ABANDONED);
 
     if (server.socket != INVALID_SOCKET) {
-        closesocket(server.socket);
-        log("Proxy<{}>: disconnected with server {}", p_no_, s_hostname);
+        // 响应完整且服务器允许保持连接时，把连接归还到连接池
+        if (framer.is_keep_alive()) {
+            io.release(server.socket);
+            upstream_pool_.release(pool_key, server.socket);
+            log("Proxy<{}>: returned connection with server {} to pool", p_no_, s_hostname);
+        } else {
+            io.close(server.socket);
+            log("Proxy<{}>: disconnected with server {}", p_no_, s_hostname);
+        }
+        server.socket = INVALID_SOCKET;
     }
-    closesocket(client.socket);
-    log("Proxy<{}>: disconnected with client<{}>", p_no_, c_no);
+    co_return keep_alive;
+}
 
-    --task_count_;
+// 输出客户端连接的复用统计
+void my::HttpProxyServer::log_client_stats() const
+{
+    ClientStats stats = client_stats();
+    log("Proxy<{}>: served {} requests over {} client connections", p_no_, stats.requests, stats.connections);
+    con<6>("requests per connection: {:.2f}, reused: {}, max: {}", stats.requests_per_connection(), stats.reused_requests, stats.max_requests_per_connection);
+    con<6>("tunnels: {}, {} bytes up, {} bytes down", tunnel_cnt_.load(), tunnel_up_bytes_.load(), tunnel_down_bytes_.load());
+    // 每次等待对应一次 GetQueuedCompletionStatusEx 或 WSAPoll 调用，用于比较不同后端每个请求的系统调用次数
+    size_t wait_cnt = 0, completion_cnt = 0;
+    for (const auto &reactor : reactors_) {
+        wait_cnt += reactor->io.wait_count();
+        completion_cnt += reactor->io.completion_count();
+    }
+    if (wait_cnt > 0) {
+        con<6>("I/O ({}): {} completions in {} waits, {:.2f} waits per request", reactors_[0]->io.backend_name(), completion_cnt, wait_cnt,
+               stats.requests == 0 ? 0.0 : static_cast<double>(wait_cnt) / stats.requests);
+    }
+    con<6>("dns cache hits: {}, lookups: {}, coalesced: {}", resolver_.hit_count(), resolver_.miss_count(), resolver_.coalesced_count());
+    if (use_cache_) {
+        HttpCacheManager::CacheStats cache = cache_manager_.stats();
+        con<6>("memory cache: {} hits, {} misses, {} bytes served, {} objects ({} / {} bytes), {} evictions",
+               cache.memory.hits, cache.memory.misses, cache.memory.hit_bytes, cache.memory.objects, cache.memory.bytes, cache.memory.budget, cache.memory.evictions);
+        con<6>("disk cache: {} hits, {} misses, {} bytes served, {} files ({} / {} bytes), {} evictions ({} bytes)", cache.disk.hits, cache.disk.misses,
+               cache.disk.hit_bytes, cache.disk.objects, cache.disk.bytes, cache.disk.budget, cache.disk.evictions, cache.disk.evicted_bytes);
+        con<6>("cache segments: {} files ({} live / {} bytes), {} compacted, {} responses moved ({} bytes)", cache.disk.segments.segments,
+               cache.disk.segments.live_bytes, cache.disk.segments.file_bytes, cache.disk.segments.compactions, cache.disk.segments.moved, cache.disk.segments.moved_bytes);
+        con<6>("cache fills: {} fetched from server, {} collapsed into in-flight fetches, {} written behind, {} dropped (write queue full)", cache.fetches,
+               cache.collapsed, cache.written, cache.dropped);
+        con<6>("cache freshness: {} served fresh without revalidation, {} revalidated by server", fresh_hit_cnt_.load(), revalidated_cnt_.load());
+        con<6>("stale cache: {} served while revalidating, {} served on server error, background refreshes: {} done, {} failed",
+               stale_revalidate_cnt_.load(), stale_error_cnt_.load(), refresh_cnt_.load(), refresh_failed_cnt_.load());
+    }
 }
 
-// 检查缓存并接收第一个数据包
-my::CheckCacheResult
-my::HttpProxyServer::check_cache_and_recv(
-    HttpRequest client_request, const Host &server, char *buffer, int buf_size, int &recv_size)
+// 记录一个客户端连接关闭时处理的请求数
+void my::HttpProxyServer::record_client_connection(int req_cnt)
+{
+    client_conn_cnt_++;
+    client_req_cnt_ += req_cnt;
+    if (req_cnt > 1) {
+        client_reused_req_cnt_ += req_cnt - 1;
+    }
+    size_t max_req = client_max_req_.load();
+    while (static_cast<size_t>(req_cnt) > max_req && !client_max_req_.compare_exchange_weak(max_req, req_cnt)) {
+    }
+}
+
+// 接收一次数据
+// 等待期间启动连接的等待定时器，到期时操作被取消，此时 conn.timed_out 为 true
+my::Coroutine<my::IoService::Result> my::HttpProxyServer::receive(Connection &conn, SOCKET s, const char *name, int timeout_ms)
+{
+    if (conn.timed_out) {
+        co_return IoService::Result{::std::string(), WSA_OPERATION_ABORTED};
+    }
+    arm_timer(conn, conn.wait_timer, name, timeout_ms);
+    IoService::Result result = co_await conn.reactor.io.async_recv(s);
+    disarm_timer(conn, conn.wait_timer);
+    co_return result;
+}
+
+// 解析主机名
+// 命中缓存时直接返回，否则在解析线程中查询，完成后投递回事件循环线程继续执行协程
+my::Coroutine<my::DnsResolver::Result> my::HttpProxyServer::resolve(Reactor &reactor, ::std::string host)
+{
+    if (auto cached = resolver_.lookup_cache(host)) {
+        co_return *cached;
+    }
+    using Awaiter = CallbackAwaiter<DnsResolver::Result>;
+    Awaiter resolved([this, &reactor, host](Awaiter::Callback done) {
+        resolver_.resolve_async(host, [&reactor, done = ::std::move(done)](const DnsResolver::Result &result) {
+            reactor.io.post([done, result]() { done(result); });
+        });
+    });
+    co_return co_await resolved;
+}
+
+// 建立到服务器的新连接
+// 连接期间套接字已保存在 conn.server 中，超时或停止时可以被取消
+my::Coroutine<void> my::HttpProxyServer::open_server_connection(Connection &conn)
+{
+    IoService &io = conn.reactor.io;
+    Host &server = conn.server;
+    if (conn.timed_out) {
+        throw ::std::runtime_error(::std::format("Client<{}> timed out before connecting to server {}:{}", conn.c_no, server.ip, server.port));
+    }
+
+    server.socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (server.socket == INVALID_SOCKET) {
+        throw ::std::runtime_error(::std::format("During connecting to server {}:{}", server.ip, server.port) + "\n        " +
+                                   ::std::format("Failed to create socket. Error code: {}", WSAGetLastError()));
+    }
+    io.associate(server.socket);
+    arm_timer(conn, conn.wait_timer, "connect", timeouts_.connect);
+    IoService::Result connected = co_await io.async_connect(server.socket, server.ip, server.port);
+    disarm_timer(conn, conn.wait_timer);
+    if (conn.timed_out) {
+        throw ::std::runtime_error(::std::format("Timeout ({}) when connecting to server {}:{}", conn.timeout_name, server.ip, server.port));
+    }
+    if (connected.error_code != 0) {
+        throw ::std::runtime_error(::std::format("During connecting to server {}:{}", server.ip, server.port) + "\n        " +
+                                   ::std::format("Failed to connect to server. Error code: {}", connected.error_code));
+    }
+}
+
+// 在客户端和服务器之间双向转发数据
+// 两个方向各由一个协程转发，一方关闭连接后关闭另一方的发送方向，双方都关闭、出错或空闲超时后结束
+my::Coroutine<void> my::HttpProxyServer::tunnel(Connection &conn, ::std::string s_hostname)
+{
+    IoService &io = conn.reactor.io;
+    SOCKET client = conn.client.socket;
+    SOCKET server = conn.server.socket;
+    uint64_t up_bytes = 0, down_bytes = 0;
+    try {
+        // 客户端在收到 200 之前已发送的数据
+        if (!conn.c_in.empty()) {
+            size_t early_size = conn.c_in.size();
+            IoService::Result sent = co_await io.async_send(server, ::std::move(conn.c_in));
+            conn.c_in.clear();
+            if (sent.error_code != 0) {
+                throw ::std::runtime_error(::std::format("Failed to send data to server {}. Error code: {}", s_hostname, sent.error_code));
+            }
+            up_bytes += early_size;
+        }
+
+        arm_timer(conn, conn.wait_timer, "tunnel idle", timeouts_.tunnel_idle);
+        co_await when_all(relay(conn, client, server, s_hostname, up_bytes), relay(conn, server, client, s_hostname, down_bytes));
+        disarm_timer(conn, conn.wait_timer);
+        if (conn.timed_out) {
+            log("Proxy<{}>: tunnel to {} closed ({})", p_no_, s_hostname, conn.timeout_name);
+        }
+    } catch (const ::std::exception &) {
+        disarm_timer(conn, conn.wait_timer);
+        record_tunnel(s_hostname, up_bytes, down_bytes);
+        throw;
+    }
+    record_tunnel(s_hostname, up_bytes, down_bytes);
+}
+
+// 在隧道中把数据从 from 转发给 to
+// 每个方向只经过一次接收缓冲：接收后立即发送给另一方，发送完再继续接收，对方接收慢时自然停止接收
+// 任一方向出错时取消两个套接字上的操作，使另一个方向也随之结束
+my::Coroutine<void> my::HttpProxyServer::relay(Connection &conn, SOCKET from, SOCKET to, ::std::string_view s_hostname, uint64_t &bytes)
+{
+    IoService &io = conn.reactor.io;
+    while (true) {
+        IoService::Result received = co_await io.async_recv(from);
+        if (conn.timed_out) {
+            co_return; // 空闲超时，由 tunnel 记录
+        }
+        if (received.error_code != 0) {
+            io.cancel(from);
+            io.cancel(to);
+            throw ::std::runtime_error(::std::format("Failed to receive data in tunnel to {}. Error code: {}", s_hostname, received.error_code));
+        }
+        if (received.data.empty()) {
+            shutdown(to, SD_SEND);
+            co_return;
+        }
+
+        // 任一方向转发数据都会重新开始隧道的空闲计时
+        arm_timer(conn, conn.wait_timer, "tunnel idle", timeouts_.tunnel_idle);
+        size_t size = received.data.size();
+        IoService::Result sent = co_await io.async_send(to, ::std::move(received.data));
+        if (conn.timed_out) {
+            co_return;
+        }
+        if (sent.error_code != 0) {
+            io.cancel(from);
+            io.cancel(to);
+            throw ::std::runtime_error(::std::format("Failed to send data in tunnel to {}. Error code: {}", s_hostname, sent.error_code));
+        }
+        bytes += size;
+    }
+}
+
+// 记录一个隧道关闭时转发的字节数
+void my::HttpProxyServer::record_tunnel(::std::string_view s_hostname, uint64_t up_bytes, uint64_t down_bytes)
+{
+    tunnel_cnt_++;
+    tunnel_up_bytes_ += up_bytes;
+    tunnel_down_bytes_ += down_bytes;
+    log("Proxy<{}>: tunnel to {} closed, {} bytes up, {} bytes down", p_no_, s_hostname, up_bytes, down_bytes);
+}
+
+// 改写转发给服务器的请求，并返回初步的缓存检查结果
+// 没有缓存键的 URL（origin-form 或非 http(s) URL）不读写缓存，以免不同的 URL 共用同一个缓存
+// 缓存的验证器一次取得，检查之后缓存被移除时按没有缓存处理
+my::CheckCacheResult my::HttpProxyServer::prepare_request(HttpRequest &client_request)
 {
     CheckCacheResult chk_res = CheckCacheResult::NONE;
-    if (!use_cache_ || client_request.method != "GET") {
+    ::std::optional<HttpCacheManager::Validators> validators;
+    if (!use_cache_ || client_request.method != "GET" || !HttpCacheManager::is_cacheable(client_request.url)) {
         chk_res = CheckCacheResult::NOT_SUPPORTED;
-    } else if (!cache_manager_.has_cache(client_request.url)) {
+    } else if (!(validators = cache_manager_.get_validators(client_request.url))) {
         chk_res = CheckCacheResult::NO_CACHE;
     }
 
-    // 移除客户端请求中的代理相关头部，添加 Connection: close 头部
+    // 移除客户端请求中的代理相关头部，与服务器保持连接以便复用
     client_request.headers.erase("Proxy-Connection");
-    client_request.headers["Connection"] = "close";
+    client_request.headers.set("Connection", "keep-alive");
+
+    // 没有缓存时，缓存中需要保存完整的响应，不转发客户端自己的条件请求头部
+    if (chk_res == CheckCacheResult::NO_CACHE) {
+        client_request.headers.erase("If-Modified-Since");
+        client_request.headers.erase("If-None-Match");
+    }
 
     // 如果缓存存在，则添加 If-Modified-Since 和 If-None-Match 头部
     if (chk_res == CheckCacheResult::NONE) {
-        if (cache_manager_.get_modified_time(client_request.url) != "") {
-            client_request.headers["If-Modified-Since"] = cache_manager_.get_modified_time(client_request.url);
+        if (validators->modified_time != "") {
+            client_request.headers.set("If-Modified-Since", validators->modified_time);
         }
-        if (cache_manager_.get_etag(client_request.url) != "") {
-            client_request.headers["If-None-Match"] = cache_manager_.get_etag(client_request.url);
+        if (validators->etag != "") {
+            client_request.headers.set("If-None-Match", validators->etag);
         }
     }
-    recv_size = send_and_recv(client_request, server, buffer, buf_size);
+    return chk_res;
+}
 
+// 根据服务器响应的第一个数据包确定最终的缓存检查结果
+my::CheckCacheResult my::HttpProxyServer::check_cache_status(CheckCacheResult chk_res, const char *buffer, int recv_size)
+{
     if (chk_res == CheckCacheResult::NONE) {
-        const char *start = strchr(buffer, ' ') + 1;
-        ::std::string status = ::std::string(start, 3);
+        ::std::string_view first_packet(buffer, recv_size);
+        size_t start = first_packet.find(' ');
+        ::std::string status = start == ::std::string_view::npos ? "" : ::std::string(first_packet.substr(start + 1, 3));
         if (status == "304") {
             chk_res = CheckCacheResult::FOUND;
         } else if (status == "200") {
             chk_res = CheckCacheResult::EXPIRED;
+        } else if (status.starts_with('5')) {
+            chk_res = CheckCacheResult::SERVER_ERROR;
         } else {
-            throw ::std::runtime_error(::std::format("Unexpected status code: {} received from server when checking cache", status));
+            // 其他状态（如 206、412）原样转发给客户端，不更新缓存
+            log("Proxy<{}>: unexpected status code: {} received from server when checking cache", p_no_, status);
+            chk_res = CheckCacheResult::NOT_SUPPORTED;
         }
     }
     return chk_res;
 }
 
+// 检查缓存并接收第一个数据包
+my::Coroutine<my::CheckCacheResult>
+my::HttpProxyServer::check_cache_and_recv(
+    Connection &conn, HttpRequest client_request, IoService::Result &first_packet)
+{
+    CheckCacheResult chk_res = prepare_request(client_request);
+    first_packet = co_await send_and_recv(conn, client_request);
+    co_return check_cache_status(chk_res, first_packet.data.data(), static_cast<int>(first_packet.data.size()));
+}
+
+// 取出连接池中的空闲连接或建立新连接，然后检查缓存并接收第一个数据包
+// 复用的连接可能已被服务器关闭，此时换用新连接重试一次
+my::Coroutine<my::CheckCacheResult> my::HttpProxyServer::request_from_server(Connection &conn, const HttpRequest &c_req, ::std::string_view s_hostname, const ::std::string &pool_key,
+                                                                             IoService::Result &first_packet, int64_t &request_time)
+{
+    IoService &io = conn.reactor.io;
+    const Host &client = conn.client;
+    Host &server = conn.server;
+    server.socket = upstream_pool_.checkout(pool_key);
+    bool reused = server.socket != INVALID_SOCKET;
+    if (reused) {
+        io.associate(server.socket);
+        log("Proxy<{}>: reused idle connection with server {}", p_no_, s_hostname);
+    } else {
+        co_await open_server_connection(conn);
+        log("Proxy<{}>: enstabished connection with server {}", p_no_, s_hostname);
+    }
+    con<6>("{}:{} ------------- {}:{} ------------- {}:{} ({})", client.ip, client.port, proxy_.ip, proxy_.port, server.ip, server.port, s_hostname);
+
+    CheckCacheResult chk_res = CheckCacheResult::NONE;
+    request_time = unix_now();
+    bool stale = false;
+    try {
+        chk_res = co_await check_cache_and_recv(conn, c_req, first_packet);
+    } catch (const ::std::runtime_error &) {
+        if (!reused || conn.timed_out) {
+            throw;
+        }
+        stale = true;
+    }
+    if (stale) {
+        log("Proxy<{}>: idle connection with server {} is stale, reconnecting", p_no_, s_hostname);
+        io.close(server.socket);
+        server.socket = INVALID_SOCKET;
+        co_await open_server_connection(conn);
+        request_time = unix_now();
+        chk_res = co_await check_cache_and_recv(conn, c_req, first_packet);
+    }
+    co_return chk_res;
+}
+
 // 从缓存中响应请求
-int my::HttpProxyServer::answer_from_cache(::std::string_view url, const Host &client)
+// framer 用于确认缓存的响应是否有明确的结束位置
+// 响应头部中的 Age 字段改为响应当前的年龄，其余部分原样发送
+my::Coroutine<int> my::HttpProxyServer::answer_from_cache(Connection &conn, ::std::string_view url, HttpResponseFramer &framer)
 {
-    char buffer[MAX_BUFFER_SIZE];
-    int total_size = 0;
-    int read_size;
-    int pkg_cnt = 0;
-    // 从缓存中读取数据并发送给客户端
-    while ((read_size = cache_manager_.read_cache(url, buffer, MAX_BUFFER_SIZE, total_size)) > 0) {
-        if (send(client.socket, buffer, read_size, 0) == SOCKET_ERROR) {
-            throw ::std::runtime_error(::std::format("Failed to send data (pack {}, {} bytes) to client. Error code: {}", pkg_cnt, read_size, WSAGetLastError()));
+    IoService &io = conn.reactor.io;
+    ::std::optional<Freshness> freshness = cache_manager_.get_freshness(url);
+    int64_t age = freshness ? freshness->age(unix_now()) : -1;
+    size_t head_size = 0;
+
+    // 内存层中有完整的响应时直接发送，不访问缓存文件
+    // 发送期间 cached 持有缓冲，缓冲被淘汰或替换后仍然有效，因此按分段发送而不拷贝
+    if (HotCache::Buffer cached = cache_manager_.get_memory_cache(url)) {
+        framer.feed(cached->data(), cached->size());
+        ::std::string head = age < 0 ? "" : with_age_field(*cached, age, head_size);
+        ::std::vector<::std::string_view> buffers;
+        if (!head.empty()) {
+            buffers.emplace_back(head);
         }
-        total_size += read_size;
-        ++pkg_cnt;
+        buffers.emplace_back(::std::string_view(*cached).substr(head_size));
+        size_t total_size = head.size() + cached->size() - head_size;
+        IoService::Result sent = co_await io.async_send(conn.client.socket, ::std::move(buffers));
+        if (sent.error_code != 0) {
+            throw ::std::runtime_error(::std::format("Failed to send cached data ({} bytes) to client. Error code: {}", total_size, sent.error_code));
+        }
+        co_return static_cast<int>(total_size);
+    }
+
+    // 只打开一次缓存文件，之后的发送不再持有缓存锁
+    CacheFile file = cache_manager_.open_cache(url, io.backend() == IoService::Backend::COMPLETION_PORT);
+    io.associate(file.handle());
+
+    // 读取开头一段用于分析响应头部，与文件的其余部分一起由 TransmitFile 发送
+    // 响应可能保存在段文件中，读取和发送都从响应在文件中的偏移量开始，读到的超出响应的部分属于其他缓存
+    IoService::Result head = co_await io.async_read_file(file.handle(), file.offset());
+    if (head.error_code != 0) {
+        throw ::std::runtime_error(::std::format("Failed to read cache file. Error code: {}", head.error_code));
+    }
+    if (head.data.size() > file.size()) {
+        head.data.resize(static_cast<size_t>(file.size()));
     }
-    return total_size;
+    framer.feed(head.data.data(), head.data.size());
+
+    // 替换读到的一段中的响应头部，其后的数据仍然随新的头部一起发送
+    uint64_t offset = head.data.size();
+    ::std::string head_data = age < 0 ? "" : with_age_field(head.data, age, head_size);
+    if (head_data.empty()) {
+        head_data = ::std::move(head.data);
+    } else {
+        head_data.append(head.data, head_size);
+    }
+    uint64_t total_size = head_data.size() + file.size() - offset;
+    IoService::Result sent = co_await io.async_transmit_file(conn.client.socket, file.handle(), file.offset() + offset, file.size() - offset, ::std::move(head_data));
+    if (sent.error_code != 0) {
+        throw ::std::runtime_error(::std::format("Failed to send cached data ({} bytes) to client. Error code: {}", total_size, sent.error_code));
+    }
+    co_return static_cast<int>(total_size);
 }
 
-// 发送请求并接收响应
-int my::HttpProxyServer::send_and_recv(const HttpRequest &req, const Host &server, char *buffer, int buf_size)
+// 发送请求并接收响应的第一个数据包
+// 请求按分段发送，未修改的部分直接引用客户端发来的原始数据，不再拼接成一个字符串
+my::Coroutine<my::IoService::Result> my::HttpProxyServer::send_and_recv(Connection &conn, const HttpRequest &request)
 {
-    ::std::string check_request = req.to_string();
-    // ::std::cout << "DEBUG: check request: " << check_request << ::std::endl;
-    if (send(server.socket, check_request.c_str(), check_request.length(), 0) == SOCKET_ERROR) {
-        throw ::std::runtime_error(::std::format("Failed to send check request to server. Error code: {}", WSAGetLastError()));
+    ::std::string scratch;
+    IoService::Result sent = co_await conn.reactor.io.async_send(conn.server.socket, request.to_buffers(scratch));
+    if (sent.error_code != 0) {
+        throw ::std::runtime_error(::std::format("Failed to send check request to server. Error code: {}", sent.error_code));
     }
 
-    int recv_size = recv_with_timeout(server.socket, buffer, buf_size, {1, 0});
-    if (recv_size == SOCKET_ERROR) {
-        throw ::std::runtime_error(::std::format("Failed to receive data from server. Error code: {}", WSAGetLastError()));
-    } else if (recv_size == 0) {
+    IoService::Result received = co_await receive(conn, conn.server.socket, "first byte", timeouts_.first_byte);
+    if (conn.timed_out) {
+        throw ::std::runtime_error(::std::format("Timeout ({}) when receiving data from server", conn.timeout_name));
+    }
+    if (received.error_code != 0) {
+        throw ::std::runtime_error(::std::format("Failed to receive data from server. Error code: {}", received.error_code));
+    } else if (received.data.empty()) {
         throw ::std::runtime_error("Server disconnected when receiving data");
     }
-
-    return recv_size;
+    co_return received;
 }
 
 // 从服务器响应请求
-int my::HttpProxyServer::answer_from_server(CheckCacheResult chk_res, ::std::string_view url, const Host &client, const Host &server, char *buffer, int buf_size, int recv_size)
+// 根据 framer 判断响应的结束位置，响应完整后不再等待服务器关闭连接
+// 接收的缓冲直接交给发送操作，发送完后才继续接收，客户端接收慢时不会在代理中积压数据
+// 有读者共享响应时，每块数据只保存一份，同时交给读者；客户端断开后仍为读者接收完整个响应
+// 后台验证没有客户端（conn.client.socket 为 INVALID_SOCKET），只写入缓存并交给读者
+// 写入缓存的数据块与读者共享同一份数据，只交给缓存的写入线程，转发不等待磁盘写入
+// 响应头部完整后确定响应能否缓存及其新鲜度，不能缓存（no-store、private 等）时放弃缓存并不再写入
+my::Coroutine<int> my::HttpProxyServer::answer_from_server(Connection &conn, CheckCacheResult chk_res, ::std::string_view url, int64_t request_time, ::std::string first_packet,
+                                                             HttpResponseFramer &framer, SharedFetch *shared)
 {
+    IoService &io = conn.reactor.io;
+    const Host &client = conn.client;
+    const Host &server = conn.server;
     int total_size = 0;
     bool need_cache = chk_res == CheckCacheResult::EXPIRED || chk_res == CheckCacheResult::NO_CACHE;
     int pkg_cnt = 0;
+    ::std::string client_error;
+    Freshness freshness;
+    bool head_checked = false;
+    HttpCacheManager::FillHandle fill;
 
     if (need_cache) {
-        cache_manager_.create_cache(url);
+        fill = cache_manager_.create_cache(url);
     }
 
     // 发送第一个数据包给客户端
     // 然后继续接收数据并发送给客户端
+    // 转发中途出错时缓存不完整，放弃后再抛出异常
+    try {
+        ::std::string data = ::std::move(first_packet);
+        while (!data.empty()) {
+            // 响应结束后多余的数据不属于本次响应，不转发
+            data.resize(framer.feed(data.data(), data.size()));
+            int recv_size = static_cast<int>(data.size());
+            if (need_cache && !head_checked && framer.state() != HttpResponseFramer::State::HEAD) {
+                head_checked = true;
+                freshness = compute_freshness(framer.head(), request_time, unix_now());
+                if (!is_storable(framer.head())) {
+                    need_cache = false;
+                    cache_manager_.abort_cache(fill);
+                    log("Proxy<{}>: response for: {} is not storable, not cached", p_no_, url);
+                } else if (!is_heuristically_cacheable(framer.head().status) && !has_explicit_lifetime(framer.head())) {
+                    // 其他状态码的响应只有明确给出新鲜期时才能缓存（RFC 9111 第 3 节）
+                    need_cache = false;
+                    cache_manager_.abort_cache(fill);
+                    log("Proxy<{}>: response {} for: {} has no explicit freshness, not cached", p_no_, framer.head().status, url);
+                }
+            }
 
-    while (recv_size > 0) {
-        // ::std::cout << "DEBUG: about to receive data from server: pack " << pkg_cnt << ::std::endl;
+            con<6>("{}:{} ------------- {}:{} <===[{}]==== {}:{}", client.ip, client.port, proxy_.ip, proxy_.port, recv_size, server.ip, server.port);
+
+            IoService::Result sent;
+            bool to_client = client.socket != INVALID_SOCKET && client_error.empty();
+            if (shared != nullptr || need_cache) {
+                SharedFetch::Chunk chunk = ::std::make_shared<const ::std::string>(::std::move(data));
+                if (need_cache) {
+                    cache_manager_.append_cache(fill, chunk);
+                }
+                if (shared != nullptr) {
+                    shared->append(chunk);
+                }
+                if (to_client) {
+                    ::std::vector<::std::string_view> buffers(1, *chunk);
+                    sent = co_await io.async_send(client.socket, ::std::move(buffers));
+                }
+            } else if (to_client) {
+                sent = co_await io.async_send(client.socket, ::std::move(data));
+            }
+            if (sent.error_code != 0) {
+                client_error = ::std::format("Failed to send data (pack {}, {} bytes) to client. Error code: {}", pkg_cnt, recv_size, sent.error_code);
+                if (shared == nullptr || shared->reader_count() == 0 || conn.timed_out) {
+                    throw ::std::runtime_error(client_error);
+                }
+                log("Proxy<{}>: client<{}> failed, continue receiving for {} readers of: {}", p_no_, conn.c_no, shared->reader_count(), url);
+            }
+            total_size += recv_size;
 
-        con<6>("{}:{} ------------- {}:{} <===[{}]==== {}:{}", client.ip, client.port, proxy_.ip, proxy_.port, recv_size, server.ip, server.port);
+            con<6>("{}:{} <===[{}]==== {}:{} ------------- {}:{} (total: {})", client.ip, client.port, recv_size, proxy_.ip, proxy_.port, server.ip, server.port, total_size);
+            ++pkg_cnt;
 
-        // ::std::cout << "DEBUG: about to send data to client: pack " << pkg_cnt << ::std::endl;
-        if (send(client.socket, buffer, recv_size, 0) == SOCKET_ERROR) {
-            throw ::std::runtime_error(::std::format("Failed to send data (pack {}, {} bytes) to client. Error code: {}", pkg_cnt, recv_size, WSAGetLastError()));
+            if (framer.is_complete()) {
+                break;
+            }
+            IoService::Result received = co_await receive(conn, server.socket, "read", timeouts_.read);
+            if (conn.timed_out) {
+                throw ::std::runtime_error(::std::format("Timeout ({}) when receiving data (pack {}) from server", conn.timeout_name, pkg_cnt));
+            }
+            if (received.error_code != 0) {
+                throw ::std::runtime_error(::std::format("Failed to receive data (pack {}) from server. Error code: {}", pkg_cnt, received.error_code));
+            }
+            data = ::std::move(received.data);
         }
-        total_size += recv_size;
-
-        con<6>("{}:{} <===[{}]==== {}:{} ------------- {}:{} (total: {})", client.ip, client.port, recv_size, proxy_.ip, proxy_.port, server.ip, server.port, total_size);
-
+    } catch (const ::std::exception &) {
         if (need_cache) {
-            // ::std::cout << "DEBUG: about to append cache for: " << c_req.url << ::std::endl;
-            cache_manager_.append_cache(url, buffer, recv_size);
+            cache_manager_.abort_cache(fill);
         }
-        ++pkg_cnt;
+        throw;
+    }
 
-        recv_size = recv_with_timeout(server.socket, buffer, buf_size, {1, 0});
-        if (recv_size == SOCKET_ERROR) {
-            throw ::std::runtime_error(::std::format("Failed to receive data (pack {}) from server. Error code: {}", pkg_cnt, WSAGetLastError()));
+    // 服务器在响应完整之前关闭连接，不缓存不完整的响应
+    if (!framer.is_complete() && !framer.is_close_delimited()) {
+        if (need_cache) {
+            cache_manager_.abort_cache(fill);
         }
+        throw ::std::runtime_error(::std::format("Server closed connection before response completed ({} bytes received)", total_size));
     }
 
     // 判断是否需要更新缓存时间
     if (need_cache) {
-        if (total_size == 0) {
-            cache_manager_.remove_cache(url);
-        } else {
-            // ::std::cout << "DEBUG: about to update cache time for: " << c_req.url << ::std::endl;
-            if (cache_manager_.update_cache_time(url))
-                log("Proxy<{}>: cache created(updated) for: {} ({})", p_no_, url, HttpCacheManager::get_key(url));
-            else {
-                log("Proxy<{}>: refused to create cache for: {} ({})", p_no_, url, HttpCacheManager::get_key(url));
-                con<6>("Neither \"Last-Modified\" nor \"ETag\" found in response header");
+        finish_cache(fill, url, total_size, freshness);
+    }
+    if (!client_error.empty()) {
+        if (shared != nullptr) {
+            shared->finish(SharedFetch::State::COMPLETE);
+        }
+        throw ::std::runtime_error(client_error);
+    }
+    co_return total_size;
+}
+
+// 加入同一 URL 进行中的获取，作为读者共享发起者收到的响应
+// 响应因请求而不同的请求（Range、Authorization）和不能缓存的 URL 不加入获取，也不写入缓存
+// 获取在发送任何数据之前被放弃时，请求改为自行向服务器请求（不写入缓存）
+// 成为发起者时缓存可能刚被写入线程发布，缓存新鲜时直接从缓存响应
+my::Coroutine<bool> my::HttpProxyServer::answer_from_fetch(Connection &conn, const HttpRequest &c_req, HttpCacheManager::Fetch &fetch, HttpResponseFramer &framer, bool &keep_alive)
+{
+    if (!use_cache_ || c_req.method != "GET") {
+        co_return false;
+    }
+    if (c_req.headers.contains("Range") || c_req.headers.contains("Authorization") || !HttpCacheManager::is_cacheable(c_req.url)) {
+        fetch.role = HttpCacheManager::FetchRole::BYPASS;
+        co_return false;
+    }
+    fetch = cache_manager_.join_fetch(c_req.url);
+    const Host &client = conn.client;
+    if (fetch.role == HttpCacheManager::FetchRole::LEADER) {
+        // 检查缓存之后、成为发起者之前，缓存的写入线程可能刚发布了同一 URL 的响应并移除了它的获取
+        // 此时缓存已新鲜，结束刚发起的获取（已加入的读者同样从缓存响应），不再向服务器请求
+        ::std::optional<Freshness> freshness = cache_manager_.get_freshness(c_req.url);
+        if (!freshness || !allows_cached(c_req.headers, *freshness, unix_now())) {
+            co_return false;
+        }
+        cache_manager_.end_fetch(c_req.url, fetch, SharedFetch::State::NOT_MODIFIED);
+        HttpResponseFramer cache_framer;
+        int total_size = co_await answer_from_cache(conn, c_req.url, cache_framer);
+        keep_alive = keep_alive && cache_framer.is_self_delimited();
+        ++fresh_hit_cnt_;
+        log("Proxy<{}>: transmitted {} bytes data from just published cache to client<{}> successfully", p_no_, total_size, conn.c_no);
+        con<6>("{}:{} <==[fresh]=== {}:{} ------------- (just published)", client.ip, client.port, proxy_.ip, proxy_.port);
+        co_return true;
+    }
+    if (fetch.role != HttpCacheManager::FetchRole::READER) {
+        co_return false;
+    }
+
+    Reactor &reactor = conn.reactor;
+    int total_size = 0;
+    log("Proxy<{}>: joined in-flight fetch for: {} ({})", p_no_, c_req.url, HttpCacheManager::get_key(c_req.url));
+
+    SharedFetch::State state = SharedFetch::State::FETCHING;
+    while (true) {
+        ::std::vector<SharedFetch::Chunk> chunks;
+        state = fetch.shared->read(fetch.reader, chunks);
+        if (!chunks.empty()) {
+            // 发送期间 chunks 持有各块数据
+            ::std::vector<::std::string_view> buffers;
+            int size = 0;
+            for (const SharedFetch::Chunk &chunk : chunks) {
+                framer.feed(chunk->data(), chunk->size());
+                buffers.emplace_back(*chunk);
+                size += static_cast<int>(chunk->size());
+            }
+            IoService::Result sent = co_await reactor.io.async_send(client.socket, ::std::move(buffers));
+            if (sent.error_code != 0) {
+                throw ::std::runtime_error(::std::format("Failed to send shared data ({} bytes) to client. Error code: {}", size, sent.error_code));
+            }
+            total_size += size;
+            continue;
+        }
+        if (state != SharedFetch::State::FETCHING) {
+            break;
+        }
+
+        // 等待发起者收到新数据，回调在发起者的线程中调用，投递回本连接的事件循环继续执行
+        using Awaiter = CallbackAwaiter<bool>;
+        Awaiter woken([&fetch, &reactor](Awaiter::Callback done) {
+            auto resume = [&reactor, done]() { reactor.io.post([done]() { done(true); }); };
+            if (!fetch.shared->wait(fetch.reader, resume)) {
+                resume();
+            }
+        });
+        co_await woken;
+        if (conn.timed_out) {
+            throw ::std::runtime_error(::std::format("Timeout ({}) when waiting for in-flight fetch of: {}", conn.timeout_name, c_req.url));
+        }
+    }
+    cache_manager_.end_fetch(c_req.url, fetch, state);
+
+    if (state == SharedFetch::State::ABANDONED) {
+        if (total_size > 0) {
+            throw ::std::runtime_error(::std::format("In-flight fetch of {} abandoned after {} bytes", c_req.url, total_size));
+        }
+        log("Proxy<{}>: in-flight fetch for: {} abandoned, requesting from server", p_no_, c_req.url);
+        fetch.role = HttpCacheManager::FetchRole::BYPASS;
+        co_return false;
+    }
+
+    if (state == SharedFetch::State::NOT_MODIFIED) {
+        // 发起者确认缓存未修改，与发起者一样从缓存中响应
+        HttpResponseFramer cache_framer;
+        total_size = co_await answer_from_cache(conn, c_req.url, cache_framer);
+        keep_alive = keep_alive && cache_framer.is_self_delimited();
+        log("Proxy<{}>: transmitted {} bytes data from cache to client<{}> successfully", p_no_, total_size, conn.c_no);
+        con<6>("{}:{} <==[cached]== {}:{} ------------- (shared)", client.ip, client.port, proxy_.ip, proxy_.port);
+    } else {
+        // 以关闭连接结束的响应只能通过关闭客户端连接来结束
+        keep_alive = keep_alive && framer.is_complete();
+        log("Proxy<{}>: transmitted {} bytes shared data to client<{}> successfully", p_no_, total_size, conn.c_no);
+        con<6>("{}:{} <==[shared]== {}:{} ------------- (shared)", client.ip, client.port, proxy_.ip, proxy_.port);
+    }
+    co_return true;
+}
+
+// 响应转发结束后提交或放弃缓存
+// 提交后由缓存的写入线程完成写入并记录结果，这里不等待
+void my::HttpProxyServer::finish_cache(const HttpCacheManager::FillHandle &fill, ::std::string_view url, int total_size, const Freshness &freshness)
+{
+    if (total_size == 0) {
+        cache_manager_.abort_cache(fill);
+    } else if (cache_manager_.commit_cache(fill, freshness)) {
+        log("Proxy<{}>: cache committed for: {} ({}), fresh for {}s", p_no_, url, HttpCacheManager::get_key(url), freshness.lifetime - freshness.initial_age);
+    } else {
+        log("Proxy<{}>: cache for: {} ({}) was given up before commit", p_no_, url, HttpCacheManager::get_key(url));
+    }
+}
+
+// 服务器确认缓存仍然有效后更新缓存的新鲜度（RFC 9111 第 4.3.4 节）
+// 304 响应没有明确给出新鲜期时沿用缓存原有的新鲜期（启发式新鲜期依赖的 Last-Modified 通常只在原响应中）
+// 304 响应没有 Cache-Control 字段时沿用缓存原有的过期后可用窗口和验证要求
+void my::HttpProxyServer::refresh_freshness(::std::string_view url, const HttpResponseHead &head, int64_t request_time)
+{
+    Freshness freshness = compute_freshness(head, request_time, unix_now());
+    if (::std::optional<Freshness> stored = cache_manager_.get_freshness(url)) {
+        if (!has_explicit_lifetime(head) && !cache_directive(head.headers, "no-cache")) {
+            freshness.lifetime = stored->lifetime;
+        }
+        if (!head.headers.contains("Cache-Control")) {
+            freshness.stale_while_revalidate = stored->stale_while_revalidate;
+            freshness.stale_if_error = stored->stale_if_error;
+            freshness.must_revalidate = stored->must_revalidate;
+        }
+    }
+    cache_manager_.refresh_cache(url, freshness);
+    ++revalidated_cnt_;
+}
+
+// 缓存新鲜时不经服务器验证直接从缓存响应请求（RFC 9111 第 4.2 节）
+// 缓存过期但在 stale-while-revalidate 窗口内时同样从缓存响应，同时在后台验证（RFC 5861 第 3 节），无法开始后台验证时改为同步验证
+// 只用于 GET 请求；响应因请求而不同的请求（Range、Authorization）和要求验证的请求（no-cache、max-age 等）仍向服务器验证
+my::Coroutine<bool> my::HttpProxyServer::answer_from_fresh_cache(Connection &conn, const HttpRequest &c_req, bool &keep_alive)
+{
+    if (!use_cache_ || c_req.method != "GET" || c_req.headers.contains("Range") || c_req.headers.contains("Authorization")) {
+        co_return false;
+    }
+    ::std::optional<Freshness> freshness = cache_manager_.get_freshness(c_req.url);
+    int64_t now = unix_now();
+    if (!freshness) {
+        co_return false;
+    }
+    bool fresh = allows_cached(c_req.headers, *freshness, now);
+    if (!fresh) {
+        int64_t window = freshness->stale_while_revalidate != Freshness::UNSPECIFIED ? freshness->stale_while_revalidate : stale_windows_.while_revalidate;
+        if (!allows_stale(c_req.headers, *freshness, now) || !freshness->is_usable_stale(now, window) || !start_background_refresh(c_req)) {
+            co_return false;
+        }
+    }
+
+    const Host &client = conn.client;
+    log("Proxy<{}>: {} cache hit for: {} ({}), age {}s of {}s", p_no_, fresh ? "fresh" : "stale", c_req.url, HttpCacheManager::get_key(c_req.url), freshness->age(now), freshness->lifetime);
+    HttpResponseFramer cache_framer;
+    int total_size = co_await answer_from_cache(conn, c_req.url, cache_framer);
+    // 缓存中只保存完整的响应，只需确认它不以关闭连接结束
+    keep_alive = keep_alive && cache_framer.is_self_delimited();
+    if (fresh) {
+        ++fresh_hit_cnt_;
+    } else {
+        ++stale_revalidate_cnt_;
+    }
+    log("Proxy<{}>: transmitted {} bytes data from cache to client<{}> successfully", p_no_, total_size, conn.c_no);
+    if (fresh) {
+        con<6>("{}:{} <==[fresh]=== {}:{} ------------- (not revalidated)", client.ip, client.port, proxy_.ip, proxy_.port);
+    } else {
+        con<6>("{}:{} <==[stale]=== {}:{} ------------- (revalidating)", client.ip, client.port, proxy_.ip, proxy_.port);
+    }
+    co_return true;
+}
+
+// 验证缓存时服务器出错或超时，从过期的缓存响应请求（RFC 5861 第 4 节）
+// 窗口优先使用响应中的 stale-if-error，没有时使用默认值；请求的 no-cache、max-age、min-fresh 同样适用
+my::Coroutine<bool> my::HttpProxyServer::answer_from_stale_cache(Connection &conn, const HttpRequest &c_req, bool &keep_alive)
+{
+    if (!use_cache_ || c_req.method != "GET" || c_req.headers.contains("Range") || c_req.headers.contains("Authorization")) {
+        co_return false;
+    }
+    ::std::optional<Freshness> freshness = cache_manager_.get_freshness(c_req.url);
+    int64_t now = unix_now();
+    if (!freshness) {
+        co_return false;
+    }
+    int64_t window = freshness->stale_if_error != Freshness::UNSPECIFIED ? freshness->stale_if_error : stale_windows_.if_error;
+    if (!allows_stale(c_req.headers, *freshness, now) || !freshness->is_usable_stale(now, window)) {
+        co_return false;
+    }
+
+    log("Proxy<{}>: server failed, serving stale cache for: {} ({}), age {}s of {}s", p_no_, c_req.url, HttpCacheManager::get_key(c_req.url), freshness->age(now), freshness->lifetime);
+    HttpResponseFramer cache_framer;
+    int total_size = co_await answer_from_cache(conn, c_req.url, cache_framer);
+    keep_alive = keep_alive && cache_framer.is_self_delimited();
+    ++stale_error_cnt_;
+    log("Proxy<{}>: transmitted {} bytes data from cache to client<{}> successfully", p_no_, total_size, conn.c_no);
+    co_return true;
+}
+
+// 开始在后台验证指定请求的缓存
+// 只有没有同一 URL 进行中的获取时才成为发起者并把验证投递到后台验证的事件循环；已有进行中的获取时它完成后同样会更新缓存
+bool my::HttpProxyServer::start_background_refresh(const HttpRequest &c_req)
+{
+    if (!refresh_reactor_ || keybord_interrupt) {
+        return false;
+    }
+    HttpCacheManager::Fetch fetch = cache_manager_.lead_fetch(c_req.url);
+    if (fetch.role != HttpCacheManager::FetchRole::LEADER) {
+        return true;
+    }
+    if (refreshing_cnt_++ >= MAX_BACKGROUND_REFRESHES) {
+        --refreshing_cnt_;
+        cache_manager_.end_fetch(c_req.url, fetch, SharedFetch::State::ABANDONED);
+        log("Proxy<{}>: too many background refreshes, revalidating: {} synchronously", p_no_, c_req.url);
+        return false;
+    }
+    refresh_reactor_->io.post([this, c_req, fetch]() { spawn(refresh_in_background(c_req, fetch)); });
+    return true;
+}
+
+// 在后台验证的事件循环中向服务器验证缓存
+// 验证使用一个没有客户端的连接，以负的编号登记在事件循环中，停止时与客户端连接一样被取消
+// 服务器确认缓存有效（304）时更新新鲜度，返回新的响应时写入缓存；期间加入获取的读者共享验证的结果
+my::Coroutine<void> my::HttpProxyServer::refresh_in_background(HttpRequest c_req, HttpCacheManager::Fetch fetch)
+{
+    static ::std::atomic_int refresh_no = 0;
+    Reactor &reactor = *refresh_reactor_;
+    int c_no = -(++refresh_no);
+    Connection conn(reactor, c_no, Host());
+    Host &server = conn.server;
+    ::std::string s_hostname;
+    ::std::string pool_key;
+    HttpResponseFramer framer;
+    bool refreshed = false;
+    reactor.connections[c_no] = &conn;
+    framer.set_request_method(c_req.method);
+    arm_timer(conn, conn.deadline_timer, "refresh", timeouts_.request);
+
+    try {
+        log("Proxy<{}>: revalidating stale cache for: {} in background", p_no_, c_req.url);
+        ::std::tie(s_hostname, server.port) = c_req.get_host_port();
+        DnsResolver::Result resolved = co_await resolve(reactor, s_hostname);
+        server.ip = resolved.address(s_hostname);
+        pool_key = ::std::format("{}#{}", ConnectionPool::make_key(s_hostname, server.port), reactor.index);
+
+        IoService::Result first_packet;
+        int64_t request_time = 0;
+        CheckCacheResult chk_res = co_await request_from_server(conn, c_req, s_hostname, pool_key, first_packet, request_time);
+        if (chk_res == CheckCacheResult::FOUND) {
+            framer.feed(first_packet.data.data(), first_packet.data.size());
+            reactor.io.give_buffer(::std::move(first_packet.data));
+            if (framer.state() != HttpResponseFramer::State::HEAD) {
+                refresh_freshness(c_req.url, framer.head(), request_time);
             }
+            cache_manager_.end_fetch(c_req.url, fetch, SharedFetch::State::NOT_MODIFIED);
+            refreshed = true;
+            log("Proxy<{}>: background refresh confirmed cache for: {}", p_no_, c_req.url);
+        } else if (chk_res == CheckCacheResult::EXPIRED || chk_res == CheckCacheResult::NO_CACHE) {
+            int total_size = co_await answer_from_server(conn, chk_res, c_req.url, request_time, ::std::move(first_packet.data), framer, fetch.shared.get());
+            cache_manager_.end_fetch(c_req.url, fetch, SharedFetch::State::COMPLETE);
+            refreshed = true;
+            log("Proxy<{}>: background refresh replaced cache for: {} ({} bytes)", p_no_, c_req.url, total_size);
+        } else {
+            log("Proxy<{}>: background refresh of: {} failed, server did not confirm the cache", p_no_, c_req.url);
         }
+    } catch (const ::std::exception &e) {
+        err("In Proxy<{}>:", p_no_);
+        con<8>("Background refresh of {} failed: {}", c_req.url, e.what());
+    }
+
+    disarm_timer(conn, conn.wait_timer);
+    disarm_timer(conn, conn.deadline_timer);
+    cache_manager_.end_fetch(c_req.url, fetch, SharedFetch::State::ABANDONED);
+    if (server.socket != INVALID_SOCKET) {
+        if (refreshed && framer.is_keep_alive()) {
+            reactor.io.release(server.socket);
+            upstream_pool_.release(pool_key, server.socket);
+        } else {
+            reactor.io.close(server.socket);
+        }
+        server.socket = INVALID_SOCKET;
+    }
+    reactor.connections.erase(c_no);
+    if (refreshed) {
+        ++refresh_cnt_;
+    } else {
+        ++refresh_failed_cnt_;
     }
-    return total_size;
+    --refreshing_cnt_;
 }
@@ -1,46 +1,58 @@
 #include "../include/HttpRequest.h"
 
-#include <cstring>
+#include <stdexcept>
 
-// 构造函数，从原始 HTTP 数据初始化
+// 构造函数，从一个完整的原始 HTTP 请求初始化
 ::my::HttpRequest::HttpRequest(const char *http_data, int size)
 {
-    const char *line_start = http_data; // 当前行的起始位置
-    const char *line_end;               // 当前行的结束位置
-    const char *body_start;             // 请求体的起始位置
-
-    // 解析请求行和头部字段
-    while (!isspace(*line_start)) {
-        line_end = strchr(line_start, '\n');                            // 查找行结束符
-        ::std::string_view line(line_start, line_end - line_start - 1); // 获取当前行
-        if (line.empty()) {
-            break; // 如果行为空，则结束解析
-        }
-
-        // 解析请求行
-        if (this->method.empty()) {
-            ::std::string_view method = line.substr(0, line.find(' ')); // 获取 HTTP 方法
-            this->method = ::std::string(method);
-            line.remove_prefix(method.size() + 1);
-
-            ::std::string_view url = line.substr(0, line.find(' ')); // 获取 URL
-            this->url = ::std::string(url);
-            line.remove_prefix(url.size() + 1);
+    ::std::string buffer(http_data, size);
+    HttpRequestParser parser;
+    HttpRequestParser::Result result = parser.parse(buffer);
+    if (result == HttpRequestParser::Result::NEED_MORE) {
+        throw ::std::runtime_error("Incomplete HTTP request");
+    } else if (result == HttpRequestParser::Result::FAILED) {
+        throw ::std::runtime_error(parser.error_message());
+    }
+    *this = HttpRequest(parser, buffer);
+}
 
-            this->version = ::std::string(line); // 获取 HTTP 版本
-        } else {
-            // 解析头部字段
-            ::std::string_view key = line.substr(0, line.find(':')); // 获取头部字段名
-            line.remove_prefix(key.size() + 2);
-            ::std::string_view value = line; // 获取头部字段值
-            this->headers[::std::string(key)] = ::std::string(value);
+// 构造函数，从已解析完整的请求初始化，并从 buffer 的开头取走请求的原始数据
+// 以 CRLF 结尾的行记录其在原始数据中的位置，转发时原样引用；只以 LF 结尾的行转发时重新生成
+::my::HttpRequest::HttpRequest(const HttpRequestParser &parser, ::std::string &buffer)
+    : method(parser.method()), url(parser.url()), version(parser.version())
+{
+    // 记录各部分相对于 buffer 开头的位置，buffer 的数据被取走后再换算为指向 raw 的 string_view
+    auto source_of = [&buffer](::std::string_view line) {
+        HttpHeaders::Source source = {};
+        if (line.size() >= 2 && line.substr(line.size() - 2) == "\r\n") {
+            source.offset = static_cast<uint32_t>(line.data() - buffer.data());
+            source.size = static_cast<uint32_t>(line.size());
         }
+        return source;
+    };
+
+    for (size_t i = 0; i < parser.header_count(); ++i) {
+        HttpRequestParser::Header header = parser.header(i);
+        this->headers.add(header.name, header.value, source_of(header.line));
+    }
+    HttpHeaders::Source request_line = source_of(parser.request_line());
+    size_t body_offset = parser.body().data() - buffer.data();
+    size_t body_size = parser.body().size();
 
-        line_start = line_end + 1; // 移动到下一行
+    // 请求占满 buffer 时直接转移 buffer 的内存，否则复制请求部分并保留后续请求的数据
+    size_t length = parser.request_length();
+    if (length == buffer.size()) {
+        this->raw = ::std::make_shared<const ::std::string>(::std::move(buffer));
+        buffer.clear();
+    } else {
+        this->raw = ::std::make_shared<const ::std::string>(buffer, 0, length);
+        buffer.erase(0, length);
     }
 
-    body_start = line_start + 2;                                             // 请求体的起始位置
-    this->body = ::std::string(body_start, size - (body_start - http_data)); // 获取请求体
+    this->body = ::std::string_view(*this->raw).substr(body_offset, body_size);
+    if (request_line.size != 0) {
+        this->raw_request_line = ::std::string_view(*this->raw).substr(request_line.offset, request_line.size);
+    }
 }
 
 // 获取主机和端口号
@@ -49,28 +61,106 @@
     ::std::string host;
     unsigned short port = 80; // 默认端口号为 80
 
-    auto it = this->headers.find("Host");
-    if (it != this->headers.end()) {
-        ::std::string_view host_port = it->second;
-        auto pos = host_port.find(':');
-        if (pos != ::std::string_view::npos) {
-            host = host_port.substr(0, pos);                              // 获取主机名
-            port = ::std::stoi(::std::string(host_port.substr(pos + 1))); // 获取端口号
-        } else {
-            host = ::std::string(host_port); // 仅获取主机名
-        }
+    // CONNECT 请求的目标就是 host:port，默认端口号为 443；其他请求使用 Host 头部
+    ::std::string_view host_port;
+    if (this->method == "CONNECT") {
+        host_port = this->url;
+        port = 443;
+    } else {
+        host_port = this->headers.get("Host");
+    }
+
+    auto pos = host_port.find(':');
+    if (pos != ::std::string_view::npos) {
+        host = host_port.substr(0, pos);                              // 获取主机名
+        port = ::std::stoi(::std::string(host_port.substr(pos + 1))); // 获取端口号
+    } else {
+        host = ::std::string(host_port); // 仅获取主机名
     }
 
     return {host, port};
 }
 
-// 将请求转换为字符串
-::std::string my::HttpRequest::to_string() const
+// 客户端是否希望在响应后保持连接
+// HTTP/1.1 默认保持连接，除非指定 close；HTTP/1.0 需要显式指定 keep-alive
+bool my::HttpRequest::is_keep_alive() const
+{
+    if (this->headers.has_token("Connection", "close") || this->headers.has_token("Proxy-Connection", "close")) {
+        return false;
+    }
+    if (this->version == "HTTP/1.1") {
+        return true;
+    }
+    return this->headers.has_token("Connection", "keep-alive") || this->headers.has_token("Proxy-Connection", "keep-alive");
+}
+
+// 将请求转换为一组待发送的分段
+// 在 raw 中相邻的分段合并为一段，未修改过的请求通常只有一段，不复制任何数据
+::std::vector<::std::string_view> my::HttpRequest::to_buffers(::std::string &scratch) const
 {
-    ::std::string str = this->method + " " + this->url + " " + this->version + "\r\n";
-    for (const auto &[key, value] : this->headers) {
-        str += key + ": " + value + "\r\n";
+    ::std::string_view raw_data = this->raw ? ::std::string_view(*this->raw) : ::std::string_view();
+
+    // 请求行与 raw 中的不同（如 URL 被改写）时需要重新生成
+    bool keep_request_line = !this->raw_request_line.empty() &&
+                             this->raw_request_line.size() == this->method.size() + this->url.size() + this->version.size() + 4 &&
+                             this->raw_request_line.starts_with(this->method) &&
+                             this->raw_request_line.substr(this->method.size() + 1).starts_with(this->url) &&
+                             this->raw_request_line.substr(this->method.size() + this->url.size() + 2).starts_with(this->version);
+    // 请求体之前的空行在 raw 中时直接引用
+    bool keep_blank_line = this->raw && this->body.data() >= raw_data.data() + 2 &&
+                           this->body.data() <= raw_data.data() + raw_data.size() && ::std::string_view(this->body.data() - 2, 2) == "\r\n";
+
+    // 先计算需要生成的数据的总长度，保证 scratch 只分配一次内存，其中的 string_view 不会失效
+    size_t size = keep_request_line ? 0 : this->method.size() + this->url.size() + this->version.size() + 4;
+    for (size_t i = 0; i < this->headers.size(); ++i) {
+        if (this->headers.source(i).size == 0) {
+            HttpHeaders::Field field = this->headers.field(i);
+            size += field.name.size() + field.value.size() + 4;
+        }
+    }
+    size += keep_blank_line ? 0 : 2;
+    scratch.clear();
+    scratch.reserve(size);
+
+    ::std::vector<::std::string_view> buffers;
+    buffers.reserve(this->headers.size() + 3);
+    // 追加一段，与上一段在内存中相邻时合并
+    auto append = [&buffers](::std::string_view piece) {
+        if (piece.empty()) {
+            return;
+        }
+        if (!buffers.empty() && buffers.back().data() + buffers.back().size() == piece.data()) {
+            buffers.back() = ::std::string_view(buffers.back().data(), buffers.back().size() + piece.size());
+        } else {
+            buffers.push_back(piece);
+        }
+    };
+    // 把一段数据写入 scratch 并追加
+    auto generate = [&scratch, &append](auto... parts) {
+        size_t offset = scratch.size();
+        (scratch.append(parts), ...);
+        append(::std::string_view(scratch).substr(offset));
+    };
+
+    if (keep_request_line) {
+        append(this->raw_request_line);
+    } else {
+        generate(::std::string_view(this->method), " ", ::std::string_view(this->url), " ", ::std::string_view(this->version), "\r\n");
+    }
+    for (size_t i = 0; i < this->headers.size(); ++i) {
+        HttpHeaders::Source source = this->headers.source(i);
+        if (source.size != 0) {
+            append(raw_data.substr(source.offset, source.size));
+        } else {
+            HttpHeaders::Field field = this->headers.field(i);
+            generate(field.name, ": ", field.value, "\r\n");
+        }
+    }
+    if (keep_blank_line) {
+        append(::std::string_view(this->body.data() - 2, 2));
+    } else {
+        generate("\r\n");
     }
-    str += "\r\n" + this->body;
-    return str;
+    append(this->body);
+    return buffers;
 }
\ No newline at end of file
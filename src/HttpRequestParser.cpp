@@ -0,0 +1,303 @@
+#include "../include/HttpRequestParser.h"
+#include "../include/simd_scan.h"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+// 可以出现在 token 中（HTTP 方法、头部字段名）的字符表
+static constexpr ::std::array<bool, 256> TOKEN_CHARS = [] {
+    ::std::array<bool, 256> table{};
+    for (int c = '0'; c <= '9'; ++c) table[c] = true;
+    for (int c = 'A'; c <= 'Z'; ++c) table[c] = table[c + 'a' - 'A'] = true;
+    for (char c : ::std::string_view("!#$%&'*+-.^_`|~")) table[static_cast<unsigned char>(c)] = true;
+    return table;
+}();
+
+// 判断字符串是否为非空的 token
+static bool is_token(::std::string_view str)
+{
+    return !str.empty() && ::std::all_of(str.begin(), str.end(), [](char c) { return TOKEN_CHARS[static_cast<unsigned char>(c)]; });
+}
+
+// 不区分大小写地比较两个字符串
+static bool iequals(::std::string_view a, ::std::string_view b)
+{
+    return a.size() == b.size() &&
+           ::std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return ::std::tolower(static_cast<unsigned char>(x)) == ::std::tolower(static_cast<unsigned char>(y)); });
+}
+
+// 解析请求，从上次停下的位置继续
+my::HttpRequestParser::Result my::HttpRequestParser::parse(::std::string_view data)
+{
+    data_ = data.data();
+    if (state_ == State::FAILED) {
+        return Result::FAILED;
+    }
+
+    // 逐行解析请求行和头部字段，行以 LF 结束（CR 可以省略）
+    // 请求行中查找空格和 LF，头部字段行中先查找冒号再查找 LF，每个字节只扫描一次
+    while (state_ == State::REQUEST_LINE || state_ == State::HEADER_LINE) {
+        ::std::string_view delims = state_ == State::REQUEST_LINE ? " \n" : colon_ == 0 ? ":\n" : "\n";
+        size_t pos = scan_pos_ + find_first_of(data.data() + scan_pos_, data.size() - scan_pos_, delims);
+        if (pos == data.size()) {
+            scan_pos_ = data.size();
+            if (data.size() > MAX_HEAD_SIZE) {
+                return fail(Error::HEAD_TOO_LARGE);
+            }
+            return Result::NEED_MORE;
+        }
+        if (pos + 1 > MAX_HEAD_SIZE) {
+            return fail(Error::HEAD_TOO_LARGE);
+        }
+        scan_pos_ = pos + 1;
+
+        if (data[pos] == ' ') {
+            if (space_count_ == 2) {
+                return fail(Error::BAD_REQUEST);
+            }
+            spaces_[space_count_++] = pos;
+            continue;
+        } else if (data[pos] == ':') {
+            colon_ = pos;
+            continue;
+        }
+
+        size_t begin = line_start_;
+        size_t end = pos;
+        line_start_ = pos + 1;
+        if (end > begin && data[end - 1] == '\r') {
+            --end;
+        }
+
+        if (state_ == State::REQUEST_LINE) {
+            // 忽略请求行之前的空行
+            if (begin == end && space_count_ == 0) {
+                continue;
+            }
+            if (!parse_request_line(begin, end)) {
+                return fail(Error::BAD_REQUEST);
+            }
+            request_line_ = {static_cast<uint32_t>(begin), static_cast<uint32_t>(line_start_ - begin)};
+            state_ = State::HEADER_LINE;
+        } else if (begin == end) {
+            // 空行表示头部结束，请求体的长度由 Content-Length 确定
+            // 请求体过长时在收到请求体之前就失败，不缓冲客户端声明的任意长度
+            if (has_transfer_encoding_) {
+                return fail(Error::NOT_IMPLEMENTED);
+            }
+            if (content_length_ > MAX_BODY_SIZE) {
+                return fail(Error::BODY_TOO_LARGE);
+            }
+            head_size_ = line_start_;
+            state_ = State::BODY;
+        } else if (field_count_ == MAX_HEADERS) {
+            return fail(Error::HEAD_TOO_LARGE);
+        } else if (!parse_header_line(begin, end)) {
+            return fail(Error::BAD_REQUEST);
+        } else {
+            fields_[field_count_ - 1].line = {static_cast<uint32_t>(begin), static_cast<uint32_t>(line_start_ - begin)};
+        }
+        colon_ = 0;
+    }
+
+    if (state_ == State::BODY) {
+        if (data.size() - head_size_ < content_length_) {
+            return Result::NEED_MORE;
+        }
+        state_ = State::COMPLETE;
+    }
+    return Result::COMPLETE;
+}
+
+// 重置状态以解析下一个请求
+void my::HttpRequestParser::reset()
+{
+    state_ = State::REQUEST_LINE;
+    error_ = Error::NONE;
+    data_ = nullptr;
+    line_start_ = 0;
+    scan_pos_ = 0;
+    space_count_ = 0;
+    colon_ = 0;
+    request_line_ = method_ = url_ = version_ = Span();
+    field_count_ = 0;
+    head_size_ = 0;
+    content_length_ = 0;
+    has_content_length_ = false;
+    has_transfer_encoding_ = false;
+}
+
+// 获取解析失败的原因
+my::HttpRequestParser::Error my::HttpRequestParser::error() const
+{
+    return error_;
+}
+
+// 获取解析失败原因的描述
+const char *my::HttpRequestParser::error_message() const
+{
+    switch (error_) {
+    case Error::NONE:
+        return "No error";
+    case Error::BAD_REQUEST:
+        return "Malformed request";
+    case Error::HEAD_TOO_LARGE:
+        return "Request head is too large";
+    case Error::NOT_IMPLEMENTED:
+        return "Transfer-Encoding in request is not supported";
+    case Error::BODY_TOO_LARGE:
+        return "Request body is too large";
+    }
+    return "Unknown error";
+}
+
+// 获取完整请求的长度，请求完整前为 0
+size_t my::HttpRequestParser::request_length() const
+{
+    return state_ == State::COMPLETE ? head_size_ + static_cast<size_t>(content_length_) : 0;
+}
+
+// 获取请求行
+::std::string_view my::HttpRequestParser::request_line() const
+{
+    return view(request_line_);
+}
+
+// 获取 HTTP 方法
+::std::string_view my::HttpRequestParser::method() const
+{
+    return view(method_);
+}
+
+// 获取请求的 URL
+::std::string_view my::HttpRequestParser::url() const
+{
+    return view(url_);
+}
+
+// 获取 HTTP 版本
+::std::string_view my::HttpRequestParser::version() const
+{
+    return view(version_);
+}
+
+// 获取头部字段的个数
+size_t my::HttpRequestParser::header_count() const
+{
+    return field_count_;
+}
+
+// 获取第 index 个头部字段
+my::HttpRequestParser::Header my::HttpRequestParser::header(size_t index) const
+{
+    return {view(fields_[index].name), view(fields_[index].value), view(fields_[index].line)};
+}
+
+// 不区分大小写地查找头部字段
+::std::string_view my::HttpRequestParser::find_header(::std::string_view name) const
+{
+    for (size_t i = 0; i < field_count_; ++i) {
+        if (iequals(view(fields_[i].name), name)) {
+            return view(fields_[i].value);
+        }
+    }
+    return {};
+}
+
+// 获取请求体
+::std::string_view my::HttpRequestParser::body() const
+{
+    if (state_ != State::COMPLETE) {
+        return {};
+    }
+    return {data_ + head_size_, static_cast<size_t>(content_length_)};
+}
+
+// 解析请求行: 方法 SP URL SP 版本，两个空格的位置已在扫描时找到
+bool my::HttpRequestParser::parse_request_line(size_t begin, size_t end)
+{
+    if (space_count_ != 2 || spaces_[1] >= end) {
+        return false;
+    }
+    ::std::string_view method(data_ + begin, spaces_[0] - begin);
+    ::std::string_view url(data_ + spaces_[0] + 1, spaces_[1] - spaces_[0] - 1);
+    ::std::string_view version(data_ + spaces_[1] + 1, end - spaces_[1] - 1);
+    if (!is_token(method) || url.empty() || ::std::any_of(url.begin(), url.end(), [](unsigned char c) { return c < ' ' || c == 0x7F; })) {
+        return false;
+    }
+    if (version.size() != 8 || version.substr(0, 5) != "HTTP/" || !::std::isdigit(static_cast<unsigned char>(version[5])) ||
+        version[6] != '.' || !::std::isdigit(static_cast<unsigned char>(version[7]))) {
+        return false;
+    }
+
+    method_ = {static_cast<uint32_t>(begin), static_cast<uint32_t>(method.size())};
+    url_ = {static_cast<uint32_t>(spaces_[0] + 1), static_cast<uint32_t>(url.size())};
+    version_ = {static_cast<uint32_t>(spaces_[1] + 1), static_cast<uint32_t>(version.size())};
+    return true;
+}
+
+// 解析一个头部字段行: 字段名 ":" OWS 字段值 OWS，冒号的位置已在扫描时找到
+// 字段名前后不能有空白（包括已废弃的折行），Content-Length 必须是一致的十进制数
+bool my::HttpRequestParser::parse_header_line(size_t begin, size_t end)
+{
+    ::std::string_view line(data_ + begin, end - begin);
+
+    if (colon_ == 0 || colon_ >= end) {
+        return false;
+    }
+    size_t colon = colon_ - begin;
+    if (!is_token(line.substr(0, colon))) {
+        return false;
+    }
+    size_t value_begin = colon + 1;
+    size_t value_end = line.size();
+    while (value_begin < value_end && (line[value_begin] == ' ' || line[value_begin] == '\t')) ++value_begin;
+    while (value_end > value_begin && (line[value_end - 1] == ' ' || line[value_end - 1] == '\t')) --value_end;
+
+    ::std::string_view name = line.substr(0, colon);
+    ::std::string_view value = line.substr(value_begin, value_end - value_begin);
+    if (iequals(name, "Content-Length")) {
+        if (value.empty()) {
+            return false;
+        }
+        uint64_t length = 0;
+        for (char c : value) {
+            if (!::std::isdigit(static_cast<unsigned char>(c)) || length > (::std::numeric_limits<uint64_t>::max() - 9) / 10) {
+                return false;
+            }
+            length = length * 10 + (c - '0');
+        }
+        if (has_content_length_ && length != content_length_) {
+            return false;
+        }
+        has_content_length_ = true;
+        content_length_ = length;
+    } else if (iequals(name, "Transfer-Encoding")) {
+        has_transfer_encoding_ = true;
+    }
+
+    fields_[field_count_++] = {
+        {static_cast<uint32_t>(begin), static_cast<uint32_t>(colon)},
+        {static_cast<uint32_t>(begin + value_begin), static_cast<uint32_t>(value.size())},
+        {},
+    };
+    return true;
+}
+
+// 解析失败，记录原因
+my::HttpRequestParser::Result my::HttpRequestParser::fail(Error error)
+{
+    state_ = State::FAILED;
+    error_ = error;
+    return Result::FAILED;
+}
+
+// 获取一段数据
+::std::string_view my::HttpRequestParser::view(Span span) const
+{
+    if (data_ == nullptr) {
+        return {};
+    }
+    return {data_ + span.offset, span.size};
+}
@@ -0,0 +1,310 @@
+#include "../include/HttpResponseFramer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+// 不区分大小写地比较两个字符串
+static bool iequals(::std::string_view a, ::std::string_view b)
+{
+    return a.size() == b.size() &&
+           ::std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return ::std::tolower(static_cast<unsigned char>(x)) == ::std::tolower(static_cast<unsigned char>(y)); });
+}
+
+// 去掉首尾的空白
+static ::std::string_view trim_ows(::std::string_view str)
+{
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) str.remove_prefix(1);
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) str.remove_suffix(1);
+    return str;
+}
+
+// 解析一个无符号整数，base 为 10 或 16，字符串为空、含有非数字字符或溢出时返回 false
+static bool parse_number(::std::string_view str, int base, uint64_t &value)
+{
+    if (str.empty()) {
+        return false;
+    }
+    value = 0;
+    for (char c : str) {
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (base == 16 && ::std::isxdigit(static_cast<unsigned char>(c))) {
+            digit = ::std::tolower(static_cast<unsigned char>(c)) - 'a' + 10;
+        } else {
+            return false;
+        }
+        if (value > (::std::numeric_limits<uint64_t>::max() - digit) / base) {
+            return false;
+        }
+        value = value * base + digit;
+    }
+    return true;
+}
+
+// 设置响应对应的请求方法
+void my::HttpResponseFramer::set_request_method(::std::string_view method)
+{
+    head_request_ = method == "HEAD";
+    connect_request_ = method == "CONNECT";
+}
+
+// 输入一段响应数据
+size_t my::HttpResponseFramer::feed(const char *data, size_t size)
+{
+    size_t pos = 0;
+    while (pos < size && state_ != State::COMPLETE) {
+        switch (state_) {
+        case State::HEAD: {
+            // 逐行查找头部结束的空行（CRLF 或 LF），只扫描新输入的数据
+            size_t old_size = line_.size();
+            line_.append(data + pos, ::std::min(size - pos, MAX_HEAD_SIZE + 1 - old_size));
+            size_t head_size = 0;
+            for (size_t end = line_.find('\n', old_size); end != ::std::string::npos; end = line_.find('\n', end + 1)) {
+                size_t length = end - head_line_start_;
+                if (length == 0 || (length == 1 && line_[head_line_start_] == '\r')) {
+                    head_size = end + 1;
+                    break;
+                }
+                head_line_start_ = end + 1;
+            }
+            if (head_size == 0) {
+                if (line_.size() > MAX_HEAD_SIZE) {
+                    throw ::std::runtime_error("Response head from server is too large");
+                }
+                pos += line_.size() - old_size;
+                break;
+            }
+            pos += head_size - old_size;
+            line_.resize(head_size);
+            begin_body();
+            line_.clear();
+            head_line_start_ = 0;
+            break;
+        }
+        case State::BODY_LENGTH:
+        case State::CHUNK_DATA: {
+            size_t n = static_cast<size_t>(::std::min<uint64_t>(remaining_, size - pos));
+            pos += n;
+            remaining_ -= n;
+            if (remaining_ == 0) {
+                state_ = state_ == State::BODY_LENGTH ? State::COMPLETE : State::CHUNK_DATA_END;
+            }
+            break;
+        }
+        case State::UNTIL_CLOSE:
+            pos = size;
+            break;
+        case State::CHUNK_SIZE:
+            if (read_line(data, size, pos)) {
+                // 忽略分块扩展，分块大小之后允许有空白
+                ::std::string_view hex = trim_ows(::std::string_view(line_).substr(0, line_.find(';')));
+                if (!parse_number(hex, 16, remaining_)) {
+                    throw ::std::runtime_error(::std::format("Invalid chunk size in response from server: {}", line_));
+                }
+                state_ = remaining_ == 0 ? State::TRAILER : State::CHUNK_DATA;
+                line_.clear();
+            }
+            break;
+        case State::CHUNK_DATA_END:
+            if (read_line(data, size, pos)) {
+                if (!line_.empty()) {
+                    throw ::std::runtime_error("Missing CRLF after chunk data in response from server");
+                }
+                state_ = State::CHUNK_SIZE;
+            }
+            break;
+        case State::TRAILER:
+            // 尾部字段以空行结束
+            if (read_line(data, size, pos)) {
+                if (line_.empty()) {
+                    state_ = State::COMPLETE;
+                }
+                line_.clear();
+            }
+            break;
+        case State::COMPLETE:
+            break;
+        }
+    }
+    return pos;
+}
+
+// 重置状态以分析下一个响应
+void my::HttpResponseFramer::reset()
+{
+    state_ = State::HEAD;
+    line_.clear();
+    head_line_start_ = 0;
+    head_ = HttpResponseHead();
+    remaining_ = 0;
+    keep_alive_ = false;
+    head_request_ = false;
+    connect_request_ = false;
+    interim_count_ = 0;
+}
+
+// 响应是否已完整
+bool my::HttpResponseFramer::is_complete() const
+{
+    return state_ == State::COMPLETE;
+}
+
+// 响应是否以关闭连接结束
+bool my::HttpResponseFramer::is_close_delimited() const
+{
+    return state_ == State::UNTIL_CLOSE;
+}
+
+// 响应头部是否已完整且响应体有明确的结束位置
+bool my::HttpResponseFramer::is_self_delimited() const
+{
+    return state_ != State::HEAD && state_ != State::UNTIL_CLOSE;
+}
+
+// 响应结束后连接是否可以复用
+bool my::HttpResponseFramer::is_keep_alive() const
+{
+    return state_ == State::COMPLETE && keep_alive_;
+}
+
+// 获取当前状态
+my::HttpResponseFramer::State my::HttpResponseFramer::state() const
+{
+    return state_;
+}
+
+// 获取已解析的（最终）响应头部
+const my::HttpResponseHead &my::HttpResponseFramer::head() const
+{
+    return head_;
+}
+
+// 获取最终响应之前的 1xx 临时响应数
+size_t my::HttpResponseFramer::interim_count() const
+{
+    return interim_count_;
+}
+
+// 响应头部接收完整后确定响应体的长度（RFC 9112 第 6.3 节）
+void my::HttpResponseFramer::begin_body()
+{
+    head_ = HttpResponseHead(line_.c_str(), static_cast<int>(line_.size()));
+    if (head_.status.size() != 3 || !::std::all_of(head_.status.begin(), head_.status.end(), [](char c) { return ::std::isdigit(static_cast<unsigned char>(c)); }) ||
+        head_.version.size() != 8 || head_.version.substr(0, 5) != "HTTP/") {
+        throw ::std::runtime_error(::std::format("Invalid status line in response from server: {} {}", head_.version, head_.status));
+    }
+
+    // HTTP/1.1 默认保持连接，HTTP/1.0 需要显式的 keep-alive
+    if (head_.version == "HTTP/1.1") {
+        keep_alive_ = !head_.headers.has_token("Connection", "close");
+    } else {
+        keep_alive_ = head_.headers.has_token("Connection", "keep-alive");
+    }
+
+    // 101 之后连接转为其他协议，数据直到关闭连接才结束；其他 1xx 临时响应之后还有最终响应
+    if (head_.status[0] == '1') {
+        if (head_.status == "101") {
+            state_ = State::UNTIL_CLOSE;
+            keep_alive_ = false;
+        } else {
+            ++interim_count_;
+            state_ = State::HEAD;
+        }
+        return;
+    }
+
+    // CONNECT 请求的 2xx 响应之后连接转为隧道
+    if (connect_request_ && head_.status[0] == '2') {
+        state_ = State::COMPLETE;
+        keep_alive_ = false;
+        return;
+    }
+
+    // HEAD 请求的响应以及 204 和 304 响应没有响应体，忽略其中的长度信息
+    if (head_request_ || head_.status == "204" || head_.status == "304") {
+        state_ = State::COMPLETE;
+        return;
+    }
+
+    determine_body();
+}
+
+// 确定响应体的编码方式和长度
+// Transfer-Encoding 优先于 Content-Length；最后一个传输编码不是 chunked 时响应体以关闭连接结束
+// 多个 Content-Length（或逗号分隔的多个值）必须一致
+void my::HttpResponseFramer::determine_body()
+{
+    ::std::string_view last_coding;
+    bool has_length = false;
+    uint64_t length = 0;
+    for (const auto &[name, value] : head_.headers) {
+        if (iequals(name, "Transfer-Encoding")) {
+            size_t comma = value.rfind(',');
+            ::std::string_view coding = trim_ows(comma == ::std::string_view::npos ? value : value.substr(comma + 1));
+            if (!coding.empty()) {
+                last_coding = coding;
+            }
+        } else if (iequals(name, "Content-Length")) {
+            ::std::string_view rest = value;
+            while (true) {
+                size_t comma = rest.find(',');
+                uint64_t number = 0;
+                if (!parse_number(trim_ows(rest.substr(0, comma)), 10, number) || (has_length && number != length)) {
+                    throw ::std::runtime_error(::std::format("Invalid Content-Length in response from server: {}", value));
+                }
+                has_length = true;
+                length = number;
+                if (comma == ::std::string_view::npos) {
+                    break;
+                }
+                rest.remove_prefix(comma + 1);
+            }
+        }
+    }
+
+    if (last_coding.data() != nullptr) {
+        if (iequals(last_coding, "chunked")) {
+            state_ = State::CHUNK_SIZE;
+        } else {
+            state_ = State::UNTIL_CLOSE;
+            keep_alive_ = false;
+        }
+        return;
+    }
+
+    if (has_length) {
+        remaining_ = length;
+        state_ = remaining_ == 0 ? State::COMPLETE : State::BODY_LENGTH;
+        return;
+    }
+
+    // 没有长度信息时响应体直到服务器关闭连接才结束，连接不能复用
+    state_ = State::UNTIL_CLOSE;
+    keep_alive_ = false;
+}
+
+// 从输入中读取一行到 line_（不含 CRLF），返回是否读到了完整的一行
+bool my::HttpResponseFramer::read_line(const char *data, size_t size, size_t &pos)
+{
+    const char *begin = data + pos;
+    const char *end = static_cast<const char *>(::std::memchr(begin, '\n', size - pos));
+    if (end == nullptr) {
+        line_.append(begin, size - pos);
+        pos = size;
+        if (line_.size() > MAX_HEAD_SIZE) {
+            throw ::std::runtime_error("Chunk line from server is too long");
+        }
+        return false;
+    }
+    line_.append(begin, end - begin);
+    pos = end - data + 1;
+    if (!line_.empty() && line_.back() == '\r') {
+        line_.pop_back();
+    }
+    return true;
+}
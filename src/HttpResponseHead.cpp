@@ -1,6 +1,5 @@
 #include "../include/HttpResponseHead.h"
-
-#include <cstring>
+#include "../include/simd_scan.h"
 
 // 构造函数，从原始 HTTP 数据初始化
 my::HttpResponseHead::HttpResponseHead(const char *http_data, int size)
@@ -8,45 +7,61 @@ my::HttpResponseHead::HttpResponseHead(const char *http_data, int size)
     this->set_all(http_data, size);
 }
 
-// 设置所有头部字段，从原始 HTTP 数据初始化
-void my::HttpResponseHead::set_all(const char *http_data, int size)
+// 去掉行尾的 CR
+static ::std::string_view trim_cr(::std::string_view line)
 {
-    const char *line_start = http_data; // 当前行的起始位置
-    const char *line_end;               // 当前行的结束位置
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    return line;
+}
 
-    // 解析状态行
-    line_end = strchr(line_start, '\n');                            // 查找行结束符
-    ::std::string_view line(line_start, line_end - line_start - 1); // 获取当前行
+// 去掉首尾的空白
+static ::std::string_view trim_ows(::std::string_view str)
+{
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) str.remove_prefix(1);
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) str.remove_suffix(1);
+    return str;
+}
 
-    // 解析 HTTP 版本
-    ::std::string_view version = line.substr(0, ::std::min(line.find(' '), line.find('\r')));
-    this->version = ::std::string(version);
-    line.remove_prefix(version.size() + 1);
+// 设置所有头部字段，从原始 HTTP 数据初始化
+// 空格、冒号和行结束符由向量化的 find_first_of 查找，每个字节只扫描一次
+void my::HttpResponseHead::set_all(const char *http_data, int size)
+{
+    ::std::string_view data(http_data, size);
+    auto find = [&](size_t from, ::std::string_view delims) {
+        return from >= data.size() ? data.size() : from + find_first_of(data.data() + from, data.size() - from, delims);
+    };
 
-    // 解析状态码
-    ::std::string_view status = line.substr(0, ::std::min(line.find(' '), line.find('\r')));
-    this->status = ::std::string(status);
-    line.remove_prefix(status.size() + 1);
+    // 解析状态行: HTTP 版本 SP 状态码 SP 状态消息
+    size_t version_end = find(0, " \n");
+    size_t status_end = version_end < data.size() && data[version_end] == ' ' ? find(version_end + 1, " \n") : version_end;
+    size_t line_end = status_end < data.size() && data[status_end] == ' ' ? find(status_end + 1, "\n") : status_end;
 
-    // 解析状态消息
-    this->message = ::std::string(line);
+    this->version = ::std::string(trim_cr(data.substr(0, version_end)));
+    if (status_end > version_end) {
+        this->status = ::std::string(trim_cr(data.substr(version_end + 1, status_end - version_end - 1)));
+    }
+    if (line_end > status_end) {
+        this->message = ::std::string(trim_cr(data.substr(status_end + 1, line_end - status_end - 1)));
+    }
 
-    line_start = line_end + 1; // 移动到下一行
+    // 解析头部字段: 先查找冒号再查找行结束符，空行表示头部结束
+    size_t line_start = line_end + 1;
+    while (line_start < data.size()) {
+        size_t colon = find(line_start, ":\n");
+        line_end = colon < data.size() && data[colon] == ':' ? find(colon + 1, "\n") : colon;
 
-    // 解析头部字段
-    while (!isspace(*line_start)) {
-        line_end = strchr(line_start, '\n');                            // 查找行结束符
-        ::std::string_view line(line_start, line_end - line_start - 1); // 获取当前行
+        ::std::string_view line = trim_cr(data.substr(line_start, line_end - line_start));
         if (line.empty()) {
             break; // 如果行为空，则结束解析
         }
-
-        // 解析头部字段名和值
-        ::std::string_view key = line.substr(0, line.find(':')); // 获取头部字段名
-        line.remove_prefix(key.size() + 2);
-        ::std::string_view value = line; // 获取头部字段值
-        this->headers[::std::string(key)] = ::std::string(value);
+        if (colon < line_end) {
+            ::std::string_view key = data.substr(line_start, colon - line_start);                       // 获取头部字段名
+            ::std::string_view value = trim_ows(trim_cr(data.substr(colon + 1, line_end - colon - 1))); // 获取头部字段值
+            this->headers.add(key, value);
+        }
 
         line_start = line_end + 1; // 移动到下一行
     }
-}
\ No newline at end of file
+}
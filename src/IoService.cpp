@@ -0,0 +1,950 @@
+#include "../include/IoService.h"
+#include "../include/format_log.hpp"
+#include "../include/wsa_wapper.h"
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+#include <mswsock.h>
+
+namespace
+{
+    constexpr ULONG_PTR IO_KEY = 0;     // 已提交的 I/O 操作完成
+    constexpr ULONG_PTR FAILED_KEY = 1; // 提交失败的 I/O 操作
+    constexpr ULONG_PTR TASK_KEY = 2;   // 投递的任务
+
+    constexpr uint64_t MAX_TRANSMIT_SIZE = 0x7FFFFFFE; // 一次 TransmitFile 最多发送的文件字节数
+
+    // 获取 Winsock 扩展函数（AcceptEx、ConnectEx）的指针
+    void *get_extension(SOCKET s, GUID guid)
+    {
+        void *function = nullptr;
+        DWORD size = 0;
+        if (WSAIoctl(s, SIO_GET_EXTENSION_FUNCTION_POINTER, &guid, sizeof(guid), &function, sizeof(function), &size, nullptr, nullptr) == SOCKET_ERROR) {
+            return nullptr;
+        }
+        return function;
+    }
+
+    // 构造指向一段数据的 WSABUF
+    WSABUF make_buffer(const char *data, size_t size)
+    {
+        WSABUF buffer;
+        buffer.buf = const_cast<char *>(data);
+        buffer.len = static_cast<ULONG>(size);
+        return buffer;
+    }
+
+    // 从第 first 个分段开始跳过已发送的 size 字节，只发送了一部分的分段调整为剩余的部分
+    // first 更新为第一个尚未发送完的分段，长度为 0 的分段视为已发送
+    void consume(::std::vector<WSABUF> &buffers, size_t &first, size_t size)
+    {
+        while (first < buffers.size() && (size > 0 || buffers[first].len == 0)) {
+            size_t consumed = ::std::min<size_t>(size, buffers[first].len);
+            buffers[first].buf += consumed;
+            buffers[first].len -= static_cast<ULONG>(consumed);
+            size -= consumed;
+            if (buffers[first].len == 0) {
+                ++first;
+            }
+        }
+    }
+} // namespace
+
+// 一个已提交的操作
+// overlapped 必须是第一个成员，完成通知中的 OVERLAPPED 指针即为操作的地址
+struct my::IoService::Operation {
+    // 操作类型
+    enum class Type {
+        ACCEPT,
+        CONNECT,
+        RECV,
+        SEND,
+        READ_FILE,
+        TRANSMIT_FILE,
+        TASK,
+    };
+
+    OVERLAPPED overlapped = {};                               // 重叠 I/O 结构
+    Type type;                                                // 操作类型
+    SOCKET socket = INVALID_SOCKET;                           // 操作的套接字（接受连接时为监听套接字）
+    SOCKET accept_socket = INVALID_SOCKET;                    // AcceptEx 预先创建的套接字
+    HANDLE file = INVALID_HANDLE_VALUE;                       // 读取的文件
+    ::std::string data;                                       // 接收、读取的缓冲或待发送的数据
+    ::std::vector<WSABUF> gather;                             // 待发送的分段，已发送的部分会被跳过
+    size_t done = 0;                                          // 已发送完的分段数（TransmitFile 为本次发送的文件字节数）
+    uint64_t offset = 0;                                      // TransmitFile 下一次发送的文件位置
+    uint64_t remaining = 0;                                   // TransmitFile 尚未发送的文件字节数
+    TRANSMIT_FILE_BUFFERS buffers = {};                       // TransmitFile 在文件数据之前发送的数据
+    int error_code = 0;                                       // 提交失败时的错误码
+    Handler handler;                                          // 发送、连接的回调
+    DataHandler data_handler;                                 // 接收、读取的回调
+    Task task;                                                // 投递的任务
+    char address_buffer[2 * (sizeof(SOCKADDR_IN) + 16)] = {}; // AcceptEx 的地址缓冲
+
+    // 构造函数
+    explicit Operation(Type type)
+        : type(type)
+    {
+    }
+};
+
+// 析构函数，关闭 I/O 服务
+my::IoService::~IoService()
+{
+    close();
+}
+
+// 打开 I/O 服务
+// 完成端口或 AcceptEx、ConnectEx 不可用时回退到 WSAPoll
+bool my::IoService::open(Backend backend)
+{
+    if (is_open_) {
+        return true;
+    }
+    wait_cnt_ = 0;
+    completion_cnt_ = 0;
+
+    if (backend == Backend::COMPLETION_PORT) {
+        port_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+        if (port_ != nullptr) {
+            SOCKET s = socket(AF_INET, SOCK_STREAM, 0);
+            if (s != INVALID_SOCKET) {
+                accept_ex_ = get_extension(s, WSAID_ACCEPTEX);
+                connect_ex_ = get_extension(s, WSAID_CONNECTEX);
+                closesocket(s);
+            }
+            if (accept_ex_ != nullptr && connect_ex_ != nullptr) {
+                backend_ = Backend::COMPLETION_PORT;
+                is_open_ = true;
+                return true;
+            }
+            CloseHandle(port_);
+            port_ = nullptr;
+        }
+        err("I/O completion port unavailable, falling back to WSAPoll. Error code: {}", GetLastError());
+    }
+
+    if (!event_loop_.open()) {
+        return false;
+    }
+    backend_ = Backend::POLL;
+    is_open_ = true;
+    return true;
+}
+
+// 关闭 I/O 服务
+// 先取消仍在接受连接的监听套接字，再等待已取消的操作完成，它们的回调仍会被调用
+void my::IoService::close()
+{
+    if (!is_open_) {
+        return;
+    }
+    ::std::vector<SOCKET> listeners;
+    for (const auto &[s, handler] : acceptors_) {
+        listeners.push_back(s);
+    }
+    for (SOCKET s : listeners) {
+        cancel(s);
+    }
+
+    if (backend_ == Backend::COMPLETION_PORT) {
+        // 取消后的完成通知很快到达，长时间没有进展时放弃等待
+        for (int idle = 0; outstanding_ > 0 && idle < 10;) {
+            int count = run_once(100);
+            if (count == SOCKET_ERROR) {
+                break;
+            }
+            idle = count == 0 ? idle + 1 : 0;
+        }
+        while (run_once(0) > 0) {
+        }
+        CloseHandle(port_);
+        port_ = nullptr;
+    } else {
+        ::std::vector<SOCKET> sockets;
+        for (const auto &[s, poll] : polls_) {
+            sockets.push_back(s);
+        }
+        for (SOCKET s : sockets) {
+            poll_cancel(s);
+        }
+        while (!deferred_.empty()) {
+            run_once(0);
+        }
+        event_loop_.close();
+    }
+    is_open_ = false;
+}
+
+// 获取实际使用的后端
+my::IoService::Backend my::IoService::backend() const
+{
+    return backend_;
+}
+
+// 获取后端名称
+const char *my::IoService::backend_name() const
+{
+    return backend_ == Backend::COMPLETION_PORT ? "IOCP" : "WSAPoll";
+}
+
+// 把套接字加入 I/O 服务
+// 两种后端都把套接字设置为非阻塞模式，就绪后的读取不会阻塞（重叠操作不受影响）
+// 完成端口后端：已关联过的套接字（如从连接池取出的连接）再次关联会失败，可以忽略
+// POLL 后端：有未完成的操作时才注册到事件循环
+void my::IoService::associate(SOCKET s)
+{
+    set_nonblocking(s, true);
+    if (backend_ == Backend::COMPLETION_PORT) {
+        CreateIoCompletionPort(reinterpret_cast<HANDLE>(s), port_, IO_KEY, 0);
+    }
+}
+
+// 把以 FILE_FLAG_OVERLAPPED 打开的文件加入 I/O 服务，POLL 后端同步读取文件，无需关联
+void my::IoService::associate(HANDLE file)
+{
+    if (backend_ == Backend::COMPLETION_PORT) {
+        CreateIoCompletionPort(file, port_, IO_KEY, 0);
+    }
+}
+
+// 把套接字移出 I/O 服务但不关闭
+// 完成端口无法解除关联，套接字之后仍可用于同步操作或再次关联到同一个完成端口
+void my::IoService::release(SOCKET s)
+{
+    if (backend_ == Backend::POLL) {
+        poll_cancel(s);
+    }
+}
+
+// 取消套接字上所有未完成的操作并关闭套接字
+void my::IoService::close(SOCKET s)
+{
+    cancel(s);
+    closesocket(s);
+}
+
+// 取消套接字上所有未完成的操作
+void my::IoService::cancel(SOCKET s)
+{
+    acceptors_.erase(s);
+    if (backend_ == Backend::COMPLETION_PORT) {
+        CancelIoEx(reinterpret_cast<HANDLE>(s), nullptr);
+    } else {
+        poll_cancel(s);
+    }
+}
+
+// 在监听套接字上持续接受连接
+// 完成端口后端始终保持 ACCEPT_DEPTH 个 AcceptEx 未完成，连接到达时无需等待下一次提交
+void my::IoService::accept(SOCKET listen_socket, AcceptHandler handler)
+{
+    acceptors_[listen_socket] = handler;
+    associate(listen_socket);
+    if (backend_ == Backend::COMPLETION_PORT) {
+        for (int i = 0; i < ACCEPT_DEPTH; ++i) {
+            post_accept(listen_socket, new Operation(Operation::Type::ACCEPT));
+        }
+    } else {
+        poll_socket(listen_socket).accept = ::std::move(handler);
+        poll_progress(listen_socket, EventLoop::READ);
+    }
+}
+
+// 以非阻塞方式连接到服务器
+// ConnectEx 要求套接字已绑定，因此先绑定到任意地址
+void my::IoService::connect(SOCKET s, const char *ip, unsigned short port, Handler handler)
+{
+    SOCKADDR_IN addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr(ip);
+
+    if (backend_ == Backend::COMPLETION_PORT) {
+        auto op = new Operation(Operation::Type::CONNECT);
+        op->socket = s;
+        op->handler = ::std::move(handler);
+        outstanding_++;
+
+        SOCKADDR_IN local = {};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = INADDR_ANY;
+        local.sin_port = 0;
+        if (bind(s, reinterpret_cast<SOCKADDR *>(&local), sizeof(local)) == SOCKET_ERROR) {
+            fail(op, WSAGetLastError());
+            return;
+        }
+        auto connect_ex = reinterpret_cast<LPFN_CONNECTEX>(connect_ex_);
+        if (!connect_ex(s, reinterpret_cast<SOCKADDR *>(&addr), sizeof(addr), nullptr, 0, nullptr, &op->overlapped) &&
+            WSAGetLastError() != ERROR_IO_PENDING) {
+            fail(op, WSAGetLastError());
+        }
+        return;
+    }
+
+    if (::connect(s, reinterpret_cast<SOCKADDR *>(&addr), sizeof(addr)) == SOCKET_ERROR) {
+        int error_code = WSAGetLastError();
+        if (is_would_block(error_code)) {
+            poll_socket(s).connect = ::std::move(handler);
+            poll_update(s);
+        } else {
+            defer([handler = ::std::move(handler), error_code]() { handler(error_code); });
+        }
+        return;
+    }
+    defer([handler = ::std::move(handler)]() { handler(0); });
+}
+
+// 接收一次数据
+// 两种后端都在套接字可读后才从缓冲池中取出缓冲，等待期间不占用缓冲：
+// POLL 后端等待 WSAPoll 报告可读，完成端口后端等待零字节的 WSARecv 完成
+void my::IoService::recv(SOCKET s, DataHandler handler)
+{
+    if (backend_ == Backend::COMPLETION_PORT) {
+        auto op = new Operation(Operation::Type::RECV);
+        op->socket = s;
+        op->data_handler = ::std::move(handler);
+        post_recv(op);
+        return;
+    }
+
+    poll_socket(s).recv = ::std::move(handler);
+    poll_progress(s, EventLoop::READ);
+}
+
+// 发送全部数据
+void my::IoService::send(SOCKET s, ::std::string data, Handler handler)
+{
+    start_send(s, ::std::move(data), {}, ::std::move(handler));
+}
+
+// 依次发送全部分段，空的分段被忽略
+void my::IoService::send(SOCKET s, ::std::vector<::std::string_view> buffers, Handler handler)
+{
+    ::std::vector<WSABUF> gather;
+    gather.reserve(buffers.size());
+    for (::std::string_view buffer : buffers) {
+        if (!buffer.empty()) {
+            gather.push_back(make_buffer(buffer.data(), buffer.size()));
+        }
+    }
+    start_send(s, ::std::string(), ::std::move(gather), ::std::move(handler));
+}
+
+// 从文件的指定位置读取一块数据
+// POLL 后端同步读取：缓存文件通常已在系统缓存中，读取不会长时间阻塞
+void my::IoService::read_file(HANDLE file, uint64_t offset, DataHandler handler)
+{
+    auto op = new Operation(Operation::Type::READ_FILE);
+    op->file = file;
+    op->data = take_buffer();
+    op->data_handler = ::std::move(handler);
+    op->overlapped.Offset = static_cast<DWORD>(offset);
+    op->overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+    if (backend_ == Backend::COMPLETION_PORT) {
+        outstanding_++;
+        if (!ReadFile(file, op->data.data(), static_cast<DWORD>(op->data.size()), nullptr, &op->overlapped) && GetLastError() != ERROR_IO_PENDING) {
+            fail(op, GetLastError());
+        }
+        return;
+    }
+
+    ::std::unique_ptr<Operation> owner(op);
+    DWORD read_size = 0;
+    int error_code = 0;
+    if (!ReadFile(file, op->data.data(), static_cast<DWORD>(op->data.size()), &read_size, &op->overlapped)) {
+        error_code = GetLastError();
+        // 以 FILE_FLAG_OVERLAPPED 打开的文件需要等待读取完成
+        if (error_code == ERROR_IO_PENDING) {
+            error_code = GetOverlappedResult(file, &op->overlapped, &read_size, TRUE) ? 0 : GetLastError();
+        }
+        if (error_code == ERROR_HANDLE_EOF) {
+            error_code = 0;
+            read_size = 0;
+        }
+    }
+    op->data.resize(error_code == 0 ? read_size : 0);
+    defer([handler = ::std::move(op->data_handler), data = ::std::move(op->data), error_code]() mutable {
+        handler(::std::move(data), error_code);
+    });
+}
+
+// 先发送 head，再把文件的一段发送到套接字
+// 完成端口后端使用重叠 TransmitFile，文件数据不经过用户态缓冲
+void my::IoService::transmit_file(SOCKET s, HANDLE file, uint64_t offset, uint64_t size, ::std::string head, Handler handler)
+{
+    if (backend_ == Backend::POLL) {
+        poll_transmit(s, file, offset, size, ::std::move(head), ::std::move(handler));
+        return;
+    }
+    // TransmitFile 的发送字节数为 0 表示发送整个文件，因此没有文件数据时只发送 head
+    if (size == 0) {
+        send(s, ::std::move(head), ::std::move(handler));
+        return;
+    }
+
+    auto op = new Operation(Operation::Type::TRANSMIT_FILE);
+    op->socket = s;
+    op->file = file;
+    op->data = ::std::move(head);
+    op->offset = offset;
+    op->remaining = size;
+    op->handler = ::std::move(handler);
+    post_transmit(op);
+}
+
+// 协程中等待连接完成
+my::IoService::Awaiter my::IoService::async_connect(SOCKET s, ::std::string ip, unsigned short port)
+{
+    return Awaiter([this, s, ip = ::std::move(ip), port](Awaiter::Callback done) {
+        connect(s, ip.c_str(), port, [done = ::std::move(done)](int error_code) { done({::std::string(), error_code}); });
+    });
+}
+
+// 协程中等待接收一次数据，数据为空且无错误表示对方已关闭连接
+my::IoService::Awaiter my::IoService::async_recv(SOCKET s)
+{
+    return Awaiter([this, s](Awaiter::Callback done) {
+        recv(s, [done = ::std::move(done)](::std::string data, int error_code) { done({::std::move(data), error_code}); });
+    });
+}
+
+// 协程中等待全部数据发送完
+my::IoService::Awaiter my::IoService::async_send(SOCKET s, ::std::string data)
+{
+    return Awaiter([this, s, data = ::std::move(data)](Awaiter::Callback done) mutable {
+        send(s, ::std::move(data), [done = ::std::move(done)](int error_code) { done({::std::string(), error_code}); });
+    });
+}
+
+// 协程中等待全部分段发送完
+my::IoService::Awaiter my::IoService::async_send(SOCKET s, ::std::vector<::std::string_view> buffers)
+{
+    return Awaiter([this, s, buffers = ::std::move(buffers)](Awaiter::Callback done) mutable {
+        send(s, ::std::move(buffers), [done = ::std::move(done)](int error_code) { done({::std::string(), error_code}); });
+    });
+}
+
+// 协程中等待读取一块文件数据，数据为空且无错误表示已到文件末尾
+my::IoService::Awaiter my::IoService::async_read_file(HANDLE file, uint64_t offset)
+{
+    return Awaiter([this, file, offset](Awaiter::Callback done) {
+        read_file(file, offset, [done = ::std::move(done)](::std::string data, int error_code) { done({::std::move(data), error_code}); });
+    });
+}
+
+// 协程中等待文件发送完
+my::IoService::Awaiter my::IoService::async_transmit_file(SOCKET s, HANDLE file, uint64_t offset, uint64_t size, ::std::string head)
+{
+    return Awaiter([this, s, file, offset, size, head = ::std::move(head)](Awaiter::Callback done) mutable {
+        transmit_file(s, file, offset, size, ::std::move(head), [done = ::std::move(done)](int error_code) { done({::std::string(), error_code}); });
+    });
+}
+
+// 从任意线程投递任务
+void my::IoService::post(Task task)
+{
+    if (backend_ == Backend::COMPLETION_PORT) {
+        auto op = new Operation(Operation::Type::TASK);
+        op->task = ::std::move(task);
+        if (!PostQueuedCompletionStatus(port_, 0, TASK_KEY, &op->overlapped)) {
+            delete op; // I/O 服务已关闭
+        }
+    } else {
+        event_loop_.post(::std::move(task));
+    }
+}
+
+// 等待并分发一批完成通知
+// 完成端口后端一次 GetQueuedCompletionStatusEx 最多取出 BATCH_SIZE 个完成通知
+// POLL 后端在一次 WSAPoll 之后调用本轮完成的所有操作的回调
+int my::IoService::run_once(int timeout_ms)
+{
+    timeout_ms = resume_accepts(timeout_ms);
+    wait_cnt_++;
+    if (backend_ == Backend::COMPLETION_PORT) {
+        OVERLAPPED_ENTRY entries[BATCH_SIZE];
+        ULONG count = 0;
+        if (!GetQueuedCompletionStatusEx(port_, entries, BATCH_SIZE, &count, static_cast<DWORD>(timeout_ms), FALSE)) {
+            return GetLastError() == WAIT_TIMEOUT ? 0 : SOCKET_ERROR;
+        }
+        for (ULONG i = 0; i < count; ++i) {
+            auto op = reinterpret_cast<Operation *>(entries[i].lpOverlapped);
+            if (entries[i].lpCompletionKey != TASK_KEY) {
+                outstanding_--;
+            }
+            // 只有提交失败的操作带有错误码，重复投递的操作需清除上一次的错误码
+            if (entries[i].lpCompletionKey != FAILED_KEY) {
+                op->error_code = 0;
+            }
+            complete(op);
+        }
+        completion_cnt_ += count;
+        return static_cast<int>(count);
+    }
+
+    int ready = event_loop_.run_once(deferred_.empty() ? timeout_ms : 0);
+    if (ready == SOCKET_ERROR) {
+        return SOCKET_ERROR;
+    }
+    ::std::vector<Task> tasks;
+    tasks.swap(deferred_);
+    for (auto &task : tasks) {
+        task();
+    }
+    completion_cnt_ += tasks.size();
+    return static_cast<int>(tasks.size());
+}
+
+// 从缓冲池中取出一个缓冲
+::std::string my::IoService::take_buffer()
+{
+    if (buffers_.empty()) {
+        return ::std::string(BUFFER_SIZE, '\0');
+    }
+    ::std::string buffer = ::std::move(buffers_.back());
+    buffers_.pop_back();
+    buffer.resize(BUFFER_SIZE);
+    return buffer;
+}
+
+// 把不再使用的缓冲放回缓冲池，容量不足一个缓冲的字符串直接释放
+void my::IoService::give_buffer(::std::string buffer)
+{
+    if (buffer.capacity() >= BUFFER_SIZE && buffers_.size() < MAX_POOLED) {
+        buffers_.push_back(::std::move(buffer));
+    }
+}
+
+// 获取等待完成通知的次数
+size_t my::IoService::wait_count() const
+{
+    return wait_cnt_;
+}
+
+// 获取已分发的完成通知数
+size_t my::IoService::completion_count() const
+{
+    return completion_cnt_;
+}
+
+// 完成端口后端：投递一个 AcceptEx
+void my::IoService::post_accept(SOCKET listen_socket, Operation *op)
+{
+    op->overlapped = {};
+    op->socket = listen_socket;
+    op->accept_socket = socket(AF_INET, SOCK_STREAM, 0);
+    outstanding_++;
+    if (op->accept_socket == INVALID_SOCKET) {
+        fail(op, WSAGetLastError());
+        return;
+    }
+
+    auto accept_ex = reinterpret_cast<LPFN_ACCEPTEX>(accept_ex_);
+    DWORD received = 0;
+    if (!accept_ex(listen_socket, op->accept_socket, op->address_buffer, 0, sizeof(SOCKADDR_IN) + 16, sizeof(SOCKADDR_IN) + 16, &received, &op->overlapped) &&
+        WSAGetLastError() != ERROR_IO_PENDING) {
+        fail(op, WSAGetLastError());
+    }
+}
+
+// 完成端口后端：投递一个零字节的 WSARecv
+// 有数据到达或对端关闭时完成，不消耗任何数据
+void my::IoService::post_recv(Operation *op)
+{
+    op->overlapped = {};
+    outstanding_++;
+    WSABUF buf;
+    buf.buf = nullptr;
+    buf.len = 0;
+    DWORD flags = 0;
+    if (WSARecv(op->socket, &buf, 1, nullptr, &flags, &op->overlapped, nullptr) == SOCKET_ERROR && WSAGetLastError() != WSA_IO_PENDING) {
+        fail(op, WSAGetLastError());
+    }
+}
+
+// 开始发送，gather 为空时发送整个 data
+// data 移动到最终的位置后才构造指向它的分段（短字符串的数据在移动时会改变位置）
+void my::IoService::start_send(SOCKET s, ::std::string data, ::std::vector<WSABUF> gather, Handler handler)
+{
+    if (backend_ == Backend::COMPLETION_PORT) {
+        auto op = new Operation(Operation::Type::SEND);
+        op->socket = s;
+        op->data = ::std::move(data);
+        op->gather = ::std::move(gather);
+        if (op->gather.empty()) {
+            op->gather.push_back(make_buffer(op->data.data(), op->data.size()));
+        }
+        op->handler = ::std::move(handler);
+        post_send(op);
+        return;
+    }
+
+    PollSocket &poll = poll_socket(s);
+    poll.send = ::std::move(handler);
+    poll.send_data = ::std::move(data);
+    poll.send_buffers = ::std::move(gather);
+    if (poll.send_buffers.empty()) {
+        poll.send_buffers.push_back(make_buffer(poll.send_data.data(), poll.send_data.size()));
+    }
+    poll.send_done = 0;
+    poll_progress(s, EventLoop::WRITE);
+}
+
+// 完成端口后端：投递一个 WSASend，一次提交所有尚未发送完的分段
+void my::IoService::post_send(Operation *op)
+{
+    op->overlapped = {};
+    outstanding_++;
+    if (WSASend(op->socket, op->gather.data() + op->done, static_cast<DWORD>(op->gather.size() - op->done), nullptr, 0, &op->overlapped, nullptr) == SOCKET_ERROR &&
+        WSAGetLastError() != WSA_IO_PENDING) {
+        fail(op, WSAGetLastError());
+    }
+}
+
+// 完成端口后端：投递一个 TransmitFile
+// 单次 TransmitFile 的发送字节数有上限，更大的文件在完成后继续投递，head 只随第一次发送
+void my::IoService::post_transmit(Operation *op)
+{
+    op->overlapped = {};
+    op->overlapped.Offset = static_cast<DWORD>(op->offset);
+    op->overlapped.OffsetHigh = static_cast<DWORD>(op->offset >> 32);
+    op->done = static_cast<size_t>(::std::min(op->remaining, MAX_TRANSMIT_SIZE));
+    op->buffers.Head = op->data.data();
+    op->buffers.HeadLength = static_cast<DWORD>(op->data.size());
+    outstanding_++;
+    if (!TransmitFile(op->socket, op->file, static_cast<DWORD>(op->done), 0, &op->overlapped, op->data.empty() ? nullptr : &op->buffers, 0) &&
+        WSAGetLastError() != WSA_IO_PENDING) {
+        fail(op, WSAGetLastError());
+    }
+}
+
+// 完成端口后端：提交失败的操作不会产生完成通知，把失败作为完成通知排队，使回调总在 run_once 中被调用
+void my::IoService::fail(Operation *op, int error_code)
+{
+    op->error_code = error_code;
+    PostQueuedCompletionStatus(port_, 0, FAILED_KEY, &op->overlapped);
+}
+
+// 完成端口后端：处理一个完成通知
+void my::IoService::complete(Operation *op)
+{
+    ::std::unique_ptr<Operation> owner(op);
+    if (op->type == Operation::Type::TASK) {
+        op->task();
+        return;
+    }
+
+    // 获取操作的结果，文件读取到末尾不视为错误
+    DWORD size = 0;
+    int error_code = op->error_code;
+    if (error_code == 0) {
+        DWORD flags = 0;
+        if (op->type == Operation::Type::READ_FILE) {
+            if (!GetOverlappedResult(op->file, &op->overlapped, &size, FALSE)) {
+                error_code = GetLastError() == ERROR_HANDLE_EOF ? 0 : GetLastError();
+            }
+        } else if (!WSAGetOverlappedResult(op->socket, &op->overlapped, &size, FALSE, &flags)) {
+            error_code = WSAGetLastError();
+        }
+    }
+
+    switch (op->type) {
+    case Operation::Type::ACCEPT: {
+        auto it = acceptors_.find(op->socket);
+        if (error_code == 0) {
+            setsockopt(op->accept_socket, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT, reinterpret_cast<char *>(&op->socket), sizeof(op->socket));
+        }
+        if (it == acceptors_.end() || error_code != 0) {
+            closesocket(op->accept_socket);
+        }
+        if (it == acceptors_.end()) {
+            return; // 已取消，不再投递
+        }
+        AcceptHandler handler = it->second;
+        handler(error_code == 0 ? op->accept_socket : INVALID_SOCKET, error_code);
+        // 失败的 AcceptEx（如套接字耗尽）稍后再投递，错误持续时立即重新投递只会使事件循环空转，其余的 AcceptEx 照常接受连接
+        if (acceptors_.contains(op->socket)) {
+            if (error_code != 0) {
+                delay_accept(op->socket);
+            } else {
+                post_accept(op->socket, owner.release());
+            }
+        }
+        break;
+    }
+    case Operation::Type::CONNECT:
+        if (error_code == 0) {
+            setsockopt(op->socket, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, nullptr, 0);
+        }
+        op->handler(error_code);
+        break;
+    case Operation::Type::SEND:
+        consume(op->gather, op->done, size);
+        // 流式套接字上的 WSASend 通常一次完成，只发送了一部分时继续发送剩余的分段
+        if (error_code == 0 && size > 0 && op->done < op->gather.size()) {
+            post_send(owner.release());
+            return;
+        }
+        give_buffer(::std::move(op->data));
+        op->handler(error_code);
+        break;
+    case Operation::Type::TRANSMIT_FILE:
+        op->offset += op->done;
+        op->remaining -= op->done;
+        if (error_code == 0 && op->remaining > 0) {
+            op->data.clear();
+            post_transmit(owner.release());
+            return;
+        }
+        op->handler(error_code);
+        break;
+    case Operation::Type::RECV:
+        // 零字节的 WSARecv 完成表示套接字可读，此时才取出缓冲以非阻塞方式读取，与 POLL 后端相同
+        // 数据已被读走（不应发生）时重新等待
+        if (error_code == 0) {
+            op->data = take_buffer();
+            int recv_size = ::recv(op->socket, op->data.data(), static_cast<int>(op->data.size()), 0);
+            error_code = recv_size == SOCKET_ERROR ? WSAGetLastError() : 0;
+            if (recv_size == SOCKET_ERROR && is_would_block(error_code)) {
+                give_buffer(::std::move(op->data));
+                op->data.clear();
+                post_recv(owner.release());
+                return;
+            }
+            op->data.resize(recv_size == SOCKET_ERROR ? 0 : recv_size);
+        }
+        op->data_handler(::std::move(op->data), error_code);
+        break;
+    case Operation::Type::READ_FILE:
+        if (error_code != 0) {
+            give_buffer(::std::move(op->data));
+            op->data.clear();
+        } else {
+            op->data.resize(size);
+        }
+        op->data_handler(::std::move(op->data), error_code);
+        break;
+    default:
+        break;
+    }
+}
+
+// POLL 后端：获取套接字的操作状态
+my::IoService::PollSocket &my::IoService::poll_socket(SOCKET s)
+{
+    auto &poll = polls_[s];
+    if (!poll) {
+        poll = ::std::make_unique<PollSocket>();
+    }
+    return *poll;
+}
+
+// POLL 后端：尝试以非阻塞方式推进套接字上的操作，完成的操作的回调排队到本轮等待结束后调用
+void my::IoService::poll_progress(SOCKET s, short revents)
+{
+    auto it = polls_.find(s);
+    if (it == polls_.end()) {
+        return;
+    }
+    PollSocket &poll = *it->second;
+    constexpr short FAILED = POLLERR | POLLHUP;
+
+    if (poll.accept && (revents & (EventLoop::READ | FAILED))) {
+        while (true) {
+            SOCKET client = ::accept(s, nullptr, nullptr);
+            if (client == INVALID_SOCKET) {
+                int error_code = WSAGetLastError();
+                if (!is_would_block(error_code)) {
+                    // 监听套接字在错误（如套接字耗尽）持续期间一直可读，暂停接受以免 WSAPoll 反复报告
+                    defer([handler = poll.accept, error_code]() { handler(INVALID_SOCKET, error_code); });
+                    poll.accept = nullptr;
+                    delay_accept(s);
+                }
+                break;
+            }
+            defer([handler = poll.accept, client]() { handler(client, 0); });
+        }
+    }
+
+    // 连接失败时 WSAPoll 只报告 POLLERR 或 POLLHUP
+    if (poll.connect && (revents & (EventLoop::WRITE | FAILED))) {
+        int error_code = 0;
+        int len = sizeof(error_code);
+        if (getsockopt(s, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&error_code), &len) == SOCKET_ERROR) {
+            error_code = WSAGetLastError();
+        }
+        defer([handler = ::std::move(poll.connect), error_code]() { handler(error_code); });
+        poll.connect = nullptr;
+    }
+
+    if (poll.recv && (revents & (EventLoop::READ | FAILED))) {
+        ::std::string buffer = take_buffer();
+        int recv_size = ::recv(s, buffer.data(), static_cast<int>(buffer.size()), 0);
+        int error_code = recv_size == SOCKET_ERROR ? WSAGetLastError() : 0;
+        if (recv_size == SOCKET_ERROR && is_would_block(error_code)) {
+            give_buffer(::std::move(buffer));
+        } else {
+            buffer.resize(recv_size == SOCKET_ERROR ? 0 : recv_size);
+            defer([handler = ::std::move(poll.recv), buffer = ::std::move(buffer), error_code]() mutable {
+                handler(::std::move(buffer), error_code);
+            });
+            poll.recv = nullptr;
+        }
+    }
+
+    // 非阻塞套接字上不带 OVERLAPPED 的 WSASend 一次发送尽可能多的分段，发送缓冲已满时等待下一次可写
+    if (poll.send && (revents & (EventLoop::WRITE | FAILED))) {
+        int error_code = 0;
+        while (poll.send_done < poll.send_buffers.size()) {
+            DWORD sent_size = 0;
+            if (WSASend(s, poll.send_buffers.data() + poll.send_done, static_cast<DWORD>(poll.send_buffers.size() - poll.send_done), &sent_size, 0, nullptr, nullptr) == SOCKET_ERROR) {
+                error_code = WSAGetLastError();
+                break;
+            }
+            consume(poll.send_buffers, poll.send_done, sent_size);
+        }
+        if (error_code == 0 || !is_would_block(error_code)) {
+            give_buffer(::std::move(poll.send_data));
+            poll.send_data.clear();
+            poll.send_buffers.clear();
+            defer([handler = ::std::move(poll.send), error_code]() { handler(error_code); });
+            poll.send = nullptr;
+        }
+    }
+
+    poll_update(s);
+}
+
+// POLL 后端：根据未完成的操作更新关注的事件，没有未完成的操作时注销，避免对端关闭后 WSAPoll 反复报告
+void my::IoService::poll_update(SOCKET s)
+{
+    auto it = polls_.find(s);
+    if (it == polls_.end()) {
+        return;
+    }
+    const PollSocket &poll = *it->second;
+    short events = 0;
+    if (poll.accept || poll.recv) {
+        events |= EventLoop::READ;
+    }
+    if (poll.connect || poll.send) {
+        events |= EventLoop::WRITE;
+    }
+
+    if (events == 0) {
+        if (event_loop_.contains(s)) {
+            event_loop_.remove(s);
+        }
+        polls_.erase(it);
+    } else if (event_loop_.contains(s)) {
+        event_loop_.modify(s, events);
+    } else {
+        event_loop_.add(s, events, [this, s](short revents) { poll_progress(s, revents); });
+    }
+}
+
+// POLL 后端：取消套接字上所有未完成的操作，被取消的操作以 WSA_OPERATION_ABORTED 完成
+void my::IoService::poll_cancel(SOCKET s)
+{
+    auto it = polls_.find(s);
+    if (it == polls_.end()) {
+        return;
+    }
+    PollSocket &poll = *it->second;
+    if (poll.connect) {
+        defer([handler = ::std::move(poll.connect)]() { handler(WSA_OPERATION_ABORTED); });
+    }
+    if (poll.recv) {
+        defer([handler = ::std::move(poll.recv)]() { handler(::std::string(), WSA_OPERATION_ABORTED); });
+    }
+    if (poll.send) {
+        defer([handler = ::std::move(poll.send)]() { handler(WSA_OPERATION_ABORTED); });
+    }
+    if (event_loop_.contains(s)) {
+        event_loop_.remove(s);
+    }
+    polls_.erase(it);
+}
+
+// 暂停在监听套接字上接受连接
+// 完成端口后端中失败的 AcceptEx 不再投递，POLL 后端中不再关注监听套接字的可读事件
+void my::IoService::delay_accept(SOCKET listen_socket)
+{
+    if (accept_retries_.empty()) {
+        accept_retry_at_ = ::std::chrono::steady_clock::now() + ::std::chrono::milliseconds(ACCEPT_RETRY_MS);
+    }
+    accept_retries_.push_back(listen_socket);
+}
+
+// 恢复到期的暂停接受的监听套接字，已取消的监听套接字不再恢复
+int my::IoService::resume_accepts(int timeout_ms)
+{
+    if (accept_retries_.empty()) {
+        return timeout_ms;
+    }
+    auto now = ::std::chrono::steady_clock::now();
+    if (now < accept_retry_at_) {
+        auto remaining = ::std::chrono::ceil<::std::chrono::milliseconds>(accept_retry_at_ - now).count();
+        return timeout_ms < 0 ? static_cast<int>(remaining) : static_cast<int>(::std::min<long long>(timeout_ms, remaining));
+    }
+    ::std::vector<SOCKET> retries;
+    retries.swap(accept_retries_);
+    for (SOCKET s : retries) {
+        auto it = acceptors_.find(s);
+        if (it == acceptors_.end()) {
+            continue;
+        }
+        if (backend_ == Backend::COMPLETION_PORT) {
+            post_accept(s, new Operation(Operation::Type::ACCEPT));
+        } else {
+            poll_socket(s).accept = it->second;
+            poll_progress(s, EventLoop::READ);
+        }
+    }
+    return timeout_ms;
+}
+
+// POLL 后端：逐块读取文件并发送，每块发送完后再读取下一块
+void my::IoService::poll_transmit(SOCKET s, HANDLE file, uint64_t offset, uint64_t size, ::std::string head, Handler handler)
+{
+    if (!head.empty()) {
+        send(s, ::std::move(head), [this, s, file, offset, size, handler = ::std::move(handler)](int error_code) mutable {
+            if (error_code != 0) {
+                handler(error_code);
+            } else {
+                poll_transmit(s, file, offset, size, ::std::string(), ::std::move(handler));
+            }
+        });
+        return;
+    }
+    if (size == 0) {
+        defer([handler = ::std::move(handler)]() { handler(0); });
+        return;
+    }
+
+    read_file(file, offset, [this, s, file, offset, size, handler = ::std::move(handler)](::std::string data, int error_code) mutable {
+        // 文件比预期的短时视为读取失败
+        if (error_code != 0 || data.empty()) {
+            handler(error_code != 0 ? error_code : ERROR_HANDLE_EOF);
+            return;
+        }
+        data.resize(static_cast<size_t>(::std::min<uint64_t>(data.size(), size)));
+        uint64_t chunk = data.size();
+        send(s, ::std::move(data), [this, s, file, offset, size, chunk, handler = ::std::move(handler)](int error_code) mutable {
+            if (error_code != 0) {
+                handler(error_code);
+            } else {
+                poll_transmit(s, file, offset + chunk, size - chunk, ::std::string(), ::std::move(handler));
+            }
+        });
+    });
+}
+
+// POLL 后端：把一个完成回调排队
+void my::IoService::defer(Task task)
+{
+    deferred_.push_back(::std::move(task));
+}
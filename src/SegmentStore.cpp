@@ -0,0 +1,340 @@
+#include "../include/SegmentStore.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <stdexcept>
+
+// 析构函数，关闭文件句柄
+my::SegmentStore::Segment::~Segment()
+{
+    if (handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(handle);
+    }
+}
+
+// 构造函数，打开已有的段文件
+// 追加位置在恢复响应时确定，此前为 0
+my::SegmentStore::SegmentStore(const ::std::string &dir) : dir_(dir)
+{
+    ::std::error_code ec;
+    for (const auto &file : ::std::filesystem::directory_iterator(dir_, ec)) {
+        ::std::string name = file.path().filename().string();
+        if (!file.is_regular_file() || !is_segment(name)) {
+            continue;
+        }
+        uint32_t id = 0;
+        ::std::from_chars(name.data() + 8, name.data() + name.size(), id, 16);
+        auto segment = ::std::make_shared<Segment>();
+        segment->id = id;
+        segment->handle = CreateFileA(path_of(id).c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                      nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER size;
+        if (segment->handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(segment->handle, &size)) {
+            continue;
+        }
+        segment->size = static_cast<uint64_t>(size.QuadPart);
+        segment->sealed = true;
+        segments_.emplace(id, segment);
+        next_id_ = ::std::max(next_id_, id + 1);
+    }
+}
+
+// 追加一个响应
+// 持有锁时只分配空间，对象头部和数据一起在锁外按偏移量写入，不同响应的写入可以同时进行
+// 写入完成前位置还没有返回给使用者，因此不会被读取
+my::SegmentStore::Location my::SegmentStore::append(const Hash128 &key, ::std::string_view data)
+{
+    if (data.size() > MAX_OBJECT) {
+        throw ::std::invalid_argument(::std::format("Object is too large for a segment: {} bytes", data.size()));
+    }
+    uint64_t total = sizeof(Header) + data.size();
+    ::std::shared_ptr<Segment> segment;
+    uint64_t offset = 0;
+    {
+        ::std::lock_guard<::std::mutex> lock(mutex_);
+        if (!active_ || active_->end + total > active_->size) {
+            open_active();
+        }
+        segment = active_;
+        offset = segment->end;
+        segment->end += total;
+        segment->live += total;
+    }
+
+    Header header = {};
+    header.magic = MAGIC;
+    header.checksum = checksum_of(data);
+    header.key[0] = key.low;
+    header.key[1] = key.high;
+    header.size = data.size();
+    parse_head(data, header);
+    ::std::string buffer(reinterpret_cast<const char *>(&header), sizeof(Header));
+    buffer.append(data);
+
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD written = 0;
+    if (!WriteFile(segment->handle, buffer.data(), static_cast<DWORD>(buffer.size()), &written, &overlapped) || written != buffer.size()) {
+        DWORD error = GetLastError();
+        release(Location{segment->id, offset + sizeof(Header), data.size()});
+        throw ::std::runtime_error(::std::format("Failed to write segment: {}. Error code: {}", path_of(segment->id), error));
+    }
+    return Location{segment->id, offset + sizeof(Header), data.size()};
+}
+
+// 读取一个响应
+// 对象头部和数据一起读取，头部中的键、大小和校验和都与预期相符才视为有效
+bool my::SegmentStore::read(const Location &location, const Hash128 &key, ::std::string &data) const
+{
+    ::std::shared_ptr<Segment> segment = segment_of(location.segment);
+    if (!segment || location.offset < sizeof(Header) || location.offset + location.size > segment->size) {
+        return false;
+    }
+    ::std::string buffer(static_cast<size_t>(sizeof(Header) + location.size), '\0');
+    uint64_t offset = location.offset - sizeof(Header);
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD read_size = 0;
+    if (!ReadFile(segment->handle, buffer.data(), static_cast<DWORD>(buffer.size()), &read_size, &overlapped) || read_size != buffer.size()) {
+        return false;
+    }
+    Header header;
+    ::std::memcpy(&header, buffer.data(), sizeof(Header));
+    ::std::string_view body = ::std::string_view(buffer).substr(sizeof(Header));
+    if (header.magic != MAGIC || header.key[0] != key.low || header.key[1] != key.high || header.size != location.size ||
+        header.checksum != checksum_of(body)) {
+        return false;
+    }
+    data.assign(body);
+    return true;
+}
+
+// 响应不再计入所在段的有效字节数
+// 当前段不整理，封存之后再根据有效数据的比例决定
+bool my::SegmentStore::release(const Location &location)
+{
+    if (location.segment == 0) {
+        return false;
+    }
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    auto it = segments_.find(location.segment);
+    if (it == segments_.end()) {
+        return false;
+    }
+    Segment &segment = *it->second;
+    segment.live -= ::std::min(segment.live, sizeof(Header) + location.size);
+    return needs_compaction(segment);
+}
+
+// 启动时记录索引中的一个响应
+bool my::SegmentStore::restore(const Location &location)
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    auto it = segments_.find(location.segment);
+    if (it == segments_.end() || location.offset < sizeof(Header) || location.offset + location.size > it->second->size) {
+        return false;
+    }
+    it->second->live += sizeof(Header) + location.size;
+    it->second->end = ::std::max(it->second->end, location.offset + location.size);
+    return true;
+}
+
+// 获取需要整理的段
+::std::vector<uint32_t> my::SegmentStore::candidates() const
+{
+    ::std::vector<::std::pair<uint64_t, uint32_t>> found;
+    {
+        ::std::lock_guard<::std::mutex> lock(mutex_);
+        for (const auto &[id, segment] : segments_) {
+            if (needs_compaction(*segment)) {
+                found.emplace_back(segment->live, id);
+            }
+        }
+    }
+    ::std::sort(found.begin(), found.end());
+    ::std::vector<uint32_t> ids;
+    for (const auto &[live, id] : found) {
+        ids.push_back(id);
+    }
+    return ids;
+}
+
+// 读出段中所有响应的对象头部
+// 对象头部之间紧密相连，读到标识不符（预先分配的空白或写入失败留下的空洞）或超出追加位置的头部时结束
+::std::vector<my::SegmentStore::Object> my::SegmentStore::scan(uint32_t id) const
+{
+    ::std::vector<Object> objects;
+    ::std::shared_ptr<Segment> segment = segment_of(id);
+    if (!segment) {
+        return objects;
+    }
+    uint64_t end = 0;
+    {
+        ::std::lock_guard<::std::mutex> lock(mutex_);
+        end = segment->end;
+    }
+    uint64_t offset = 0;
+    while (offset + sizeof(Header) <= end) {
+        Header header;
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD read_size = 0;
+        if (!ReadFile(segment->handle, &header, sizeof(Header), &read_size, &overlapped) || read_size != sizeof(Header) ||
+            header.magic != MAGIC || header.size > MAX_OBJECT || offset + sizeof(Header) + header.size > end) {
+            break;
+        }
+        objects.push_back(Object{Hash128{header.key[0], header.key[1]}, Location{id, offset + sizeof(Header), header.size}});
+        offset += sizeof(Header) + header.size;
+    }
+    return objects;
+}
+
+// 记录整理时移动的响应
+void my::SegmentStore::record_move(uint64_t bytes)
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    ++moved_;
+    moved_bytes_ += bytes;
+}
+
+// 删除没有有效数据的封存的段
+// 正在读取该段的使用者仍持有句柄，文件在句柄全部关闭后才真正删除
+bool my::SegmentStore::remove(uint32_t id)
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    auto it = segments_.find(id);
+    if (it == segments_.end() || !it->second->sealed || it->second->live != 0) {
+        return false;
+    }
+    DeleteFileA(path_of(id).c_str());
+    segments_.erase(it);
+    ++compactions_;
+    return true;
+}
+
+// 启动时恢复完所有响应
+// 上次运行时的当前段通常没有写满，继续在最后一个有效响应之后追加，而不是封存后立即整理；
+// 之后的数据（已被移除的响应或异常退出前没有写入索引的响应）不再被引用，可以直接覆盖
+void my::SegmentStore::finish_restore()
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    for (auto it = segments_.begin(); it != segments_.end();) {
+        if (it->second->sealed && it->second->live == 0) {
+            DeleteFileA(path_of(it->first).c_str());
+            it = segments_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (!active_ && !segments_.empty()) {
+        active_ = segments_.rbegin()->second;
+        active_->sealed = false;
+    }
+}
+
+// 设置之后新建的段文件的大小
+void my::SegmentStore::set_segment_size(uint64_t size)
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    segment_size_ = ::std::clamp(size, MIN_SEGMENT_SIZE, SEGMENT_SIZE);
+}
+
+// 获取段文件路径
+::std::string my::SegmentStore::path_of(uint32_t segment) const
+{
+    return ::std::format("{}\\segment_{:08X}", dir_, segment);
+}
+
+// 获取统计
+my::SegmentStore::Stats my::SegmentStore::stats() const
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    Stats stats;
+    stats.segments = segments_.size();
+    for (const auto &[id, segment] : segments_) {
+        stats.file_bytes += segment->size;
+        stats.live_bytes += segment->live;
+    }
+    stats.compactions = compactions_;
+    stats.moved = moved_;
+    stats.moved_bytes = moved_bytes_;
+    return stats;
+}
+
+// 文件名是否为段文件：segment_ 后接 8 个十六进制数字
+bool my::SegmentStore::is_segment(const ::std::string &name)
+{
+    return name.size() == 16 && name.starts_with("segment_") &&
+           ::std::all_of(name.begin() + 8, name.end(), [](char c) { return ::std::isxdigit(static_cast<unsigned char>(c)) != 0; });
+}
+
+// 查找段
+::std::shared_ptr<my::SegmentStore::Segment> my::SegmentStore::segment_of(uint32_t id) const
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    auto it = segments_.find(id);
+    return it == segments_.end() ? nullptr : it->second;
+}
+
+// 新建一个段作为当前段，原有的当前段被封存
+// 一次分配整个段的空间，之后的追加不再改变文件大小，文件在磁盘上尽量连续
+void my::SegmentStore::open_active()
+{
+    auto segment = ::std::make_shared<Segment>();
+    segment->id = next_id_;
+    segment->handle = CreateFileA(path_of(segment->id).c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (segment->handle == INVALID_HANDLE_VALUE) {
+        throw ::std::runtime_error(::std::format("Failed to create segment: {}. Error code: {}", path_of(segment->id), GetLastError()));
+    }
+    LARGE_INTEGER size;
+    size.QuadPart = static_cast<int64_t>(segment_size_);
+    if (!SetFilePointerEx(segment->handle, size, nullptr, FILE_BEGIN) || !SetEndOfFile(segment->handle)) {
+        DWORD error = GetLastError();
+        DeleteFileA(path_of(segment->id).c_str());
+        throw ::std::runtime_error(::std::format("Failed to allocate segment: {}. Error code: {}", path_of(segment->id), error));
+    }
+    segment->size = segment_size_;
+    ++next_id_;
+    if (active_) {
+        active_->sealed = true;
+    }
+    active_ = segment;
+    segments_.emplace(segment->id, segment);
+}
+
+// 段是否需要整理：已封存且有效数据低于文件大小的 COMPACT_PERCENT%
+bool my::SegmentStore::needs_compaction(const Segment &segment)
+{
+    return segment.sealed && segment.live * 100 < segment.size * COMPACT_PERCENT;
+}
+
+// 计算响应数据的校验和：MurmurHash3 的低 32 位
+uint32_t my::SegmentStore::checksum_of(::std::string_view data)
+{
+    return static_cast<uint32_t>(murmur3_128(data).low);
+}
+
+// 从响应中解析状态码和头部长度，只用于整理和排查问题，无法识别时为 0
+void my::SegmentStore::parse_head(::std::string_view data, Header &header)
+{
+    size_t head_end = data.find("\r\n\r\n");
+    if (head_end != ::std::string_view::npos && head_end + 4 <= UINT32_MAX) {
+        header.head_size = static_cast<uint32_t>(head_end + 4);
+    }
+    size_t space = data.find(' ');
+    if (space != ::std::string_view::npos && space < head_end) {
+        uint16_t status = 0;
+        auto [ptr, ec] = ::std::from_chars(data.data() + space + 1, data.data() + ::std::min(data.size(), space + 4), status);
+        if (ec == ::std::errc()) {
+            header.status = status;
+        }
+    }
+}
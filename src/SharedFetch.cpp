@@ -0,0 +1,129 @@
+#include "../include/SharedFetch.h"
+
+#include <algorithm>
+
+// 追加一块数据，唤醒等待的读者
+// 回调在释放锁之后调用，回调中可以再次读取
+void my::SharedFetch::append(Chunk chunk)
+{
+    ::std::vector<Waiter> waiters;
+    {
+        ::std::lock_guard<::std::mutex> lock(mutex_);
+        if (state_ != State::FETCHING) {
+            return;
+        }
+        buffered_ += chunk->size();
+        chunks_.push_back(::std::move(chunk));
+        if (buffered_ > MAX_BUFFERED) {
+            joinable_ = false;
+        }
+        trim();
+        waiters.swap(waiters_);
+    }
+    for (Waiter &waiter : waiters) {
+        waiter();
+    }
+}
+
+// 结束获取
+// 继续接受新读者时保留所有块，新读者从第一块开始读到完整的响应
+void my::SharedFetch::finish(State state, bool joinable)
+{
+    ::std::vector<Waiter> waiters;
+    {
+        ::std::lock_guard<::std::mutex> lock(mutex_);
+        if (state_ != State::FETCHING) {
+            return;
+        }
+        state_ = state;
+        joinable_ = joinable_ && joinable;
+        trim();
+        waiters.swap(waiters_);
+    }
+    for (Waiter &waiter : waiters) {
+        waiter();
+    }
+}
+
+// 不再接受新的读者
+// 可以在结束之前调用，之后的 finish 不会重新接受新的读者
+void my::SharedFetch::close()
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    joinable_ = false;
+    trim();
+}
+
+// 加入一个读者，新读者从第一块开始读取
+size_t my::SharedFetch::attach()
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    if (!joinable_) {
+        return NO_READER;
+    }
+    cursors_.push_back(first_);
+    ++readers_;
+    return cursors_.size() - 1;
+}
+
+// 移除读者
+void my::SharedFetch::detach(size_t reader)
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    if (reader >= cursors_.size() || cursors_[reader] == NO_READER) {
+        return;
+    }
+    cursors_[reader] = NO_READER;
+    --readers_;
+    trim();
+}
+
+// 读取读者尚未读取的所有块
+my::SharedFetch::State my::SharedFetch::read(size_t reader, ::std::vector<Chunk> &chunks)
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    size_t &cursor = cursors_.at(reader);
+    for (; cursor < first_ + chunks_.size(); ++cursor) {
+        chunks.push_back(chunks_[cursor - first_]);
+    }
+    trim();
+    return state_;
+}
+
+// 在没有新数据且仍在获取时注册等待回调
+bool my::SharedFetch::wait(size_t reader, Waiter waiter)
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    if (state_ != State::FETCHING || cursors_.at(reader) < first_ + chunks_.size()) {
+        return false;
+    }
+    waiters_.push_back(::std::move(waiter));
+    return true;
+}
+
+// 获取当前的读者数
+size_t my::SharedFetch::reader_count() const
+{
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    return readers_;
+}
+
+// 释放所有读者都已读过的块
+// 仍接受新读者时新读者需要从第一块开始读取，不能释放
+void my::SharedFetch::trim()
+{
+    if (joinable_) {
+        return;
+    }
+    size_t oldest = first_ + chunks_.size();
+    for (size_t cursor : cursors_) {
+        if (cursor != NO_READER) {
+            oldest = ::std::min(oldest, cursor);
+        }
+    }
+    while (first_ < oldest) {
+        buffered_ -= chunks_.front()->size();
+        chunks_.pop_front();
+        ++first_;
+    }
+}
@@ -0,0 +1,180 @@
+#include "../include/TimerWheel.h"
+
+#include <algorithm>
+
+// 构造函数
+my::TimerWheel::TimerWheel(Clock::duration tick)
+    : tick_(tick), start_(Clock::now())
+{
+    heads_.fill(NIL);
+}
+
+// 添加一个在 delay 之后到期的定时器
+// 到期刻度向上取整，且至少为下一个刻度，保证不会提前触发
+my::TimerWheel::TimerId my::TimerWheel::schedule(Clock::duration delay, Callback callback)
+{
+    Clock::duration since_start = Clock::now() - start_ + ::std::max(delay, Clock::duration::zero());
+    uint64_t expiry = static_cast<uint64_t>((since_start + tick_ - Clock::duration(1)) / tick_);
+
+    uint32_t index = free_;
+    if (index != NIL) {
+        free_ = nodes_[index].next;
+    } else {
+        index = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+    }
+    Node &node = nodes_[index];
+    node.expiry = ::std::max(expiry, current_ + 1);
+    node.callback = ::std::move(callback);
+    insert(index);
+    ++count_;
+    return (static_cast<uint64_t>(node.generation) << 32) | index;
+}
+
+// 取消定时器
+bool my::TimerWheel::cancel(TimerId id)
+{
+    uint32_t index = static_cast<uint32_t>(id);
+    if (id == 0 || index >= nodes_.size() || nodes_[index].generation != static_cast<uint32_t>(id >> 32) || nodes_[index].slot == NIL) {
+        return false;
+    }
+    unlink(index);
+    release(index);
+    return true;
+}
+
+// 推进到当前时间
+size_t my::TimerWheel::advance()
+{
+    return advance(Clock::now());
+}
+
+// 推进到指定时间
+// 逐个刻度前进：低层转完一圈时先重新分配高层的槽，再触发当前刻度的槽中的定时器
+size_t my::TimerWheel::advance(Clock::time_point now)
+{
+    uint64_t target = tick_of(now);
+    size_t fired = 0;
+    while (current_ < target) {
+        // 没有定时器时直接跳到目标刻度
+        if (count_ == 0) {
+            current_ = target;
+            break;
+        }
+        ++current_;
+        for (int level = 1; level < LEVELS; ++level) {
+            if ((current_ & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            cascade(level, (current_ >> (SLOT_BITS * level)) & MASK);
+        }
+
+        uint32_t &head = heads_[current_ & MASK];
+        while (head != NIL) {
+            uint32_t index = head;
+            unlink(index);
+            // 到期时间超出时间轮范围的定时器被放在最远的槽中，尚未真正到期时重新放入
+            if (nodes_[index].expiry > current_) {
+                insert(index);
+                continue;
+            }
+            Callback callback = ::std::move(nodes_[index].callback);
+            release(index);
+            callback();
+            ++fired;
+        }
+    }
+    return fired;
+}
+
+// 获取距离下一次需要推进的毫秒数
+// 只查看第 0 层：下一个非空的槽，或第 0 层转完一圈需要重新分配高层的槽的时刻
+int my::TimerWheel::next_timeout_ms(int max_ms) const
+{
+    if (count_ == 0) {
+        return max_ms;
+    }
+    uint64_t ticks = 1;
+    while (heads_[(current_ + ticks) & MASK] == NIL && ((current_ + ticks) & MASK) != 0) {
+        ++ticks;
+    }
+    Clock::time_point wake = start_ + tick_ * static_cast<Clock::rep>(current_ + ticks);
+    auto remaining = ::std::chrono::ceil<::std::chrono::milliseconds>(wake - Clock::now()).count();
+    return static_cast<int>(::std::clamp<decltype(remaining)>(remaining, 0, max_ms));
+}
+
+// 获取尚未触发的定时器数
+size_t my::TimerWheel::size() const
+{
+    return count_;
+}
+
+// 把节点按到期刻度放入对应层的槽中
+// 与当前刻度的距离小于 SLOTS^(n+1) 的定时器放入第 n 层，槽号取到期刻度的第 n 组位
+void my::TimerWheel::insert(uint32_t index)
+{
+    Node &node = nodes_[index];
+    uint64_t expiry = ::std::max(node.expiry, current_);
+    uint64_t distance = expiry - current_;
+    if (distance >= MAX_TICKS) {
+        distance = MAX_TICKS - 1;
+        expiry = current_ + distance;
+    }
+    int level = 0;
+    while (distance >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+
+    node.slot = static_cast<uint32_t>(level * SLOTS + ((expiry >> (SLOT_BITS * level)) & MASK));
+    node.prev = NIL;
+    node.next = heads_[node.slot];
+    if (node.next != NIL) {
+        nodes_[node.next].prev = index;
+    }
+    heads_[node.slot] = index;
+}
+
+// 把节点从所在的槽中移出
+void my::TimerWheel::unlink(uint32_t index)
+{
+    Node &node = nodes_[index];
+    if (node.prev != NIL) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        heads_[node.slot] = node.next;
+    }
+    if (node.next != NIL) {
+        nodes_[node.next].prev = node.prev;
+    }
+    node.prev = node.next = NIL;
+    node.slot = NIL;
+}
+
+// 释放节点，放回空闲链表
+void my::TimerWheel::release(uint32_t index)
+{
+    Node &node = nodes_[index];
+    node.callback = nullptr;
+    ++node.generation;
+    node.next = free_;
+    free_ = index;
+    --count_;
+}
+
+// 把高层的一个槽中的定时器重新分配到低层
+void my::TimerWheel::cascade(int level, uint64_t slot)
+{
+    uint32_t index = heads_[level * SLOTS + slot];
+    heads_[level * SLOTS + slot] = NIL;
+    while (index != NIL) {
+        uint32_t next = nodes_[index].next;
+        insert(index);
+        index = next;
+    }
+}
+
+// 获取时间点对应的刻度
+uint64_t my::TimerWheel::tick_of(Clock::time_point time) const
+{
+    return time <= start_ ? 0 : static_cast<uint64_t>((time - start_) / tick_);
+}
@@ -0,0 +1,148 @@
+#include "../include/simd_scan.h"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_SCAN_X86
+#include <immintrin.h>
+#endif
+
+// 逐字节查找第一个属于 delims 的字符
+static size_t scan_scalar(const char *data, size_t size, ::std::string_view delims)
+{
+    if (delims.size() == 1) {
+        const void *found = ::std::memchr(data, delims[0], size);
+        return found != nullptr ? static_cast<const char *>(found) - data : size;
+    }
+    for (size_t pos = 0; pos < size; ++pos) {
+        for (char delim : delims) {
+            if (data[pos] == delim) {
+                return pos;
+            }
+        }
+    }
+    return size;
+}
+
+#ifdef SIMD_SCAN_X86
+// 使用 SSE4.2 的 PCMPESTRI 一次在 16 字节中查找任意一个分隔符，不足 16 字节的尾部逐字节查找
+__attribute__((target("sse4.2"))) static size_t scan_sse42(const char *data, size_t size, ::std::string_view delims)
+{
+    char set[16] = {};
+    ::std::memcpy(set, delims.data(), delims.size());
+    const __m128i needles = _mm_loadu_si128(reinterpret_cast<const __m128i *>(set));
+    const int needle_count = static_cast<int>(delims.size());
+
+    size_t pos = 0;
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+        int index = _mm_cmpestri(needles, needle_count, block, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+        if (index != 16) {
+            return pos + index;
+        }
+    }
+    return pos + scan_scalar(data + pos, size - pos, delims);
+}
+
+// 使用 AVX2 一次比较 32 字节，各分隔符的比较结果合并为一个位掩码，最低的置位即为第一个分隔符
+__attribute__((target("avx2"))) static size_t scan_avx2(const char *data, size_t size, ::std::string_view delims)
+{
+    __m256i needles[16];
+    for (size_t i = 0; i < delims.size(); ++i) {
+        needles[i] = _mm256_set1_epi8(delims[i]);
+    }
+
+    size_t pos = 0;
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+        __m256i matched = _mm256_cmpeq_epi8(block, needles[0]);
+        for (size_t i = 1; i < delims.size(); ++i) {
+            matched = _mm256_or_si256(matched, _mm256_cmpeq_epi8(block, needles[i]));
+        }
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(matched));
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return pos + scan_sse42(data + pos, size - pos, delims);
+}
+#endif
+
+// 检测 CPU 支持的最高指令集
+static ::my::ScanLevel detect_scan_level()
+{
+#ifdef SIMD_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return ::my::ScanLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return ::my::ScanLevel::SSE42;
+    }
+#endif
+    return ::my::ScanLevel::SCALAR;
+}
+
+// CPU 支持的最高指令集
+static ::my::ScanLevel supported_scan_level()
+{
+    static const ::my::ScanLevel level = detect_scan_level();
+    return level;
+}
+
+// 当前使用的指令集
+static ::std::atomic<::my::ScanLevel> &current_scan_level()
+{
+    static ::std::atomic<::my::ScanLevel> level(supported_scan_level());
+    return level;
+}
+
+// 获取当前使用的指令集
+my::ScanLevel my::scan_level()
+{
+    return current_scan_level().load(::std::memory_order_relaxed);
+}
+
+// 获取指令集的名称
+const char *my::scan_level_name(ScanLevel level)
+{
+    switch (level) {
+    case ScanLevel::SCALAR:
+        return "scalar";
+    case ScanLevel::SSE42:
+        return "SSE4.2";
+    case ScanLevel::AVX2:
+        return "AVX2";
+    }
+    return "unknown";
+}
+
+// 指定使用的指令集，CPU 不支持时选择支持的最高指令集
+my::ScanLevel my::set_scan_level(ScanLevel level)
+{
+    if (static_cast<int>(level) > static_cast<int>(supported_scan_level())) {
+        level = supported_scan_level();
+    }
+    current_scan_level().store(level, ::std::memory_order_relaxed);
+    return level;
+}
+
+// 查找第一个属于 delims 的字符
+size_t my::find_first_of(const char *data, size_t size, ::std::string_view delims)
+{
+    if (delims.empty() || delims.size() > 16) {
+        return delims.empty() ? size : scan_scalar(data, size, delims);
+    }
+#ifdef SIMD_SCAN_X86
+    switch (scan_level()) {
+    case ScanLevel::AVX2:
+        return scan_avx2(data, size, delims);
+    case ScanLevel::SSE42:
+        return scan_sse42(data, size, delims);
+    case ScanLevel::SCALAR:
+        break;
+    }
+#endif
+    return scan_scalar(data, size, delims);
+}
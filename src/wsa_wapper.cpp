@@ -61,53 +61,15 @@ bool ::my::cleanup_wsa()
     return true;
 }
 
-// 连接到服务器
-SOCKET my::connect_to_server(const char *s_ip, unsigned short s_port)
+// 设置套接字的阻塞模式
+bool my::set_nonblocking(SOCKET s, bool nonblocking)
 {
-    // 创建套接字
-    SOCKET s_sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (s_sock == INVALID_SOCKET) {
-        throw std::runtime_error(::std::format("Failed to create socket. Error code: {}", WSAGetLastError()));
-    }
-
-    // 设置服务器地址
-    SOCKADDR_IN s_sockaddr;
-    s_sockaddr.sin_family = AF_INET;
-    s_sockaddr.sin_port = htons(s_port);
-    s_sockaddr.sin_addr.s_addr = inet_addr(s_ip);
-
-    // 连接到服务器
-    if (connect(s_sock, reinterpret_cast<SOCKADDR *>(&s_sockaddr), sizeof(s_sockaddr)) == SOCKET_ERROR) {
-        closesocket(s_sock);
-        throw std::runtime_error(::std::format("Failed to connect to server. Error code: {}", WSAGetLastError()));
-    }
-
-    return s_sock;
+    u_long mode = nonblocking ? 1 : 0;
+    return ioctlsocket(s, FIONBIO, &mode) != SOCKET_ERROR;
 }
 
-// 获取主机的 IP 字符串
-const char *my::get_ip_str(const char *host)
+// 检查错误码是否表示非阻塞操作需要稍后重试
+bool my::is_would_block(int error_code)
 {
-    // 解析主机名
-    hostent *host_info = gethostbyname(host);
-    if (host_info == nullptr) {
-        throw std::runtime_error(::std::format("Failed to resolve host: {}. Error code: {}", host, WSAGetLastError()));
-    }
-
-    // 返回 IP 地址字符串
-    return inet_ntoa(*reinterpret_cast<IN_ADDR *>(host_info->h_addr));
+    return error_code == WSAEWOULDBLOCK || error_code == WSAEINPROGRESS;
 }
-
-// 带超时的接收数据
-int my::recv_with_timeout(SOCKET s, char *buffer, int buf_size, TIMEVAL timeout)
-{
-    fd_set readfds;
-    FD_ZERO(&readfds);   // 清空文件描述符集合
-    FD_SET(s, &readfds); // 将套接字加入集合
-    // 使用 select 函数等待数据可读或超时
-    if (select(0, &readfds, nullptr, nullptr, &timeout) == 0) {
-        throw ::std::runtime_error("Timeout(1s) when receiving data from server");
-    }
-    // 接收数据
-    return recv(s, buffer, buf_size, 0);
-}
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "../include/CacheIndex.h"
+#include "./check.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace
+{
+    constexpr size_t RECORD_SIZE = 256; // 日志中一条记录的大小
+
+    // 生成第 id 个索引项
+    ::my::CacheIndex::Item make_item(uint64_t id)
+    {
+        ::my::CacheIndex::Item item;
+        item.key = ::my::Hash128{id * 0x9E3779B97F4A7C15ULL + 1, id};
+        item.check = ::my::Hash128{id, ~id};
+        item.size = 1000 + id;
+        item.stored_at = 1700000000;
+        item.lifetime = 3600;
+        item.etag = ::std::format("\"{}\"", id);
+        return item;
+    }
+
+    // 索引中是否有第 id 个索引项且内容一致
+    bool has_item(const ::my::CacheIndex &index, uint64_t id)
+    {
+        ::std::optional<::my::CacheIndex::Item> item = index.find(make_item(id).key);
+        return item && item->size == 1000 + id && item->etag == ::std::format("\"{}\"", id);
+    }
+
+    // 读取整个文件，文件可以正被索引打开
+    ::std::string read_file(const ::std::filesystem::path &path)
+    {
+        ::std::ifstream file(path, ::std::ios::binary);
+        return ::std::string(::std::istreambuf_iterator<char>(file), ::std::istreambuf_iterator<char>());
+    }
+
+    // 写入整个文件
+    void write_file(const ::std::filesystem::path &path, const ::std::string &data)
+    {
+        ::std::ofstream file(path, ::std::ios::binary | ::std::ios::trunc);
+        file.write(data.data(), static_cast<::std::streamsize>(data.size()));
+    }
+
+    // 模拟异常退出：在 dir 中放入上次检查点时的索引文件 index 和之后写入的日志 wal
+    ::std::string crash_state(const ::std::filesystem::path &dir, const ::std::string &index, const ::std::string &wal)
+    {
+        ::std::filesystem::remove_all(dir);
+        ::std::filesystem::create_directories(dir);
+        ::std::string path = (dir / "index").string();
+        write_file(path, index);
+        write_file(path + ".wal", wal);
+        return path;
+    }
+} // namespace
+
+// 异常退出后重放日志：完整的日志恢复全部修改，撕裂或损坏的日志尾部只丢失该记录及其之后的修改
+// 重放途中重建索引时日志在全部应用后才被清空
+int main()
+{
+    ::std::filesystem::path root = ::std::filesystem::temp_directory_path() / "CacheIndex_test";
+    ::std::filesystem::remove_all(root);
+    ::std::filesystem::create_directories(root);
+
+    // 正常关闭后重新打开：检查点已包含所有修改，日志为空
+    ::std::string path = (root / "clean" / "index").string();
+    ::std::filesystem::create_directories(root / "clean");
+    {
+        ::my::CacheIndex index(path);
+        CHECK(index.created());
+        for (uint64_t id = 0; id < 100; ++id) {
+            CHECK(index.put(make_item(id)));
+        }
+    }
+    ::std::string checkpointed = read_file(path);
+    CHECK(::std::filesystem::file_size(path + ".wal") == 0);
+
+    // 检查点之后先移除 0 ~ 9，再插入 100 ~ 149，记录下异常退出前的日志
+    ::std::string wal;
+    {
+        ::my::CacheIndex index(path);
+        CHECK(!index.created());
+        CHECK(index.size() == 100);
+        for (uint64_t id = 0; id < 10; ++id) {
+            index.erase(make_item(id).key);
+        }
+        for (uint64_t id = 100; id < 150; ++id) {
+            index.put(make_item(id));
+        }
+        wal = read_file(path + ".wal");
+    }
+    CHECK(wal.size() == 60 * RECORD_SIZE);
+
+    // 完整的日志：所有修改都被恢复
+    {
+        ::my::CacheIndex index(crash_state(root / "full", checkpointed, wal));
+        CHECK(!index.created());
+        CHECK(index.size() == 140);
+        CHECK(!has_item(index, 0) && !has_item(index, 9));
+        CHECK(has_item(index, 10) && has_item(index, 99) && has_item(index, 100) && has_item(index, 149));
+    }
+    CHECK(::std::filesystem::file_size(root / "full" / "index.wal") == 0);
+
+    // 最后一条记录只写了一半：只丢失最后一次插入
+    {
+        ::my::CacheIndex index(crash_state(root / "torn", checkpointed, wal.substr(0, wal.size() - RECORD_SIZE / 2)));
+        CHECK(index.size() == 139);
+        CHECK(has_item(index, 148) && !has_item(index, 149));
+        CHECK(!has_item(index, 0));
+    }
+
+    // 倒数第二条记录损坏：从该记录起停止重放
+    {
+        ::std::string corrupted = wal;
+        corrupted[corrupted.size() - RECORD_SIZE - 100] ^= 0x5A;
+        ::my::CacheIndex index(crash_state(root / "corrupt", checkpointed, corrupted));
+        CHECK(index.size() == 138);
+        CHECK(has_item(index, 147) && !has_item(index, 148) && !has_item(index, 149));
+    }
+
+    // 重放途中重建索引：检查点时非空的槽接近 3/4，日志中的插入使索引重建，重建后的插入也不丢失
+    constexpr uint64_t BASE = ::my::CacheIndex::MIN_CAPACITY * 3 / 4 - 10;
+    path = (root / "grow" / "index").string();
+    ::std::filesystem::create_directories(root / "grow");
+    {
+        ::my::CacheIndex index(path);
+        for (uint64_t id = 0; id < BASE; ++id) {
+            index.put(make_item(id));
+        }
+    }
+    checkpointed = read_file(path);
+    {
+        ::my::CacheIndex index(path);
+        for (uint64_t id = BASE; id < BASE + 5; ++id) {
+            index.put(make_item(id));
+        }
+        wal = read_file(path + ".wal");
+    }
+    // 用另一个空索引生成跨过重建阈值的日志（在原索引中插入时重建会清空日志）
+    path = (root / "grow-wal" / "index").string();
+    ::std::filesystem::create_directories(root / "grow-wal");
+    {
+        ::my::CacheIndex index(path);
+        for (uint64_t id = BASE + 5; id < BASE + 40; ++id) {
+            index.put(make_item(id));
+        }
+        wal += read_file(path + ".wal");
+    }
+    CHECK(wal.size() == 40 * RECORD_SIZE);
+    {
+        ::my::CacheIndex index(crash_state(root / "grown", checkpointed, wal));
+        CHECK(index.size() == BASE + 40);
+        CHECK(has_item(index, 0) && has_item(index, BASE - 1));
+        bool all_logged = true;
+        for (uint64_t id = BASE; id < BASE + 40; ++id) {
+            all_logged = all_logged && has_item(index, id);
+        }
+        CHECK(all_logged);
+    }
+    CHECK(::std::filesystem::file_size(root / "grown" / "index") > checkpointed.size());
+    CHECK(::std::filesystem::file_size(root / "grown" / "index.wal") == 0);
+
+    ::std::filesystem::remove_all(root);
+    return ::my::test::check_result("CacheIndex_test");
+}
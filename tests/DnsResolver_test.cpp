@@ -0,0 +1,107 @@
+#include "../include/DnsResolver.h"
+#include "./check.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using namespace ::std::chrono_literals;
+    using Status = ::my::DnsResolver::Status;
+
+    // 写入 hosts 格式的文件
+    void write_hosts(const ::std::string &path, const ::std::string &content)
+    {
+        ::std::ofstream file(path, ::std::ios::trunc);
+        file << content;
+    }
+
+    // 包装 hosts 文件后端，记录查询次数，delay 为每次查询的耗时
+    ::my::DnsResolver::Backend counting_backend(const ::std::string &path, ::std::atomic<int> &calls, ::std::chrono::milliseconds delay = 0ms)
+    {
+        return [backend = ::my::DnsResolver::hosts_file_backend(path, 1s), &calls, delay](const ::std::string &host) {
+            ++calls;
+            ::std::this_thread::sleep_for(delay);
+            return backend(host);
+        };
+    }
+} // namespace
+
+// 使用 hosts 文件后端检查缓存命中、不存在的域名的缓存、TTL 过期以及并发查询的合并
+int main()
+{
+    ::std::string path = (::std::filesystem::temp_directory_path() / "DnsResolver_test.hosts").string();
+    write_hosts(path, "# test hosts\n"
+                      "10.0.0.1 www.example.com example.com\n"
+                      "10.0.0.2 other.example.com # comment\n");
+
+    ::std::atomic<int> calls = 0;
+    {
+        ::my::DnsResolver resolver(2, counting_backend(path, calls));
+        resolver.set_negative_ttl(1s);
+
+        // 首次解析查询后端，之后（主机名不区分大小写）命中缓存
+        ::my::DnsResolver::Result result = resolver.resolve("WWW.Example.com");
+        CHECK(result.status == Status::OK && result.address("www.example.com") == "10.0.0.1");
+        CHECK(resolver.resolve("www.example.com").address("www.example.com") == "10.0.0.1");
+        CHECK(resolver.lookup_cache("www.EXAMPLE.com").has_value());
+        CHECK(calls == 1);
+        CHECK(resolver.miss_count() == 1 && resolver.hit_count() == 2);
+        CHECK(resolver.resolve("example.com").address("example.com") == "10.0.0.1");
+        CHECK(calls == 2);
+
+        // IP 地址字面量不查询后端
+        CHECK(resolver.resolve("192.168.1.1").address("192.168.1.1") == "192.168.1.1");
+        CHECK(calls == 2);
+
+        // 不存在的域名被缓存 negative_ttl
+        CHECK(resolver.resolve("missing.example.com").status == Status::NOT_FOUND);
+        CHECK(resolver.resolve("missing.example.com").status == Status::NOT_FOUND);
+        CHECK(calls == 3);
+
+        // 缓存在 TTL 内不变，过期后重新查询并得到新的结果
+        write_hosts(path, "10.0.0.9 www.example.com\n"
+                          "10.0.0.3 missing.example.com\n");
+        CHECK(resolver.resolve("www.example.com").address("www.example.com") == "10.0.0.1");
+        CHECK(resolver.resolve("missing.example.com").status == Status::NOT_FOUND);
+        CHECK(calls == 3);
+        ::std::this_thread::sleep_for(1100ms);
+        CHECK(!resolver.lookup_cache("www.example.com").has_value());
+        CHECK(resolver.resolve("www.example.com").address("www.example.com") == "10.0.0.9");
+        CHECK(resolver.resolve("missing.example.com").address("missing.example.com") == "10.0.0.3");
+        CHECK(calls == 5);
+    }
+
+    // 并发解析同一主机名只查询一次
+    calls = 0;
+    {
+        ::my::DnsResolver resolver(2, counting_backend(path, calls, 200ms));
+        ::std::vector<::std::shared_future<::my::DnsResolver::Result>> futures;
+        for (int i = 0; i < 4; ++i) {
+            futures.push_back(resolver.resolve_async("www.example.com"));
+        }
+        for (auto &future : futures) {
+            CHECK(future.get().address("www.example.com") == "10.0.0.9");
+        }
+        CHECK(calls == 1);
+        CHECK(resolver.coalesced_count() == 3);
+    }
+
+    // 查询失败（hosts 文件不存在）不被缓存
+    calls = 0;
+    {
+        ::my::DnsResolver resolver(1, counting_backend(path + ".missing", calls));
+        CHECK(resolver.resolve("www.example.com").status == Status::FAILED);
+        CHECK(resolver.resolve("www.example.com").status == Status::FAILED);
+        CHECK(calls == 2);
+    }
+
+    ::std::filesystem::remove(path);
+    return ::my::test::check_result("DnsResolver_test");
+}
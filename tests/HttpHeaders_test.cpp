@@ -0,0 +1,156 @@
+#include "../include/HttpHeaders.h"
+#include "../include/HttpRequest.h"
+#include "../include/HttpRequestParser.h"
+#include "./check.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    bool counting = false;  // 是否正在统计堆内存分配
+    size_t allocations = 0; // 统计期间的堆内存分配次数
+
+    // 生成一个典型的浏览器请求，field_count 为头部字段数（不少于 8）
+    ::std::string make_request(size_t field_count)
+    {
+        ::std::string request = "GET http://www.example.com/index.html?q=proxy HTTP/1.1\r\n"
+                                "Host: www.example.com\r\n"
+                                "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+                                "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+                                "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+                                "Accept-Encoding: gzip, deflate, br\r\n"
+                                "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark\r\n"
+                                "Proxy-Connection: keep-alive\r\n"
+                                "If-None-Match: \"5f3c-1a2b3c4d\"\r\n";
+        for (size_t i = 8; i < field_count; ++i) {
+            request += "X-Extra-" + ::std::to_string(i) + ": value-" + ::std::to_string(i) + "\r\n";
+        }
+        return request + "\r\n";
+    }
+
+    // 把解析出的字段依次加入 headers（与 HttpRequest 的构造函数相同）
+    void fill(::my::HttpHeaders &headers, const ::my::HttpRequestParser &parser)
+    {
+        for (size_t i = 0; i < parser.header_count(); ++i) {
+            ::my::HttpRequestParser::Header header = parser.header(i);
+            headers.add(header.name, header.value);
+        }
+    }
+
+    // 解析请求并进行转发前的典型修改，检查整个过程不分配堆内存
+    void check_no_allocation(size_t field_count)
+    {
+        ::std::string request = make_request(field_count);
+        ::my::HttpRequestParser parser;
+        ::my::HttpHeaders headers;
+
+        allocations = 0;
+        counting = true;
+        ::my::HttpRequestParser::Result result = parser.parse(request);
+        fill(headers, parser);
+        bool found = headers.get("host") == "www.example.com" && headers.has_token("accept-encoding", "GZIP") && !headers.contains("Range");
+        headers.erase("Proxy-Connection");
+        headers.set("Connection", "keep-alive");
+        ::my::HttpHeaders copy(headers);
+        counting = false;
+
+        CHECK(result == ::my::HttpRequestParser::Result::COMPLETE);
+        CHECK(found);
+        CHECK(copy.size() == field_count);
+        CHECK(copy.get("Connection") == "keep-alive");
+        if (!CHECK(allocations == 0)) {
+            ::std::fprintf(stderr, "  %zu fields, %zu bytes: %zu allocation(s)\n", field_count, request.size(), allocations);
+        }
+    }
+
+    // 从解析结果构造 HttpRequest，进行 prepare_request 中的修改（带上缓存的验证器）后转换为待发送的分段
+    // 头部字段本身不分配堆内存，剩下的分配是固定的 4 次，与字段数无关:
+    // url（超过 std::string 的内置容量）、共享的原始数据 raw、to_buffers 的 scratch 和分段数组各一次
+    void check_request_allocations(size_t field_count)
+    {
+        constexpr size_t EXPECTED_ALLOCATIONS = 4;
+        ::std::string buffer = make_request(field_count);
+        ::my::HttpRequestParser parser;
+        ::std::string scratch;
+
+        allocations = 0;
+        counting = true;
+        ::my::HttpRequestParser::Result result = parser.parse(buffer);
+        ::my::HttpRequest request(parser, buffer);
+        request.headers.erase("Proxy-Connection");
+        request.headers.set("Connection", "keep-alive");
+        request.headers.set("If-Modified-Since", "Sat, 01 Jun 2024 08:00:00 GMT");
+        request.headers.set("If-None-Match", "\"5f3c-1a2b3c4d\"");
+        ::std::vector<::std::string_view> buffers = request.to_buffers(scratch);
+        counting = false;
+
+        ::std::string sent;
+        for (::std::string_view piece : buffers) {
+            sent += piece;
+        }
+        CHECK(result == ::my::HttpRequestParser::Result::COMPLETE);
+        CHECK(sent.find("Proxy-Connection") == ::std::string::npos);
+        CHECK(sent.find("\r\nConnection: keep-alive\r\n") != ::std::string::npos);
+        CHECK(sent.find("\r\nIf-Modified-Since: Sat, 01 Jun 2024 08:00:00 GMT\r\n") != ::std::string::npos);
+        CHECK(sent.ends_with("\r\n\r\n"));
+        if (!CHECK(allocations == EXPECTED_ALLOCATIONS)) {
+            ::std::fprintf(stderr, "  HttpRequest with %zu fields: %zu allocation(s), expected %zu\n", field_count, allocations, EXPECTED_ALLOCATIONS);
+        }
+    }
+} // namespace
+
+// 替换全局的 operator new，统计期间记录分配次数
+void *operator new(size_t size)
+{
+    if (counting) {
+        ++allocations;
+    }
+    if (void *p = ::std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw ::std::bad_alloc();
+}
+
+// 与替换的 operator new 配对
+void operator delete(void *p) noexcept
+{
+    ::std::free(p);
+}
+
+// 与替换的 operator new 配对
+void operator delete(void *p, size_t) noexcept
+{
+    ::std::free(p);
+}
+
+// 典型请求（不超过 INLINE_FIELDS 个字段、INLINE_BYTES 字节）的解析和修改不分配堆内存
+// 构造 HttpRequest 并转换为待发送的分段只有固定次数的分配
+// 超过内置容量的请求转为使用堆内存，字段仍然完整
+int main()
+{
+    check_no_allocation(8);
+    check_no_allocation(20);
+    check_no_allocation(::my::HttpHeaders::INLINE_FIELDS - 1); // set 追加 Connection 后正好占满
+    check_request_allocations(8);
+    check_request_allocations(20);
+
+    ::std::string request = make_request(::my::HttpHeaders::INLINE_FIELDS + 8);
+    ::my::HttpRequestParser parser;
+    ::my::HttpHeaders headers;
+    CHECK(parser.parse(request) == ::my::HttpRequestParser::Result::COMPLETE);
+    allocations = 0;
+    counting = true;
+    fill(headers, parser);
+    counting = false;
+    CHECK(allocations > 0);
+    CHECK(headers.size() == ::my::HttpHeaders::INLINE_FIELDS + 8);
+    CHECK(headers.get("X-Extra-39") == "value-39");
+    CHECK(headers.get("Host") == "www.example.com");
+
+    return ::my::test::check_result("HttpHeaders_test");
+}
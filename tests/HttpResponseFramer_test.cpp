@@ -0,0 +1,138 @@
+#include "../include/HttpResponseFramer.h"
+#include "./check.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Expected 结构体表示一个响应及其预期的分析结果
+    struct Expected {
+        ::std::string text;     // 响应的全部数据，分析出的长度应等于其长度
+        bool complete = true;   // 是否完整（以关闭连接结束的响应不完整）
+        bool keep_alive = true; // 响应结束后连接是否可以复用
+        size_t interim = 0;     // 最终响应之前的 1xx 临时响应数
+    };
+
+    // Case 结构体表示一个测试用例：同一连接上依次到达的若干响应
+    struct Case {
+        const char *name;                  // 用例名称
+        const char *method;                // 请求方法
+        ::std::vector<Expected> responses; // 依次到达的响应
+    };
+
+    // Framed 结构体记录分析出的一个响应
+    struct Framed {
+        size_t length = 0;       // 属于该响应的字节数
+        bool complete = false;   // 是否完整
+        bool keep_alive = false; // 连接是否可以复用
+        size_t interim = 0;      // 1xx 临时响应数
+
+        bool operator==(const Framed &) const = default;
+    };
+
+    // 把数据在 splits 指定的位置切开，依次输入分析器，记录分析出的每个响应
+    // 最后一个响应不完整时也记录已输入的字节数
+    ::std::vector<Framed> frame(const ::std::string &stream, const char *method, const ::std::vector<size_t> &splits)
+    {
+        ::std::vector<Framed> framed;
+        ::my::HttpResponseFramer framer;
+        framer.set_request_method(method);
+        size_t consumed = 0;
+        size_t begin = 0;
+        for (size_t i = 0; i <= splits.size(); ++i) {
+            size_t end = i < splits.size() ? splits[i] : stream.size();
+            while (begin < end) {
+                size_t n = framer.feed(stream.data() + begin, end - begin);
+                begin += n;
+                consumed += n;
+                if (framer.is_complete()) {
+                    framed.push_back({consumed, true, framer.is_keep_alive(), framer.interim_count()});
+                    consumed = 0;
+                    framer.reset();
+                    framer.set_request_method(method);
+                } else if (!CHECK(begin == end)) {
+                    return framed; // 响应不完整时应接受全部输入
+                }
+            }
+        }
+        if (consumed > 0) {
+            framed.push_back({consumed, false, framer.is_keep_alive(), framer.interim_count()});
+        }
+        return framed;
+    }
+
+    // 随机选取 count 个切分位置（可以重复，重复时产生空的分段）
+    ::std::vector<size_t> random_splits(::std::mt19937 &random, size_t size, size_t count)
+    {
+        ::std::uniform_int_distribution<size_t> position(0, size);
+        ::std::vector<size_t> splits(count);
+        for (size_t &split : splits) {
+            split = position(random);
+        }
+        ::std::sort(splits.begin(), splits.end());
+        return splits;
+    }
+
+    // 测试用例
+    ::std::vector<Case> make_cases()
+    {
+        const Expected next{"HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nend"}; // 跟在后面的响应，检查结束位置是否准确
+        return {
+            {"content-length", "GET", {{"HTTP/1.1 200 OK\r\nContent-Length: 10\r\nContent-Type: text/plain\r\n\r\n0123456789"}, next}},
+            {"content-length-close", "GET", {{"HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 4\r\n\r\nabcd", true, false}, next}},
+            {"http10-keep-alive", "GET", {{"HTTP/1.0 200 OK\r\nConnection: keep-alive\r\nContent-Length: 2\r\n\r\nhi"}, {"HTTP/1.0 200 OK\r\nContent-Length: 2\r\n\r\nhi", true, false}}},
+            {"chunked-trailers", "GET", {{"HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip, chunked\r\n\r\n5\r\nhello\r\n1a;name=value\r\nabcdefghijklmnopqrstuvwxyz\r\n0\r\nX-Checksum: abc\r\nX-Other: 1\r\n\r\n"}, next}},
+            {"chunked-lf", "GET", {{"HTTP/1.1 200 OK\nTransfer-Encoding: chunked\n\n3 \nabc\nA\n0123456789\n0\n\n"}, next}},
+            {"interim", "GET", {{"HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 103 Early Hints\r\nLink: </a.css>; rel=preload\r\n\r\nHTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok", true, true, 2}, next}},
+            {"no-content", "GET", {{"HTTP/1.1 204 No Content\r\nContent-Length: 50\r\n\r\n"}, next}},
+            {"not-modified", "GET", {{"HTTP/1.1 304 Not Modified\r\nETag: \"v1\"\r\nContent-Length: 1000\r\n\r\n"}, {"HTTP/1.1 304 Not Modified\r\nTransfer-Encoding: chunked\r\n\r\n"}, next}},
+            {"head", "HEAD", {{"HTTP/1.1 200 OK\r\nContent-Length: 1000\r\n\r\n"}, {"HTTP/1.1 404 Not Found\r\nTransfer-Encoding: chunked\r\n\r\n"}}},
+            {"until-close", "GET", {next, {"HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\nthe body ends when the server closes", false, false}}},
+        };
+    }
+} // namespace
+
+// 每个用例先一次输入全部数据，再逐字节输入，最后以随机切分输入多次，分析结果都应与预期相同
+int main()
+{
+    constexpr int ROUNDS = 2000; // 每个用例的随机切分次数
+    ::std::mt19937 random(20240601);
+
+    for (const Case &test_case : make_cases()) {
+        ::std::string stream;
+        ::std::vector<Framed> expected;
+        for (const Expected &response : test_case.responses) {
+            stream += response.text;
+            expected.push_back({response.text.size(), response.complete, response.keep_alive, response.interim});
+        }
+
+        try {
+            if (!CHECK(frame(stream, test_case.method, {}) == expected)) {
+                ::std::fprintf(stderr, "  case %s: whole input\n", test_case.name);
+            }
+            ::std::vector<size_t> bytes(stream.size());
+            for (size_t i = 0; i < bytes.size(); ++i) {
+                bytes[i] = i;
+            }
+            if (!CHECK(frame(stream, test_case.method, bytes) == expected)) {
+                ::std::fprintf(stderr, "  case %s: byte by byte\n", test_case.name);
+            }
+            for (int round = 0; round < ROUNDS; ++round) {
+                ::std::vector<size_t> splits = random_splits(random, stream.size(), 1 + round % 8);
+                if (!CHECK(frame(stream, test_case.method, splits) == expected)) {
+                    ::std::fprintf(stderr, "  case %s: round %d\n", test_case.name, round);
+                    break;
+                }
+            }
+        } catch (const ::std::exception &e) {
+            CHECK(false);
+            ::std::fprintf(stderr, "  case %s: %s\n", test_case.name, e.what());
+        }
+    }
+    return ::my::test::check_result("HttpResponseFramer_test");
+}
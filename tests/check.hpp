@@ -0,0 +1,42 @@
+#ifndef _CHECK_H_INCLUDED_
+#define _CHECK_H_INCLUDED_
+
+#include <cstdio>
+
+namespace my
+{
+    // 测试程序共用的检查函数：检查失败时输出位置和表达式并计数，不中止测试，最后由 check_result 给出退出码
+    namespace test
+    {
+        inline int failures = 0; // 失败的检查数
+
+        // 检查条件，不成立时输出失败的位置和表达式
+        // 返回值: 条件是否成立
+        inline bool check(bool ok, const char *expr, const char *file, int line)
+        {
+            if (!ok) {
+                ++failures;
+                ::std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+            }
+            return ok;
+        }
+
+        // 输出测试结果
+        // 返回值: 进程的退出码，有失败的检查时为 1
+        inline int check_result(const char *name)
+        {
+            if (failures != 0) {
+                ::std::fprintf(stderr, "%s: %d check(s) failed\n", name, failures);
+                return 1;
+            }
+            ::std::printf("%s: all checks passed\n", name);
+            return 0;
+        }
+    } // namespace test
+
+} // namespace my
+
+// 检查表达式是否成立
+#define CHECK(expr) ::my::test::check(static_cast<bool>(expr), #expr, __FILE__, __LINE__)
+
+#endif // _CHECK_H_INCLUDED_